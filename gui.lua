@@ -12,9 +12,62 @@ local background_color_props = {
     color = { 0.05, 0.05, 0.08, 1.0 } -- Deep dark blue
 }
 
+-- Atlas images for the sprite stress test, generated on first use
+local sprite_images = nil
+
+-- A soft-edged disc as an RGBA string, for App.CreateImage
+local function make_disc_image(size, r, g, b)
+    local bytes = {}
+    local center = (size - 1) / 2
+    for y = 0, size - 1 do
+        for x = 0, size - 1 do
+            local distance = math.sqrt((x - center) ^ 2 + (y - center) ^ 2) / center
+            local alpha = math.max(0, math.min(1, (1 - distance) * 4))
+            local shade = 1 - 0.4 * distance
+            bytes[#bytes + 1] = string.char(math.floor(r * shade * 255), math.floor(g * shade * 255),
+                math.floor(b * shade * 255), math.floor(alpha * 255))
+        end
+    end
+    return table.concat(bytes)
+end
+
+-- Streaming plot demo: samples are appended a chunk per frame
+local plot = { id = nil, target = 1000000, chunk = 50000, follow = false, behind = false }
+
+local function stream_plot_samples()
+    local info = App.GetPolylineInfo(plot.id)
+    if info.samples >= plot.target then
+        return
+    end
+    local samples = {}
+    for i = 1, plot.chunk do
+        local t = (info.samples + i) * 0.0005
+        samples[i] = math.sin(t) + 0.3 * math.sin(t * 17.0) + (math.random() - 0.5) * 0.4
+    end
+    App.AppendPolyline(plot.id, samples)
+end
+
+-- Particle demo: one emitter, simulated and drawn entirely in C++
+local fountain = { id = nil, rate = 100000 }
+-- The same on the GPU: emission, forces and lifetimes in transform feedback
+local gpuFountain = { id = nil, rate = 1000000 }
+
+-- Scene text demo: labels pinned to shapes, every glyph in one draw call
+local labels = { font = nil, ids = {}, size = 12 }
+
+local function load_label_font()
+    -- The build links imgui's fonts next to the executable; the second path
+    -- covers running from the source tree
+    return App.LoadFont("fonts/Roboto-Medium.ttf") or App.LoadFont("deps/imgui/misc/fonts/Roboto-Medium.ttf")
+end
+
+-- Grouped shapes demo: one group node carries every attached shape
+local swarm = { id = nil, rotation = 0, scale = 1 }
+
 -- Animation and visual state
 local animation_time = 0
 local pulse_intensity = 0
+local pulse_header = true -- An animation: keeps frames coming while on
 
 -- Color presets for quick selection
 local color_presets = {
@@ -115,8 +168,11 @@ UpdateCppBackgroundColor()
 
 function draw_gui()
     -- Update animation time
-    animation_time = animation_time + 0.016                    -- Assume ~60fps
-    pulse_intensity = (math.sin(animation_time * 2) + 1) * 0.5 -- 0 to 1
+    if pulse_header then
+        animation_time = animation_time + App.GetDeltaTime()       -- Real frame time
+        pulse_intensity = (math.sin(animation_time * 2) + 1) * 0.5 -- 0 to 1
+        App.RequestRedraw() -- Counts as activity for on-demand rendering
+    end
 
     PushStyleColors()
     PushStyleVars()
@@ -283,6 +339,271 @@ function draw_gui()
             ImGui.PopStyleColor(2)
 
             ImGui.Spacing()
+
+            App.BeginGpuScope("Quick Actions")
+            -- Batch stress test: every spawned shape shares one instanced draw call
+            if ImGui.Button("Spawn 10k Shapes", -1, 40) then
+                local width, height = App.GetWindowSize()
+                for _ = 1, 10000 do
+                    App.AddShape(math.random() * width, math.random() * height, 4 + math.random() * 12,
+                        math.random(), math.random(), math.random(), 1.0)
+                end
+            end
+            -- Sprites sample the texture atlas but stay in the same draw call
+            if ImGui.Button("Spawn 1k Sprites", -1, 40) then
+                if not sprite_images then
+                    sprite_images = {}
+                    for i, preset in ipairs(color_presets) do
+                        local c = preset.color
+                        sprite_images[i] = App.CreateImage(32, 32, make_disc_image(32, c[1], c[2], c[3]))
+                    end
+                end
+                local width, height = App.GetWindowSize()
+                for _ = 1, 1000 do
+                    local image = sprite_images[math.random(#sprite_images)]
+                    local size = 12 + math.random() * 28
+                    App.AddSprite(image, math.random() * width, math.random() * height, size, size)
+                end
+            end
+            -- SDF primitives: circles, rounded rects, rings, lines and triangles, still one draw
+            if ImGui.Button("Spawn 1k SDF Shapes", -1, 40) then
+                local width, height = App.GetWindowSize()
+                for i = 1, 1000 do
+                    local x, y = math.random() * width, math.random() * height
+                    local s = 8 + math.random() * 24
+                    local r, g, b = math.random(), math.random(), math.random()
+                    local kind = i % 5
+                    if kind == 0 then
+                        App.AddCircle(x, y, s * 0.5, r, g, b, 1.0)
+                    elseif kind == 1 then
+                        App.AddRoundedRect(x, y, s * 1.5, s, s * 0.25, r, g, b, 1.0)
+                    elseif kind == 2 then
+                        App.AddRing(x, y, s * 0.5, 3, r, g, b, 1.0)
+                    elseif kind == 3 then
+                        App.AddLine(x, y, x + (math.random() - 0.5) * 4 * s, y + (math.random() - 0.5) * 4 * s, 3,
+                            r, g, b, 1.0)
+                    else
+                        App.AddTriangle(x, y, x + s, y, x + s * 0.5, y - s, r, g, b, 1.0)
+                    end
+                end
+            end
+            -- Tweens: started once from Lua, then eased in C++ every frame in one SIMD pass
+            if ImGui.Button("Spawn 2k Tweened Shapes", -1, 40) then
+                local width, height = App.GetWindowSize()
+                local easings = { "linear", "easeInOut", "backOut", "backInOut" }
+                for i = 1, 2000 do
+                    local x, y = math.random() * width, math.random() * height
+                    local shape = App.AddShape(x, y, 6 + math.random() * 10, math.random(), math.random(), 1.0, 1.0)
+                    App.Tween(shape, "position", { x + (math.random() - 0.5) * 300, y + (math.random() - 0.5) * 300 },
+                        1 + math.random() * 2, easings[i % #easings + 1], "pingpong", math.random())
+                    App.Animate(shape, "color", { { 0, 1.0, 0.3, 0.3 }, { 1, 0.3, 1.0, 0.3 }, { 2, 0.3, 0.3, 1.0 },
+                        { 3, 1.0, 0.3, 0.3 } }, "easeInOut", "repeat", math.random() * 3)
+                end
+            end
+            ImGui.Text("Active tweens: " .. App.GetTweenCount())
+            -- Transform hierarchy: turning or scaling the group is one call and one partial update
+            if not swarm.id then
+                if ImGui.Button("Spawn 10k Grouped Shapes", -1, 40) then
+                    local width, height = App.GetWindowSize()
+                    local cx, cy = width * 0.5, height * 0.5
+                    swarm.id = App.CreateGroup(cx, cy)
+                    for _ = 1, 10000 do
+                        local angle, radius = math.random() * 2 * math.pi, math.random() * 250
+                        local shape = App.AddShape(cx + math.cos(angle) * radius, cy + math.sin(angle) * radius,
+                            4 + math.random() * 8, math.random(), math.random(), math.random(), 1.0)
+                        App.AttachShape(shape, swarm.id)
+                    end
+                end
+            else
+                local rotation_changed, rotation = ImGui.SliderFloat("Group rotation", swarm.rotation, -math.pi, math.pi,
+                    "%.2f rad")
+                local scale_changed, scale = ImGui.SliderFloat("Group scale", swarm.scale, 0.25, 2.0, "%.2f")
+                if rotation_changed or scale_changed then
+                    swarm.rotation, swarm.scale = rotation, scale
+                    local x, y = App.GetGroupTransform(swarm.id)
+                    App.SetGroupTransform(swarm.id, x, y, swarm.rotation, swarm.scale)
+                end
+                local transforms = App.GetTransformStats()
+                ImGui.Text(string.format("Transforms: %d nodes, %d recomputed", transforms.nodes, transforms.updated))
+                if ImGui.Button("Ungroup", -1, 0) then
+                    App.RemoveGroup(swarm.id) -- The shapes stay where they are
+                    swarm.id, swarm.rotation, swarm.scale = nil, 0, 1
+                end
+            end
+            -- Particles: SIMD integration on worker threads, one instanced draw per emitter
+            if not fountain.id then
+                if ImGui.Button("Start Particle Fountain", -1, 40) then
+                    local width, height = App.GetWindowSize()
+                    fountain.id = App.CreateEmitter(width * 0.5, height - 40, {
+                        rate = fountain.rate, maxParticles = 1000000, lifetimeMin = 1.5, lifetimeMax = 2.5,
+                        speedMin = 200, speedMax = 450, spread = 0.6, gravityY = 300, drag = 0.2,
+                        startColor = { 0.3, 0.7, 1.0, 0.8 }, endColor = { 1.0, 0.3, 0.6, 0.0 },
+                        startSize = 4, endSize = 1.5 })
+                end
+            else
+                local rate_changed, rate = ImGui.SliderFloat("Particles/s", fountain.rate, 0, 500000, "%.0f")
+                if rate_changed then
+                    fountain.rate = rate
+                    App.SetEmitter(fountain.id, { rate = rate })
+                end
+                if ImGui.Button("Burst 50k", -1, 0) then
+                    App.BurstEmitter(fountain.id, 50000)
+                end
+                local particles = App.GetParticleStats()
+                ImGui.Text(string.format("Particles: %d, %.2f ms on %d threads x %d lanes", particles.particles,
+                    particles.updateMs, particles.threads, particles.lanes))
+                if ImGui.Button("Stop Fountain", -1, 0) then
+                    App.RemoveEmitter(fountain.id)
+                    fountain.id = nil
+                end
+            end
+            if not gpuFountain.id then
+                if ImGui.Button("Start GPU Particle Fountain", -1, 40) then
+                    local width, height = App.GetWindowSize()
+                    gpuFountain.id = App.CreateGpuEmitter(width * 0.5, height - 40, {
+                        rate = gpuFountain.rate, maxParticles = 4000000, lifetimeMin = 1.5, lifetimeMax = 2.5,
+                        speedMin = 200, speedMax = 450, spread = 0.6, gravityY = 300, drag = 0.2,
+                        startColor = { 1.0, 0.6, 0.2, 0.5 }, endColor = { 0.6, 0.1, 1.0, 0.0 },
+                        startSize = 3, endSize = 1 })
+                end
+            else
+                local rate_changed, rate = ImGui.SliderFloat("GPU Particles/s", gpuFountain.rate, 0, 2000000, "%.0f")
+                if rate_changed then
+                    gpuFountain.rate = rate
+                    App.SetGpuEmitter(gpuFountain.id, { rate = rate })
+                end
+                if ImGui.Button("GPU Burst 500k", -1, 0) then
+                    App.BurstGpuEmitter(gpuFountain.id, 500000)
+                end
+                local gpu = App.GetGpuParticleStats()
+                ImGui.Text(string.format("GPU particle slots: %d", gpu.capacity))
+                if ImGui.Button("Stop GPU Fountain", -1, 0) then
+                    App.RemoveGpuEmitter(gpuFountain.id)
+                    gpuFountain.id = nil
+                end
+            end
+            -- Scene text: glyphs baked once as distance fields, each distinct string laid out once
+            if #labels.ids == 0 then
+                if ImGui.Button("Spawn 1k Labeled Shapes", -1, 40) then
+                    labels.font = labels.font or load_label_font()
+                    if labels.font then
+                        local width, height = App.GetWindowSize()
+                        for i = 1, 1000 do
+                            local shape = App.AddShape(math.random() * width, math.random() * height, 8,
+                                math.random(), math.random(), math.random(), 1.0)
+                            labels.ids[i] = App.AddLabel("#" .. (i % 100), labels.font, 0, -10, {
+                                size = labels.size, alignX = 0.5, alignY = 1, anchor = shape })
+                        end
+                    end
+                end
+            else
+                local size_changed, size = ImGui.SliderFloat("Label size", labels.size, 6, 96, "%.0f")
+                if size_changed then
+                    labels.size = size
+                    for _, id in ipairs(labels.ids) do
+                        App.SetLabel(id, { size = size })
+                    end
+                end
+                local text = App.GetTextStats()
+                ImGui.Text(string.format("Labels: %d, %d glyphs in one draw, %d layouts, %d glyphs baked", text.labels,
+                    text.glyphs, text.layouts, text.bakedGlyphs))
+                if ImGui.Button("Clear Labels", -1, 0) then
+                    App.ClearLabels()
+                    labels.ids = {}
+                end
+            end
+            -- Time series: a min/max pyramid keeps 1M samples at about one bucket per pixel
+            if not plot.id then
+                if ImGui.Button("Plot 1M Samples", -1, 40) then
+                    local width, height = App.GetWindowSize()
+                    plot.id = App.AddPolyline(20, height - 220, width - 40, 200, 0.3, 0.9, 0.6, 1.0)
+                end
+            else
+                stream_plot_samples()
+                local info = App.GetPolylineInfo(plot.id)
+                ImGui.Text(string.format("Plot: %d samples, drawing level %d of %d", info.samples, info.level,
+                    info.levels - 1))
+                local follow_changed, follow = ImGui.Checkbox("Follow last 20k samples", plot.follow)
+                if follow_changed then
+                    plot.follow = follow
+                    if follow then App.SetPolylineView(plot.id, -1, 20000) else App.SetPolylineView(plot.id) end
+                end
+                local behind_changed, behind = ImGui.Checkbox("Plot behind shapes", plot.behind)
+                if behind_changed then
+                    plot.behind = behind
+                    App.SetPolylineLayer(plot.id, behind and 0 or 128)
+                end
+                if ImGui.Button("Remove Plot", -1, 0) then
+                    App.RemovePolyline(plot.id)
+                    plot.id = nil
+                    plot.behind = false
+                end
+            end
+            if ImGui.Button("Clear Shapes", -1, 40) then
+                App.ClearShapes()
+                if swarm.id then
+                    App.RemoveGroup(swarm.id)
+                    swarm.id, swarm.rotation, swarm.scale = nil, 0, 1
+                end
+            end
+            ImGui.Text("Batched shapes: " .. App.GetShapeCount())
+            local stats = App.GetRenderStats()
+            ImGui.Text("GL state calls: " .. stats.issued .. " issued, " .. stats.skipped .. " skipped")
+            local draws = App.GetDrawStats()
+            ImGui.Text("Scene draws: " .. draws.draws .. ", state changes: " .. draws.stateChanges ..
+                " (" .. draws.unsortedStateChanges .. " unsorted)")
+            local draw_stats_changed, show_draw_stats = ImGui.Checkbox("Draw stats (F4)", App.IsDrawStatsVisible())
+            if draw_stats_changed then
+                App.ShowDrawStats(show_draw_stats)
+            end
+            local memory = App.GetMemoryStats()
+            ImGui.Text(string.format("GPU memory: %.1f MB, %d shared buffers, %d shared programs",
+                (memory.geometry + memory.programs + memory.textures + memory.buffers) / (1024 * 1024),
+                memory.sharedBuffers, memory.sharedPrograms))
+            local memory_changed, show_memory = ImGui.Checkbox("GPU memory (F7)", App.IsMemoryStatsVisible())
+            if memory_changed then
+                App.ShowMemoryStats(show_memory)
+            end
+
+            -- Idle: only redraw on input or changes; the header pulse is a
+            -- running animation, so it has to be off for frames to stop
+            local changed, on_demand = ImGui.Checkbox("Render only on changes", App.IsOnDemandRendering())
+            if changed then
+                App.SetOnDemandRendering(on_demand)
+            end
+            _, pulse_header = ImGui.Checkbox("Pulse header", pulse_header)
+
+            -- Frame pacing: power vs latency
+            local frame = App.GetFrameStats()
+            if ImGui.RadioButton("Uncapped", frame.mode == "uncapped") then App.SetFrameLimit("uncapped") end
+            ImGui.SameLine()
+            if ImGui.RadioButton("VSync", frame.mode == "vsync") then App.SetFrameLimit("vsync") end
+            ImGui.SameLine()
+            if ImGui.RadioButton("Adaptive", frame.mode == "adaptive") then App.SetFrameLimit("adaptive") end
+            ImGui.SameLine()
+            if ImGui.RadioButton("60 FPS", frame.mode == "limited") then App.SetFrameLimit(60) end
+            ImGui.Text(string.format("Frame %.2f ms, jitter %.2f ms, worst %.2f ms",
+                frame.averageMs, frame.jitterMs, frame.worstMs))
+
+            -- GPU pass timings; this section shows up as its own scope
+            local profiler_changed, show_profiler = ImGui.Checkbox("GPU profiler (F3)", App.IsGpuProfilerVisible())
+            if profiler_changed then
+                App.ShowGpuProfiler(show_profiler)
+            end
+            App.EndGpuScope()
+
+            -- Capture: read back asynchronously, written on a worker thread
+            if ImGui.Button("Screenshot") then App.Screenshot("screenshot.png") end
+            ImGui.SameLine()
+            local capture = App.GetCaptureStats()
+            if capture.recording then
+                if ImGui.Button("Stop Recording") then App.StopRecording() end
+            elseif ImGui.Button("Record capture.y4m") then
+                App.StartRecording("capture.y4m", 60)
+            end
+            ImGui.Text("Captured " .. capture.captured .. ", written " .. capture.written .. ", dropped " .. capture.dropped)
+
+            ImGui.Spacing()
         end
 
         -- Info footer
@@ -1,56 +1,207 @@
 #include "Application.h"
+#include "GLState.h"
 #include "LuaEngine.h"
-#include "SquareRenderer.h"
+#include "ShapeBatchRenderer.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
 #include <gtc/matrix_transform.hpp>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
-#include <imgui_impl_opengl3.h>
 #include <iostream>
 
-// Define static shader sources
-const char *Application::s_vertexShaderSource = R"(
-    #version 410 core
-    layout (location = 0) in vec2 aPos; 
+namespace {
+// prefix_YYYYmmdd_HHMMSS.extension, for captures started from the keyboard
+std::string TimestampedPath(const char *prefix, const char *extension) {
+  std::time_t now = std::time(nullptr);
+  char stamp[32];
+  std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+  return std::string(prefix) + "_" + stamp + "." + extension;
+}
+
+// A group scaled to zero on an axis: nothing maps back out of it, so the
+// local transforms of its children can't be solved for
+bool IsCollapsed(const Transform2D &world) {
+  return world.scale.x == 0.0f || world.scale.y == 0.0f;
+}
 
-    uniform mat4 projection;
-    uniform vec2 u_position; 
-    uniform float u_size;    
+// An offset within a box of the given size as a share of it, for ShapeParams;
+// 0 along a flat side
+glm::vec2 ToBoxUnits(const glm::vec2 &offset, const glm::vec2 &size) {
+  return {size.x > 0.0f ? offset.x / size.x : 0.0f,
+          size.y > 0.0f ? offset.y / size.y : 0.0f};
+}
+} // namespace
+
+// Define static shader sources. Every shape attribute is per-instance and
+// comes straight from the ShapeStore columns; u_projection is provided by the
+// FrameGlobals block that Shader injects. The kind in the flags picks the
+// primitive: plain rects fill the quad, everything else is a signed distance
+// field evaluated per pixel, with the quad padded by a unit so the
+// anti-aliased edge isn't clipped. Rotation turns the quad about the shape's
+// position; vLocal stays unrotated, so the fields don't change. Textured
+// shapes (sprites) modulate their color with a region of the atlas array
+// texture.
+const char *Application::s_batchVertexShaderSource = R"(
+    #version 410 core
+    layout (location = 0) in vec2 aPos;
+    layout (location = 1) in vec2 iPosition;
+    layout (location = 2) in vec2 iSize;
+    layout (location = 3) in vec4 iColor;
+    layout (location = 4) in uint iFlags;
+    layout (location = 5) in vec4 iUVRect;
+    layout (location = 6) in uint iLayer;
+    layout (location = 7) in vec4 iParamsA;
+    layout (location = 8) in vec4 iParamsB;
+    layout (location = 9) in float iRotation;
+
+    out vec4 vColor;
+    out vec2 vUV;
+    out vec2 vLocal; // Relative to the shape's position, in window units
+    flat out uint vLayer;
+    flat out uint vFlags;
+    flat out vec2 vSize;
+    flat out vec4 vParamsA;
+    flat out vec4 vParamsB;
 
     void main() {
-        vec2 worldPos = aPos * u_size + u_position;
-        gl_Position = projection * vec4(worldPos, 0.0, 1.0);
+        uint kind = (iFlags >> 8u) & 0xFFu;
+        vec2 pad = kind == 0u ? vec2(0.0) : vec2(1.0);
+        vLocal = aPos * (iSize + 2.0 * pad) - pad;
+        vUV = mix(iUVRect.xy, iUVRect.zw,
+                  clamp(vLocal / max(iSize, vec2(1e-5)), 0.0, 1.0));
+        vLayer = iLayer;
+        vFlags = iFlags;
+        vSize = iSize;
+        vParamsA = iParamsA;
+        vParamsB = iParamsB;
+        if ((iFlags & 1u) == 0u) {
+            gl_Position = vec4(2.0, 2.0, 2.0, 1.0); // Hidden: outside clip space
+            vColor = vec4(0.0);
+            return;
+        }
+        float c = cos(iRotation);
+        float s = sin(iRotation);
+        vec2 worldPos = iPosition + mat2(c, s, -s, c) * vLocal;
+        gl_Position = u_projection * vec4(worldPos, 0.0, 1.0);
+        vColor = iColor;
     }
 )";
 
-const char *Application::s_fragmentShaderSource = R"(
+const char *Application::s_batchFragmentShaderSource = R"(
     #version 410 core
+    in vec4 vColor;
+    in vec2 vUV;
+    in vec2 vLocal;
+    flat in uint vLayer;
+    flat in uint vFlags;
+    flat in vec2 vSize;
+    flat in vec4 vParamsA;
+    flat in vec4 vParamsB;
+    uniform sampler2DArray u_atlas;
     out vec4 FragColor;
-    uniform vec4 u_color; // Changed to vec4 for RGBA
+
+    float sdRoundedBox(vec2 p, vec2 halfSize, float radius) {
+        radius = min(radius, min(halfSize.x, halfSize.y));
+        vec2 q = abs(p) - halfSize + radius;
+        return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+    }
+
+    float sdSegment(vec2 p, vec2 a, vec2 b) {
+        vec2 pa = p - a;
+        vec2 ba = b - a;
+        float h = clamp(dot(pa, ba) / max(dot(ba, ba), 1e-8), 0.0, 1.0);
+        return length(pa - ba * h);
+    }
+
+    float sdTriangle(vec2 p, vec2 p0, vec2 p1, vec2 p2) {
+        vec2 e0 = p1 - p0, e1 = p2 - p1, e2 = p0 - p2;
+        vec2 v0 = p - p0, v1 = p - p1, v2 = p - p2;
+        vec2 pq0 = v0 - e0 * clamp(dot(v0, e0) / max(dot(e0, e0), 1e-8),
+                                   0.0, 1.0);
+        vec2 pq1 = v1 - e1 * clamp(dot(v1, e1) / max(dot(e1, e1), 1e-8),
+                                   0.0, 1.0);
+        vec2 pq2 = v2 - e2 * clamp(dot(v2, e2) / max(dot(e2, e2), 1e-8),
+                                   0.0, 1.0);
+        // Not sign(): a flat triangle would zero every side test
+        float s = e0.x * e2.y - e0.y * e2.x < 0.0 ? -1.0 : 1.0;
+        vec2 d = min(min(vec2(dot(pq0, pq0), s * (v0.x * e0.y - v0.y * e0.x)),
+                         vec2(dot(pq1, pq1), s * (v1.x * e1.y - v1.y * e1.x))),
+                     vec2(dot(pq2, pq2), s * (v2.x * e2.y - v2.y * e2.x)));
+        return -sqrt(d.x) * sign(d.y);
+    }
+
+    // Signed distance to the shape's edge in window units, negative inside
+    float ShapeDistance(uint kind) {
+        vec2 center = vSize * 0.5;
+        float radius = min(vSize.x, vSize.y) * 0.5;
+        if (kind == 1u) { // Circle
+            return length(vLocal - center) - radius;
+        } else if (kind == 2u) { // Rounded rect
+            return sdRoundedBox(vLocal - center, center, vParamsA.x);
+        } else if (kind == 3u) { // Ring
+            float halfThickness = min(vParamsA.x, radius) * 0.5;
+            return abs(length(vLocal - center) - radius + halfThickness) -
+                   halfThickness;
+        } else if (kind == 4u) { // Capsule line, in box units
+            return sdSegment(vLocal, vParamsA.xy * vSize, vParamsA.zw * vSize) -
+                   vParamsB.x * min(vSize.x, vSize.y);
+        } else if (kind == 5u) { // Triangle, in box units
+            return sdTriangle(vLocal, vParamsA.xy * vSize, vParamsA.zw * vSize,
+                              vParamsB.xy * vSize);
+        }
+        return -1.0;
+    }
 
     void main() {
-        FragColor = u_color;
+        FragColor = vColor;
+        // Sampled before any discard, which would leave derivatives undefined
+        if ((vFlags & 4u) != 0u) {
+            FragColor *= texture(u_atlas, vec3(vUV, float(vLayer)));
+        }
+        uint kind = (vFlags >> 8u) & 0xFFu;
+        if (kind != 0u) {
+            // fwidth keeps the edge one pixel wide at any scale or DPI
+            float d = ShapeDistance(kind);
+            float coverage = clamp(0.5 - d / max(fwidth(d), 1e-4), 0.0, 1.0);
+            if (coverage <= 0.0) {
+                discard;
+            }
+            FragColor.a *= coverage;
+        }
     }
 )";
 
-Application::Application()
+Application::Application(ApplicationOptions options)
     : m_window(nullptr), m_luaEngine(nullptr), m_isRunning(false),
       m_lastTime(0.0), m_frameCount(0), m_fpsTimeAccumulator(0.0),
-      m_fpsFrameCountAccumulator(0) // Initialize FPS members
-{}
+      m_fpsFrameCountAccumulator(0), // Initialize FPS members
+      m_options(std::move(options)) {}
 
 Application::~Application() { Shutdown(); }
 
 bool Application::Initialize() {
+  using Clock = std::chrono::steady_clock;
+  auto startTime = Clock::now();
   try {
     InitializeGLFW();
     if (gladLoadGLLoader((GLADloadproc)glfwGetProcAddress) == 0) {
       throw std::runtime_error("Failed to initialize GLAD");
     }
     InitializeImGui();
-    InitializeRenderables(); // Initialize renderables (shader, square)
+
+    auto shaderStartTime = Clock::now();
+    m_programCache.Initialize();
+    if (!m_frameGlobals.Initialize()) {
+      throw std::runtime_error("Failed to create frame globals buffer");
+    }
+    m_gpuProfiler.Initialize(); // Optional; the overlay says if unsupported
+    InitializeRenderables(); // Initialize renderables (shader, shape batch)
+    std::chrono::duration<double, std::milli> shaderTime =
+        Clock::now() - shaderStartTime;
 
     m_luaEngine = std::make_unique<LuaEngine>();
-    if (!m_luaEngine->Initialize(this)) {
+    if (!m_luaEngine->Initialize(this, m_options.scriptPath)) {
       std::cerr << "Failed to initialize Lua engine\n";
       CleanupRenderables();
       return false;
@@ -58,6 +209,21 @@ bool Application::Initialize() {
 
     m_lastTime = glfwGetTime();
 
+    // From here on all GL work happens in SubmitFrame (on the render thread
+    // when threaded)
+    m_renderThread.Start(
+        m_window, [this](FramePacket &packet) { SubmitFrame(packet); },
+        m_options.threadedRendering);
+
+    // Cold start report, to compare runs with and without a warm cache
+    std::chrono::duration<double, std::milli> totalTime =
+        Clock::now() - startTime;
+    std::cout << "Startup: " << totalTime.count() << " ms total, "
+              << shaderTime.count() << " ms shaders (program cache: "
+              << m_programCache.GetHits() << " hits, "
+              << m_programCache.GetMisses() << " misses, "
+              << m_programCache.GetRejected() << " rejected)\n";
+
     m_isRunning = true;
     return true;
   } catch (const std::exception &e) {
@@ -93,6 +259,9 @@ void Application::UpdateWindowTitleWithFPS() {
 void Application::InitializeGLFW() {
   glfwSetErrorCallback(ErrorCallback);
 
+  if (m_options.headless) {
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  }
   if (glfwInit() == 0) {
     throw std::runtime_error("Failed to initialize GLFW");
   }
@@ -105,19 +274,132 @@ void Application::InitializeGLFW() {
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-  m_window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT,
-                              "Minimal ImGui + Lua App", nullptr, nullptr);
+  if (m_options.headless) {
+    m_window = CreateHeadlessWindow();
+  } else {
+    m_window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT,
+                                "Minimal ImGui + Lua App", nullptr, nullptr);
+  }
   if (m_window == nullptr) {
     glfwTerminate();
     throw std::runtime_error("Failed to create GLFW window");
   }
 
   glfwMakeContextCurrent(m_window);
-  glfwSwapInterval(0); // VSync
+  m_framePacer.Initialize();
+  if (m_options.headless) {
+    // Nothing to wait for: no input, no display to sync to
+    m_onDemandRendering = false;
+    m_framePacer.SetMode(FramePacingMode::Uncapped);
+  }
+  m_appliedSwapInterval = m_framePacer.GetSwapInterval();
+  glfwSwapInterval(m_appliedSwapInterval);
 
   // Set up keyboard callback for live reload
   glfwSetWindowUserPointer(m_window, this);
   glfwSetKeyCallback(m_window, KeyCallback);
+
+  // Any input wakes the on-demand loop. Installed before the ImGui backend,
+  // which chains to them.
+  glfwSetCursorPosCallback(m_window, [](GLFWwindow *window, double, double) {
+    RequestRedrawForWindow(window);
+  });
+  glfwSetMouseButtonCallback(m_window, [](GLFWwindow *window, int, int, int) {
+    RequestRedrawForWindow(window);
+  });
+  glfwSetScrollCallback(m_window, [](GLFWwindow *window, double, double) {
+    RequestRedrawForWindow(window);
+  });
+  glfwSetCharCallback(m_window, [](GLFWwindow *window, unsigned int) {
+    RequestRedrawForWindow(window);
+  });
+  glfwSetCursorEnterCallback(m_window, [](GLFWwindow *window, int) {
+    RequestRedrawForWindow(window);
+  });
+  glfwSetWindowFocusCallback(m_window, [](GLFWwindow *window, int) {
+    RequestRedrawForWindow(window);
+  });
+  glfwSetWindowRefreshCallback(m_window, RequestRedrawForWindow);
+
+  // Sizes are queried once here and then only change through callbacks, so
+  // nothing per frame has to ask GLFW
+  int width = 0;
+  int height = 0;
+  glfwGetWindowSize(m_window, &width, &height);
+  OnWindowSize(width, height);
+  glfwGetFramebufferSize(m_window, &width, &height);
+  OnFramebufferSize(width, height);
+  float scale = 1.0f;
+  glfwGetWindowContentScale(m_window, &scale, nullptr);
+  OnContentScale(scale);
+
+  glfwSetWindowSizeCallback(m_window, [](GLFWwindow *window, int w, int h) {
+    static_cast<Application *>(glfwGetWindowUserPointer(window))
+        ->OnWindowSize(w, h);
+  });
+  glfwSetFramebufferSizeCallback(
+      m_window, [](GLFWwindow *window, int w, int h) {
+        static_cast<Application *>(glfwGetWindowUserPointer(window))
+            ->OnFramebufferSize(w, h);
+      });
+  glfwSetWindowContentScaleCallback(
+      m_window, [](GLFWwindow *window, float xScale, float) {
+        static_cast<Application *>(glfwGetWindowUserPointer(window))
+            ->OnContentScale(xScale);
+      });
+}
+
+void Application::OnWindowSize(int width, int height) {
+  if (width <= 0 || height <= 0) {
+    return; // Minimized; keep the last usable projection
+  }
+  if (glm::ivec2(width, height) != m_windowSize) {
+    m_windowSize = {width, height};
+    UpdateProjection();
+  }
+  RequestRedraw();
+}
+
+void Application::OnFramebufferSize(int width, int height) {
+  m_framebufferSize = {width, height};
+  RequestRedraw();
+}
+
+void Application::OnContentScale(float scale) {
+  m_contentScale = scale;
+  RequestRedraw();
+}
+
+// Screen coordinates, Y down, matching ImGui's mouse positions; the
+// viewport maps them to framebuffer pixels
+void Application::UpdateProjection() {
+  m_projectionMatrix =
+      glm::ortho(0.0f, static_cast<float>(m_windowSize.x),
+                 static_cast<float>(m_windowSize.y), 0.0f, -1.0f, 1.0f);
+}
+
+// The null platform has no window system, so the context comes from EGL
+// (surfaceless, e.g. llvmpipe) or, failing that, OSMesa. Neither gives a
+// usable default framebuffer; frames go to an FBO (CreateOffscreenTarget).
+GLFWwindow *Application::CreateHeadlessWindow() {
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+  GLFWwindow *window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT,
+                                        "Headless", nullptr, nullptr);
+  if (window != nullptr) {
+    std::cout << "Headless: EGL context\n";
+    return window;
+  }
+
+  std::cout << "Headless: EGL unavailable, trying OSMesa\n";
+  glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+  window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Headless", nullptr,
+                            nullptr);
+  if (window != nullptr) {
+    std::cout << "Headless: OSMesa context\n";
+  }
+  return window;
 }
 
 void Application::InitializeImGui() {
@@ -129,136 +411,273 @@ void Application::InitializeImGui() {
   ImGui::StyleColorsDark();
 
   ImGui_ImplGlfw_InitForOpenGL(m_window, true);
-  ImGui_ImplOpenGL3_Init("#version 410 core");
+  // The renderer side (UiRenderer) needs the program cache, see
+  // InitializeRenderables
 }
 
 void Application::InitializeRenderables() {
-  // Create and compile the shader
-  // Pass true for the third argument as we are providing source code directly
-  m_simpleShapeShader =
-      Shader(s_vertexShaderSource, s_fragmentShaderSource, true);
-  if (m_simpleShapeShader.ID == 0) {
-    throw std::runtime_error("Failed to create simple shape shader program");
-  }
-
-  // Create and initialize the square
-  m_mainSquare = std::make_unique<SquareRenderer>();
-  if (!m_mainSquare->Initialize(
-          &m_simpleShapeShader)) { // Pass pointer to the shader
-    throw std::runtime_error("Failed to initialize main square renderer");
-  }
-  // Set initial properties (could also be done via Lua after init)
-  m_mainSquare->SetPosition(150.0f, 150.0f);
-  m_mainSquare->SetSize(50.0f);
-  m_mainSquare->SetColor(1.0f, 0.0f, 0.0f, 1.0f); // Red, fully opaque
-
-  // Setup projection matrix (do this once or on window resize)
-  float L = 0.0f;
-  float R = static_cast<float>(WINDOW_WIDTH);
-  float B = static_cast<float>(WINDOW_HEIGHT); // Y positive down
-  float T = 0.0f;                              // Y positive down
-  // Using GLM for ortho projection
-  m_projectionMatrix = glm::ortho(L, R, B, T, -1.0f, 1.0f);
-  // If not using GLM, you can use the raw array as before:
-  // const float ortho_projection_raw[4][4] = {
-  //     { 2.0f/(R-L),   0.0f,         0.0f,   0.0f },
-  //     { 0.0f,         2.0f/(T-B),   0.0f,   0.0f },
-  //     { 0.0f,         0.0f,        -1.0f,   0.0f },
-  //     { (R+L)/(L-R),  (T+B)/(B-T),  0.0f,   1.0f },
-  // };
-  // m_projectionMatrix = glm::make_mat4(&ortho_projection_raw[0][0]); // if you
-  // have raw data
+  // Programs built through the manager load from the binary cache
+  m_resources.Initialize(&m_programCache);
+  m_shapeBatchProgram = m_resources.AcquireProgram(
+      s_batchVertexShaderSource, s_batchFragmentShaderSource);
+  if (!m_shapeBatchProgram) {
+    throw std::runtime_error("Failed to create shape batch shader program");
+  }
+  // Unit 0 belongs to the UI's font and image textures
+  m_shapeBatchProgram->Use();
+  m_shapeBatchProgram->Set(m_shapeBatchProgram->GetUniform<int>("u_atlas"),
+                           ATLAS_TEXTURE_UNIT);
+
+  // Ring buffer renderers use for anything rebuilt every frame
+  if (!m_streamBuffer.Initialize(STREAM_REGION_SIZE,
+                                 (GLADloadproc)glfwGetProcAddress)) {
+    throw std::runtime_error("Failed to create stream buffer");
+  }
+  std::cout << "Stream buffer: "
+            << (m_streamBuffer.IsPersistent() ? "persistent mapping"
+                                              : "unsynchronized map/unmap")
+            << ", " << StreamBuffer::REGION_COUNT << " x "
+            << (STREAM_REGION_SIZE / (1024 * 1024)) << " MB\n";
+
+  if (m_options.headless &&
+      !EnsureOffscreenTarget(m_framebufferSize.x, m_framebufferSize.y)) {
+    throw std::runtime_error("Failed to create offscreen framebuffer");
+  }
+
+  if (!m_uiRenderer.Initialize(&m_resources)) {
+    throw std::runtime_error("Failed to initialize UI renderer");
+  }
+  if (!m_polylineRenderer.Initialize(&m_resources)) {
+    throw std::runtime_error("Failed to initialize polyline renderer");
+  }
+  if (!m_particleRenderer.Initialize(&m_resources)) {
+    throw std::runtime_error("Failed to initialize particle renderer");
+  }
+  if (!m_gpuParticleRenderer.Initialize(&m_resources)) {
+    throw std::runtime_error("Failed to initialize GPU particle renderer");
+  }
+  if (!m_textRenderer.Initialize(&m_resources, ATLAS_TEXTURE_UNIT)) {
+    throw std::runtime_error("Failed to initialize text renderer");
+  }
+  m_particles.Initialize();
+  if (m_options.softwareRendering) {
+    // The UI draws sample its own copy of the font atlas
+    unsigned char *pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    m_softwareRasterizer.Initialize();
+    m_softwareRasterizer.SetUiTexture(pixels, width, height);
+    SoftwareRasterizer::Stats stats = m_softwareRasterizer.GetStats();
+    std::cout << "Software rendering: " << stats.threads << " threads, "
+              << stats.lanes << " pixels per SIMD step\n";
+  }
+  m_frameCapture.Initialize();
+
+  // Every shape in the store is drawn by the batch in one instanced call
+  m_shapeBatch = std::make_unique<ShapeBatchRenderer>();
+  if (!m_shapeBatch->Initialize(m_shapeBatchProgram, &m_resources,
+                                m_shapes.Capacity())) {
+    throw std::runtime_error("Failed to initialize shape batch renderer");
+  }
+
+  // The main shape backs the single-shape Lua API (SetShapePosition etc.)
+  m_mainShape = m_shapes.Create({150.0f, 150.0f}, {50.0f, 50.0f},
+                                {1.0f, 0.0f, 0.0f, 1.0f}); // Red, opaque
+}
+
+// Bound once and left bound: nothing else binds framebuffers, and the
+// binding is context state, so it follows the context to the render thread.
+// Grows by at least half a dimension at a time and never shrinks, so
+// dragging a size around doesn't reallocate every frame.
+bool Application::EnsureOffscreenTarget(int width, int height) {
+  if (m_offscreenFBO != 0 && width <= m_offscreenWidth &&
+      height <= m_offscreenHeight) {
+    return true;
+  }
+  if (m_offscreenFBO != 0) {
+    width = std::max(width, m_offscreenWidth + m_offscreenWidth / 2);
+    height = std::max(height, m_offscreenHeight + m_offscreenHeight / 2);
+  } else {
+    glGenRenderbuffers(1, &m_offscreenColor);
+    glGenFramebuffers(1, &m_offscreenFBO);
+  }
+
+  glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenColor);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFBO);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, m_offscreenColor);
+  m_offscreenWidth = width;
+  m_offscreenHeight = height;
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "Offscreen framebuffer incomplete at " << width << "x"
+              << height << "\n";
+    return false;
+  }
+  return true;
 }
 
 void Application::Run() {
+  using Clock = std::chrono::steady_clock;
   m_lastTime = glfwGetTime();
+  auto runStartTime = Clock::now();
+  int framesRun = 0;
 
   while (m_isRunning && (glfwWindowShouldClose(m_window) == 0)) {
+    if (m_options.frameLimit > 0 && framesRun >= m_options.frameLimit) {
+      break;
+    }
+    if (m_onDemandRendering && m_redrawFrames == 0) {
+      // Nothing changed: sleep until input arrives or the timeout
+      glfwWaitEventsTimeout(IDLE_WAIT_TIMEOUT);
+      m_framePacer.SkipInterval();
+    } else {
+      // Limit before polling, so the frame samples the freshest input
+      m_framePacer.WaitForNextFrame();
+      glfwPollEvents();
+    }
+    m_framePacer.BeginFrame();
+    if (m_redrawFrames > 0) {
+      m_redrawFrames--;
+    }
+
     UpdateWindowTitleWithFPS();
-    glfwPollEvents();
     Update(); // Calls ImGui NewFrame, HandleMouseInput, Lua DrawGUI
-    Render(); // Clears, Renders Scene, Renders ImGui, Swaps Buffers
+    Render(); // Records the frame for the render thread
+    framesRun++;
+    if (FrameHadActivity()) {
+      RequestRedraw();
+    }
+  }
+
+  if (m_options.frameLimit > 0) {
+    // Count the time until the last frame is actually drawn
+    m_renderThread.Stop();
+    glFinish();
+    std::chrono::duration<double> runTime = Clock::now() - runStartTime;
+    ReportRun(runTime.count(), framesRun);
+  }
+}
+
+// Summary of a fixed-length run, for throughput comparisons between builds
+void Application::ReportRun(double seconds, int frames) {
+  double msPerFrame = frames > 0 ? seconds * 1000.0 / frames : 0.0;
+  std::cout << "Run: " << frames << " frames in " << seconds * 1000.0
+            << " ms (" << msPerFrame << " ms/frame, "
+            << (seconds > 0.0 ? frames / seconds : 0.0) << " FPS, "
+            << (m_options.threadedRendering ? "threaded" : "serial") << ")\n";
+  for (const GpuProfiler::ScopeResult &scope : m_gpuProfiler.GetResults()) {
+    std::cout << "  GPU " << std::string(scope.depth * 2, ' ') << scope.name
+              << ": " << scope.averageMs << " ms avg, " << scope.maxMs
+              << " ms max\n";
+  }
+  if (m_options.softwareRendering) {
+    // Last frame only; binning is serial, shading runs on every thread
+    SoftwareRasterizer::Stats stats = m_softwareRasterizer.GetStats();
+    std::cout << "  CPU raster: " << stats.primitives << " primitives, "
+              << stats.binnedRefs << " tile entries, " << stats.binMs
+              << " ms binning, " << stats.shadeMs << " ms shading on "
+              << stats.threads << " threads\n";
   }
 }
 
+void Application::RequestRedraw() { m_redrawFrames = REDRAW_FRAMES; }
+
+void Application::SetOnDemandRendering(bool enabled) {
+  m_onDemandRendering = enabled;
+  RequestRedraw();
+}
+
+void Application::SetGpuProfilerVisible(bool visible) {
+  m_showGpuProfiler = visible;
+  RequestRedraw();
+}
+
+void Application::SetDrawStatsVisible(bool visible) {
+  m_showDrawStats = visible;
+  RequestRedraw();
+}
+
+void Application::SetMemoryStatsVisible(bool visible) {
+  m_showMemoryStats = visible;
+  RequestRedraw();
+}
+
+void Application::RequestRedrawForWindow(GLFWwindow *window) {
+  auto *app = static_cast<Application *>(glfwGetWindowUserPointer(window));
+  if (app != nullptr) {
+    app->RequestRedraw();
+  }
+}
+
+// True if this frame changed something or ImGui is mid-interaction (a held
+// button, an active slider, a blinking text cursor), so the next frame must
+// not wait for input. The profiler overlay also keeps frames coming (its
+// results trail the frames being measured), as does a capture in progress
+// or a running tween or particle effect.
+bool Application::FrameHadActivity() {
+  bool shapesChanged = m_shapes.Revision() != m_lastShapeRevision;
+  m_lastShapeRevision = m_shapes.Revision();
+
+  const ImGuiIO &io = ImGui::GetIO();
+  return shapesChanged || ImGui::IsAnyItemActive() || ImGui::IsAnyMouseDown() ||
+         io.WantTextInput || m_showGpuProfiler || m_frameCapture.IsActive() ||
+         m_tweens.ActiveCount() > 0 || m_particles.IsActive() ||
+         m_gpuParticles.IsActive();
+}
+
 void Application::Update() {
-  glfwPollEvents();
-  ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplGlfw_NewFrame();
   ImGui::NewFrame();
+  // Before input and the script, so both see and override this frame's values
+  m_tweens.Update(ImGui::GetIO().DeltaTime, m_shapes);
+  m_particles.Update(ImGui::GetIO().DeltaTime);
+  m_gpuParticles.Update(ImGui::GetIO().DeltaTime);
   HandleMouseInput();
   if (m_luaEngine) {
     m_luaEngine->DrawGUI();
   }
+  if (m_showGpuProfiler) {
+    m_gpuProfiler.DrawOverlay(&m_showGpuProfiler);
+  }
+  if (m_showDrawStats) {
+    m_renderQueue.DrawOverlay(&m_showDrawStats);
+  }
+  if (m_showMemoryStats) {
+    m_resources.DrawPanel(&m_showMemoryStats);
+  }
 }
 
 void Application::HandleMouseInput() {
-  if (!m_mainSquare) {
-    return; // No shape to drag
-  }
-
   ImGuiIO &io = ImGui::GetIO();
   glm::vec2 mousePos = {io.MousePos.x, io.MousePos.y};
 
-  // Check if ImGui wants to capture the mouse (e.g., if a window is hovered or
-  // active) If our shape rendering is independent of ImGui windows, we might
-  // want to drag even if an ImGui window isn't focused, UNLESS an ImGui item is
-  // *actively* being interacted with. A simpler check for now: if ImGui is NOT
-  // using the mouse, we can.
+  // Don't start a drag while ImGui is using the mouse (hovering a window,
+  // dragging a slider, ...)
   bool imguiWantsMouse = io.WantCaptureMouse;
 
-  // Get shape properties (assuming RenderableObject has getters or direct
-  // access for bounds checking) For SquareRenderer, we can temporarily access
-  // its members or add getters. Let's assume RenderableObject gets methods to
-  // retrieve its bounds. For now, we'll directly use m_mainSquare->m_position
-  // and m_mainSquare->m_size (needs friendship or public access or getters in
-  // RenderableObject/SquareRenderer) Let's modify RenderableObject and
-  // SquareRenderer for this. For simplicity here, I'll assume m_mainSquare has
-  // accessible m_position and m_size. If these are protected in
-  // RenderableObject, SquareRenderer needs public getters. For now, to make it
-  // compile, let's assume we added these getters to SquareRenderer.
-
-  // To access m_position and m_size from SquareRenderer, they need to be
-  // accessible. Option 1: Make them public in RenderableObject (quickest for
-  // now, but less encapsulated) Option 2: Add public getters in
-  // RenderableObject and SquareRenderer Let's go with adding getters to
-  // RenderableObject and SquareRenderer for better practice. (See Step 2a below
-  // for these modifications)
-
-  glm::vec2 shapePos = m_mainSquare->GetPosition();
-  float shapeSize = m_mainSquare->GetSize();
-  glm::vec4 shapeColor = m_mainSquare->GetColor();
-
-  // Simple AABB (Axis-Aligned Bounding Box) hit test for the square
-  bool mouseOverShape =
-      (mousePos.x >= shapePos.x && mousePos.x <= shapePos.x + shapeSize &&
-       mousePos.y >= shapePos.y && mousePos.y <= shapePos.y + shapeSize);
-
-  if (!m_isDraggingShape) {
-    if (mouseOverShape && ImGui::IsMouseClicked(ImGuiMouseButton_Left) &&
-        !imguiWantsMouse) {
-      m_isDraggingShape = true;
-      m_dragOffset =
-          mousePos - shapePos; // Calculate offset from shape's top-left
-      // Optional: Visual feedback for dragging (e.g., change color slightly)
-      // m_mainSquare->SetColor(shapeColor.r * 0.8f, shapeColor.g * 0.8f,
-      // shapeColor.b * 0.8f, shapeColor.a);
+  if (!m_shapes.IsAlive(m_draggedShape)) {
+    m_draggedShape = {};
+    if (ImGui::IsMouseClicked(ImGuiMouseButton_Left) && !imguiWantsMouse) {
+      // Linear back-to-front scan over the packed position/size arrays
+      m_draggedShape = m_shapes.HitTest(mousePos, ShapeFlags::Draggable);
+      if (m_draggedShape.IsValid()) {
+        m_dragOffset = mousePos - m_shapes.GetPosition(m_draggedShape);
+      }
     }
   }
 
-  if (m_isDraggingShape) {
+  if (m_draggedShape.IsValid()) {
     if (ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
       glm::vec2 newShapePos = mousePos - m_dragOffset;
-      m_mainSquare->SetPosition(newShapePos.x, newShapePos.y);
-      if (m_luaEngine) {
+      MoveShape(m_draggedShape, newShapePos);
+      if (m_draggedShape == m_mainShape && m_luaEngine) {
         m_luaEngine->NotifyLuaShapePositionUpdated(newShapePos.x,
                                                    newShapePos.y);
       }
     } else { // Mouse button released
-      m_isDraggingShape = false;
-      // Optional: Restore original color if changed for dragging
-      // m_mainSquare->SetColor(shapeColor.r, shapeColor.g, shapeColor.b,
-      // shapeColor.a); // This needs the color *before* drag started
+      m_draggedShape = {};
     }
   }
 }
@@ -266,43 +685,149 @@ void Application::HandleMouseInput() {
 void Application::Render() {
   ImGui::Render();
 
-  int display_w;
-  int display_h;
-  glfwGetFramebufferSize(m_window, &display_w, &display_h);
-  glViewport(0, 0, display_w, display_h);
+  // Waits only if the render thread is still a full frame behind
+  FramePacket &packet = m_renderThread.BeginPacket();
+
+  // Shared globals for every scene shader, uploaded once per frame. The
+  // sizes come from the resize callbacks, not from per-frame queries.
+  packet.globals.projection = m_projectionMatrix;
+  packet.globals.viewportSize = glm::vec2(m_framebufferSize);
+  packet.globals.time = static_cast<float>(glfwGetTime());
+  packet.globals.dpiScale = m_contentScale;
+
+  for (int i = 0; i < 4; ++i) {
+    packet.backgroundColor[i] = m_backgroundColor[i];
+  }
+  packet.swapInterval = m_framePacer.GetSwapInterval();
+  m_transforms.Update(m_shapes); // Only subtrees changed since last frame
+  packet.shapes.Capture(m_shapes);
+  // Labels follow the shapes just placed; glyphs baked here go out with
+  // this packet's atlas update
+  packet.text.Clear();
+  m_sceneText.Emit(m_shapes, m_atlas, packet.text);
+  m_atlas.TakeUpdate(packet.atlas);
+
+  // Each polyline picks its level of detail for the current framebuffer
+  // resolution; only the reduced points go into the packet
+  packet.polylines.Clear();
+  float pixelsPerUnit =
+      m_windowSize.x > 0
+          ? static_cast<float>(m_framebufferSize.x) / m_windowSize.x
+          : 1.0f;
+  for (auto &[id, polyline] : m_polylines) {
+    polyline.Emit(pixelsPerUnit, packet.polylines);
+  }
+  packet.particles.Clear();
+  m_particles.Emit(packet.particles);
+  m_gpuParticles.Emit(packet.gpuParticles);
+  packet.ui.Capture(ImGui::GetDrawData());
+
+  m_renderThread.SubmitPacket();
+}
 
-  glClearColor(m_backgroundColor[0], m_backgroundColor[1], m_backgroundColor[2],
-               m_backgroundColor[3]);
+void Application::SubmitFrame(FramePacket &packet) {
+  if (m_options.headless) {
+    EnsureOffscreenTarget(static_cast<int>(packet.globals.viewportSize.x),
+                          static_cast<int>(packet.globals.viewportSize.y));
+  }
+  // Filtered by GLState: only reaches GL when the size changed
+  GLState::Viewport(0, 0, static_cast<GLsizei>(packet.globals.viewportSize.x),
+                    static_cast<GLsizei>(packet.globals.viewportSize.y));
+  m_frameGlobals.Update(packet.globals);
+  m_gpuProfiler.BeginFrame();
+  m_gpuProfiler.BeginScope("Frame");
+
+  // The UI pass leaves scissoring on, and clears respect the scissor box
+  GLState::SetEnabled(GL_SCISSOR_TEST, false);
+  glClearColor(packet.backgroundColor[0], packet.backgroundColor[1],
+               packet.backgroundColor[2], packet.backgroundColor[3]);
   glClear(GL_COLOR_BUFFER_BIT);
 
-  RenderScene();
+  m_streamBuffer.BeginFrame();
+  if (m_options.softwareRendering) {
+    // Scene and UI in one CPU pass; the GPU only sees the upload and blit
+    m_softwareRasterizer.Render(packet);
+    GpuProfiler::Scope scope(m_gpuProfiler, "Present");
+    m_softwarePresenter.Present(m_softwareRasterizer);
+  } else {
+    m_atlasTexture.Apply(packet.atlas); // Before any sprite samples it
+    {
+      GpuProfiler::Scope scope(m_gpuProfiler, "Scene");
+      RenderScene(packet);
+    }
 
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    // No state backup/restore around the UI: it states what it needs and
+    // GLState drops whatever the scene pass already set. Script scopes nest
+    // under this one, from callbacks in the draw lists.
+    {
+      GpuProfiler::Scope scope(m_gpuProfiler, "UI");
+      m_uiRenderer.Render(packet.ui.Get());
+    }
+  }
+  {
+    // Queues the readback; the pixels are picked up frames later
+    GpuProfiler::Scope scope(m_gpuProfiler, "Capture");
+    m_frameCapture.CaptureFrame(
+        static_cast<int>(packet.globals.viewportSize.x),
+        static_cast<int>(packet.globals.viewportSize.y));
+  }
+  m_streamBuffer.EndFrame(); // Fence this frame's region
+  ReportMemory();
+  m_resources.EndFrame(); // Fences releases, deletes what the GPU finished
+  m_gpuProfiler.EndFrame(); // Closes "Frame"
+  GLState::EndFrame();
+  if (m_options.headless) {
+    glFlush(); // No swap to submit the frame
+    return;
+  }
+  if (packet.swapInterval != m_appliedSwapInterval) {
+    // Needs the context, so it is applied here rather than by the pacer
+    glfwSwapInterval(packet.swapInterval);
+    m_appliedSwapInterval = packet.swapInterval;
+  }
   glfwSwapBuffers(m_window);
 }
 
-void Application::RenderScene() {
-  if (m_mainSquare) {
-    m_mainSquare->Render(m_projectionMatrix);
-  }
-  // Later, if you have a list:
-  // for (const auto& renderable : m_renderables) {
-  //     if (renderable) renderable->Render(m_projectionMatrix);
-  // }
+void Application::RenderScene(const FramePacket &packet) {
+  // Every scene draw goes through the queue, which orders them by layer
+  // and state and applies the state each one needs
+  DrawCommand shapes = m_shapeBatch ? m_shapeBatch->Prepare(packet.shapes)
+                                    : DrawCommand();
+  // All shapes go out in one instanced draw call, sprites included: every
+  // atlas image lives in the one array texture
+  shapes.textureTarget = GL_TEXTURE_2D_ARRAY;
+  shapes.texture = m_atlasTexture.GetTexture();
+  shapes.textureUnit = ATLAS_TEXTURE_UNIT;
+  m_renderQueue.Submit(shapes, DrawLayer::Shapes);
+  m_particleRenderer.Submit(packet.particles, m_renderQueue);
+  // Steps the GPU emitters here, ahead of the queue that draws them
+  m_gpuParticleRenderer.Submit(packet.gpuParticles, m_renderQueue);
+  // Polylines stream their points through this frame's region
+  m_polylineRenderer.Submit(packet.polylines, m_streamBuffer, m_renderQueue);
+  m_textRenderer.Submit(packet.text, m_atlasTexture.GetTexture(),
+                        m_renderQueue);
+  m_renderQueue.Execute();
+}
 
-  // Important: After rendering your scene objects that use a specific shader,
-  // if ImGui uses a different shader (which it does), you might need to
-  // ensure its state is restored. ImGui_ImplOpenGL3_RenderDrawData usually
-  // handles this. If you see issues, you might explicitly call glUseProgram(0)
-  // after your scene.
+void Application::ReportMemory() {
+  m_resources.SetExternal("Atlas", ResourceCategory::Texture,
+                          m_atlasTexture.GetBytes());
+  m_resources.SetExternal(
+      "Stream buffer", ResourceCategory::Buffer,
+      static_cast<size_t>(m_streamBuffer.GetRegionSize()) *
+          StreamBuffer::REGION_COUNT);
+  m_resources.SetExternal("Shape instances", ResourceCategory::Buffer,
+                          m_shapeBatch ? m_shapeBatch->GetBufferBytes() : 0);
+  m_resources.SetExternal("GPU particles", ResourceCategory::Buffer,
+                          m_gpuParticleRenderer.GetBufferBytes());
 }
 
 void Application::Shutdown() {
+  m_renderThread.Stop(); // Hands the GL context back to this thread
   CleanupRenderables();
   m_luaEngine.reset();
 
   if (ImGui::GetCurrentContext() != nullptr) {
-    ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
   }
@@ -316,42 +841,318 @@ void Application::Shutdown() {
 }
 
 void Application::CleanupRenderables() {
-  if (m_mainSquare) {
-    m_mainSquare->Cleanup();
-    m_mainSquare.reset();
+  if (m_shapeBatch) {
+    m_shapeBatch->Cleanup();
+    m_shapeBatch.reset();
+  }
+  m_shapes.Clear();
+  m_transforms.Clear();
+  m_tweens.Clear();
+  m_polylines.clear();
+  m_particles.Clear();
+  m_gpuParticles.Clear();
+  m_sceneText.ClearLabels();
+  m_mainShape = {};
+  m_draggedShape = {};
+
+  m_shapeBatchProgram.Reset();
+  m_atlasTexture.Cleanup();
+  m_uiRenderer.Cleanup();
+  m_polylineRenderer.Cleanup();
+  m_particleRenderer.Cleanup();
+  m_gpuParticleRenderer.Cleanup();
+  m_textRenderer.Cleanup();
+  m_particles.Cleanup();
+  m_softwareRasterizer.Cleanup();
+  m_softwarePresenter.Cleanup();
+  m_frameCapture.Cleanup(); // Writes out frames still in flight
+  m_gpuProfiler.Cleanup();
+  m_frameGlobals.Cleanup();
+  m_streamBuffer.Cleanup();
+  m_resources.Cleanup(); // After every renderer has dropped its references
+
+  if (m_offscreenFBO != 0) {
+    glDeleteFramebuffers(1, &m_offscreenFBO);
+    glDeleteRenderbuffers(1, &m_offscreenColor);
+    m_offscreenFBO = 0;
+    m_offscreenColor = 0;
+    m_offscreenWidth = 0;
+    m_offscreenHeight = 0;
   }
-  // for (auto& renderable : m_renderables) {
-  //     if (renderable) renderable->Cleanup();
-  // }
-  // m_renderables.clear();
-
-  m_simpleShapeShader.Cleanup(); // Cleanup the shader program
 }
 
-glm::vec2 Application::getWindowDimensions() {
-  return glm::vec2(WINDOW_WIDTH, WINDOW_HEIGHT);
+glm::vec2 Application::getWindowDimensions() const {
+  return glm::vec2(m_windowSize);
 }
 
 // --- Public setters for Lua ---
 void Application::SetShapePosition(float x, float y) {
-  if (m_mainSquare) {
-    m_mainSquare->SetPosition(x, y);
-  }
+  MoveShape(m_mainShape, {x, y});
 }
 
 void Application::SetShapeSize(float size) {
-  if (m_mainSquare) {
-    m_mainSquare->SetSize(size);
-  }
+  size = size > 0 ? size : 1.0f;
+  ResizeShape(m_mainShape, {size, size});
 }
 
 void Application::SetShapeColor(float r, float g, float b, float a) {
-  if (m_mainSquare) {
-    m_mainSquare->SetColor(r, g, b, a);
+  m_shapes.SetColor(m_mainShape, {r, g, b, a});
+}
+
+ShapeHandle Application::AddShape(float x, float y, float size,
+                                  const glm::vec4 &color) {
+  return m_shapes.Create({x, y}, {size, size}, color);
+}
+
+ShapeHandle Application::AddCircle(const glm::vec2 &center, float radius,
+                                   const glm::vec4 &color) {
+  ShapeHandle handle =
+      m_shapes.Create(center - radius, glm::vec2(radius * 2.0f), color);
+  m_shapes.SetKind(handle, ShapeKind::Circle);
+  return handle;
+}
+
+ShapeHandle Application::AddRoundedRect(const glm::vec2 &position,
+                                        const glm::vec2 &size,
+                                        float cornerRadius,
+                                        const glm::vec4 &color) {
+  ShapeHandle handle = m_shapes.Create(position, size, color);
+  ShapeParams params;
+  params.a.x = cornerRadius;
+  m_shapes.SetKind(handle, ShapeKind::RoundedRect, params);
+  return handle;
+}
+
+ShapeHandle Application::AddRing(const glm::vec2 &center, float radius,
+                                 float thickness, const glm::vec4 &color) {
+  ShapeHandle handle =
+      m_shapes.Create(center - radius, glm::vec2(radius * 2.0f), color);
+  ShapeParams params;
+  params.a.x = thickness;
+  m_shapes.SetKind(handle, ShapeKind::Ring, params);
+  return handle;
+}
+
+ShapeHandle Application::AddLine(const glm::vec2 &from, const glm::vec2 &to,
+                                 float thickness, const glm::vec4 &color) {
+  // The box bounds the capsule: both end caps included
+  float radius = thickness * 0.5f;
+  glm::vec2 origin = glm::min(from, to) - radius;
+  glm::vec2 size = glm::max(from, to) + radius - origin;
+  ShapeHandle handle = m_shapes.Create(origin, size, color);
+  ShapeParams params;
+  params.a = {ToBoxUnits(from - origin, size), ToBoxUnits(to - origin, size)};
+  float shorterSide = std::min(size.x, size.y);
+  params.b.x = shorterSide > 0.0f ? radius / shorterSide : 0.0f;
+  m_shapes.SetKind(handle, ShapeKind::Line, params);
+  return handle;
+}
+
+ShapeHandle Application::AddTriangle(const glm::vec2 &p0, const glm::vec2 &p1,
+                                     const glm::vec2 &p2,
+                                     const glm::vec4 &color) {
+  glm::vec2 origin = glm::min(glm::min(p0, p1), p2);
+  glm::vec2 size = glm::max(glm::max(p0, p1), p2) - origin;
+  ShapeHandle handle = m_shapes.Create(origin, size, color);
+  ShapeParams params;
+  params.a = {ToBoxUnits(p0 - origin, size), ToBoxUnits(p1 - origin, size)};
+  params.b = {ToBoxUnits(p2 - origin, size), 0.0f, 0.0f};
+  m_shapes.SetKind(handle, ShapeKind::Triangle, params);
+  return handle;
+}
+
+bool Application::RemoveShape(ShapeHandle handle) {
+  if (handle == m_mainShape) {
+    return false; // The main shape backs the single-shape API
+  }
+  m_transforms.Destroy(m_transforms.FindShape(handle));
+  m_tweens.StopShape(handle);
+  return m_shapes.Destroy(handle);
+}
+
+void Application::ClearShapes() {
+  // Destroy from the back so swap-remove never has to move anything
+  for (size_t i = m_shapes.Size(); i-- > 0;) {
+    ShapeHandle handle = m_shapes.HandleAt(static_cast<uint32_t>(i));
+    if (handle != m_mainShape) {
+      m_shapes.Destroy(handle);
+    }
+  }
+  // Their nodes in one pass rather than one array shift per shape
+  m_transforms.RemoveDeadShapes(m_shapes);
+  m_tweens.RemoveDeadShapes(m_shapes);
+}
+
+// In a collapsed group the setters below only write the store and leave the
+// node alone, so the shape comes back where it was once the group is scaled
+// back up
+
+void Application::MoveShape(ShapeHandle handle, const glm::vec2 &position) {
+  TransformHandle node = m_transforms.FindShape(handle);
+  if (node.IsValid()) {
+    const glm::mat3 parentWorld = UpdatedParentWorld(node);
+    if (!IsCollapsed(Transform2D::FromMatrix(parentWorld))) {
+      Transform2D local = m_transforms.GetLocal(node);
+      local.translation =
+          glm::vec2(glm::inverse(parentWorld) * glm::vec3(position, 1.0f));
+      m_transforms.SetLocal(node, local);
+    }
+  }
+  // Also right away, so reads before the next frame see the new position
+  m_shapes.SetPosition(handle, position);
+}
+
+void Application::ResizeShape(ShapeHandle handle, const glm::vec2 &size) {
+  TransformHandle node = m_transforms.FindShape(handle);
+  if (node.IsValid()) {
+    const Transform2D parent =
+        Transform2D::FromMatrix(UpdatedParentWorld(node));
+    if (!IsCollapsed(parent)) {
+      m_transforms.SetShapeSize(node, size / parent.scale);
+    }
+  }
+  m_shapes.SetSize(handle, size);
+}
+
+void Application::RotateShape(ShapeHandle handle, float rotation) {
+  TransformHandle node = m_transforms.FindShape(handle);
+  if (node.IsValid()) {
+    const Transform2D parent =
+        Transform2D::FromMatrix(UpdatedParentWorld(node));
+    if (!IsCollapsed(parent)) {
+      Transform2D local = m_transforms.GetLocal(node);
+      local.rotation = rotation - parent.rotation;
+      m_transforms.SetLocal(node, local);
+    }
+  }
+  m_shapes.SetRotation(handle, rotation);
+}
+
+TransformHandle Application::CreateGroup(const Transform2D &local,
+                                         TransformHandle parent) {
+  if (parent.IsValid() && !IsGroup(parent)) {
+    return {};
+  }
+  return m_transforms.Create(parent, local);
+}
+
+bool Application::RemoveGroup(TransformHandle group) {
+  return IsGroup(group) && m_transforms.Destroy(group);
+}
+
+bool Application::SetGroupParent(TransformHandle group,
+                                 TransformHandle parent) {
+  if (!IsGroup(group) || (parent.IsValid() && !IsGroup(parent))) {
+    return false;
+  }
+  return m_transforms.SetParent(group, parent);
+}
+
+bool Application::AttachShape(ShapeHandle shape, TransformHandle group) {
+  if (!m_shapes.IsAlive(shape) || !IsGroup(group)) {
+    return false;
+  }
+  // The local transform that keeps the shape's current placement
+  m_transforms.Update(m_shapes);
+  const glm::mat3 world = m_transforms.GetWorld(group);
+  const Transform2D parent = Transform2D::FromMatrix(world);
+  if (IsCollapsed(parent)) {
+    return false;
+  }
+  Transform2D local;
+  local.translation = glm::vec2(glm::inverse(world) *
+                                glm::vec3(m_shapes.GetPosition(shape), 1.0f));
+  local.rotation = m_shapes.GetRotation(shape) - parent.rotation;
+  const glm::vec2 shapeSize = m_shapes.GetSize(shape) / parent.scale;
+
+  m_transforms.Destroy(m_transforms.FindShape(shape));
+  return m_transforms.CreateForShape(shape, shapeSize, group, local)
+      .IsValid();
+}
+
+bool Application::DetachShape(ShapeHandle shape) {
+  // The store already holds the shape's last placement
+  return m_transforms.Destroy(m_transforms.FindShape(shape));
+}
+
+bool Application::IsGroup(TransformHandle handle) const {
+  return m_transforms.IsAlive(handle) &&
+         !m_transforms.GetShape(handle).IsValid();
+}
+
+glm::mat3 Application::UpdatedParentWorld(TransformHandle node) {
+  m_transforms.Update(m_shapes);
+  return m_transforms.GetParentWorld(node);
+}
+
+size_t Application::GetShapeCount() const { return m_shapes.Size(); }
+
+uint32_t Application::AddImageFile(const std::string &path) {
+  Image image;
+  if (!LoadImageFile(path, image)) {
+    return 0;
   }
+  return m_atlas.Add(image.pixels.data(), image.width, image.height);
+}
+
+uint32_t Application::AddImage(const uint8_t *rgba, int width, int height) {
+  return m_atlas.Add(rgba, width, height);
+}
+
+bool Application::RemoveImage(uint32_t imageId) {
+  return m_atlas.Remove(imageId);
+}
+
+ShapeHandle Application::AddSprite(uint32_t imageId, float x, float y,
+                                   float width, float height) {
+  AtlasRegion region;
+  if (!m_atlas.GetRegion(imageId, region)) {
+    return {};
+  }
+  // A non-positive size means the image's own size in pixels
+  glm::vec2 size = {width > 0.0f ? width : static_cast<float>(region.width),
+                    height > 0.0f ? height : static_cast<float>(region.height)};
+  ShapeHandle handle =
+      m_shapes.Create({x, y}, size, {1.0f, 1.0f, 1.0f, 1.0f});
+  m_shapes.SetSprite(handle, region.uvRect, region.layer);
+  return handle;
+}
+
+bool Application::SetSpriteImage(ShapeHandle handle, uint32_t imageId) {
+  AtlasRegion region;
+  if (!m_shapes.IsAlive(handle) || !m_atlas.GetRegion(imageId, region)) {
+    return false;
+  }
+  m_shapes.SetSprite(handle, region.uvRect, region.layer);
+  return true;
+}
+
+uint32_t Application::AddPolyline(const glm::vec2 &position,
+                                  const glm::vec2 &size,
+                                  const glm::vec4 &color) {
+  uint32_t id = m_nextPolylineId++;
+  Polyline &polyline = m_polylines[id];
+  polyline.SetRect(position, size);
+  polyline.SetStyle(color, 1.5f);
+  RequestRedraw();
+  return id;
+}
+
+bool Application::RemovePolyline(uint32_t id) {
+  RequestRedraw();
+  return m_polylines.erase(id) > 0;
+}
+
+Polyline *Application::GetPolyline(uint32_t id) {
+  auto it = m_polylines.find(id);
+  return it != m_polylines.end() ? &it->second : nullptr;
 }
 
 void Application::SetBackgroundColor(float r, float g, float b, float a) {
+  if (m_backgroundColor[0] != r || m_backgroundColor[1] != g ||
+      m_backgroundColor[2] != b || m_backgroundColor[3] != a) {
+    RequestRedraw();
+  }
   m_backgroundColor[0] = r;
   m_backgroundColor[1] = g;
   m_backgroundColor[2] = b;
@@ -359,24 +1160,15 @@ void Application::SetBackgroundColor(float r, float g, float b, float a) {
 }
 
 glm::vec2 Application::GetShapePositionLua() const {
-  if (m_mainSquare) {
-    return m_mainSquare->GetPosition();
-  }
-  return {0.0f, 0.0f}; // Default if no square
+  return m_shapes.GetPosition(m_mainShape);
 }
 
 float Application::GetShapeSizeLua() const {
-  if (m_mainSquare) {
-    return m_mainSquare->GetSize();
-  }
-  return 0.0f;
+  return m_shapes.GetSize(m_mainShape).x;
 }
 
 glm::vec4 Application::GetShapeColorLua() const {
-  if (m_mainSquare) {
-    return m_mainSquare->GetColor();
-  }
-  return {0.0f, 0.0f, 0.0f, 0.0f};
+  return m_shapes.GetColor(m_mainShape);
 }
 
 void Application::ErrorCallback(int error, const char *description) {
@@ -386,6 +1178,7 @@ void Application::ErrorCallback(int error, const char *description) {
 void Application::KeyCallback(GLFWwindow *window, int key, int scancode,
                               int action, int mods) {
   auto *app = static_cast<Application *>(glfwGetWindowUserPointer(window));
+  app->RequestRedraw();
 
   if (action == GLFW_PRESS || action == GLFW_REPEAT) {
     // F5 for force reload
@@ -396,6 +1189,31 @@ void Application::KeyCallback(GLFWwindow *window, int key, int scancode,
     else if (key == GLFW_KEY_R && ((mods & GLFW_MOD_CONTROL) != 0)) {
       app->m_luaEngine->ForceReload();
     }
+    // F3 to toggle the GPU profiler overlay
+    else if (key == GLFW_KEY_F3) {
+      app->SetGpuProfilerVisible(!app->m_showGpuProfiler);
+    }
+    // F4 to toggle the draw submission stats
+    else if (key == GLFW_KEY_F4) {
+      app->SetDrawStatsVisible(!app->m_showDrawStats);
+    }
+    // F7 to toggle the GPU memory panel
+    else if (key == GLFW_KEY_F7) {
+      app->SetMemoryStatsVisible(!app->m_showMemoryStats);
+    }
+    // F12 for a screenshot, Ctrl+F12 to start/stop recording
+    else if (key == GLFW_KEY_F12 && ((mods & GLFW_MOD_CONTROL) != 0)) {
+      FrameCapture &capture = app->m_frameCapture;
+      if (capture.IsRecording()) {
+        capture.StopRecording();
+        std::cout << "Recording stopped\n";
+      } else {
+        capture.StartRecording(TimestampedPath("capture", "y4m"));
+      }
+    } else if (key == GLFW_KEY_F12) {
+      app->m_frameCapture.RequestScreenshot(
+          TimestampedPath("screenshot", "png"));
+    }
     // F6 to toggle auto-reload
     else if (key == GLFW_KEY_F6) {
       bool currentState = app->m_luaEngine->IsAutoReloadEnabled();
@@ -2,18 +2,51 @@
 
 #include <glad/glad.h>
 #define GLFW_INCLUDE_NONE
+#include "FrameCapture.h"
+#include "FrameGlobals.h"
+#include "FramePacer.h"
+#include "GpuParticleSystem.h"
+#include "GpuProfiler.h"
+#include "Image.h"
+#include "ParticleSystem.h"
+#include "Polyline.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
+#include "RenderThread.h"
+#include "ResourceManager.h"
+#include "SceneText.h"
 #include "Shader.h"
+#include "ShapeStore.h"
+#include "SoftwareRasterizer.h"
+#include "StreamBuffer.h"
+#include "TextureAtlas.h"
+#include "TransformHierarchy.h"
+#include "TweenSystem.h"
+#include "UiRenderer.h"
 #include <GLFW/glfw3.h>
 #include <glm.hpp>
+#include <map>
 #include <memory>
+#include <string>
 
-class RenderableObject;
-class SquareRenderer;
+class ShapeBatchRenderer;
 class LuaEngine;
 
+// Command-line configurable launch settings, see main.cpp
+struct ApplicationOptions {
+  // No display: GLFW's null platform, with an EGL (surfaceless) or OSMesa
+  // context, drawing into an offscreen framebuffer instead of a window
+  bool headless = false;
+  int frameLimit = 0; // Frames to run before exiting; 0 runs until closed
+  std::string scriptPath = "gui.lua";
+  bool threadedRendering = true;
+  // Draw frames on the CPU (SoftwareRasterizer); GL only presents them
+  bool softwareRendering = false;
+};
+
 class Application {
 public:
-  Application();
+  explicit Application(ApplicationOptions options = {});
   ~Application();
 
   bool Initialize();
@@ -25,7 +58,123 @@ public:
   void SetShapeColor(float r, float g, float b, float a = 1.0f);
   void SetBackgroundColor(float r, float g, float b, float a);
 
-  static glm::vec2 getWindowDimensions();
+  // On-demand rendering: when nothing changed, the loop blocks in
+  // glfwWaitEventsTimeout instead of drawing. Input, shape changes and
+  // active ImGui widgets keep frames coming; anything else that animates
+  // calls RequestRedraw().
+  void RequestRedraw();
+  void SetOnDemandRendering(bool enabled);
+  [[nodiscard]] bool IsOnDemandRendering() const {
+    return m_onDemandRendering;
+  }
+
+  // Swap interval and frame limiter, switchable at runtime
+  FramePacer &GetFramePacer() { return m_framePacer; }
+
+  // GPU timings of the render passes; the overlay toggles with F3
+  GpuProfiler &GetGpuProfiler() { return m_gpuProfiler; }
+  void SetGpuProfilerVisible(bool visible);
+  [[nodiscard]] bool IsGpuProfilerVisible() const {
+    return m_showGpuProfiler;
+  }
+
+  // Scene draws and state changes per frame; the panel toggles with F4
+  [[nodiscard]] RenderQueue::Stats GetDrawStats() const {
+    return m_renderQueue.GetStats();
+  }
+  void SetDrawStatsVisible(bool visible);
+  [[nodiscard]] bool IsDrawStatsVisible() const { return m_showDrawStats; }
+
+  // GPU memory by category and the shared objects; the panel toggles with F7
+  [[nodiscard]] ResourceManager::Stats GetMemoryStats() const {
+    return m_resources.GetStats();
+  }
+  void SetMemoryStatsVisible(bool visible);
+  [[nodiscard]] bool IsMemoryStatsVisible() const {
+    return m_showMemoryStats;
+  }
+
+  // Screenshots (F12) and recordings (Ctrl+F12), read back asynchronously
+  FrameCapture &GetFrameCapture() { return m_frameCapture; }
+
+  // Shapes beyond the main one, addressed by generational handles
+  ShapeHandle AddShape(float x, float y, float size, const glm::vec4 &color);
+  bool RemoveShape(ShapeHandle handle);
+  void ClearShapes(); // Removes every shape except the main one
+  size_t GetShapeCount() const;
+  ShapeStore &GetShapeStore() { return m_shapes; }
+  // Placement in window units. Shapes attached to a group are placed by the
+  // hierarchy, so for them these set the local transform that lands there.
+  void MoveShape(ShapeHandle handle, const glm::vec2 &position);
+  void ResizeShape(ShapeHandle handle, const glm::vec2 &size);
+  void RotateShape(ShapeHandle handle, float rotation);
+
+  // Groups are transform nodes shapes attach to, nested under other groups.
+  // Moving, turning or scaling one carries its whole subtree along, placed
+  // once per frame by a partial update of the hierarchy.
+  TransformHandle CreateGroup(const Transform2D &local,
+                              TransformHandle parent = {});
+  // Removes the group and its subgroups; their shapes stay where they are
+  bool RemoveGroup(TransformHandle group);
+  // An invalid parent makes the group a root
+  bool SetGroupParent(TransformHandle group, TransformHandle parent);
+  // Both keep the shape where it is on screen
+  bool AttachShape(ShapeHandle shape, TransformHandle group);
+  bool DetachShape(ShapeHandle shape);
+  [[nodiscard]] bool IsGroup(TransformHandle handle) const;
+  TransformHierarchy &GetTransforms() { return m_transforms; }
+
+  // Shape tweens, advanced once per frame before the script's GUI runs
+  TweenSystem &GetTweens() { return m_tweens; }
+
+  // Particle emitters, simulated once per frame next to the tweens and drawn
+  // with one instanced call each
+  ParticleSystem &GetParticles() { return m_particles; }
+  // Emitters simulated on the GPU, for counts the CPU can't integrate;
+  // only their parameters travel with each frame
+  GpuParticleSystem &GetGpuParticles() { return m_gpuParticles; }
+
+  // Text labels placed in the scene or on shapes, baked into the atlas as
+  // distance fields and drawn with one instanced call
+  SceneText &GetSceneText() { return m_sceneText; }
+
+  // SDF primitives, in the same instanced batch as every other shape. Each
+  // is a shape whose box bounds the primitive.
+  ShapeHandle AddCircle(const glm::vec2 &center, float radius,
+                        const glm::vec4 &color);
+  ShapeHandle AddRoundedRect(const glm::vec2 &position, const glm::vec2 &size,
+                             float cornerRadius, const glm::vec4 &color);
+  ShapeHandle AddRing(const glm::vec2 &center, float radius, float thickness,
+                      const glm::vec4 &color);
+  ShapeHandle AddLine(const glm::vec2 &from, const glm::vec2 &to,
+                      float thickness, const glm::vec4 &color);
+  ShapeHandle AddTriangle(const glm::vec2 &p0, const glm::vec2 &p1,
+                          const glm::vec2 &p2, const glm::vec4 &color);
+
+  // Images are packed into the texture atlas and referenced by id (0 is
+  // never valid). Sprites are shapes showing an atlas image; they draw in
+  // the same instanced batch as every other shape.
+  uint32_t AddImageFile(const std::string &path);
+  uint32_t AddImage(const uint8_t *rgba, int width, int height);
+  bool RemoveImage(uint32_t imageId);
+  // A non-positive width or height takes the image's size
+  ShapeHandle AddSprite(uint32_t imageId, float x, float y,
+                        float width = 0.0f, float height = 0.0f);
+  bool SetSpriteImage(ShapeHandle handle, uint32_t imageId);
+  [[nodiscard]] const TextureAtlas &GetTextureAtlas() const { return m_atlas; }
+
+  // Sample series plotted into a window rectangle, drawn after the shapes
+  // in creation order. Ids are never 0.
+  uint32_t AddPolyline(const glm::vec2 &position, const glm::vec2 &size,
+                       const glm::vec4 &color);
+  bool RemovePolyline(uint32_t id);
+  // Null for unknown ids. Changes show up in the next frame that is drawn,
+  // see RequestRedraw().
+  Polyline *GetPolyline(uint32_t id);
+
+  // Window size in screen coordinates (the space shapes and the mouse use);
+  // the framebuffer may be larger on HiDPI displays
+  glm::vec2 getWindowDimensions() const;
 
   glm::vec2 GetShapePositionLua() const;
   float GetShapeSizeLua() const;
@@ -35,9 +184,24 @@ private:
   void InitializeGLFW();
   void InitializeImGui();
   void InitializeRenderables();
+  GLFWwindow *CreateHeadlessWindow();
+  // Size-dependent state, refreshed from the GLFW callbacks only
+  void OnWindowSize(int width, int height);
+  void OnFramebufferSize(int width, int height);
+  void OnContentScale(float scale);
+  void UpdateProjection();
+  // Render thread side; grows the headless target to fit
+  bool EnsureOffscreenTarget(int width, int height);
+  void ReportRun(double seconds, int frames);
   void Update();
-  void Render();
-  void RenderScene();
+  void Render(); // Records the frame into a packet for the render thread
+  // Render thread side: draws and presents one recorded frame
+  void SubmitFrame(FramePacket &packet);
+  void RenderScene(const FramePacket &packet);
+  // Hands the storage renderers allocate themselves to m_resources
+  void ReportMemory();
+  // World transform of an attached shape's group, brought up to date first
+  glm::mat3 UpdatedParentWorld(TransformHandle node);
   void CleanupRenderables();
 
   // --- FPS Calculation Members ---
@@ -54,6 +218,8 @@ private:
                           int mods);
 
   void HandleMouseInput();
+  [[nodiscard]] bool FrameHadActivity();
+  static void RequestRedrawForWindow(GLFWwindow *window);
   GLFWwindow *m_window;
   std::string m_baseWindowTitle = "Minimal ImGui + Lua App";
   std::unique_ptr<LuaEngine> m_luaEngine;
@@ -61,20 +227,81 @@ private:
 
   float m_backgroundColor[4] = {0.2f, 0.2f, 0.2f, 1.0f};
 
-  Shader m_simpleShapeShader;                   // Shader object
-  std::unique_ptr<SquareRenderer> m_mainSquare; // Example renderable
-  // std::vector<std::unique_ptr<RenderableObject>> m_renderables; // For
-  // multiple objects
+  ShapeStore m_shapes;    // Every shape in the scene, SoA
+  ShapeHandle m_mainShape; // Target of SetShapePosition/Size/Color
+  // Groups, placing the shapes attached to them before every capture
+  TransformHierarchy m_transforms;
+  TweenSystem m_tweens; // Writes into m_shapes every frame
+
+  ProgramCache m_programCache; // Linked program binaries kept across runs
+  // Shared programs and geometry; declared ahead of everything holding them
+  ResourceManager m_resources;
+  bool m_showMemoryStats = false;
+  FrameGlobals m_frameGlobals; // Per-frame UBO shared by scene shaders
+  StreamBuffer m_streamBuffer; // Per-frame dynamic vertex/instance data
+  ProgramRef m_shapeBatchProgram; // Instanced program used by m_shapeBatch
+  std::unique_ptr<ShapeBatchRenderer> m_shapeBatch;
+  TextureAtlas m_atlas;        // Packing, on the main thread
+  AtlasTexture m_atlasTexture; // Its array texture, on the render thread
+  std::map<uint32_t, Polyline> m_polylines; // Ordered: drawn by id
+  uint32_t m_nextPolylineId = 1;
+  PolylineRenderer m_polylineRenderer;
+  ParticleSystem m_particles;
+  ParticleRenderer m_particleRenderer;
+  GpuParticleSystem m_gpuParticles;
+  GpuParticleRenderer m_gpuParticleRenderer;
+  SceneText m_sceneText; // Bakes into m_atlas
+  TextRenderer m_textRenderer;
+  RenderQueue m_renderQueue; // Sorts the scene draws, on the render thread
+  bool m_showDrawStats = false;
+  UiRenderer m_uiRenderer; // ImGui draw data, through GLState
+  // Replace the GL scene and UI passes with ApplicationOptions::
+  // softwareRendering
+  SoftwareRasterizer m_softwareRasterizer;
+  SoftwarePresenter m_softwarePresenter;
+  GpuProfiler m_gpuProfiler; // Recorded on the render thread
+  bool m_showGpuProfiler = false;
+  FrameCapture m_frameCapture; // Reads back on the render thread
+
+  ApplicationOptions m_options;
+
+  // Owns the GL context once started, unless
+  // ApplicationOptions::threadedRendering is off
+  RenderThread m_renderThread;
+
+  // Headless render target, standing in for the window's framebuffer.
+  // Allocated size; frames use its lower-left corner.
+  GLuint m_offscreenFBO = 0;
+  GLuint m_offscreenColor = 0;
+  int m_offscreenWidth = 0;
+  int m_offscreenHeight = 0;
+
+  FramePacer m_framePacer;
+  int m_appliedSwapInterval = 0; // Render thread side
+
+  bool m_onDemandRendering = true;
+  int m_redrawFrames = REDRAW_FRAMES; // Frames left before the loop may block
+  uint64_t m_lastShapeRevision = 0;
+  // ImGui needs a couple of frames to settle hover and layout state after
+  // an event, so every request keeps the loop running for this many
+  static constexpr int REDRAW_FRAMES = 3;
+  // Upper bound on a blocking wait; also paces script hot-reload checks
+  static constexpr double IDLE_WAIT_TIMEOUT = 0.5;
 
-  glm::mat4 m_projectionMatrix;
+  glm::mat4 m_projectionMatrix; // Uploaded through m_frameGlobals
+  glm::ivec2 m_windowSize = {WINDOW_WIDTH, WINDOW_HEIGHT};
+  glm::ivec2 m_framebufferSize = {WINDOW_WIDTH, WINDOW_HEIGHT};
+  float m_contentScale = 1.0f;
 
-  bool m_isDraggingShape = false;
+  ShapeHandle m_draggedShape; // Invalid when not dragging
   glm::vec2 m_dragOffset = {0.0f, 0.0f};
 
   // Window settings
   static constexpr int WINDOW_WIDTH = 1080 * 1.25;
   static constexpr int WINDOW_HEIGHT = 720;
+  static constexpr GLsizeiptr STREAM_REGION_SIZE = 8 * 1024 * 1024;
+  static constexpr GLuint ATLAS_TEXTURE_UNIT = 1;
 
-  static const char *s_vertexShaderSource;
-  static const char *s_fragmentShaderSource;
+  static const char *s_batchVertexShaderSource;
+  static const char *s_batchFragmentShaderSource;
 };
\ No newline at end of file
@@ -0,0 +1,536 @@
+#include "FrameCapture.h"
+#include "GLState.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+constexpr GLuint64 ONE_SECOND = 1000000000;
+
+// RGBA rows, bottom first (as read back), to top-down RGB
+void FlipToRGB(const std::vector<uint8_t> &rgba, int width, int height,
+               std::vector<uint8_t> &rgb) {
+  rgb.resize(static_cast<size_t>(width) * height * 3);
+  for (int y = 0; y < height; ++y) {
+    const uint8_t *src = rgba.data() + static_cast<size_t>(height - 1 - y) *
+                                           width * 4;
+    uint8_t *dst = rgb.data() + static_cast<size_t>(y) * width * 3;
+    for (int x = 0; x < width; ++x) {
+      dst[x * 3 + 0] = src[x * 4 + 0];
+      dst[x * 3 + 1] = src[x * 4 + 1];
+      dst[x * 3 + 2] = src[x * 4 + 2];
+    }
+  }
+}
+
+uint32_t Crc32(const uint8_t *data, size_t size) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) != 0 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      t[n] = c;
+    }
+    return t;
+  }();
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; ++i) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void PutBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+  out.push_back(static_cast<uint8_t>(value >> 24));
+  out.push_back(static_cast<uint8_t>(value >> 16));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+void PutChunk(std::vector<uint8_t> &out, const char *type,
+              const std::vector<uint8_t> &data) {
+  PutBigEndian(out, static_cast<uint32_t>(data.size()));
+  size_t typeStart = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data.begin(), data.end());
+  PutBigEndian(out, Crc32(out.data() + typeStart, out.size() - typeStart));
+}
+
+// No compression: a zlib stream of stored deflate blocks. Encoding is a copy,
+// which keeps the worker ahead of 60 FPS recording; the files are large.
+std::vector<uint8_t> EncodePNG(const std::vector<uint8_t> &rgb, int width,
+                               int height) {
+  const size_t rowBytes = static_cast<size_t>(width) * 3;
+  std::vector<uint8_t> raw;
+  raw.reserve((rowBytes + 1) * height);
+  for (int y = 0; y < height; ++y) {
+    raw.push_back(0); // Filter: none
+    const uint8_t *row = rgb.data() + y * rowBytes;
+    raw.insert(raw.end(), row, row + rowBytes);
+  }
+
+  std::vector<uint8_t> zlib;
+  zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+  zlib.push_back(0x78); // Deflate, 32K window
+  zlib.push_back(0x01);
+  uint32_t adlerA = 1;
+  uint32_t adlerB = 0;
+  size_t offset = 0;
+  do {
+    size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+    bool last = offset + blockSize == raw.size();
+    zlib.push_back(last ? 1 : 0); // BFINAL, BTYPE = stored
+    zlib.push_back(static_cast<uint8_t>(blockSize));
+    zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+    zlib.push_back(static_cast<uint8_t>(~blockSize));
+    zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+    zlib.insert(zlib.end(), raw.begin() + offset,
+                raw.begin() + offset + blockSize);
+    for (size_t i = offset; i < offset + blockSize; ++i) {
+      adlerA = (adlerA + raw[i]) % 65521;
+      adlerB = (adlerB + adlerA) % 65521;
+    }
+    offset += blockSize;
+  } while (offset < raw.size());
+  PutBigEndian(zlib, (adlerB << 16) | adlerA);
+
+  static const uint8_t signature[] = {0x89, 'P',  'N',  'G',
+                                      '\r', '\n', 0x1A, '\n'};
+  std::vector<uint8_t> png(signature, signature + sizeof(signature));
+  std::vector<uint8_t> header;
+  PutBigEndian(header, static_cast<uint32_t>(width));
+  PutBigEndian(header, static_cast<uint32_t>(height));
+  header.insert(header.end(), {8, 2, 0, 0, 0}); // 8-bit RGB, no interlace
+  PutChunk(png, "IHDR", header);
+  PutChunk(png, "IDAT", zlib);
+  PutChunk(png, "IEND", {});
+  return png;
+}
+
+bool WriteImage(const std::string &path, FrameCapture::Format format,
+                const std::vector<uint8_t> &rgba, int width, int height) {
+  std::vector<uint8_t> rgb;
+  FlipToRGB(rgba, width, height, rgb);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    std::cerr << "FrameCapture: cannot write " << path << "\n";
+    return false;
+  }
+  if (format == FrameCapture::Format::PPM) {
+    file << "P6\n" << width << " " << height << "\n255\n";
+    file.write(reinterpret_cast<const char *>(rgb.data()),
+               static_cast<std::streamsize>(rgb.size()));
+  } else {
+    std::vector<uint8_t> png = EncodePNG(rgb, width, height);
+    file.write(reinterpret_cast<const char *>(png.data()),
+               static_cast<std::streamsize>(png.size()));
+  }
+  return static_cast<bool>(file);
+}
+
+// JFIF (full range BT.601) Y'CbCr, chroma averaged over 2x2 blocks, which is
+// what C420jpeg declares
+void ConvertToYUV420(const std::vector<uint8_t> &rgba, int width, int height,
+                     std::vector<uint8_t> &yuv) {
+  const int chromaWidth = (width + 1) / 2;
+  const int chromaHeight = (height + 1) / 2;
+  const size_t lumaSize = static_cast<size_t>(width) * height;
+  const size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+  yuv.resize(lumaSize + chromaSize * 2);
+  uint8_t *planeY = yuv.data();
+  uint8_t *planeU = planeY + lumaSize;
+  uint8_t *planeV = planeU + chromaSize;
+
+  auto pixel = [&](int x, int y) {
+    // Top-down output from bottom-up rows
+    return rgba.data() + (static_cast<size_t>(height - 1 - y) * width + x) * 4;
+  };
+
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const uint8_t *p = pixel(x, y);
+      float luma = 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+      planeY[static_cast<size_t>(y) * width + x] =
+          static_cast<uint8_t>(std::min(luma + 0.5f, 255.0f));
+    }
+  }
+  for (int cy = 0; cy < chromaHeight; ++cy) {
+    for (int cx = 0; cx < chromaWidth; ++cx) {
+      float r = 0.0f;
+      float g = 0.0f;
+      float b = 0.0f;
+      int samples = 0;
+      for (int dy = 0; dy < 2 && cy * 2 + dy < height; ++dy) {
+        for (int dx = 0; dx < 2 && cx * 2 + dx < width; ++dx) {
+          const uint8_t *p = pixel(cx * 2 + dx, cy * 2 + dy);
+          r += p[0];
+          g += p[1];
+          b += p[2];
+          samples++;
+        }
+      }
+      r /= samples;
+      g /= samples;
+      b /= samples;
+      float u = 128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b;
+      float v = 128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b;
+      size_t index = static_cast<size_t>(cy) * chromaWidth + cx;
+      planeU[index] = static_cast<uint8_t>(std::clamp(u + 0.5f, 0.0f, 255.0f));
+      planeV[index] = static_cast<uint8_t>(std::clamp(v + 0.5f, 0.0f, 255.0f));
+    }
+  }
+}
+
+// "shots/run.png", 7 -> "shots/run_00007.png"
+std::string SequencePath(const std::string &path, uint64_t index) {
+  size_t dot = path.find_last_of('.');
+  size_t slash = path.find_last_of("/\\");
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    dot = path.size();
+  }
+  char number[24];
+  std::snprintf(number, sizeof(number), "_%05llu",
+                static_cast<unsigned long long>(index));
+  return path.substr(0, dot) + number + path.substr(dot);
+}
+} // namespace
+
+FrameCapture::~FrameCapture() { Cleanup(); }
+
+bool FrameCapture::Initialize() {
+  for (Slot &slot : m_slots) {
+    glGenBuffers(1, &slot.pbo);
+  }
+  m_stopWorker = false;
+  m_worker = std::thread(&FrameCapture::WorkerMain, this);
+  m_initialized = true;
+  return true;
+}
+
+void FrameCapture::Cleanup() {
+  if (!m_initialized) {
+    return;
+  }
+  // Oldest first, so recorded frames reach the worker in order
+  for (int i = 0; i < SLOT_COUNT; ++i) {
+    Collect(m_slots[(m_nextSlot + i) % SLOT_COUNT], true);
+  }
+  if (m_openSession != 0) {
+    Job close;
+    close.record.session = m_openSession;
+    Enqueue(std::move(close));
+    m_openSession = 0;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_stopWorker = true;
+  }
+  m_queueCondition.notify_all();
+  m_worker.join();
+
+  for (Slot &slot : m_slots) {
+    GLState::DeleteBuffer(slot.pbo);
+    slot = Slot();
+  }
+  m_freeBuffers.clear();
+  m_nextSlot = 0;
+  m_initialized = false;
+}
+
+bool FrameCapture::FormatFromPath(const std::string &path, Format &format) {
+  size_t dot = path.find_last_of('.');
+  if (dot == std::string::npos) {
+    return false;
+  }
+  std::string extension = path.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (extension == "png") {
+    format = Format::PNG;
+  } else if (extension == "ppm") {
+    format = Format::PPM;
+  } else if (extension == "y4m") {
+    format = Format::Y4M;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool FrameCapture::RequestScreenshot(const std::string &path) {
+  Format format;
+  if (!FormatFromPath(path, format) || format == Format::Y4M) {
+    std::cerr << "FrameCapture: screenshots are .png or .ppm, not " << path
+              << "\n";
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(m_requestMutex);
+  m_screenshotPath = path;
+  m_screenshotFormat = format;
+  return true;
+}
+
+bool FrameCapture::StartRecording(const std::string &path, int fps) {
+  Format format;
+  if (!FormatFromPath(path, format)) {
+    std::cerr << "FrameCapture: recordings are .y4m, .png or .ppm, not "
+              << path << "\n";
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(m_requestMutex);
+  m_recording.session = ++m_lastSession;
+  m_recording.path = path;
+  m_recording.format = format;
+  m_recording.fps = fps > 0 ? fps : 60;
+  m_recording.frameIndex = 0;
+  return true;
+}
+
+void FrameCapture::StopRecording() {
+  std::lock_guard<std::mutex> lock(m_requestMutex);
+  m_recording = RecordTarget();
+}
+
+bool FrameCapture::IsRecording() const {
+  std::lock_guard<std::mutex> lock(m_requestMutex);
+  return m_recording.session != 0;
+}
+
+bool FrameCapture::IsActive() const {
+  std::lock_guard<std::mutex> lock(m_requestMutex);
+  return m_recording.session != 0 || !m_screenshotPath.empty();
+}
+
+FrameCapture::Stats FrameCapture::GetStats() const {
+  Stats stats;
+  stats.recording = IsRecording();
+  stats.captured = m_captured.load();
+  stats.written = m_written.load();
+  stats.dropped = m_dropped.load();
+  return stats;
+}
+
+void FrameCapture::CaptureFrame(int width, int height) {
+  if (!m_initialized || width <= 0 || height <= 0) {
+    return;
+  }
+  for (int i = 0; i < SLOT_COUNT; ++i) {
+    Collect(m_slots[(m_nextSlot + i) % SLOT_COUNT], false);
+  }
+
+  Slot &slot = m_slots[m_nextSlot];
+  const bool slotFree = slot.fence == nullptr;
+  uint64_t activeSession = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_requestMutex);
+    activeSession = m_recording.session;
+    if (slotFree) {
+      // A screenshot request stays queued until a slot is free for it
+      slot.screenshotPath.swap(m_screenshotPath);
+      m_screenshotPath.clear();
+      slot.screenshotFormat = m_screenshotFormat;
+      if (m_recording.session != 0) {
+        slot.record = m_recording;
+        m_recording.frameIndex++;
+      }
+    }
+  }
+  if (!slotFree && activeSession != 0) {
+    m_dropped++; // GPU more than SLOT_COUNT frames behind
+  }
+
+  // A stopped recording is closed once its last frame is out of the ring
+  if (m_openSession != 0 && m_openSession != activeSession &&
+      std::none_of(std::begin(m_slots), std::end(m_slots),
+                   [this](const Slot &s) {
+                     return s.fence != nullptr &&
+                            s.record.session == m_openSession;
+                   })) {
+    Job close;
+    close.record.session = m_openSession;
+    Enqueue(std::move(close));
+    m_openSession = 0;
+  }
+
+  if (!slotFree || (slot.screenshotPath.empty() && slot.record.session == 0)) {
+    return;
+  }
+
+  GLsizeiptr bytes = static_cast<GLsizeiptr>(width) * height * 4;
+  GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+  if (slot.capacity < bytes) {
+    // Geometric, so a window being resized doesn't reallocate every frame
+    slot.capacity = std::max(bytes, slot.capacity + slot.capacity / 2);
+    glBufferData(GL_PIXEL_PACK_BUFFER, slot.capacity, nullptr,
+                 GL_STREAM_READ);
+  }
+  // Into the PBO: returns immediately, the copy happens on the GPU timeline
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.width = width;
+  slot.height = height;
+  m_captured++;
+  if (slot.record.session != 0) {
+    m_openSession = slot.record.session;
+  }
+  m_nextSlot = (m_nextSlot + 1) % SLOT_COUNT;
+}
+
+// Returns false if the readback hasn't finished (only when not waiting)
+bool FrameCapture::Collect(Slot &slot, bool wait) {
+  if (slot.fence == nullptr) {
+    return true;
+  }
+  GLenum status =
+      glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                       wait ? ONE_SECOND : 0);
+  if (status == GL_TIMEOUT_EXPIRED && !wait) {
+    return false;
+  }
+  glDeleteSync(slot.fence);
+  slot.fence = nullptr;
+
+  Job job;
+  job.width = slot.width;
+  job.height = slot.height;
+  job.screenshotPath = std::move(slot.screenshotPath);
+  job.screenshotFormat = slot.screenshotFormat;
+  job.record = std::move(slot.record);
+  slot.screenshotPath.clear();
+  slot.record = RecordTarget();
+  if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+    m_dropped++;
+    return true;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    if (m_jobs.size() >= MAX_QUEUED_JOBS) {
+      // The worker is behind: drop the recorded frame, but never a
+      // screenshot that was asked for explicitly
+      if (job.record.session != 0) {
+        m_dropped++;
+        job.record = RecordTarget();
+      }
+      if (job.screenshotPath.empty()) {
+        return true;
+      }
+    }
+    if (!m_freeBuffers.empty()) {
+      job.pixels = std::move(m_freeBuffers.back());
+      m_freeBuffers.pop_back();
+    }
+  }
+
+  size_t bytes = static_cast<size_t>(job.width) * job.height * 4;
+  job.pixels.resize(bytes);
+  GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+  void *data =
+      glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                       static_cast<GLsizeiptr>(bytes), GL_MAP_READ_BIT);
+  if (data == nullptr) {
+    m_dropped++;
+    return true;
+  }
+  std::memcpy(job.pixels.data(), data, bytes);
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  Enqueue(std::move(job));
+  return true;
+}
+
+void FrameCapture::Enqueue(Job &&job) {
+  {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_jobs.push_back(std::move(job));
+  }
+  m_queueCondition.notify_one();
+}
+
+void FrameCapture::WorkerMain() {
+  std::unique_lock<std::mutex> lock(m_queueMutex);
+  for (;;) {
+    m_queueCondition.wait(lock,
+                          [this] { return m_stopWorker || !m_jobs.empty(); });
+    if (m_jobs.empty()) {
+      break; // Stopping, and everything queued is written
+    }
+    Job job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    lock.unlock();
+
+    WriteJob(job);
+
+    lock.lock();
+    if (job.pixels.capacity() > 0) {
+      m_freeBuffers.push_back(std::move(job.pixels));
+    }
+  }
+  lock.unlock();
+  CloseRecording();
+}
+
+void FrameCapture::WriteJob(const Job &job) {
+  if (job.pixels.empty()) {
+    if (job.record.session == m_streamSession) {
+      CloseRecording();
+    }
+    return;
+  }
+
+  if (!job.screenshotPath.empty() &&
+      WriteImage(job.screenshotPath, job.screenshotFormat, job.pixels,
+                 job.width, job.height)) {
+    std::cout << "Saved screenshot " << job.screenshotPath << "\n";
+  }
+
+  const RecordTarget &record = job.record;
+  if (record.session == 0) {
+    return;
+  }
+  if (record.format != Format::Y4M) {
+    if (WriteImage(SequencePath(record.path, record.frameIndex),
+                   record.format, job.pixels, job.width, job.height)) {
+      m_written++;
+    }
+    return;
+  }
+
+  if (record.session != m_streamSession) {
+    CloseRecording();
+    m_stream.open(record.path, std::ios::binary | std::ios::trunc);
+    if (!m_stream) {
+      std::cerr << "FrameCapture: cannot write " << record.path << "\n";
+      return;
+    }
+    m_streamSession = record.session;
+    m_streamWidth = job.width;
+    m_streamHeight = job.height;
+    m_stream << "YUV4MPEG2 W" << job.width << " H" << job.height << " F"
+             << record.fps << ":1 Ip A1:1 C420jpeg\n";
+    std::cout << "Recording to " << record.path << "\n";
+  }
+  if (!m_stream || job.width != m_streamWidth ||
+      job.height != m_streamHeight) {
+    m_dropped++; // Y4M can't change size mid-stream
+    return;
+  }
+  ConvertToYUV420(job.pixels, job.width, job.height, m_yuv);
+  m_stream << "FRAME\n";
+  m_stream.write(reinterpret_cast<const char *>(m_yuv.data()),
+                 static_cast<std::streamsize>(m_yuv.size()));
+  m_written++;
+}
+
+void FrameCapture::CloseRecording() {
+  if (m_stream.is_open()) {
+    m_stream.close();
+  }
+  m_streamSession = 0;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Screenshots and frame recording without stalling the pipeline. Frames are
+// read back into a ring of pixel buffer objects, each guarded by a fence, and
+// mapped only once the fence has signaled (normally 2-3 frames later).
+// Encoding and file I/O happen on a worker thread. If the ring or the
+// worker's queue is full, the frame is dropped from the capture rather than
+// waited on, so recording never holds back the frame rate.
+//
+// Requests come from the main thread; readback runs on the thread that owns
+// the GL context (CaptureFrame, once per frame, before the swap).
+class FrameCapture {
+public:
+  enum class Format {
+    PPM, // Binary P6
+    PNG, // RGB, uncompressed (stored deflate blocks)
+    Y4M  // YUV 4:2:0 stream; recording only
+  };
+
+  struct Stats {
+    bool recording = false;
+    uint64_t captured = 0; // Frames read back
+    uint64_t written = 0;  // Frames encoded and written
+    uint64_t dropped = 0;  // Frames skipped because the ring or queue was full
+  };
+
+  FrameCapture() = default;
+  ~FrameCapture();
+  FrameCapture(const FrameCapture &) = delete;
+  FrameCapture &operator=(const FrameCapture &) = delete;
+
+  // Needs a current GL context; starts the worker
+  bool Initialize();
+  // Waits for frames still in flight, then stops the worker
+  void Cleanup();
+
+  // --- Main thread ---
+  // The format follows the extension (.png, .ppm)
+  bool RequestScreenshot(const std::string &path);
+  // path.y4m records one Y4M stream; path.png / path.ppm records numbered
+  // images (path_00000.png, ...)
+  bool StartRecording(const std::string &path, int fps = 60);
+  void StopRecording();
+  [[nodiscard]] bool IsRecording() const;
+  // Recording, or a screenshot not yet read back
+  [[nodiscard]] bool IsActive() const;
+  [[nodiscard]] Stats GetStats() const;
+
+  // --- Render thread ---
+  // Collects finished readbacks and starts this frame's, if wanted
+  void CaptureFrame(int width, int height);
+
+  // False for unknown extensions
+  static bool FormatFromPath(const std::string &path, Format &format);
+
+private:
+  static constexpr int SLOT_COUNT = 3;
+  static constexpr size_t MAX_QUEUED_JOBS = 8;
+
+  struct RecordTarget {
+    uint64_t session = 0; // 0: not part of a recording
+    std::string path;
+    Format format = Format::PNG;
+    int fps = 60;
+    uint64_t frameIndex = 0;
+  };
+
+  struct Slot {
+    GLuint pbo = 0;
+    GLsizeiptr capacity = 0;
+    GLsync fence = nullptr; // Set while the readback is in flight
+    int width = 0;
+    int height = 0;
+    std::string screenshotPath;
+    Format screenshotFormat = Format::PNG;
+    RecordTarget record;
+  };
+
+  // One frame for the worker. No pixels: end of a recording session.
+  struct Job {
+    std::vector<uint8_t> pixels; // RGBA, bottom row first
+    int width = 0;
+    int height = 0;
+    std::string screenshotPath;
+    Format screenshotFormat = Format::PNG;
+    RecordTarget record;
+  };
+
+  bool Collect(Slot &slot, bool wait);
+  void Enqueue(Job &&job);
+  void WorkerMain();
+  void WriteJob(const Job &job);
+  void CloseRecording();
+
+  // Render thread
+  Slot m_slots[SLOT_COUNT];
+  int m_nextSlot = 0;
+  uint64_t m_openSession = 0; // Latest session seen; closed once drained
+  bool m_initialized = false;
+
+  // Requests, guarded by m_requestMutex
+  mutable std::mutex m_requestMutex;
+  std::string m_screenshotPath;
+  Format m_screenshotFormat = Format::PNG;
+  RecordTarget m_recording; // session 0 when not recording
+  uint64_t m_lastSession = 0;
+
+  // Worker queue, guarded by m_queueMutex
+  std::mutex m_queueMutex;
+  std::condition_variable m_queueCondition;
+  std::deque<Job> m_jobs;
+  std::vector<std::vector<uint8_t>> m_freeBuffers; // Recycled pixel storage
+  bool m_stopWorker = false;
+  std::thread m_worker;
+
+  // Worker only: the open Y4M stream
+  uint64_t m_streamSession = 0;
+  std::ofstream m_stream;
+  int m_streamWidth = 0;
+  int m_streamHeight = 0;
+  std::vector<uint8_t> m_yuv; // Conversion scratch
+
+  std::atomic<uint64_t> m_captured{0};
+  std::atomic<uint64_t> m_written{0};
+  std::atomic<uint64_t> m_dropped{0};
+};
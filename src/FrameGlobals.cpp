@@ -0,0 +1,38 @@
+#include "FrameGlobals.h"
+#include "GLState.h"
+
+const char *FrameGlobals::GLSL_BLOCK = R"(
+    layout (std140) uniform FrameGlobals {
+        mat4 u_projection;
+        vec2 u_viewportSize;
+        float u_time;
+        float u_dpiScale;
+    };
+)";
+
+FrameGlobals::~FrameGlobals() { Cleanup(); }
+
+bool FrameGlobals::Initialize() {
+  glGenBuffers(1, &m_UBO);
+  GLState::BindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameGlobalsData), &m_data,
+               GL_DYNAMIC_DRAW);
+
+  // Bound once; programs only need their block index pointed at it
+  GLState::BindBufferBase(GL_UNIFORM_BUFFER, BINDING_POINT, m_UBO);
+  return m_UBO != 0;
+}
+
+void FrameGlobals::Update(const FrameGlobalsData &data) {
+  if (m_UBO == 0) {
+    return;
+  }
+  m_data = data;
+  GLState::BindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameGlobalsData), &m_data);
+}
+
+void FrameGlobals::Cleanup() {
+  GLState::DeleteBuffer(m_UBO);
+  m_UBO = 0;
+}
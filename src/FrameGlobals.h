@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm.hpp>
+
+// CPU mirror of the std140 FrameGlobals uniform block. Members are ordered so
+// the C++ layout matches std140 without padding.
+struct FrameGlobalsData {
+  glm::mat4 projection{1.0f};   // offset 0
+  glm::vec2 viewportSize{0.0f}; // offset 64, framebuffer pixels
+  float time = 0.0f;            // offset 72, seconds since start
+  float dpiScale = 1.0f;        // offset 76, window content scale
+};
+static_assert(sizeof(FrameGlobalsData) == 80,
+              "FrameGlobalsData must match the std140 block layout");
+
+// Per-frame globals shared by every scene shader through one uniform buffer.
+// The buffer is bound once at BINDING_POINT; Shader injects GLSL_BLOCK into
+// every stage and points the block at that binding, so shaders just use
+// u_projection etc. and renderers upload instance data only.
+class FrameGlobals {
+public:
+  static constexpr GLuint BINDING_POINT = 0;
+  static constexpr const char *BLOCK_NAME = "FrameGlobals";
+  static const char *GLSL_BLOCK;
+
+  FrameGlobals() = default;
+  ~FrameGlobals();
+
+  bool Initialize();
+  void Update(const FrameGlobalsData &data); // Once per frame
+  void Cleanup();
+
+  [[nodiscard]] const FrameGlobalsData &GetData() const { return m_data; }
+
+private:
+  GLuint m_UBO = 0;
+  FrameGlobalsData m_data;
+};
@@ -0,0 +1,130 @@
+#include "FramePacer.h"
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+// Bounds for the spin margin: below the minimum, timer slack alone makes
+// frames late; above the maximum, spinning costs more than it saves
+constexpr double MIN_SPIN_MARGIN = 0.00025;
+constexpr double MAX_SPIN_MARGIN = 0.004;
+constexpr double OVERSHOOT_DECAY = 0.99;
+} // namespace
+
+void FramePacer::Initialize() {
+  m_tearSupported = glfwExtensionSupported("WGL_EXT_swap_control_tear") ||
+                    glfwExtensionSupported("GLX_EXT_swap_control_tear");
+}
+
+void FramePacer::SetMode(FramePacingMode mode, double targetFps) {
+  if (mode == FramePacingMode::Limited && targetFps <= 0.0) {
+    mode = FramePacingMode::Uncapped;
+  }
+  m_mode = mode;
+  m_targetFps = mode == FramePacingMode::Limited ? targetFps : 0.0;
+  m_hasDeadline = false;
+  m_intervalCount = 0;
+  m_nextInterval = 0;
+}
+
+int FramePacer::GetSwapInterval() const {
+  switch (m_mode) {
+  case FramePacingMode::VSync:
+    return 1;
+  case FramePacingMode::AdaptiveVSync:
+    return m_tearSupported ? -1 : 1;
+  case FramePacingMode::Uncapped:
+  case FramePacingMode::Limited:
+    break;
+  }
+  return 0;
+}
+
+void FramePacer::WaitForNextFrame() {
+  if (m_mode != FramePacingMode::Limited) {
+    return;
+  }
+
+  const auto period = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / m_targetFps));
+  Clock::time_point now = Clock::now();
+  if (!m_hasDeadline || now > m_nextDeadline + period) {
+    // First frame, or more than a frame late: resync instead of rushing
+    // through several frames to catch up
+    m_nextDeadline = now;
+    m_hasDeadline = true;
+  }
+
+  // Sleep up to the margin before the deadline...
+  const auto margin = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(m_sleepOvershoot));
+  Clock::time_point wakeTarget = m_nextDeadline - margin;
+  if (wakeTarget > now) {
+    std::this_thread::sleep_until(wakeTarget);
+    double overshoot =
+        std::chrono::duration<double>(Clock::now() - wakeTarget).count();
+    m_sleepOvershoot =
+        std::clamp(std::max(overshoot, m_sleepOvershoot * OVERSHOOT_DECAY),
+                   MIN_SPIN_MARGIN, MAX_SPIN_MARGIN);
+  }
+  // ...then spin the rest for a precise frame start
+  while (Clock::now() < m_nextDeadline) {
+    std::this_thread::yield();
+  }
+  m_nextDeadline += period;
+}
+
+void FramePacer::BeginFrame() {
+  Clock::time_point now = Clock::now();
+  if (m_hasLastFrame) {
+    m_intervals[m_nextInterval] =
+        std::chrono::duration<double>(now - m_lastFrameStart).count();
+    m_nextInterval = (m_nextInterval + 1) % HISTORY_SIZE;
+    m_intervalCount = std::min(m_intervalCount + 1, HISTORY_SIZE);
+  }
+  m_lastFrameStart = now;
+  m_hasLastFrame = true;
+}
+
+FramePacer::Stats FramePacer::GetStats() const {
+  Stats stats;
+  stats.samples = m_intervalCount;
+  if (m_intervalCount == 0) {
+    return stats;
+  }
+
+  double sum = 0.0;
+  double worst = 0.0;
+  for (int i = 0; i < m_intervalCount; ++i) {
+    sum += m_intervals[i];
+    worst = std::max(worst, m_intervals[i]);
+  }
+  double mean = sum / m_intervalCount;
+  double variance = 0.0;
+  for (int i = 0; i < m_intervalCount; ++i) {
+    double delta = m_intervals[i] - mean;
+    variance += delta * delta;
+  }
+  variance /= m_intervalCount;
+
+  stats.averageMs = mean * 1000.0;
+  stats.jitterMs = std::sqrt(variance) * 1000.0;
+  stats.worstMs = worst * 1000.0;
+  return stats;
+}
+
+const char *FramePacer::ModeName(FramePacingMode mode) {
+  switch (mode) {
+  case FramePacingMode::Uncapped:
+    return "uncapped";
+  case FramePacingMode::VSync:
+    return "vsync";
+  case FramePacingMode::AdaptiveVSync:
+    return "adaptive";
+  case FramePacingMode::Limited:
+    return "limited";
+  }
+  return "unknown";
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+
+enum class FramePacingMode {
+  Uncapped,      // Swap interval 0, no limiter
+  VSync,         // Swap interval 1
+  AdaptiveVSync, // Swap interval -1: late frames swap immediately and tear
+                 // instead of waiting a whole refresh (EXT_swap_control_tear)
+  Limited        // Swap interval 0, paced to a target FPS on the CPU
+};
+
+// Chooses the swap interval and, in Limited mode, holds the main loop to a
+// target frame rate. The limiter sleeps for most of the frame and spins for
+// the rest; the spin margin tracks how much the OS has recently overslept,
+// so it stays as short as the platform allows. Frame-to-frame intervals are
+// kept for jitter statistics.
+//
+// Everything runs on the main thread. The swap interval is only a request;
+// the thread owning the context applies it (see GetSwapInterval).
+class FramePacer {
+public:
+  struct Stats {
+    double averageMs = 0.0;
+    double jitterMs = 0.0; // Standard deviation of frame intervals
+    double worstMs = 0.0;
+    int samples = 0;
+  };
+
+  // Needs a current GL context, to query swap_control_tear support
+  void Initialize();
+
+  // targetFps is only used by Limited. AdaptiveVSync falls back to VSync
+  // when the driver lacks swap_control_tear.
+  void SetMode(FramePacingMode mode, double targetFps = 0.0);
+  [[nodiscard]] FramePacingMode GetMode() const { return m_mode; }
+  [[nodiscard]] double GetTargetFps() const { return m_targetFps; }
+  [[nodiscard]] bool IsAdaptiveSupported() const { return m_tearSupported; }
+  [[nodiscard]] int GetSwapInterval() const;
+
+  // Call once per frame, before input is polled
+  void WaitForNextFrame();
+  // Records the interval since the previous frame
+  void BeginFrame();
+  // The loop blocked waiting for events; the next interval isn't a frame
+  // time and is not recorded
+  void SkipInterval() { m_hasLastFrame = false; }
+
+  [[nodiscard]] Stats GetStats() const;
+  [[nodiscard]] static const char *ModeName(FramePacingMode mode);
+
+private:
+  using Clock = std::chrono::steady_clock;
+  static constexpr int HISTORY_SIZE = 120;
+
+  FramePacingMode m_mode = FramePacingMode::VSync;
+  double m_targetFps = 0.0;
+  bool m_tearSupported = false;
+
+  Clock::time_point m_nextDeadline;
+  bool m_hasDeadline = false;
+  double m_sleepOvershoot = 0.001; // Seconds, decaying maximum
+
+  Clock::time_point m_lastFrameStart;
+  bool m_hasLastFrame = false;
+  std::array<double, HISTORY_SIZE> m_intervals{}; // Seconds
+  int m_intervalCount = 0;
+  int m_nextInterval = 0;
+};
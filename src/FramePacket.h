@@ -0,0 +1,26 @@
+#pragma once
+
+#include "FrameGlobals.h"
+#include "GpuParticleSystem.h"
+#include "ParticleSystem.h"
+#include "Polyline.h"
+#include "SceneText.h"
+#include "ShapeBatchRenderer.h"
+#include "TextureAtlas.h"
+#include "UiRenderer.h"
+
+// Everything needed to draw one frame, recorded on the main thread and
+// submitted on the render thread. RenderThread double buffers packets and
+// reuses them, so their vectors keep their capacity from frame to frame.
+struct FramePacket {
+  float backgroundColor[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+  int swapInterval = 0; // Applied by the presenting thread when it changes
+  FrameGlobalsData globals;
+  ShapeBatchUpdate shapes;       // Dirty shape columns since the last packet
+  PolylineBatch polylines;       // Every polyline, reduced to the current zoom
+  ParticleBatch particles;       // Every live particle
+  GpuParticleBatch gpuParticles; // GPU emitters' parameters, no particles
+  TextBatch text;                // Every visible label's glyphs
+  DrawDataSnapshot ui;           // Copied ImGui draw data
+  AtlasUpdate atlas; // Images added to the atlas since the last packet
+};
@@ -0,0 +1,284 @@
+#include "GLState.h"
+#include <cstddef>
+#include <mutex>
+
+namespace {
+// A shadowed value; unknown until first set (or after an invalidate), so the
+// first call always reaches the driver
+template <typename T> struct Tracked {
+  T value{};
+  bool known = false;
+
+  // Returns true if the call has to be issued
+  bool Set(const T &newValue) {
+    if (known && value == newValue) {
+      return false;
+    }
+    value = newValue;
+    known = true;
+    return true;
+  }
+};
+
+struct Rect {
+  GLint x, y;
+  GLsizei width, height;
+
+  bool operator==(const Rect &o) const {
+    return x == o.x && y == o.y && width == o.width && height == o.height;
+  }
+};
+
+struct BlendFuncs {
+  GLenum srcRGB, dstRGB, srcAlpha, dstAlpha;
+
+  bool operator==(const BlendFuncs &o) const {
+    return srcRGB == o.srcRGB && dstRGB == o.dstRGB &&
+           srcAlpha == o.srcAlpha && dstAlpha == o.dstAlpha;
+  }
+};
+
+constexpr GLenum BUFFER_TARGETS[] = {
+    GL_ARRAY_BUFFER,      GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER,
+    GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER,  GL_COPY_READ_BUFFER,
+    GL_COPY_WRITE_BUFFER, GL_TRANSFORM_FEEDBACK_BUFFER,
+    GL_TEXTURE_BUFFER,    GL_DRAW_INDIRECT_BUFFER};
+constexpr int BUFFER_TARGET_COUNT =
+    sizeof(BUFFER_TARGETS) / sizeof(BUFFER_TARGETS[0]);
+
+constexpr GLenum TEXTURE_TARGETS[] = {GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY,
+                                      GL_TEXTURE_BUFFER};
+constexpr int TEXTURE_TARGET_COUNT =
+    sizeof(TEXTURE_TARGETS) / sizeof(TEXTURE_TARGETS[0]);
+constexpr int TEXTURE_UNIT_COUNT = 16;
+
+constexpr GLenum CAPABILITIES[] = {
+    GL_BLEND,        GL_SCISSOR_TEST,       GL_CULL_FACE,
+    GL_DEPTH_TEST,   GL_STENCIL_TEST,       GL_PRIMITIVE_RESTART,
+    GL_RASTERIZER_DISCARD, GL_PROGRAM_POINT_SIZE, GL_FRAMEBUFFER_SRGB};
+constexpr int CAPABILITY_COUNT = sizeof(CAPABILITIES) / sizeof(CAPABILITIES[0]);
+
+struct State {
+  Tracked<GLuint> program;
+  Tracked<GLuint> vertexArray;
+  Tracked<GLuint> buffers[BUFFER_TARGET_COUNT];
+  Tracked<GLenum> activeTexture;
+  Tracked<GLuint> textures[TEXTURE_UNIT_COUNT][TEXTURE_TARGET_COUNT];
+  Tracked<bool> capabilities[CAPABILITY_COUNT];
+  Tracked<GLenum> blendEquation;
+  Tracked<BlendFuncs> blendFuncs;
+  Tracked<Rect> scissor;
+  Tracked<Rect> viewport;
+};
+
+State s_state;
+GLState::Counters s_counters;
+GLState::Counters s_frameCounters; // Guarded by s_frameCountersMutex
+std::mutex s_frameCountersMutex;
+
+template <size_t N> int IndexOf(const GLenum (&table)[N], GLenum value) {
+  for (size_t i = 0; i < N; ++i) {
+    if (table[i] == value) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+// Records the outcome and returns whether the call has to be issued
+bool Count(GLState::Category category, bool issue) {
+  int index = static_cast<int>(category);
+  if (issue) {
+    s_counters.issued[index]++;
+  } else {
+    s_counters.skipped[index]++;
+  }
+  return issue;
+}
+
+// Texture unit the next BindTexture applies to, or -1 if it isn't known (or
+// is beyond the shadowed units) and the bind can't be filtered
+int ActiveUnit() {
+  if (!s_state.activeTexture.known) {
+    return -1;
+  }
+  int unit = static_cast<int>(s_state.activeTexture.value - GL_TEXTURE0);
+  return unit < TEXTURE_UNIT_COUNT ? unit : -1;
+}
+} // namespace
+
+uint32_t GLState::Counters::TotalIssued() const {
+  uint32_t total = 0;
+  for (uint32_t count : issued) {
+    total += count;
+  }
+  return total;
+}
+
+uint32_t GLState::Counters::TotalSkipped() const {
+  uint32_t total = 0;
+  for (uint32_t count : skipped) {
+    total += count;
+  }
+  return total;
+}
+
+void GLState::Invalidate() { s_state = State(); }
+
+void GLState::UseProgram(GLuint program) {
+  if (Count(Category::Program, s_state.program.Set(program))) {
+    glUseProgram(program);
+  }
+}
+
+void GLState::BindVertexArray(GLuint vao) {
+  if (Count(Category::VertexArray, s_state.vertexArray.Set(vao))) {
+    glBindVertexArray(vao);
+    s_state.buffers[IndexOf(BUFFER_TARGETS, GL_ELEMENT_ARRAY_BUFFER)] = {};
+  }
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer) {
+  int index = IndexOf(BUFFER_TARGETS, target);
+  bool issue = index < 0 || s_state.buffers[index].Set(buffer);
+  if (Count(Category::Buffer, issue)) {
+    glBindBuffer(target, buffer);
+  }
+}
+
+void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+  // Indexed bindings aren't shadowed; these are rare (once per buffer)
+  Count(Category::Buffer, true);
+  glBindBufferBase(target, index, buffer);
+  int slot = IndexOf(BUFFER_TARGETS, target);
+  if (slot >= 0) {
+    s_state.buffers[slot].Set(buffer);
+  }
+}
+
+void GLState::ActiveTexture(GLenum unit) {
+  if (Count(Category::Texture, s_state.activeTexture.Set(unit))) {
+    glActiveTexture(unit);
+  }
+}
+
+void GLState::BindTexture(GLenum target, GLuint texture) {
+  int unit = ActiveUnit();
+  int index = IndexOf(TEXTURE_TARGETS, target);
+  bool issue =
+      unit < 0 || index < 0 || s_state.textures[unit][index].Set(texture);
+  if (Count(Category::Texture, issue)) {
+    glBindTexture(target, texture);
+  }
+}
+
+void GLState::SetEnabled(GLenum capability, bool enabled) {
+  int index = IndexOf(CAPABILITIES, capability);
+  bool issue = index < 0 || s_state.capabilities[index].Set(enabled);
+  if (Count(Category::Capability, issue)) {
+    if (enabled) {
+      glEnable(capability);
+    } else {
+      glDisable(capability);
+    }
+  }
+}
+
+void GLState::BlendEquation(GLenum mode) {
+  if (Count(Category::Blend, s_state.blendEquation.Set(mode))) {
+    glBlendEquation(mode);
+  }
+}
+
+void GLState::BlendFunc(GLenum src, GLenum dst) {
+  BlendFuncSeparate(src, dst, src, dst);
+}
+
+void GLState::BlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha,
+                                GLenum dstAlpha) {
+  BlendFuncs funcs = {srcRGB, dstRGB, srcAlpha, dstAlpha};
+  if (Count(Category::Blend, s_state.blendFuncs.Set(funcs))) {
+    glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+  }
+}
+
+void GLState::Scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+  if (Count(Category::Scissor, s_state.scissor.Set({x, y, width, height}))) {
+    glScissor(x, y, width, height);
+  }
+}
+
+void GLState::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  if (Count(Category::Viewport, s_state.viewport.Set({x, y, width, height}))) {
+    glViewport(x, y, width, height);
+  }
+}
+
+// Deleting a bound object resets its bindings to 0 in GL, and the name may
+// be handed out again; forget the shadowed binding either way
+void GLState::DeleteProgram(GLuint program) {
+  if (program == 0) {
+    return;
+  }
+  glDeleteProgram(program);
+  if (s_state.program.value == program) {
+    s_state.program = {};
+  }
+}
+
+void GLState::DeleteVertexArray(GLuint vao) {
+  if (vao == 0) {
+    return;
+  }
+  glDeleteVertexArrays(1, &vao);
+  if (s_state.vertexArray.value == vao) {
+    s_state.vertexArray = {};
+  }
+}
+
+void GLState::DeleteBuffer(GLuint buffer) {
+  if (buffer == 0) {
+    return;
+  }
+  glDeleteBuffers(1, &buffer);
+  for (Tracked<GLuint> &binding : s_state.buffers) {
+    if (binding.value == buffer) {
+      binding = {};
+    }
+  }
+}
+
+void GLState::DeleteTexture(GLuint texture) {
+  if (texture == 0) {
+    return;
+  }
+  glDeleteTextures(1, &texture);
+  for (auto &unit : s_state.textures) {
+    for (Tracked<GLuint> &binding : unit) {
+      if (binding.value == texture) {
+        binding = {};
+      }
+    }
+  }
+}
+
+void GLState::EndFrame() {
+  {
+    std::lock_guard<std::mutex> lock(s_frameCountersMutex);
+    s_frameCounters = s_counters;
+  }
+  s_counters = Counters();
+}
+
+GLState::Counters GLState::GetFrameCounters() {
+  std::lock_guard<std::mutex> lock(s_frameCountersMutex);
+  return s_frameCounters;
+}
+
+const char *GLState::CategoryName(Category category) {
+  static const char *const names[CATEGORY_COUNT] = {
+      "Program", "VertexArray", "Buffer", "Texture",
+      "Blend",   "Capability",  "Scissor", "Viewport"};
+  int index = static_cast<int>(category);
+  return index >= 0 && index < CATEGORY_COUNT ? names[index] : "Unknown";
+}
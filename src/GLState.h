@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+
+// Shadow copy of the GL state the renderers touch (program, VAO, buffer and
+// texture bindings, blend, capabilities, scissor, viewport). Calls that would
+// set a value the context already holds are skipped and counted, so passes
+// can state everything they depend on without paying for redundant binds,
+// and no pass needs to back up and restore state around itself.
+//
+// The cache is only correct while every change to tracked state goes
+// through here. Code that touches GL directly (third-party callbacks, ...)
+// must call Invalidate() afterwards. Objects must be deleted through the
+// Delete* helpers so a recycled name is never mistaken for a live binding.
+class GLState {
+public:
+  enum class Category {
+    Program,
+    VertexArray,
+    Buffer,
+    Texture,
+    Blend,
+    Capability,
+    Scissor,
+    Viewport,
+    Count
+  };
+  static constexpr int CATEGORY_COUNT = static_cast<int>(Category::Count);
+
+  struct Counters {
+    uint32_t issued[CATEGORY_COUNT] = {};
+    uint32_t skipped[CATEGORY_COUNT] = {};
+
+    [[nodiscard]] uint32_t TotalIssued() const;
+    [[nodiscard]] uint32_t TotalSkipped() const;
+  };
+
+  // Forgets everything; the next call of each kind reaches the driver
+  static void Invalidate();
+
+  static void UseProgram(GLuint program);
+  // Element array bindings live in the VAO, so switching VAOs forgets them
+  static void BindVertexArray(GLuint vao);
+  static void BindBuffer(GLenum target, GLuint buffer);
+  // Also replaces the generic binding of target, as glBindBufferBase does
+  static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+  static void ActiveTexture(GLenum unit);
+  // Binds to the active texture unit
+  static void BindTexture(GLenum target, GLuint texture);
+
+  static void SetEnabled(GLenum capability, bool enabled);
+  static void BlendEquation(GLenum mode);
+  static void BlendFunc(GLenum src, GLenum dst);
+  static void BlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha,
+                                GLenum dstAlpha);
+  static void Scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+  static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+  static void DeleteProgram(GLuint program);
+  static void DeleteVertexArray(GLuint vao);
+  static void DeleteBuffer(GLuint buffer);
+  static void DeleteTexture(GLuint texture);
+
+  // Latches this frame's counters (see GetFrameCounters) and resets them
+  static void EndFrame();
+  // Counters of the last completed frame. Safe to call from any thread;
+  // everything else must run on the thread that owns the context.
+  [[nodiscard]] static Counters GetFrameCounters();
+  [[nodiscard]] static const char *CategoryName(Category category);
+};
@@ -0,0 +1,398 @@
+#include "GpuParticleSystem.h"
+#include "GLState.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+// One particle per vertex, written back through transform feedback. Dead
+// slots in this frame's part of the ring respawn at the emitter, then every
+// live particle takes the same semi-implicit Euler step as on the CPU.
+const char *s_updateVertexShaderSource = R"(
+    #version 410 core
+    layout (location = 0) in vec2 aPosition;
+    layout (location = 1) in vec2 aVelocity;
+    // Share of life spent (1 once dead) and share spent per second
+    layout (location = 2) in vec2 aLife;
+
+    uniform float u_deltaTime;
+    uniform vec2 u_emitterPosition;
+    uniform vec2 u_gravity;
+    uniform float u_damping; // Share of the velocity kept over this step
+    uniform float u_direction;
+    uniform float u_spread;
+    uniform vec2 u_speed;    // Min, max
+    uniform vec2 u_lifetime; // Min, max seconds
+    uniform int u_slots;
+    uniform int u_spawnBegin;
+    uniform int u_spawnCount;
+    uniform int u_seed;
+
+    out vec2 tfPosition;
+    out vec2 tfVelocity;
+    out vec2 tfLife;
+
+    uint Hash(uint x) {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // Uniform in [0, 1)
+    float Random(inout uint state) {
+        state = Hash(state);
+        return float(state >> 8) * (1.0 / 16777216.0);
+    }
+
+    void main() {
+        vec2 position = aPosition;
+        vec2 velocity = aVelocity;
+        vec2 life = aLife;
+
+        int ring = gl_VertexID - u_spawnBegin;
+        if (ring < 0) {
+            ring += u_slots;
+        }
+        if (life.x >= 1.0 && ring < u_spawnCount) {
+            uint state = Hash(uint(u_seed)) ^ uint(gl_VertexID);
+            float angle = u_direction + (Random(state) - 0.5) * u_spread;
+            float speed = mix(u_speed.x, u_speed.y, Random(state));
+            position = u_emitterPosition;
+            velocity = vec2(cos(angle), sin(angle)) * speed;
+            life = vec2(0.0,
+                        1.0 / mix(u_lifetime.x, u_lifetime.y, Random(state)));
+        }
+        if (life.x < 1.0) {
+            velocity = (velocity + u_gravity * u_deltaTime) * u_damping;
+            position += velocity * u_deltaTime;
+            life.x = min(life.x + life.y * u_deltaTime, 1.0);
+        }
+
+        tfPosition = position;
+        tfVelocity = velocity;
+        tfLife = life;
+    }
+)";
+
+// Never runs: the update draws with rasterization off
+const char *s_updateFragmentShaderSource = R"(
+    #version 410 core
+    out vec4 FragColor;
+
+    void main() {
+        FragColor = vec4(0.0);
+    }
+)";
+
+constexpr size_t FLOATS_PER_PARTICLE = 6;
+constexpr GLsizei PARTICLE_STRIDE = FLOATS_PER_PARTICLE * sizeof(float);
+
+// Emitters stay live this long past their longest life, so rounding in the
+// GPU's ages never leaves a particle one step short of dying
+constexpr float LIFE_SLACK = 0.1f;
+} // namespace
+
+uint32_t GpuParticleSystem::CreateEmitter(const EmitterSettings &settings) {
+  const uint32_t id = m_nextId++;
+  Emitter &emitter = m_emitters[id];
+  emitter.settings = settings;
+  // Distinct seeds, so emitters created together differ
+  emitter.seed = m_nextSeed;
+  m_nextSeed = m_nextSeed * 747796405u + 2891336453u;
+  return id;
+}
+
+bool GpuParticleSystem::DestroyEmitter(uint32_t id) {
+  return m_emitters.erase(id) > 0;
+}
+
+void GpuParticleSystem::Clear() { m_emitters.clear(); }
+
+EmitterSettings *GpuParticleSystem::GetSettings(uint32_t id) {
+  auto it = m_emitters.find(id);
+  return it != m_emitters.end() ? &it->second.settings : nullptr;
+}
+
+void GpuParticleSystem::Burst(uint32_t id, uint32_t count) {
+  auto it = m_emitters.find(id);
+  if (it != m_emitters.end()) {
+    Emitter &emitter = it->second;
+    emitter.burst = std::min(emitter.burst + std::min(count, MAX_PARTICLES),
+                             MAX_PARTICLES);
+  }
+}
+
+void GpuParticleSystem::Update(float deltaTime) {
+  m_deltaTime = deltaTime;
+  for (auto &[id, emitter] : m_emitters) {
+    const EmitterSettings &settings = emitter.settings;
+    const uint32_t slots = SlotCount(settings);
+    // The rate's fractions carry over, so low rates still spawn steadily
+    emitter.spawnCarry = std::min(
+        emitter.spawnCarry + std::max(settings.rate, 0.0f) * deltaTime,
+        static_cast<float>(slots));
+    const auto due = static_cast<uint32_t>(emitter.spawnCarry);
+    emitter.spawnCarry -= static_cast<float>(due);
+
+    emitter.cursor = slots > 0 ? emitter.cursor % slots : 0;
+    emitter.spawnBegin = emitter.cursor;
+    emitter.spawnCount = std::min(due + emitter.burst, slots);
+    emitter.burst = 0;
+    if (emitter.spawnCount > 0) {
+      emitter.cursor = (emitter.cursor + emitter.spawnCount) % slots;
+    }
+    emitter.seed = emitter.seed * 747796405u + 2891336453u;
+
+    emitter.liveFor -= deltaTime;
+    if (emitter.spawnCount > 0) {
+      const float lifetimeMax =
+          std::max({settings.lifetimeMin, settings.lifetimeMax, 1e-3f});
+      emitter.liveFor = std::max(emitter.liveFor, lifetimeMax + LIFE_SLACK);
+    }
+  }
+}
+
+void GpuParticleSystem::Emit(GpuParticleBatch &batch) const {
+  batch.deltaTime = m_deltaTime;
+  batch.emitters.clear();
+  for (const auto &[id, emitter] : m_emitters) {
+    GpuEmitterFrame frame;
+    frame.id = id;
+    frame.settings = emitter.settings;
+    frame.settings.maxParticles = SlotCount(emitter.settings);
+    frame.spawnBegin = emitter.spawnBegin;
+    frame.spawnCount = emitter.spawnCount;
+    frame.seed = emitter.seed;
+    frame.live = emitter.liveFor > 0.0f;
+    batch.emitters.push_back(frame);
+  }
+}
+
+size_t GpuParticleSystem::Capacity() const {
+  size_t slots = 0;
+  for (const auto &[id, emitter] : m_emitters) {
+    slots += SlotCount(emitter.settings);
+  }
+  return slots;
+}
+
+bool GpuParticleSystem::IsActive() const {
+  for (const auto &[id, emitter] : m_emitters) {
+    if (emitter.liveFor > 0.0f || emitter.burst > 0 ||
+        (emitter.settings.rate > 0.0f && SlotCount(emitter.settings) > 0)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t GpuParticleSystem::SlotCount(const EmitterSettings &settings) {
+  return std::min(settings.maxParticles, MAX_PARTICLES);
+}
+
+GpuParticleRenderer::~GpuParticleRenderer() { Cleanup(); }
+
+bool GpuParticleRenderer::Initialize(ResourceManager *resources) {
+  m_updateShader = resources->AcquireProgram(
+      s_updateVertexShaderSource, s_updateFragmentShaderSource,
+      {"tfPosition", "tfVelocity", "tfLife"});
+  // The same program as ParticleRenderer's, so both share one
+  m_drawShader = resources->AcquireProgram(ParticleRenderer::VERTEX_SHADER,
+                                           ParticleRenderer::FRAGMENT_SHADER);
+  if (!m_updateShader || !m_drawShader) {
+    std::cerr << "GpuParticleRenderer::Initialize: failed to build the "
+                 "particle shaders\n";
+    return false;
+  }
+  m_deltaTimeUniform = m_updateShader->GetUniform<float>("u_deltaTime");
+  m_emitterPositionUniform =
+      m_updateShader->GetUniform<glm::vec2>("u_emitterPosition");
+  m_gravityUniform = m_updateShader->GetUniform<glm::vec2>("u_gravity");
+  m_dampingUniform = m_updateShader->GetUniform<float>("u_damping");
+  m_directionUniform = m_updateShader->GetUniform<float>("u_direction");
+  m_spreadUniform = m_updateShader->GetUniform<float>("u_spread");
+  m_speedUniform = m_updateShader->GetUniform<glm::vec2>("u_speed");
+  m_lifetimeUniform = m_updateShader->GetUniform<glm::vec2>("u_lifetime");
+  m_slotsUniform = m_updateShader->GetUniform<int>("u_slots");
+  m_spawnBeginUniform = m_updateShader->GetUniform<int>("u_spawnBegin");
+  m_spawnCountUniform = m_updateShader->GetUniform<int>("u_spawnCount");
+  m_seedUniform = m_updateShader->GetUniform<int>("u_seed");
+
+  m_startColorUniform = m_drawShader->GetUniform<glm::vec4>("u_startColor");
+  m_endColorUniform = m_drawShader->GetUniform<glm::vec4>("u_endColor");
+  m_sizeUniform = m_drawShader->GetUniform<glm::vec2>("u_size");
+  return true;
+}
+
+void GpuParticleRenderer::Submit(const GpuParticleBatch &batch,
+                                 RenderQueue &queue) {
+  if (!m_updateShader) {
+    return;
+  }
+  m_batch = &batch;
+  ++m_frame;
+
+  DrawCommand command;
+  command.program = m_drawShader->ID;
+  command.execute = &GpuParticleRenderer::DrawParticles;
+  command.context = this;
+  bool stepping = false;
+  for (size_t i = 0; i < batch.emitters.size(); ++i) {
+    const GpuEmitterFrame &frame = batch.emitters[i];
+    Emitter &emitter = m_emitters[frame.id];
+    emitter.lastFrame = m_frame;
+    const uint32_t slots = frame.settings.maxParticles;
+    if (emitter.slots != slots) {
+      Release(emitter); // A new ring, and every particle gone
+      if (slots > 0 && !Allocate(emitter, slots)) {
+        Release(emitter);
+      }
+    }
+    if (emitter.slots == 0 || !frame.live) {
+      continue;
+    }
+    if (!stepping) {
+      m_updateShader->Use();
+      GLState::SetEnabled(GL_RASTERIZER_DISCARD, true);
+      stepping = true;
+    }
+    Step(frame, emitter, batch.deltaTime);
+
+    command.vertexArray = emitter.drawArrays[emitter.current];
+    command.blend = frame.settings.blend;
+    command.argument = static_cast<uint32_t>(i);
+    queue.Submit(command, frame.settings.layer);
+  }
+  if (stepping) {
+    GLState::SetEnabled(GL_RASTERIZER_DISCARD, false);
+  }
+
+  for (auto it = m_emitters.begin(); it != m_emitters.end();) {
+    if (it->second.lastFrame != m_frame) {
+      Release(it->second);
+      it = m_emitters.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// Runs with the update program in use and rasterization off
+void GpuParticleRenderer::Step(const GpuEmitterFrame &frame, Emitter &emitter,
+                               float deltaTime) {
+  const EmitterSettings &settings = frame.settings;
+  const float lifetimeMin = std::max(settings.lifetimeMin, 1e-3f);
+  const float lifetimeMax = std::max(settings.lifetimeMax, lifetimeMin);
+  const Shader &shader = *m_updateShader;
+  shader.Set(m_deltaTimeUniform, deltaTime);
+  shader.Set(m_emitterPositionUniform, settings.position);
+  shader.Set(m_gravityUniform, settings.gravity);
+  shader.Set(m_dampingUniform,
+             std::exp(-std::max(settings.drag, 0.0f) * deltaTime));
+  shader.Set(m_directionUniform, settings.direction);
+  shader.Set(m_spreadUniform, settings.spread);
+  shader.Set(m_speedUniform, glm::vec2(settings.speedMin, settings.speedMax));
+  shader.Set(m_lifetimeUniform, glm::vec2(lifetimeMin, lifetimeMax));
+  shader.Set(m_slotsUniform, static_cast<int>(emitter.slots));
+  shader.Set(m_spawnBeginUniform, static_cast<int>(frame.spawnBegin));
+  shader.Set(m_spawnCountUniform, static_cast<int>(frame.spawnCount));
+  shader.Set(m_seedUniform, static_cast<int>(frame.seed));
+
+  // Reads the current buffer, captures into the other one
+  const int next = 1 - emitter.current;
+  GLState::BindVertexArray(emitter.updateArrays[emitter.current]);
+  GLState::BindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0,
+                          emitter.buffers[next]);
+  glBeginTransformFeedback(GL_POINTS);
+  glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(emitter.slots));
+  glEndTransformFeedback();
+  emitter.current = next;
+}
+
+// Runs with the draw program and the emitter's draw VAO bound by the queue
+void GpuParticleRenderer::DrawParticles(void *context, uint32_t drawIndex) {
+  auto *renderer = static_cast<GpuParticleRenderer *>(context);
+  const EmitterSettings &settings =
+      renderer->m_batch->emitters[drawIndex].settings;
+  const Shader &shader = *renderer->m_drawShader;
+  shader.Set(renderer->m_startColorUniform, settings.startColor);
+  shader.Set(renderer->m_endColorUniform, settings.endColor);
+  shader.Set(renderer->m_sizeUniform,
+             glm::vec2(settings.startSize, settings.endSize));
+  // Every slot; the dead ones collapse in the vertex shader
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                        static_cast<GLsizei>(settings.maxParticles));
+}
+
+bool GpuParticleRenderer::Allocate(Emitter &emitter, uint32_t slots) {
+  glGenBuffers(2, emitter.buffers);
+  glGenVertexArrays(2, emitter.updateArrays);
+  glGenVertexArrays(2, emitter.drawArrays);
+  emitter.slots = slots;
+  emitter.current = 0;
+
+  // Every slot starts out dead; the other buffer is written before it is
+  // ever read
+  std::vector<float> dead(slots * FLOATS_PER_PARTICLE, 0.0f);
+  for (size_t i = 4; i < dead.size(); i += FLOATS_PER_PARTICLE) {
+    dead[i] = 1.0f;
+  }
+  const auto bytes = static_cast<GLsizeiptr>(dead.size() * sizeof(float));
+  for (int i = 0; i < 2; ++i) {
+    GLState::BindBuffer(GL_ARRAY_BUFFER, emitter.buffers[i]);
+    glBufferData(GL_ARRAY_BUFFER, bytes, i == 0 ? dead.data() : nullptr,
+                 GL_DYNAMIC_COPY);
+
+    // Position, velocity and life as vec2s
+    GLState::BindVertexArray(emitter.updateArrays[i]);
+    for (GLuint attrib = 0; attrib <= 2; ++attrib) {
+      glEnableVertexAttribArray(attrib);
+      glVertexAttribPointer(attrib, 2, GL_FLOAT, GL_FALSE, PARTICLE_STRIDE,
+                            (void *)(attrib * 2 * sizeof(float)));
+    }
+
+    // x, y and the share of life spent, per instance
+    GLState::BindVertexArray(emitter.drawArrays[i]);
+    const size_t offsets[] = {0, 1, 4};
+    for (GLuint attrib = 0; attrib <= 2; ++attrib) {
+      glEnableVertexAttribArray(attrib);
+      glVertexAttribPointer(attrib, 1, GL_FLOAT, GL_FALSE, PARTICLE_STRIDE,
+                            (void *)(offsets[attrib] * sizeof(float)));
+      glVertexAttribDivisor(attrib, 1);
+    }
+  }
+  return emitter.buffers[0] != 0 && emitter.buffers[1] != 0 &&
+         emitter.updateArrays[0] != 0 && emitter.updateArrays[1] != 0 &&
+         emitter.drawArrays[0] != 0 && emitter.drawArrays[1] != 0;
+}
+
+void GpuParticleRenderer::Release(Emitter &emitter) {
+  for (int i = 0; i < 2; ++i) {
+    GLState::DeleteVertexArray(emitter.updateArrays[i]);
+    GLState::DeleteVertexArray(emitter.drawArrays[i]);
+    GLState::DeleteBuffer(emitter.buffers[i]);
+    emitter.updateArrays[i] = emitter.drawArrays[i] = emitter.buffers[i] = 0;
+  }
+  emitter.slots = 0;
+}
+
+size_t GpuParticleRenderer::GetBufferBytes() const {
+  size_t bytes = 0;
+  for (const auto &[id, emitter] : m_emitters) {
+    bytes += 2 * emitter.slots * FLOATS_PER_PARTICLE * sizeof(float);
+  }
+  return bytes;
+}
+
+void GpuParticleRenderer::Cleanup() {
+  for (auto &[id, emitter] : m_emitters) {
+    Release(emitter);
+  }
+  m_emitters.clear();
+  m_batch = nullptr;
+  m_updateShader.Reset();
+  m_drawShader.Reset();
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "ParticleSystem.h"
+#include "RenderQueue.h"
+#include "ResourceManager.h"
+#include "Shader.h"
+#include <cstdint>
+#include <glm.hpp>
+#include <map>
+#include <vector>
+
+// One GPU emitter's step for a frame. The ring slots [spawnBegin,
+// spawnBegin + spawnCount), modulo settings.maxParticles, respawn if dead.
+struct GpuEmitterFrame {
+  uint32_t id = 0;
+  EmitterSettings settings; // maxParticles already capped
+  uint32_t spawnBegin = 0;
+  uint32_t spawnCount = 0;
+  uint32_t seed = 0; // Differs every frame
+  bool live = true;  // False once every particle died: nothing to step
+};
+
+// A frame's GPU particle step: emitter parameters only, the particles
+// themselves never leave the GPU
+struct GpuParticleBatch {
+  float deltaTime = 0.0f;
+  std::vector<GpuEmitterFrame> emitters;
+
+  void Clear() {
+    deltaTime = 0.0f;
+    emitters.clear();
+  }
+};
+
+// Emitters whose particles are spawned, moved and retired on the GPU (see
+// GpuParticleRenderer), for counts beyond what ParticleSystem integrates in
+// a frame. This side keeps the settings and decides how many particles
+// each emitter spawns per frame; nothing is read back, so there is no live
+// count, only each emitter's slots.
+//
+// An emitter owns maxParticles slots and spawns into them in ring order. A
+// slot whose turn comes while its particle still lives skips that spawn,
+// so rates beyond maxParticles / lifetime saturate rather than cut lives
+// short. Changing maxParticles restarts the emitter's particles.
+//
+// Emitter ids are never 0, and separate from ParticleSystem's. Main thread
+// only.
+class GpuParticleSystem {
+public:
+  static constexpr uint32_t MAX_PARTICLES = 1u << 24; // Per emitter
+
+  uint32_t CreateEmitter(const EmitterSettings &settings);
+  bool DestroyEmitter(uint32_t id);
+  void Clear();
+  // Null for unknown ids. Changes apply to particles spawned afterwards,
+  // apart from the looks, which every live particle takes on.
+  EmitterSettings *GetSettings(uint32_t id);
+  // Spawns count particles with the next step, up to the emitter's slots
+  void Burst(uint32_t id, uint32_t count);
+
+  // Decides this frame's spawns
+  void Update(float deltaTime);
+  // Fills the batch with this frame's step for the render thread
+  void Emit(GpuParticleBatch &batch) const;
+
+  [[nodiscard]] size_t EmitterCount() const { return m_emitters.size(); }
+  // Every emitter's slots: an upper bound on the live particles
+  [[nodiscard]] size_t Capacity() const;
+  // True while any emitter spawns, or spawned within its longest lifetime
+  [[nodiscard]] bool IsActive() const;
+
+private:
+  struct Emitter {
+    EmitterSettings settings;
+    float spawnCarry = 0.0f; // Fraction of a particle owed by the rate
+    uint32_t burst = 0;      // Owed by Burst()
+    uint32_t cursor = 0;     // Next ring slot to spawn into
+    uint32_t spawnBegin = 0; // This frame
+    uint32_t spawnCount = 0;
+    uint32_t seed = 0;
+    float liveFor = 0.0f; // Seconds until every particle has died
+  };
+
+  [[nodiscard]] static uint32_t SlotCount(const EmitterSettings &settings);
+
+  std::map<uint32_t, Emitter> m_emitters; // Ordered: drawn by id
+  uint32_t m_nextId = 1;
+  uint32_t m_nextSeed = 0x85EBCA6Bu;
+  float m_deltaTime = 0.0f;
+};
+
+// Runs GpuParticleBatch steps and draws the results. Each emitter has two
+// state buffers of six floats per slot (position, velocity, share of life
+// spent, share per second); the update program reads one and captures into
+// the other through transform feedback with rasterization off, spawning
+// into dead slots from the step's uniforms. The quads are then drawn
+// straight from the buffer just written, one instanced draw per emitter
+// over all of its slots, with dead ones collapsing. Buffers of emitters
+// missing from a batch are released.
+class GpuParticleRenderer {
+public:
+  GpuParticleRenderer() = default;
+  ~GpuParticleRenderer();
+  GpuParticleRenderer(const GpuParticleRenderer &) = delete;
+  GpuParticleRenderer &operator=(const GpuParticleRenderer &) = delete;
+
+  bool Initialize(ResourceManager *resources);
+  // Steps every emitter of the batch and submits its draw. The batch has to
+  // outlive the queue's Execute().
+  void Submit(const GpuParticleBatch &batch, RenderQueue &queue);
+  void Cleanup();
+
+  // State buffers of every allocated emitter, both halves
+  [[nodiscard]] size_t GetBufferBytes() const;
+
+private:
+  struct Emitter {
+    uint32_t slots = 0;
+    GLuint buffers[2] = {};
+    GLuint updateArrays[2] = {}; // Reading buffers[i] as update input
+    GLuint drawArrays[2] = {};   // Reading buffers[i] as instances
+    int current = 0;             // The buffer with the latest state
+    uint64_t lastFrame = 0;      // Last batch it was in
+  };
+
+  static bool Allocate(Emitter &emitter, uint32_t slots);
+  static void Release(Emitter &emitter);
+  void Step(const GpuEmitterFrame &frame, Emitter &emitter, float deltaTime);
+  static void DrawParticles(void *context, uint32_t drawIndex);
+
+  ProgramRef m_updateShader;
+  UniformHandle<float> m_deltaTimeUniform;
+  UniformHandle<glm::vec2> m_emitterPositionUniform;
+  UniformHandle<glm::vec2> m_gravityUniform;
+  UniformHandle<float> m_dampingUniform;
+  UniformHandle<float> m_directionUniform;
+  UniformHandle<float> m_spreadUniform;
+  UniformHandle<glm::vec2> m_speedUniform;
+  UniformHandle<glm::vec2> m_lifetimeUniform;
+  UniformHandle<int> m_slotsUniform;
+  UniformHandle<int> m_spawnBeginUniform;
+  UniformHandle<int> m_spawnCountUniform;
+  UniformHandle<int> m_seedUniform;
+
+  ProgramRef m_drawShader;
+  UniformHandle<glm::vec4> m_startColorUniform;
+  UniformHandle<glm::vec4> m_endColorUniform;
+  UniformHandle<glm::vec2> m_sizeUniform;
+
+  std::map<uint32_t, Emitter> m_emitters;
+  uint64_t m_frame = 0;
+
+  // The submitted frame, read back by DrawParticles
+  const GpuParticleBatch *m_batch = nullptr;
+};
@@ -0,0 +1,222 @@
+#include "GpuProfiler.h"
+#include <algorithm>
+#include <cstring>
+#include <imgui.h>
+#include <iostream>
+
+namespace {
+// Copied by value into the draw list's callback data buffer, so the name
+// outlives the script string and survives the UI snapshot
+struct DrawListScopeData {
+  GpuProfiler *profiler;
+  char name[48];
+};
+
+void BeginDrawListScope(const ImDrawList *, const ImDrawCmd *cmd) {
+  const auto *data =
+      static_cast<const DrawListScopeData *>(cmd->UserCallbackData);
+  data->profiler->BeginScope(data->name);
+}
+
+void EndDrawListScope(const ImDrawList *, const ImDrawCmd *cmd) {
+  const auto *data =
+      static_cast<const DrawListScopeData *>(cmd->UserCallbackData);
+  data->profiler->EndScope();
+}
+} // namespace
+
+GpuProfiler::~GpuProfiler() { Cleanup(); }
+
+bool GpuProfiler::Initialize() {
+  GLint counterBits = 0;
+  glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counterBits);
+  m_available = counterBits > 0;
+  if (!m_available) {
+    std::cerr << "GpuProfiler: no GL timestamp counter, profiling disabled\n";
+  }
+  return m_available;
+}
+
+void GpuProfiler::Cleanup() {
+  for (FrameSlot &slot : m_slots) {
+    if (!slot.queries.empty()) {
+      glDeleteQueries(static_cast<GLsizei>(slot.queries.size()),
+                      slot.queries.data());
+    }
+    slot = FrameSlot();
+  }
+  m_currentSlot = -1;
+  m_openScopes.clear();
+  m_history.clear();
+  m_available = false;
+}
+
+GLuint GpuProfiler::AcquireQuery(FrameSlot &slot) {
+  if (slot.usedQueries == slot.queries.size()) {
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    slot.queries.push_back(query);
+  }
+  return slot.queries[slot.usedQueries++];
+}
+
+void GpuProfiler::BeginFrame() {
+  if (!m_available) {
+    return;
+  }
+  m_currentSlot = (m_currentSlot + 1) % FRAME_LATENCY;
+  FrameSlot &slot = m_slots[m_currentSlot];
+  if (slot.pending) {
+    Collect(slot);
+  }
+  slot.scopes.clear();
+  slot.usedQueries = 0;
+  m_openScopes.clear();
+}
+
+void GpuProfiler::EndFrame() {
+  if (m_currentSlot < 0) {
+    return;
+  }
+  while (!m_openScopes.empty()) {
+    EndScope();
+  }
+  FrameSlot &slot = m_slots[m_currentSlot];
+  slot.pending = !slot.scopes.empty();
+}
+
+void GpuProfiler::BeginScope(const char *name) {
+  if (m_currentSlot < 0) {
+    return;
+  }
+  FrameSlot &slot = m_slots[m_currentSlot];
+  ScopeRecord &record = slot.scopes.emplace_back();
+  record.name = name;
+  record.depth = static_cast<int>(m_openScopes.size());
+  record.parent = m_openScopes.empty() ? -1 : m_openScopes.back();
+  record.beginQuery = AcquireQuery(slot);
+  record.endQuery = 0;
+  glQueryCounter(record.beginQuery, GL_TIMESTAMP);
+  m_openScopes.push_back(static_cast<int>(slot.scopes.size()) - 1);
+}
+
+void GpuProfiler::EndScope() {
+  if (m_currentSlot < 0 || m_openScopes.empty()) {
+    return; // Unbalanced end; ignored
+  }
+  FrameSlot &slot = m_slots[m_currentSlot];
+  ScopeRecord &record = slot.scopes[m_openScopes.back()];
+  m_openScopes.pop_back();
+  record.endQuery = AcquireQuery(slot);
+  glQueryCounter(record.endQuery, GL_TIMESTAMP);
+}
+
+void GpuProfiler::Collect(FrameSlot &slot) {
+  slot.pending = false;
+
+  // Queries complete in order, so the last one issued stands for the frame
+  GLuint available = GL_FALSE;
+  glGetQueryObjectuiv(slot.queries[slot.usedQueries - 1],
+                      GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available == GL_FALSE) {
+    std::lock_guard<std::mutex> lock(m_resultsMutex);
+    m_droppedFrames++;
+    return;
+  }
+
+  std::vector<ScopeResult> results;
+  results.reserve(slot.scopes.size());
+  std::vector<std::string> paths(slot.scopes.size());
+  for (size_t i = 0; i < slot.scopes.size(); ++i) {
+    const ScopeRecord &record = slot.scopes[i];
+    GLuint64 begin = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(record.beginQuery, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(record.endQuery, GL_QUERY_RESULT, &end);
+    double ms = end > begin ? static_cast<double>(end - begin) / 1.0e6 : 0.0;
+
+    paths[i] = record.parent >= 0 ? paths[record.parent] + "/" + record.name
+                                  : record.name;
+    ScopeHistory &history = m_history[paths[i]];
+    history.samples[history.next] = ms;
+    history.next = (history.next + 1) % HISTORY_SIZE;
+    history.count = std::min(history.count + 1, HISTORY_SIZE);
+
+    ScopeResult &result = results.emplace_back();
+    result.name = record.name;
+    result.depth = record.depth;
+    result.lastMs = ms;
+    double sum = 0.0;
+    for (int s = 0; s < history.count; ++s) {
+      sum += history.samples[s];
+      result.maxMs = std::max(result.maxMs, history.samples[s]);
+    }
+    result.averageMs = sum / history.count;
+  }
+
+  std::lock_guard<std::mutex> lock(m_resultsMutex);
+  m_results = std::move(results);
+}
+
+void GpuProfiler::AddDrawListScope(ImDrawList *drawList, const char *name) {
+  DrawListScopeData data = {this, {}};
+  std::strncpy(data.name, name, sizeof(data.name) - 1);
+  drawList->AddCallback(BeginDrawListScope, &data, sizeof(data));
+}
+
+void GpuProfiler::AddDrawListScopeEnd(ImDrawList *drawList) {
+  DrawListScopeData data = {this, {}};
+  drawList->AddCallback(EndDrawListScope, &data, sizeof(data));
+}
+
+std::vector<GpuProfiler::ScopeResult> GpuProfiler::GetResults() const {
+  std::lock_guard<std::mutex> lock(m_resultsMutex);
+  return m_results;
+}
+
+uint64_t GpuProfiler::GetDroppedFrames() const {
+  std::lock_guard<std::mutex> lock(m_resultsMutex);
+  return m_droppedFrames;
+}
+
+void GpuProfiler::DrawOverlay(bool *open) {
+  ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("GPU Profiler", open,
+                    ImGuiWindowFlags_AlwaysAutoResize |
+                        ImGuiWindowFlags_NoFocusOnAppearing)) {
+    ImGui::End();
+    return;
+  }
+
+  if (!m_available) {
+    ImGui::TextUnformatted("Timestamp queries not supported");
+    ImGui::End();
+    return;
+  }
+
+  const std::vector<ScopeResult> results = GetResults();
+  if (ImGui::BeginTable("scopes", 4,
+                        ImGuiTableFlags_RowBg |
+                            ImGuiTableFlags_SizingFixedFit)) {
+    ImGui::TableSetupColumn("Scope");
+    ImGui::TableSetupColumn("Last ms");
+    ImGui::TableSetupColumn("Avg ms");
+    ImGui::TableSetupColumn("Max ms");
+    ImGui::TableHeadersRow();
+    for (const ScopeResult &result : results) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%*s%s", result.depth * 2, "", result.name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", result.lastMs);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", result.averageMs);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", result.maxMs);
+    }
+    ImGui::EndTable();
+  }
+  ImGui::Text("Dropped frames: %llu",
+              static_cast<unsigned long long>(GetDroppedFrames()));
+  ImGui::End();
+}
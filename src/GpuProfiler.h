@@ -0,0 +1,119 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ImDrawList;
+
+// GPU timings for named, nestable scopes. Each scope end-point is a
+// GL_TIMESTAMP query (GL_TIME_ELAPSED queries can't nest), recorded into one
+// of FRAME_LATENCY frame slots. A slot is read back when it comes around
+// again, several frames later, so the results are already there and reading
+// never stalls the pipeline; a slot whose queries still aren't done is
+// dropped rather than waited on.
+//
+// Frames and C++ scopes are recorded on the thread owning the GL context
+// (the render thread). Results are published under a mutex and read, and
+// the overlay drawn, on the main thread. Scripts scope their UI through
+// ImDrawList callbacks, which the UI renderer runs on the render thread at
+// the right point of the UI pass (see AddDrawListScope).
+class GpuProfiler {
+public:
+  struct ScopeResult {
+    std::string name;
+    int depth = 0;
+    double lastMs = 0.0;
+    double averageMs = 0.0; // Over the last HISTORY_SIZE frames it ran in
+    double maxMs = 0.0;
+  };
+
+  // RAII scope for C++ passes
+  class Scope {
+  public:
+    Scope(GpuProfiler &profiler, const char *name) : m_profiler(profiler) {
+      m_profiler.BeginScope(name);
+    }
+    ~Scope() { m_profiler.EndScope(); }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    GpuProfiler &m_profiler;
+  };
+
+  GpuProfiler() = default;
+  ~GpuProfiler();
+  GpuProfiler(const GpuProfiler &) = delete;
+  GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+  // Needs a current GL context. Returns false (and stays disabled) when the
+  // driver has no timestamp counter.
+  bool Initialize();
+  void Cleanup();
+
+  // --- Render thread ---
+  // Collects the oldest slot's results and starts recording into it
+  void BeginFrame();
+  void EndFrame(); // Closes scopes left open
+  void BeginScope(const char *name);
+  void EndScope();
+
+  // --- Main thread ---
+  // Inserts a begin/end pair into a draw list, around the commands added in
+  // between. Both ends have to go into the same draw list.
+  void AddDrawListScope(ImDrawList *drawList, const char *name);
+  void AddDrawListScopeEnd(ImDrawList *drawList);
+
+  [[nodiscard]] std::vector<ScopeResult> GetResults() const;
+  [[nodiscard]] uint64_t GetDroppedFrames() const;
+  // ImGui window with the latest results; call between NewFrame and Render
+  void DrawOverlay(bool *open);
+
+  [[nodiscard]] bool IsAvailable() const { return m_available; }
+
+private:
+  static constexpr int FRAME_LATENCY = 4;
+  static constexpr int HISTORY_SIZE = 120;
+
+  struct ScopeRecord {
+    std::string name;
+    int depth = 0;
+    int parent = -1; // Index into the same frame's records
+    GLuint beginQuery = 0;
+    GLuint endQuery = 0;
+  };
+
+  struct FrameSlot {
+    std::vector<ScopeRecord> scopes;
+    std::vector<GLuint> queries; // Pool, grown on demand
+    size_t usedQueries = 0;
+    bool pending = false; // Recorded and not yet read back
+  };
+
+  struct ScopeHistory {
+    std::array<double, HISTORY_SIZE> samples{}; // Milliseconds
+    int count = 0;
+    int next = 0;
+  };
+
+  GLuint AcquireQuery(FrameSlot &slot);
+  void Collect(FrameSlot &slot);
+
+  bool m_available = false;
+  std::array<FrameSlot, FRAME_LATENCY> m_slots;
+  int m_currentSlot = -1; // -1 outside BeginFrame/EndFrame
+  std::vector<int> m_openScopes; // Record indices, innermost last
+
+  // Keyed by path ("Frame/Scene") so equal names under different parents
+  // stay apart. Render thread only.
+  std::unordered_map<std::string, ScopeHistory> m_history;
+
+  mutable std::mutex m_resultsMutex;
+  std::vector<ScopeResult> m_results; // Guarded by m_resultsMutex
+  uint64_t m_droppedFrames = 0;       // Guarded by m_resultsMutex
+};
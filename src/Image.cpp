@@ -0,0 +1,129 @@
+#include "Image.h"
+#include <cctype>
+#include <fstream>
+#include <iostream>
+
+namespace {
+// Next whitespace-separated header token, skipping # comments
+bool ReadToken(std::istream &in, std::string &token) {
+  token.clear();
+  int c = in.get();
+  while (c != EOF) {
+    if (c == '#') {
+      while (c != EOF && c != '\n') {
+        c = in.get();
+      }
+    } else if (std::isspace(c) == 0) {
+      break;
+    }
+    c = in.get();
+  }
+  while (c != EOF && std::isspace(c) == 0) {
+    token.push_back(static_cast<char>(c));
+    c = in.get();
+  }
+  return !token.empty(); // The single whitespace after the token is consumed
+}
+
+bool ReadPPM(std::istream &in, Image &image) {
+  std::string width, height, maxValue;
+  if (!ReadToken(in, width) || !ReadToken(in, height) ||
+      !ReadToken(in, maxValue) || maxValue != "255") {
+    return false;
+  }
+  image.width = std::stoi(width);
+  image.height = std::stoi(height);
+  if (image.width <= 0 || image.height <= 0) {
+    return false;
+  }
+  size_t count = static_cast<size_t>(image.width) * image.height;
+  std::vector<uint8_t> rgb(count * 3);
+  in.read(reinterpret_cast<char *>(rgb.data()),
+          static_cast<std::streamsize>(rgb.size()));
+  if (!in) {
+    return false;
+  }
+  image.pixels.resize(count * 4);
+  for (size_t i = 0; i < count; ++i) {
+    image.pixels[i * 4 + 0] = rgb[i * 3 + 0];
+    image.pixels[i * 4 + 1] = rgb[i * 3 + 1];
+    image.pixels[i * 4 + 2] = rgb[i * 3 + 2];
+    image.pixels[i * 4 + 3] = 255;
+  }
+  return true;
+}
+
+bool ReadPAM(std::istream &in, Image &image) {
+  int depth = 0;
+  int maxValue = 0;
+  std::string token;
+  while (ReadToken(in, token) && token != "ENDHDR") {
+    std::string value;
+    if (!ReadToken(in, value)) {
+      return false;
+    }
+    if (token == "WIDTH") {
+      image.width = std::stoi(value);
+    } else if (token == "HEIGHT") {
+      image.height = std::stoi(value);
+    } else if (token == "DEPTH") {
+      depth = std::stoi(value);
+    } else if (token == "MAXVAL") {
+      maxValue = std::stoi(value);
+    }
+  }
+  if (token != "ENDHDR" || image.width <= 0 || image.height <= 0 ||
+      maxValue != 255 || (depth != 3 && depth != 4)) {
+    return false;
+  }
+  size_t count = static_cast<size_t>(image.width) * image.height;
+  std::vector<uint8_t> data(count * depth);
+  in.read(reinterpret_cast<char *>(data.data()),
+          static_cast<std::streamsize>(data.size()));
+  if (!in) {
+    return false;
+  }
+  if (depth == 4) {
+    image.pixels = std::move(data);
+    return true;
+  }
+  image.pixels.resize(count * 4);
+  for (size_t i = 0; i < count; ++i) {
+    image.pixels[i * 4 + 0] = data[i * 3 + 0];
+    image.pixels[i * 4 + 1] = data[i * 3 + 1];
+    image.pixels[i * 4 + 2] = data[i * 3 + 2];
+    image.pixels[i * 4 + 3] = 255;
+  }
+  return true;
+}
+} // namespace
+
+bool LoadImageFile(const std::string &path, Image &image) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "LoadImageFile: cannot open " << path << "\n";
+    return false;
+  }
+
+  image = Image();
+  std::string magic;
+  bool ok = false;
+  try {
+    if (ReadToken(file, magic)) {
+      if (magic == "P6") {
+        ok = ReadPPM(file, image);
+      } else if (magic == "P7") {
+        ok = ReadPAM(file, image);
+      }
+    }
+  } catch (const std::exception &) {
+    ok = false; // Malformed number in the header
+  }
+  if (!ok || !image.IsValid()) {
+    std::cerr << "LoadImageFile: " << path
+              << " is not an 8-bit binary PPM (P6) or PAM (P7)\n";
+    image = Image();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 8-bit RGBA pixels, rows top to bottom
+struct Image {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> pixels;
+
+  [[nodiscard]] bool IsValid() const {
+    return width > 0 && height > 0 &&
+           pixels.size() == static_cast<size_t>(width) * height * 4;
+  }
+};
+
+// Reads binary PPM (P6, opaque), which FrameCapture's .ppm output uses, and
+// PAM (P7 with TUPLTYPE RGB or RGB_ALPHA), for images with alpha; both are
+// simple to parse without extra libraries. PNG is not read. Returns false
+// with a message on stderr.
+bool LoadImageFile(const std::string &path, Image &image);
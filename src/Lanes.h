@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define APP_LANES_SSE2
+#endif
+
+// Fixed-width float vectors for the CPU-side hot loops: 8 lanes with AVX2,
+// 4 with SSE2, 1 otherwise. The width follows the flags of the file that
+// includes this (see APP_RASTER_AVX2), so it all has internal linkage.
+// Comparisons return masks (all bits set per passing lane) for And() and
+// Select().
+namespace {
+#if defined(__AVX2__)
+struct Lanes {
+  static constexpr int WIDTH = 8;
+  __m256 v;
+
+  static Lanes Set(float x) { return {_mm256_set1_ps(x)}; }
+  static Lanes Ramp(float x) {
+    return {_mm256_add_ps(_mm256_set1_ps(x),
+                          _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7))};
+  }
+  static Lanes Load(const float *p) { return {_mm256_load_ps(p)}; }
+  static Lanes LoadUnaligned(const float *p) { return {_mm256_loadu_ps(p)}; }
+  void Store(float *p) const { _mm256_store_ps(p, v); }
+  void StoreUnaligned(float *p) const { _mm256_storeu_ps(p, v); }
+};
+inline Lanes operator+(Lanes a, Lanes b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline Lanes operator-(Lanes a, Lanes b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline Lanes operator*(Lanes a, Lanes b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline Lanes operator/(Lanes a, Lanes b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline Lanes Min(Lanes a, Lanes b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline Lanes Max(Lanes a, Lanes b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline Lanes Sqrt(Lanes a) { return {_mm256_sqrt_ps(a.v)}; }
+inline Lanes Abs(Lanes a) {
+  return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)};
+}
+inline Lanes Less(Lanes a, Lanes b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)};
+}
+inline Lanes Greater(Lanes a, Lanes b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)};
+}
+inline Lanes GreaterEqual(Lanes a, Lanes b) {
+  return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)};
+}
+inline Lanes And(Lanes mask, Lanes a) { return {_mm256_and_ps(mask.v, a.v)}; }
+inline Lanes Select(Lanes mask, Lanes a, Lanes b) {
+  return {_mm256_blendv_ps(b.v, a.v, mask.v)};
+}
+inline bool Any(Lanes mask) { return _mm256_movemask_ps(mask.v) != 0; }
+#elif defined(APP_LANES_SSE2)
+struct Lanes {
+  static constexpr int WIDTH = 4;
+  __m128 v;
+
+  static Lanes Set(float x) { return {_mm_set1_ps(x)}; }
+  static Lanes Ramp(float x) {
+    return {_mm_add_ps(_mm_set1_ps(x), _mm_setr_ps(0, 1, 2, 3))};
+  }
+  static Lanes Load(const float *p) { return {_mm_load_ps(p)}; }
+  static Lanes LoadUnaligned(const float *p) { return {_mm_loadu_ps(p)}; }
+  void Store(float *p) const { _mm_store_ps(p, v); }
+  void StoreUnaligned(float *p) const { _mm_storeu_ps(p, v); }
+};
+inline Lanes operator+(Lanes a, Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+inline Lanes operator-(Lanes a, Lanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline Lanes operator/(Lanes a, Lanes b) { return {_mm_div_ps(a.v, b.v)}; }
+inline Lanes Min(Lanes a, Lanes b) { return {_mm_min_ps(a.v, b.v)}; }
+inline Lanes Max(Lanes a, Lanes b) { return {_mm_max_ps(a.v, b.v)}; }
+inline Lanes Sqrt(Lanes a) { return {_mm_sqrt_ps(a.v)}; }
+inline Lanes Abs(Lanes a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+inline Lanes Less(Lanes a, Lanes b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+inline Lanes Greater(Lanes a, Lanes b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+inline Lanes GreaterEqual(Lanes a, Lanes b) {
+  return {_mm_cmpge_ps(a.v, b.v)};
+}
+inline Lanes And(Lanes mask, Lanes a) { return {_mm_and_ps(mask.v, a.v)}; }
+inline Lanes Select(Lanes mask, Lanes a, Lanes b) {
+  return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+}
+inline bool Any(Lanes mask) { return _mm_movemask_ps(mask.v) != 0; }
+#else
+struct Lanes {
+  static constexpr int WIDTH = 1;
+  float v;
+
+  static Lanes Set(float x) { return {x}; }
+  static Lanes Ramp(float x) { return {x}; }
+  static Lanes Load(const float *p) { return {*p}; }
+  static Lanes LoadUnaligned(const float *p) { return {*p}; }
+  void Store(float *p) const { *p = v; }
+  void StoreUnaligned(float *p) const { *p = v; }
+};
+inline float FromBits(uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+inline uint32_t ToBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+inline Lanes Mask(bool pass) { return {FromBits(pass ? ~0u : 0u)}; }
+inline Lanes operator+(Lanes a, Lanes b) { return {a.v + b.v}; }
+inline Lanes operator-(Lanes a, Lanes b) { return {a.v - b.v}; }
+inline Lanes operator*(Lanes a, Lanes b) { return {a.v * b.v}; }
+inline Lanes operator/(Lanes a, Lanes b) { return {a.v / b.v}; }
+inline Lanes Min(Lanes a, Lanes b) { return {std::min(a.v, b.v)}; }
+inline Lanes Max(Lanes a, Lanes b) { return {std::max(a.v, b.v)}; }
+inline Lanes Sqrt(Lanes a) { return {std::sqrt(a.v)}; }
+inline Lanes Abs(Lanes a) { return {std::fabs(a.v)}; }
+inline Lanes Less(Lanes a, Lanes b) { return Mask(a.v < b.v); }
+inline Lanes Greater(Lanes a, Lanes b) { return Mask(a.v > b.v); }
+inline Lanes GreaterEqual(Lanes a, Lanes b) { return Mask(a.v >= b.v); }
+inline Lanes And(Lanes mask, Lanes a) {
+  return {FromBits(ToBits(mask.v) & ToBits(a.v))};
+}
+inline Lanes Select(Lanes mask, Lanes a, Lanes b) {
+  return ToBits(mask.v) != 0 ? a : b;
+}
+inline bool Any(Lanes mask) { return ToBits(mask.v) != 0; }
+#endif
+
+inline Lanes Clamp01(Lanes a) {
+  return Min(Max(a, Lanes::Set(0.0f)), Lanes::Set(1.0f));
+}
+
+inline Lanes Sign(Lanes a) {
+  const Lanes zero = Lanes::Set(0.0f);
+  return Select(Greater(a, zero), Lanes::Set(1.0f),
+                Select(Less(a, zero), Lanes::Set(-1.0f), zero));
+}
+
+inline Lanes Length(Lanes x, Lanes y) { return Sqrt(x * x + y * y); }
+} // namespace
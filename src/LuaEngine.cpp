@@ -1,7 +1,10 @@
 // LuaEngine.cpp
 #include "LuaEngine.h"
 #include "Application.h"
+#include "GLState.h"
 #include "ImGuiBindings.h"
+#include <algorithm>
+#include <cstdint>
 #include <filesystem>
 #include <imgui.h>
 #include <iostream>
@@ -120,7 +123,8 @@ LuaEngine::~LuaEngine() {
   }
 }
 
-bool LuaEngine::Initialize(Application *appInstance) {
+bool LuaEngine::Initialize(Application *appInstance,
+                           const std::string &scriptPath) {
   m_app = appInstance; // Store the Application instance
   if (m_app == nullptr) {
     std::cerr << "LuaEngine::Initialize: Application instance is null\n";
@@ -137,10 +141,10 @@ bool LuaEngine::Initialize(Application *appInstance) {
   RegisterBindings();
 
   // Try to load GUI script
-  m_scriptPath = "gui.lua";
+  m_scriptPath = scriptPath;
   m_scriptLoaded = LoadScriptInternal(m_scriptPath.c_str(), L);
   if (!m_scriptLoaded) {
-    std::cout << "No gui.lua found, using default GUI\n";
+    std::cout << "No " << m_scriptPath << " found, using default GUI\n";
   } else {
     // Store initial modification time
     try {
@@ -196,13 +200,1533 @@ int LuaEngine::Lua_GetShapeColor(lua_State *L) {
   return 1; // Returns the table
 }
 
-void LuaEngine::RegisterBindings() {
-  ImGuiBindings::Register(L);
+// Shape handles cross into Lua as plain integers
+static ShapeHandle CheckShapeHandle(lua_State *L, int index) {
+  return ShapeHandle{static_cast<uint32_t>(luaL_checkinteger(L, index))};
+}
+
+int LuaEngine::Lua_AddShape(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  float x = luaL_checknumber(L, 1);
+  float y = luaL_checknumber(L, 2);
+  float size = luaL_checknumber(L, 3);
+  glm::vec4 color(1.0f);
+  color.r = luaL_optnumber(L, 4, 1.0);
+  color.g = luaL_optnumber(L, 5, 1.0);
+  color.b = luaL_optnumber(L, 6, 1.0);
+  color.a = luaL_optnumber(L, 7, 1.0);
+  ShapeHandle handle = app->AddShape(x, y, size, color);
+  if (!handle.IsValid()) {
+    lua_pushnil(L);
+    return 1;
+  }
+  lua_pushinteger(L, handle.value);
+  return 1; // Returns the shape handle
+}
+
+int LuaEngine::Lua_RemoveShape(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  bool removed = app->RemoveShape(CheckShapeHandle(L, 1));
+  lua_pushboolean(L, static_cast<int>(removed));
+  return 1;
+}
+
+int LuaEngine::Lua_MoveShape(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  ShapeHandle handle = CheckShapeHandle(L, 1);
+  float x = luaL_checknumber(L, 2);
+  float y = luaL_checknumber(L, 3);
+  app->MoveShape(handle, {x, y});
+  return 0;
+}
+
+int LuaEngine::Lua_ResizeShape(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  ShapeHandle handle = CheckShapeHandle(L, 1);
+  float width = luaL_checknumber(L, 2);
+  float height = luaL_optnumber(L, 3, width); // Square if height is omitted
+  app->ResizeShape(handle, {width, height});
+  return 0;
+}
+
+int LuaEngine::Lua_RecolorShape(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  ShapeHandle handle = CheckShapeHandle(L, 1);
+  glm::vec4 color;
+  color.r = luaL_checknumber(L, 2);
+  color.g = luaL_checknumber(L, 3);
+  color.b = luaL_checknumber(L, 4);
+  color.a = luaL_optnumber(L, 5, 1.0);
+  app->GetShapeStore().SetColor(handle, color);
+  return 0;
+}
+
+int LuaEngine::Lua_SetShapeVisible(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  ShapeHandle handle = CheckShapeHandle(L, 1);
+  bool visible = lua_toboolean(L, 2) != 0;
+  ShapeStore &store = app->GetShapeStore();
+  uint32_t flags = store.GetFlags(handle);
+  flags = visible ? (flags | ShapeFlags::Visible)
+                  : (flags & ~ShapeFlags::Visible);
+  store.SetFlags(handle, flags);
+  return 0;
+}
+
+int LuaEngine::Lua_GetShapeAt(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    lua_pushnil(L);
+    return 1;
+  }
+  float x = luaL_checknumber(L, 1);
+  float y = luaL_checknumber(L, 2);
+  ShapeHandle handle = app->GetShapeStore().HitTest({x, y});
+  if (handle.IsValid()) {
+    lua_pushinteger(L, handle.value);
+  } else {
+    lua_pushnil(L);
+  }
+  return 1; // Topmost shape handle under the point, or nil
+}
+
+// App.SetShapeRotation(id, radians); clockwise, about the shape's position
+int LuaEngine::Lua_SetShapeRotation(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  ShapeHandle handle = CheckShapeHandle(L, 1);
+  app->RotateShape(handle, static_cast<float>(luaL_checknumber(L, 2)));
+  return 0;
+}
+
+int LuaEngine::Lua_GetShapeRotation(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  lua_pushnumber(L, app->GetShapeStore().GetRotation(CheckShapeHandle(L, 1)));
+  return 1;
+}
+
+// Group handles cross into Lua as plain integers, like shape handles
+static TransformHandle CheckGroupHandle(lua_State *L, int index) {
+  return TransformHandle{static_cast<uint32_t>(luaL_checkinteger(L, index))};
+}
+
+static TransformHandle OptGroupHandle(lua_State *L, int index) {
+  return lua_isnoneornil(L, index) ? TransformHandle{}
+                                   : CheckGroupHandle(L, index);
+}
+
+// App.CreateGroup(x, y [, parent]) -> group id, or nil if parent isn't a
+// group
+int LuaEngine::Lua_CreateGroup(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  Transform2D local;
+  local.translation.x = luaL_checknumber(L, 1);
+  local.translation.y = luaL_checknumber(L, 2);
+  TransformHandle group = app->CreateGroup(local, OptGroupHandle(L, 3));
+  if (!group.IsValid()) {
+    lua_pushnil(L);
+    return 1;
+  }
+  lua_pushinteger(L, group.value);
+  return 1;
+}
+
+// App.RemoveGroup(id) -> bool; subgroups go too, shapes stay in place
+int LuaEngine::Lua_RemoveGroup(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  lua_pushboolean(L,
+                  static_cast<int>(app->RemoveGroup(CheckGroupHandle(L, 1))));
+  return 1;
+}
+
+// App.SetGroupTransform(id, x, y [, rotation [, scaleX [, scaleY]]]),
+// relative to the parent group; scaleY defaults to scaleX
+int LuaEngine::Lua_SetGroupTransform(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  TransformHandle group = CheckGroupHandle(L, 1);
+  Transform2D local;
+  local.translation.x = luaL_checknumber(L, 2);
+  local.translation.y = luaL_checknumber(L, 3);
+  local.rotation = luaL_optnumber(L, 4, 0.0);
+  local.scale.x = luaL_optnumber(L, 5, 1.0);
+  local.scale.y = luaL_optnumber(L, 6, local.scale.x);
+  if (app->IsGroup(group)) {
+    app->GetTransforms().SetLocal(group, local);
+  }
+  return 0;
+}
+
+// App.GetGroupTransform(id) -> x, y, rotation, scaleX, scaleY
+int LuaEngine::Lua_GetGroupTransform(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const Transform2D local =
+      app->GetTransforms().GetLocal(CheckGroupHandle(L, 1));
+  lua_pushnumber(L, local.translation.x);
+  lua_pushnumber(L, local.translation.y);
+  lua_pushnumber(L, local.rotation);
+  lua_pushnumber(L, local.scale.x);
+  lua_pushnumber(L, local.scale.y);
+  return 5;
+}
+
+// App.SetGroupParent(id, parent) -> bool; a nil parent makes it a root
+int LuaEngine::Lua_SetGroupParent(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  bool moved =
+      app->SetGroupParent(CheckGroupHandle(L, 1), OptGroupHandle(L, 2));
+  lua_pushboolean(L, static_cast<int>(moved));
+  return 1;
+}
+
+// App.AttachShape(shape, group) -> bool; the shape keeps its place on
+// screen and follows the group from then on
+int LuaEngine::Lua_AttachShape(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  bool attached =
+      app->AttachShape(CheckShapeHandle(L, 1), CheckGroupHandle(L, 2));
+  lua_pushboolean(L, static_cast<int>(attached));
+  return 1;
+}
+
+int LuaEngine::Lua_DetachShape(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  lua_pushboolean(L,
+                  static_cast<int>(app->DetachShape(CheckShapeHandle(L, 1))));
+  return 1;
+}
+
+// App.GetTransformStats() -> {nodes, updated}; updated is how many nodes
+// the last frame recomputed
+int LuaEngine::Lua_GetTransformStats(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const TransformHierarchy &transforms = app->GetTransforms();
+  lua_newtable(L);
+  lua_pushinteger(L, static_cast<lua_Integer>(transforms.Size()));
+  lua_setfield(L, -2, "nodes");
+  lua_pushinteger(L, static_cast<lua_Integer>(transforms.LastUpdateCount()));
+  lua_setfield(L, -2, "updated");
+  return 1;
+}
+
+static TweenProperty CheckTweenProperty(lua_State *L, int index) {
+  static const char *const names[] = {"position", "size", "rotation",
+                                      "color", nullptr};
+  static const TweenProperty values[] = {
+      TweenProperty::Position, TweenProperty::Size, TweenProperty::Rotation,
+      TweenProperty::Color};
+  return values[luaL_checkoption(L, index, nullptr, names)];
+}
+
+// A preset name or a {x1, y1, x2, y2} table; linear when absent
+static Easing OptEasing(lua_State *L, int index) {
+  Easing easing;
+  if (lua_istable(L, index)) {
+    float *points[] = {&easing.x1, &easing.y1, &easing.x2, &easing.y2};
+    for (int i = 0; i < 4; ++i) {
+      lua_rawgeti(L, index, i + 1);
+      *points[i] = static_cast<float>(luaL_checknumber(L, -1));
+      lua_pop(L, 1);
+    }
+  } else if (!lua_isnoneornil(L, index) &&
+             !Easing::FromName(luaL_checkstring(L, index), easing)) {
+    luaL_argerror(L, index, "unknown easing");
+  }
+  return easing;
+}
+
+static TweenLoop OptTweenLoop(lua_State *L, int index) {
+  static const char *const names[] = {"once", "repeat", "pingpong", nullptr};
+  static const TweenLoop values[] = {TweenLoop::Once, TweenLoop::Repeat,
+                                     TweenLoop::PingPong};
+  return values[luaL_checkoption(L, index, "once", names)];
+}
+
+// Overwrites the value's leading components with the numbers at table
+// index first onwards, stopping at the first nil. Doesn't raise, so it is
+// safe with C++ objects on the stack.
+static void ReadTweenComponents(lua_State *L, int index, int first,
+                                int count, glm::vec4 &value) {
+  for (int c = 0; c < count; ++c) {
+    lua_rawgeti(L, index, first + c);
+    if (lua_isnil(L, -1)) {
+      lua_pop(L, 1);
+      break;
+    }
+    value[c] = static_cast<float>(lua_tonumber(L, -1));
+    lua_pop(L, 1);
+  }
+}
+
+static void PushTweenId(lua_State *L, uint32_t id) {
+  if (id != 0) {
+    lua_pushinteger(L, id);
+  } else {
+    lua_pushnil(L);
+  }
+}
+
+// App.Tween(shape, property, to, duration [, easing [, loop [, delay]]])
+// -> tween id, or nil. property is "position", "size", "rotation" or
+// "color"; to is a number for rotation, a table otherwise (missing
+// components keep their current value). The tween starts from the current
+// value, and replaces any other on the same shape and property.
+int LuaEngine::Lua_Tween(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  ShapeHandle shape = CheckShapeHandle(L, 1);
+  TweenProperty property = CheckTweenProperty(L, 2);
+  if (!lua_istable(L, 3)) {
+    luaL_checknumber(L, 3);
+  }
+  const float duration = static_cast<float>(luaL_checknumber(L, 4));
+  const Easing easing = OptEasing(L, 5);
+  const TweenLoop loop = OptTweenLoop(L, 6);
+  const float delay = static_cast<float>(luaL_optnumber(L, 7, 0.0));
+  if (!app->GetShapeStore().IsAlive(shape)) {
+    lua_pushnil(L);
+    return 1;
+  }
+  const glm::vec4 from = GetTweenValue(app->GetShapeStore(), shape, property);
+  glm::vec4 to = from;
+  if (lua_istable(L, 3)) {
+    ReadTweenComponents(L, 3, 1, TweenComponentCount(property), to);
+  } else {
+    to.x = static_cast<float>(lua_tonumber(L, 3));
+  }
+  PushTweenId(L, app->GetTweens().Start(shape, property,
+                                        {{0.0f, from}, {duration, to}},
+                                        easing, loop, delay));
+  return 1;
+}
+
+// App.Animate(shape, property, {{time, value...}, ...} [, easing [, loop
+// [, delay]]]) -> tween id, or nil. Times increase, in seconds; the easing
+// applies to every segment. Missing components keep their current value.
+int LuaEngine::Lua_Animate(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  ShapeHandle shape = CheckShapeHandle(L, 1);
+  TweenProperty property = CheckTweenProperty(L, 2);
+  luaL_checktype(L, 3, LUA_TTABLE);
+  const Easing easing = OptEasing(L, 4);
+  const TweenLoop loop = OptTweenLoop(L, 5);
+  const float delay = static_cast<float>(luaL_optnumber(L, 6, 0.0));
+  if (!app->GetShapeStore().IsAlive(shape)) {
+    lua_pushnil(L);
+    return 1;
+  }
+  const glm::vec4 current =
+      GetTweenValue(app->GetShapeStore(), shape, property);
+  const int count = TweenComponentCount(property);
+  std::vector<TweenKeyframe> keyframes(lua_rawlen(L, 3));
+  bool valid = true;
+  for (size_t i = 0; i < keyframes.size(); ++i) {
+    lua_rawgeti(L, 3, static_cast<lua_Integer>(i + 1));
+    const int key = lua_gettop(L);
+    valid = valid && lua_istable(L, key);
+    if (valid) {
+      lua_rawgeti(L, key, 1);
+      keyframes[i].time = static_cast<float>(lua_tonumber(L, -1));
+      lua_pop(L, 1);
+      keyframes[i].value = current;
+      ReadTweenComponents(L, key, 2, count, keyframes[i].value);
+    }
+    lua_pop(L, 1);
+  }
+  PushTweenId(L, valid ? app->GetTweens().Start(shape, property, keyframes,
+                                                easing, loop, delay)
+                       : 0);
+  return 1;
+}
+
+// App.StopTween(id) -> bool; the property keeps its current value
+int LuaEngine::Lua_StopTween(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  lua_pushboolean(L, static_cast<int>(app->GetTweens().Stop(
+                         static_cast<uint32_t>(luaL_checkinteger(L, 1)))));
+  return 1;
+}
+
+// App.StopTweens(shape) -> number of tweens stopped
+int LuaEngine::Lua_StopTweens(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  lua_pushinteger(L, static_cast<lua_Integer>(app->GetTweens().StopShape(
+                         CheckShapeHandle(L, 1))));
+  return 1;
+}
+
+int LuaEngine::Lua_IsTweenActive(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  lua_pushboolean(L, static_cast<int>(app->GetTweens().IsActive(
+                         static_cast<uint32_t>(luaL_checkinteger(L, 1)))));
+  return 1;
+}
+
+// App.GetTweenProgress(id) -> 0 to 1 through the current run, or nil once
+// the tween has ended
+int LuaEngine::Lua_GetTweenProgress(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const float progress = app->GetTweens().GetProgress(
+      static_cast<uint32_t>(luaL_checkinteger(L, 1)));
+  if (progress < 0.0f) {
+    lua_pushnil(L);
+  } else {
+    lua_pushnumber(L, progress);
+  }
+  return 1;
+}
+
+int LuaEngine::Lua_GetTweenCount(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  lua_pushinteger(L,
+                  static_cast<lua_Integer>(app->GetTweens().ActiveCount()));
+  return 1;
+}
+
+int LuaEngine::Lua_ClearShapes(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  app->ClearShapes();
+  return 0;
+}
+
+int LuaEngine::Lua_GetShapeCount(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    lua_pushinteger(L, 0);
+    return 1;
+  }
+  lua_pushinteger(L, static_cast<lua_Integer>(app->GetShapeCount()));
+  return 1;
+}
+
+// App.GetWindowSize() -> width, height in screen coordinates, current
+// after resizes
+int LuaEngine::Lua_GetWindowSize(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  glm::vec2 size = app->getWindowDimensions();
+  lua_pushnumber(L, size.x);
+  lua_pushnumber(L, size.y);
+  return 2;
+}
+
+int LuaEngine::Lua_RequestRedraw(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app != nullptr) {
+    app->RequestRedraw();
+  }
+  return 0;
+}
+
+int LuaEngine::Lua_SetOnDemandRendering(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  app->SetOnDemandRendering(lua_toboolean(L, 1) != 0);
+  return 0;
+}
+
+int LuaEngine::Lua_IsOnDemandRendering(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  lua_pushboolean(L, app != nullptr && app->IsOnDemandRendering() ? 1 : 0);
+  return 1;
+}
+
+// App.SetFrameLimit(fps) limits to fps (0 = uncapped);
+// App.SetFrameLimit("uncapped" | "vsync" | "adaptive") picks a swap mode
+int LuaEngine::Lua_SetFrameLimit(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  FramePacer &pacer = app->GetFramePacer();
+  if (lua_type(L, 1) == LUA_TSTRING) {
+    static const char *const modes[] = {"uncapped", "vsync", "adaptive",
+                                        nullptr};
+    static const FramePacingMode values[] = {FramePacingMode::Uncapped,
+                                             FramePacingMode::VSync,
+                                             FramePacingMode::AdaptiveVSync};
+    pacer.SetMode(values[luaL_checkoption(L, 1, nullptr, modes)]);
+  } else {
+    double fps = luaL_checknumber(L, 1);
+    pacer.SetMode(fps > 0.0 ? FramePacingMode::Limited
+                            : FramePacingMode::Uncapped,
+                  fps);
+  }
+  app->RequestRedraw();
+  return 0;
+}
+
+int LuaEngine::Lua_GetFrameStats(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    lua_pushnil(L);
+    return 1;
+  }
+  const FramePacer &pacer = app->GetFramePacer();
+  FramePacer::Stats stats = pacer.GetStats();
+  lua_newtable(L);
+  lua_pushstring(L, FramePacer::ModeName(pacer.GetMode()));
+  lua_setfield(L, -2, "mode");
+  lua_pushnumber(L, pacer.GetTargetFps());
+  lua_setfield(L, -2, "targetFps");
+  lua_pushboolean(L, pacer.IsAdaptiveSupported() ? 1 : 0);
+  lua_setfield(L, -2, "adaptiveSupported");
+  lua_pushnumber(L, stats.averageMs);
+  lua_setfield(L, -2, "averageMs");
+  lua_pushnumber(L, stats.jitterMs);
+  lua_setfield(L, -2, "jitterMs");
+  lua_pushnumber(L, stats.worstMs);
+  lua_setfield(L, -2, "worstMs");
+  return 1;
+}
+
+// Seconds since the previous frame, as ImGui measured it. Frame intervals
+// vary with the pacer and on-demand rendering, so animations advance by this.
+int LuaEngine::Lua_GetDeltaTime(lua_State *L) {
+  lua_pushnumber(L, ImGui::GetIO().DeltaTime);
+  return 1;
+}
+
+// App.BeginGpuScope(name) ... App.EndGpuScope() times the UI drawn in
+// between on the GPU. Both calls must be inside the same ImGui window.
+int LuaEngine::Lua_BeginGpuScope(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const char *name = luaL_checkstring(L, 1);
+  app->GetGpuProfiler().AddDrawListScope(ImGui::GetWindowDrawList(), name);
+  return 0;
+}
+
+int LuaEngine::Lua_EndGpuScope(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  app->GetGpuProfiler().AddDrawListScopeEnd(ImGui::GetWindowDrawList());
+  return 0;
+}
+
+int LuaEngine::Lua_ShowGpuProfiler(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  app->SetGpuProfilerVisible(lua_toboolean(L, 1) != 0);
+  return 0;
+}
+
+int LuaEngine::Lua_IsGpuProfilerVisible(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  lua_pushboolean(L, app != nullptr && app->IsGpuProfilerVisible() ? 1 : 0);
+  return 1;
+}
+
+// Latest GPU timings, in frame order: {{name, depth, lastMs, averageMs,
+// maxMs}, ...}
+int LuaEngine::Lua_GetGpuTimings(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  lua_newtable(L);
+  if (app == nullptr) {
+    return 1;
+  }
+  const std::vector<GpuProfiler::ScopeResult> results =
+      app->GetGpuProfiler().GetResults();
+  for (size_t i = 0; i < results.size(); ++i) {
+    const GpuProfiler::ScopeResult &result = results[i];
+    lua_newtable(L);
+    lua_pushstring(L, result.name.c_str());
+    lua_setfield(L, -2, "name");
+    lua_pushinteger(L, result.depth);
+    lua_setfield(L, -2, "depth");
+    lua_pushnumber(L, result.lastMs);
+    lua_setfield(L, -2, "lastMs");
+    lua_pushnumber(L, result.averageMs);
+    lua_setfield(L, -2, "averageMs");
+    lua_pushnumber(L, result.maxMs);
+    lua_setfield(L, -2, "maxMs");
+    lua_rawseti(L, -2, static_cast<lua_Integer>(i + 1));
+  }
+  return 1;
+}
+
+// App.Screenshot([path]) saves the next frame (.png or .ppm); returns
+// false if the path isn't usable
+int LuaEngine::Lua_Screenshot(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const char *path = luaL_optstring(L, 1, "screenshot.png");
+  bool ok = app->GetFrameCapture().RequestScreenshot(path);
+  app->RequestRedraw();
+  lua_pushboolean(L, ok ? 1 : 0);
+  return 1;
+}
+
+// App.StartRecording(path [, fps]): .y4m for one video stream, .png/.ppm
+// for numbered images
+int LuaEngine::Lua_StartRecording(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const char *path = luaL_checkstring(L, 1);
+  int fps = static_cast<int>(luaL_optinteger(L, 2, 60));
+  bool ok = app->GetFrameCapture().StartRecording(path, fps);
+  app->RequestRedraw();
+  lua_pushboolean(L, ok ? 1 : 0);
+  return 1;
+}
+
+int LuaEngine::Lua_StopRecording(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  app->GetFrameCapture().StopRecording();
+  app->RequestRedraw(); // Lets the frames still in flight drain
+  return 0;
+}
+
+// {recording, captured, written, dropped}
+int LuaEngine::Lua_GetCaptureStats(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    lua_pushnil(L);
+    return 1;
+  }
+  FrameCapture::Stats stats = app->GetFrameCapture().GetStats();
+  lua_newtable(L);
+  lua_pushboolean(L, stats.recording ? 1 : 0);
+  lua_setfield(L, -2, "recording");
+  lua_pushinteger(L, static_cast<lua_Integer>(stats.captured));
+  lua_setfield(L, -2, "captured");
+  lua_pushinteger(L, static_cast<lua_Integer>(stats.written));
+  lua_setfield(L, -2, "written");
+  lua_pushinteger(L, static_cast<lua_Integer>(stats.dropped));
+  lua_setfield(L, -2, "dropped");
+  return 1;
+}
+
+// Last frame's GL state counters: {issued, skipped, byCategory = {name =
+// {issued, skipped}, ...}}
+int LuaEngine::Lua_GetRenderStats(lua_State *L) {
+  const GLState::Counters counters = GLState::GetFrameCounters();
+  lua_newtable(L);
+  lua_pushinteger(L, counters.TotalIssued());
+  lua_setfield(L, -2, "issued");
+  lua_pushinteger(L, counters.TotalSkipped());
+  lua_setfield(L, -2, "skipped");
+
+  lua_newtable(L);
+  for (int i = 0; i < GLState::CATEGORY_COUNT; ++i) {
+    lua_newtable(L);
+    lua_pushinteger(L, counters.issued[i]);
+    lua_setfield(L, -2, "issued");
+    lua_pushinteger(L, counters.skipped[i]);
+    lua_setfield(L, -2, "skipped");
+    lua_setfield(L, -2,
+                 GLState::CategoryName(static_cast<GLState::Category>(i)));
+  }
+  lua_setfield(L, -2, "byCategory");
+  return 1;
+}
+
+// Last frame's scene draws: {draws, stateChanges, unsortedStateChanges,
+// sortMs}; unsortedStateChanges is what submission order would have cost
+int LuaEngine::Lua_GetDrawStats(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const RenderQueue::Stats stats = app->GetDrawStats();
+  lua_newtable(L);
+  lua_pushinteger(L, stats.draws);
+  lua_setfield(L, -2, "draws");
+  lua_pushinteger(L, stats.stateChanges);
+  lua_setfield(L, -2, "stateChanges");
+  lua_pushinteger(L, stats.unsortedStateChanges);
+  lua_setfield(L, -2, "unsortedStateChanges");
+  lua_pushnumber(L, stats.sortMs);
+  lua_setfield(L, -2, "sortMs");
+  return 1;
+}
+
+int LuaEngine::Lua_ShowDrawStats(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  app->SetDrawStatsVisible(lua_toboolean(L, 1) != 0);
+  return 0;
+}
+
+int LuaEngine::Lua_IsDrawStatsVisible(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  lua_pushboolean(L, app != nullptr && app->IsDrawStatsVisible() ? 1 : 0);
+  return 1;
+}
+
+// GPU memory as of the last frame: bytes per category {geometry, programs,
+// textures, buffers}, then {sharedBuffers, sharedPrograms, retiring, reuses}
+int LuaEngine::Lua_GetMemoryStats(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const ResourceManager::Stats stats = app->GetMemoryStats();
+  lua_newtable(L);
+  const char *categories[] = {"geometry", "programs", "textures", "buffers"};
+  for (int i = 0; i < RESOURCE_CATEGORY_COUNT; ++i) {
+    lua_pushinteger(L, static_cast<lua_Integer>(stats.bytes[i]));
+    lua_setfield(L, -2, categories[i]);
+  }
+  lua_pushinteger(L, stats.buffers);
+  lua_setfield(L, -2, "sharedBuffers");
+  lua_pushinteger(L, stats.programs);
+  lua_setfield(L, -2, "sharedPrograms");
+  lua_pushinteger(L, stats.retiring);
+  lua_setfield(L, -2, "retiring");
+  lua_pushinteger(L, static_cast<lua_Integer>(stats.reuses));
+  lua_setfield(L, -2, "reuses");
+  return 1;
+}
+
+int LuaEngine::Lua_ShowMemoryStats(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  app->SetMemoryStatsVisible(lua_toboolean(L, 1) != 0);
+  return 0;
+}
+
+int LuaEngine::Lua_IsMemoryStatsVisible(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  lua_pushboolean(L, app != nullptr && app->IsMemoryStatsVisible() ? 1 : 0);
+  return 1;
+}
+
+// Image ids cross into Lua as plain integers too; nil when adding failed
+static void PushImageId(lua_State *L, uint32_t imageId) {
+  if (imageId == 0) {
+    lua_pushnil(L);
+  } else {
+    lua_pushinteger(L, imageId);
+  }
+}
+
+// App.LoadImage(path) -> image id; binary PPM (P6) or PAM (P7) files
+int LuaEngine::Lua_LoadImage(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  PushImageId(L, app->AddImageFile(luaL_checkstring(L, 1)));
+  return 1;
+}
+
+// App.CreateImage(width, height, pixels) -> image id; pixels is a string of
+// width * height RGBA bytes, rows top to bottom
+int LuaEngine::Lua_CreateImage(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  lua_Integer width = luaL_checkinteger(L, 1);
+  lua_Integer height = luaL_checkinteger(L, 2);
+  size_t length = 0;
+  const char *pixels = luaL_checklstring(L, 3, &length);
+  luaL_argcheck(L, width > 0 && height > 0, 1, "size must be positive");
+  luaL_argcheck(L, length == static_cast<size_t>(width * height * 4), 3,
+                "expected width * height * 4 bytes");
+  PushImageId(L, app->AddImage(reinterpret_cast<const uint8_t *>(pixels),
+                               static_cast<int>(width),
+                               static_cast<int>(height)));
+  return 1;
+}
+
+int LuaEngine::Lua_RemoveImage(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  bool removed =
+      app->RemoveImage(static_cast<uint32_t>(luaL_checkinteger(L, 1)));
+  lua_pushboolean(L, static_cast<int>(removed));
+  return 1;
+}
+
+// App.AddSprite(image, x, y[, width, height]) -> shape handle. The sprite is
+// an ordinary shape (move, resize, recolor and remove it as one); its color
+// tints the image. The size defaults to the image's.
+int LuaEngine::Lua_AddSprite(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  auto imageId = static_cast<uint32_t>(luaL_checkinteger(L, 1));
+  float x = luaL_checknumber(L, 2);
+  float y = luaL_checknumber(L, 3);
+  float width = luaL_optnumber(L, 4, 0.0);
+  float height = luaL_optnumber(L, 5, width);
+  ShapeHandle handle = app->AddSprite(imageId, x, y, width, height);
+  if (!handle.IsValid()) {
+    lua_pushnil(L);
+    return 1;
+  }
+  lua_pushinteger(L, handle.value);
+  return 1;
+}
+
+int LuaEngine::Lua_SetSpriteImage(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  ShapeHandle handle = CheckShapeHandle(L, 1);
+  bool changed = app->SetSpriteImage(
+      handle, static_cast<uint32_t>(luaL_checkinteger(L, 2)));
+  lua_pushboolean(L, static_cast<int>(changed));
+  return 1;
+}
+
+// Optional r, g, b, a starting at index; white and opaque by default
+static glm::vec4 OptColor(lua_State *L, int index) {
+  glm::vec4 color;
+  color.r = luaL_optnumber(L, index, 1.0);
+  color.g = luaL_optnumber(L, index + 1, 1.0);
+  color.b = luaL_optnumber(L, index + 2, 1.0);
+  color.a = luaL_optnumber(L, index + 3, 1.0);
+  return color;
+}
+
+static int PushShapeHandle(lua_State *L, ShapeHandle handle) {
+  if (handle.IsValid()) {
+    lua_pushinteger(L, handle.value);
+  } else {
+    lua_pushnil(L);
+  }
+  return 1;
+}
+
+// App.AddCircle(cx, cy, radius[, r, g, b, a]) -> shape handle
+int LuaEngine::Lua_AddCircle(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  glm::vec2 center(luaL_checknumber(L, 1), luaL_checknumber(L, 2));
+  float radius = luaL_checknumber(L, 3);
+  return PushShapeHandle(L, app->AddCircle(center, radius, OptColor(L, 4)));
+}
+
+// App.AddRoundedRect(x, y, width, height, cornerRadius[, r, g, b, a])
+int LuaEngine::Lua_AddRoundedRect(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  glm::vec2 position(luaL_checknumber(L, 1), luaL_checknumber(L, 2));
+  glm::vec2 size(luaL_checknumber(L, 3), luaL_checknumber(L, 4));
+  float cornerRadius = luaL_checknumber(L, 5);
+  return PushShapeHandle(L, app->AddRoundedRect(position, size, cornerRadius,
+                                                OptColor(L, 6)));
+}
+
+// App.AddRing(cx, cy, radius, thickness[, r, g, b, a])
+int LuaEngine::Lua_AddRing(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  glm::vec2 center(luaL_checknumber(L, 1), luaL_checknumber(L, 2));
+  float radius = luaL_checknumber(L, 3);
+  float thickness = luaL_checknumber(L, 4);
+  return PushShapeHandle(
+      L, app->AddRing(center, radius, thickness, OptColor(L, 5)));
+}
+
+// App.AddLine(x1, y1, x2, y2, thickness[, r, g, b, a]); round caps
+int LuaEngine::Lua_AddLine(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  glm::vec2 from(luaL_checknumber(L, 1), luaL_checknumber(L, 2));
+  glm::vec2 to(luaL_checknumber(L, 3), luaL_checknumber(L, 4));
+  float thickness = luaL_checknumber(L, 5);
+  return PushShapeHandle(
+      L, app->AddLine(from, to, thickness, OptColor(L, 6)));
+}
+
+// App.AddTriangle(x1, y1, x2, y2, x3, y3[, r, g, b, a])
+int LuaEngine::Lua_AddTriangle(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  glm::vec2 p0(luaL_checknumber(L, 1), luaL_checknumber(L, 2));
+  glm::vec2 p1(luaL_checknumber(L, 3), luaL_checknumber(L, 4));
+  glm::vec2 p2(luaL_checknumber(L, 5), luaL_checknumber(L, 6));
+  return PushShapeHandle(L, app->AddTriangle(p0, p1, p2, OptColor(L, 7)));
+}
+
+// App.AddPolyline(x, y, width, height[, r, g, b, a]) -> polyline id
+int LuaEngine::Lua_AddPolyline(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  glm::vec2 position(luaL_checknumber(L, 1), luaL_checknumber(L, 2));
+  glm::vec2 size(luaL_checknumber(L, 3), luaL_checknumber(L, 4));
+  lua_pushinteger(L, app->AddPolyline(position, size, OptColor(L, 5)));
+  return 1;
+}
+
+// Polyline ids are plain integers; unknown ids raise an error
+static Polyline &CheckPolyline(lua_State *L, Application *app, int index) {
+  Polyline *polyline =
+      app->GetPolyline(static_cast<uint32_t>(luaL_checkinteger(L, index)));
+  if (polyline == nullptr) {
+    luaL_argerror(L, index, "unknown polyline");
+  }
+  return *polyline;
+}
+
+// App.AppendPolyline(id, value | {values...}). Appending is incremental:
+// only one bucket per pyramid level changes per sample.
+int LuaEngine::Lua_AppendPolyline(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  Polyline &polyline = CheckPolyline(L, app, 1);
+  if (lua_istable(L, 2)) {
+    auto count = static_cast<size_t>(lua_rawlen(L, 2));
+    std::vector<float> samples(count);
+    for (size_t i = 0; i < count; ++i) {
+      lua_rawgeti(L, 2, static_cast<lua_Integer>(i + 1));
+      samples[i] = static_cast<float>(lua_tonumber(L, -1));
+      lua_pop(L, 1);
+    }
+    polyline.Append(samples.data(), count);
+  } else {
+    float value = luaL_checknumber(L, 2);
+    polyline.Append(&value, 1);
+  }
+  app->RequestRedraw();
+  return 0;
+}
 
-  lua_pushlightuserdata(L, m_app);
-  lua_setfield(L, LUA_REGISTRYINDEX, "AppInstance");
+int LuaEngine::Lua_ClearPolyline(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  CheckPolyline(L, app, 1).Clear();
+  app->RequestRedraw();
+  return 0;
+}
+
+int LuaEngine::Lua_RemovePolyline(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  bool removed =
+      app->RemovePolyline(static_cast<uint32_t>(luaL_checkinteger(L, 1)));
+  lua_pushboolean(L, static_cast<int>(removed));
+  return 1;
+}
+
+// App.SetPolylineRect(id, x, y, width, height)
+int LuaEngine::Lua_SetPolylineRect(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  Polyline &polyline = CheckPolyline(L, app, 1);
+  polyline.SetRect({luaL_checknumber(L, 2), luaL_checknumber(L, 3)},
+                   {luaL_checknumber(L, 4), luaL_checknumber(L, 5)});
+  app->RequestRedraw();
+  return 0;
+}
+
+// App.SetPolylineStyle(id, thickness[, r, g, b, a])
+int LuaEngine::Lua_SetPolylineStyle(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  Polyline &polyline = CheckPolyline(L, app, 1);
+  float thickness = luaL_checknumber(L, 2);
+  polyline.SetStyle(OptColor(L, 3), thickness);
+  app->RequestRedraw();
+  return 0;
+}
+
+// App.SetPolylineView(id[, first, count]): samples [first, first + count);
+// no count shows everything, a negative first follows the newest samples
+int LuaEngine::Lua_SetPolylineView(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  Polyline &polyline = CheckPolyline(L, app, 1);
+  polyline.SetView(luaL_optnumber(L, 2, 0.0), luaL_optnumber(L, 3, 0.0));
+  app->RequestRedraw();
+  return 0;
+}
+
+// App.SetPolylineRange(id[, min, max]); without a range the visible samples
+// are fitted
+int LuaEngine::Lua_SetPolylineRange(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  Polyline &polyline = CheckPolyline(L, app, 1);
+  polyline.SetValueRange(luaL_optnumber(L, 2, 0.0),
+                         luaL_optnumber(L, 3, 0.0));
+  app->RequestRedraw();
+  return 0;
+}
+
+// App.SetPolylineLayer(id, layer); layers 0-255 draw in order, shapes at
+// 64 and polylines by default at 128
+int LuaEngine::Lua_SetPolylineLayer(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  Polyline &polyline = CheckPolyline(L, app, 1);
+  lua_Integer layer = luaL_checkinteger(L, 2);
+  luaL_argcheck(L, layer >= 0 && layer <= 255, 2, "layer must be 0-255");
+  polyline.SetLayer(static_cast<uint8_t>(layer));
+  app->RequestRedraw();
+  return 0;
+}
+
+// App.GetPolylineInfo(id) -> {samples, levels, level}; level is the one
+// drawn last frame
+int LuaEngine::Lua_GetPolylineInfo(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const Polyline &polyline = CheckPolyline(L, app, 1);
+  lua_newtable(L);
+  lua_pushinteger(L, static_cast<lua_Integer>(polyline.GetPyramid().Size()));
+  lua_setfield(L, -2, "samples");
+  lua_pushinteger(L, polyline.GetPyramid().LevelCount());
+  lua_setfield(L, -2, "levels");
+  lua_pushinteger(L, polyline.GetLastLevel());
+  lua_setfield(L, -2, "level");
+  return 1;
+}
+
+// Overwrites value with the number table field name, when present
+static void OptNumberField(lua_State *L, int index, const char *name,
+                           float &value) {
+  lua_getfield(L, index, name);
+  if (!lua_isnil(L, -1)) {
+    value = static_cast<float>(luaL_checknumber(L, -1));
+  }
+  lua_pop(L, 1);
+}
+
+// Overwrites the components of color given by the {r, g, b, a} table field
+// name, when present
+static void OptColorField(lua_State *L, int index, const char *name,
+                          glm::vec4 &color) {
+  lua_getfield(L, index, name);
+  if (lua_istable(L, -1)) {
+    for (int c = 0; c < 4; ++c) {
+      lua_rawgeti(L, -1, c + 1);
+      if (!lua_isnil(L, -1)) {
+        color[c] = static_cast<float>(luaL_checknumber(L, -1));
+      }
+      lua_pop(L, 1);
+    }
+  }
+  lua_pop(L, 1);
+}
+
+// Fields of a settings table; the ones left out keep their value
+static void ReadEmitterSettings(lua_State *L, int index,
+                                EmitterSettings &settings) {
+  if (lua_isnoneornil(L, index)) {
+    return;
+  }
+  luaL_checktype(L, index, LUA_TTABLE);
+  OptNumberField(L, index, "x", settings.position.x);
+  OptNumberField(L, index, "y", settings.position.y);
+  OptNumberField(L, index, "rate", settings.rate);
+  float maxParticles = static_cast<float>(settings.maxParticles);
+  OptNumberField(L, index, "maxParticles", maxParticles);
+  settings.maxParticles = static_cast<uint32_t>(std::max(maxParticles, 0.0f));
+  OptNumberField(L, index, "lifetimeMin", settings.lifetimeMin);
+  OptNumberField(L, index, "lifetimeMax", settings.lifetimeMax);
+  OptNumberField(L, index, "speedMin", settings.speedMin);
+  OptNumberField(L, index, "speedMax", settings.speedMax);
+  OptNumberField(L, index, "direction", settings.direction);
+  OptNumberField(L, index, "spread", settings.spread);
+  OptNumberField(L, index, "gravityX", settings.gravity.x);
+  OptNumberField(L, index, "gravityY", settings.gravity.y);
+  OptNumberField(L, index, "drag", settings.drag);
+  OptColorField(L, index, "startColor", settings.startColor);
+  OptColorField(L, index, "endColor", settings.endColor);
+  OptNumberField(L, index, "startSize", settings.startSize);
+  OptNumberField(L, index, "endSize", settings.endSize);
+  lua_getfield(L, index, "additive");
+  if (!lua_isnil(L, -1)) {
+    settings.blend =
+        lua_toboolean(L, -1) ? BlendMode::Additive : BlendMode::Alpha;
+  }
+  lua_pop(L, 1);
+  lua_getfield(L, index, "layer");
+  if (!lua_isnil(L, -1)) {
+    settings.layer =
+        static_cast<uint8_t>(std::clamp<lua_Integer>(
+            luaL_checkinteger(L, -1), 0, 255));
+  }
+  lua_pop(L, 1);
+}
+
+// Emitter ids are plain integers; unknown ids raise an error
+static EmitterSettings &CheckEmitter(lua_State *L, Application *app,
+                                     int index) {
+  EmitterSettings *settings = app->GetParticles().GetSettings(
+      static_cast<uint32_t>(luaL_checkinteger(L, index)));
+  if (settings == nullptr) {
+    luaL_argerror(L, index, "unknown emitter");
+  }
+  return *settings;
+}
+
+// App.CreateEmitter(x, y [, settings]) -> emitter id. settings may hold
+// rate, maxParticles, lifetimeMin/Max, speedMin/Max, direction, spread
+// (radians), gravityX/Y, drag, startColor/endColor ({r, g, b, a}),
+// startSize/endSize, additive and layer.
+int LuaEngine::Lua_CreateEmitter(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  EmitterSettings settings;
+  settings.position = {luaL_checknumber(L, 1), luaL_checknumber(L, 2)};
+  ReadEmitterSettings(L, 3, settings);
+  lua_pushinteger(L, app->GetParticles().CreateEmitter(settings));
+  return 1;
+}
+
+// App.SetEmitter(id, settings); fields as for CreateEmitter
+int LuaEngine::Lua_SetEmitter(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  ReadEmitterSettings(L, 2, CheckEmitter(L, app, 1));
+  return 0;
+}
+
+// App.MoveEmitter(id, x, y); live particles stay where they are
+int LuaEngine::Lua_MoveEmitter(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  CheckEmitter(L, app, 1).position = {luaL_checknumber(L, 2),
+                                      luaL_checknumber(L, 3)};
+  return 0;
+}
+
+// App.BurstEmitter(id, count) spawns count particles at once
+int LuaEngine::Lua_BurstEmitter(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  CheckEmitter(L, app, 1);
+  const lua_Integer count = luaL_checkinteger(L, 2);
+  app->GetParticles().Burst(
+      static_cast<uint32_t>(lua_tointeger(L, 1)),
+      static_cast<uint32_t>(std::clamp<lua_Integer>(count, 0, UINT32_MAX)));
+  app->RequestRedraw();
+  return 0;
+}
+
+// App.RemoveEmitter(id) -> bool; its particles go with it
+int LuaEngine::Lua_RemoveEmitter(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  app->RequestRedraw();
+  lua_pushboolean(L, static_cast<int>(app->GetParticles().DestroyEmitter(
+                         static_cast<uint32_t>(luaL_checkinteger(L, 1)))));
+  return 1;
+}
+
+// As CheckEmitter, for GpuParticleSystem ids
+static EmitterSettings &CheckGpuEmitter(lua_State *L, Application *app,
+                                        int index) {
+  EmitterSettings *settings = app->GetGpuParticles().GetSettings(
+      static_cast<uint32_t>(luaL_checkinteger(L, index)));
+  if (settings == nullptr) {
+    luaL_argerror(L, index, "unknown GPU emitter");
+  }
+  return *settings;
+}
+
+// App.CreateGpuEmitter(x, y [, settings]) -> GPU emitter id. Settings as for
+// CreateEmitter; maxParticles slots are allocated up front.
+int LuaEngine::Lua_CreateGpuEmitter(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  EmitterSettings settings;
+  settings.position = {luaL_checknumber(L, 1), luaL_checknumber(L, 2)};
+  ReadEmitterSettings(L, 3, settings);
+  lua_pushinteger(L, app->GetGpuParticles().CreateEmitter(settings));
+  return 1;
+}
+
+// App.SetGpuEmitter(id, settings); a new maxParticles restarts the emitter
+int LuaEngine::Lua_SetGpuEmitter(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  ReadEmitterSettings(L, 2, CheckGpuEmitter(L, app, 1));
+  return 0;
+}
+
+// App.MoveGpuEmitter(id, x, y)
+int LuaEngine::Lua_MoveGpuEmitter(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  CheckGpuEmitter(L, app, 1).position = {luaL_checknumber(L, 2),
+                                         luaL_checknumber(L, 3)};
+  return 0;
+}
+
+// App.BurstGpuEmitter(id, count) spawns up to count particles next frame
+int LuaEngine::Lua_BurstGpuEmitter(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  CheckGpuEmitter(L, app, 1);
+  const lua_Integer count = luaL_checkinteger(L, 2);
+  app->GetGpuParticles().Burst(
+      static_cast<uint32_t>(lua_tointeger(L, 1)),
+      static_cast<uint32_t>(std::clamp<lua_Integer>(count, 0, UINT32_MAX)));
+  app->RequestRedraw();
+  return 0;
+}
+
+// App.RemoveGpuEmitter(id) -> bool
+int LuaEngine::Lua_RemoveGpuEmitter(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  app->RequestRedraw();
+  lua_pushboolean(L, static_cast<int>(app->GetGpuParticles().DestroyEmitter(
+                         static_cast<uint32_t>(luaL_checkinteger(L, 1)))));
+  return 1;
+}
+
+// App.GetGpuParticleStats() -> {emitters, capacity}. Live counts stay on
+// the GPU; capacity is every emitter's slots.
+int LuaEngine::Lua_GetGpuParticleStats(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const GpuParticleSystem &particles = app->GetGpuParticles();
+  lua_newtable(L);
+  lua_pushinteger(L, static_cast<lua_Integer>(particles.EmitterCount()));
+  lua_setfield(L, -2, "emitters");
+  lua_pushinteger(L, static_cast<lua_Integer>(particles.Capacity()));
+  lua_setfield(L, -2, "capacity");
+  return 1;
+}
+
+// App.GetParticleStats() -> {particles, emitters, threads, lanes, updateMs}
+int LuaEngine::Lua_GetParticleStats(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const ParticleSystem::Stats stats = app->GetParticles().GetStats();
+  lua_newtable(L);
+  lua_pushinteger(L, static_cast<lua_Integer>(stats.particles));
+  lua_setfield(L, -2, "particles");
+  lua_pushinteger(L, static_cast<lua_Integer>(stats.emitters));
+  lua_setfield(L, -2, "emitters");
+  lua_pushinteger(L, stats.threads);
+  lua_setfield(L, -2, "threads");
+  lua_pushinteger(L, stats.lanes);
+  lua_setfield(L, -2, "lanes");
+  lua_pushnumber(L, stats.updateMs);
+  lua_setfield(L, -2, "updateMs");
+  return 1;
+}
+
+// Fields of a label style table; the ones left out keep their value
+static void ReadLabelStyle(lua_State *L, int index, LabelStyle &style) {
+  if (lua_isnoneornil(L, index)) {
+    return;
+  }
+  luaL_checktype(L, index, LUA_TTABLE);
+  OptNumberField(L, index, "size", style.size);
+  OptNumberField(L, index, "x", style.position.x);
+  OptNumberField(L, index, "y", style.position.y);
+  OptNumberField(L, index, "alignX", style.align.x);
+  OptNumberField(L, index, "alignY", style.align.y);
+  OptColorField(L, index, "color", style.color);
+  lua_getfield(L, index, "anchor");
+  if (lua_isboolean(L, -1) && !lua_toboolean(L, -1)) {
+    style.anchor = {}; // anchor = false detaches
+  } else if (!lua_isnil(L, -1)) {
+    style.anchor = CheckShapeHandle(L, -1);
+  }
+  lua_pop(L, 1);
+  lua_getfield(L, index, "visible");
+  if (!lua_isnil(L, -1)) {
+    style.visible = lua_toboolean(L, -1) != 0;
+  }
+  lua_pop(L, 1);
+}
+
+static uint32_t CheckFont(lua_State *L, Application *app, int index) {
+  const auto font = static_cast<uint32_t>(luaL_checkinteger(L, index));
+  if (!app->GetSceneText().HasFont(font)) {
+    luaL_argerror(L, index, "unknown font");
+  }
+  return font;
+}
+
+static LabelStyle &CheckLabel(lua_State *L, Application *app, int index) {
+  LabelStyle *style = app->GetSceneText().GetLabelStyle(
+      static_cast<uint32_t>(luaL_checkinteger(L, index)));
+  if (style == nullptr) {
+    luaL_argerror(L, index, "unknown label");
+  }
+  return *style;
+}
+
+// App.LoadFont(path) -> font id, or nil if the file can't be read. A TTF or
+// OTF file; loading the same path again returns the same id.
+int LuaEngine::Lua_LoadFont(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const char *path = luaL_checkstring(L, 1);
+  const uint32_t font = app->GetSceneText().LoadFont(path);
+  if (font == 0) {
+    lua_pushnil(L);
+  } else {
+    lua_pushinteger(L, font);
+  }
+  return 1;
+}
+
+// App.AddLabel(text, font, x, y [, style]) -> label id. style may hold size
+// (em height, default 16), alignX/alignY (0 left/top, 0.5 centered, 1
+// right/bottom), color ({r, g, b, a}), anchor (a shape the label follows,
+// x/y then being an offset from its center) and visible.
+int LuaEngine::Lua_AddLabel(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  size_t length = 0;
+  const char *text = luaL_checklstring(L, 1, &length);
+  const uint32_t font = CheckFont(L, app, 2);
+  LabelStyle style;
+  style.position = {luaL_checknumber(L, 3), luaL_checknumber(L, 4)};
+  ReadLabelStyle(L, 5, style);
+  lua_pushinteger(L, app->GetSceneText().AddLabel(std::string(text, length),
+                                                  font, style));
+  app->RequestRedraw();
+  return 1;
+}
+
+// App.SetLabelText(id, text [, font]); the layout is shared with every other
+// label showing the same text in the same font
+int LuaEngine::Lua_SetLabelText(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  CheckLabel(L, app, 1);
+  size_t length = 0;
+  const char *text = luaL_checklstring(L, 2, &length);
+  const uint32_t font = lua_isnoneornil(L, 3) ? 0 : CheckFont(L, app, 3);
+  app->GetSceneText().SetLabelText(static_cast<uint32_t>(lua_tointeger(L, 1)),
+                                   std::string(text, length), font);
+  app->RequestRedraw();
+  return 0;
+}
+
+// App.SetLabel(id, style), style fields as for AddLabel
+int LuaEngine::Lua_SetLabel(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  ReadLabelStyle(L, 2, CheckLabel(L, app, 1));
+  app->RequestRedraw();
+  return 0;
+}
+
+// App.RemoveLabel(id) -> bool
+int LuaEngine::Lua_RemoveLabel(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  app->RequestRedraw();
+  lua_pushboolean(L, static_cast<int>(app->GetSceneText().RemoveLabel(
+                         static_cast<uint32_t>(luaL_checkinteger(L, 1)))));
+  return 1;
+}
+
+// App.ClearLabels(); fonts stay loaded
+int LuaEngine::Lua_ClearLabels(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  app->GetSceneText().ClearLabels();
+  app->RequestRedraw();
+  return 0;
+}
 
-  lua_newtable(L); // Creates the 'App' table
+// App.MeasureText(text, font [, size]) -> width, height of the text box
+int LuaEngine::Lua_MeasureText(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  size_t length = 0;
+  const char *text = luaL_checklstring(L, 1, &length);
+  const uint32_t font = CheckFont(L, app, 2);
+  const auto size = static_cast<float>(luaL_optnumber(L, 3, 16.0));
+  const glm::vec2 box =
+      app->GetSceneText().Measure(std::string(text, length), font, size);
+  lua_pushnumber(L, box.x);
+  lua_pushnumber(L, box.y);
+  return 2;
+}
+
+// App.GetTextStats() -> {fonts, labels, layouts, bakedGlyphs, glyphs}.
+// glyphs is the last frame's instance count, all drawn in one call.
+int LuaEngine::Lua_GetTextStats(lua_State *L) {
+  Application *app = GetAppInstanceFromLua(L);
+  if (app == nullptr) {
+    return luaL_error(L, "App instance not found");
+  }
+  const SceneText::Stats stats = app->GetSceneText().GetStats();
+  lua_newtable(L);
+  lua_pushinteger(L, static_cast<lua_Integer>(stats.fonts));
+  lua_setfield(L, -2, "fonts");
+  lua_pushinteger(L, static_cast<lua_Integer>(stats.labels));
+  lua_setfield(L, -2, "labels");
+  lua_pushinteger(L, static_cast<lua_Integer>(stats.layouts));
+  lua_setfield(L, -2, "layouts");
+  lua_pushinteger(L, static_cast<lua_Integer>(stats.bakedGlyphs));
+  lua_setfield(L, -2, "bakedGlyphs");
+  lua_pushinteger(L, static_cast<lua_Integer>(stats.glyphs));
+  lua_setfield(L, -2, "glyphs");
+  return 1;
+}
+
+void LuaEngine::RegisterAppFunctions(lua_State *targetL) {
+  lua_newtable(targetL); // Creates the 'App' table
   static const luaL_Reg app_functions[] = {
       {"SetShapePosition", Lua_SetShapePosition},
       {"SetShapeSize", Lua_SetShapeSize},
@@ -211,9 +1735,107 @@ void LuaEngine::RegisterBindings() {
       {"GetShapeSize", Lua_GetShapeSize},
       {"GetShapeColor", Lua_GetShapeColor},
       {"SetBackgroundColor", Lua_SetBackgroundColor},
+      {"AddShape", Lua_AddShape},
+      {"RemoveShape", Lua_RemoveShape},
+      {"MoveShape", Lua_MoveShape},
+      {"ResizeShape", Lua_ResizeShape},
+      {"RecolorShape", Lua_RecolorShape},
+      {"SetShapeVisible", Lua_SetShapeVisible},
+      {"GetShapeAt", Lua_GetShapeAt},
+      {"SetShapeRotation", Lua_SetShapeRotation},
+      {"GetShapeRotation", Lua_GetShapeRotation},
+      {"CreateGroup", Lua_CreateGroup},
+      {"RemoveGroup", Lua_RemoveGroup},
+      {"SetGroupTransform", Lua_SetGroupTransform},
+      {"GetGroupTransform", Lua_GetGroupTransform},
+      {"SetGroupParent", Lua_SetGroupParent},
+      {"AttachShape", Lua_AttachShape},
+      {"DetachShape", Lua_DetachShape},
+      {"GetTransformStats", Lua_GetTransformStats},
+      {"Tween", Lua_Tween},
+      {"Animate", Lua_Animate},
+      {"StopTween", Lua_StopTween},
+      {"StopTweens", Lua_StopTweens},
+      {"IsTweenActive", Lua_IsTweenActive},
+      {"GetTweenProgress", Lua_GetTweenProgress},
+      {"GetTweenCount", Lua_GetTweenCount},
+      {"ClearShapes", Lua_ClearShapes},
+      {"GetShapeCount", Lua_GetShapeCount},
+      {"GetRenderStats", Lua_GetRenderStats},
+      {"GetDrawStats", Lua_GetDrawStats},
+      {"ShowDrawStats", Lua_ShowDrawStats},
+      {"IsDrawStatsVisible", Lua_IsDrawStatsVisible},
+      {"GetMemoryStats", Lua_GetMemoryStats},
+      {"ShowMemoryStats", Lua_ShowMemoryStats},
+      {"IsMemoryStatsVisible", Lua_IsMemoryStatsVisible},
+      {"GetWindowSize", Lua_GetWindowSize},
+      {"RequestRedraw", Lua_RequestRedraw},
+      {"SetOnDemandRendering", Lua_SetOnDemandRendering},
+      {"IsOnDemandRendering", Lua_IsOnDemandRendering},
+      {"SetFrameLimit", Lua_SetFrameLimit},
+      {"GetFrameStats", Lua_GetFrameStats},
+      {"GetDeltaTime", Lua_GetDeltaTime},
+      {"BeginGpuScope", Lua_BeginGpuScope},
+      {"EndGpuScope", Lua_EndGpuScope},
+      {"ShowGpuProfiler", Lua_ShowGpuProfiler},
+      {"IsGpuProfilerVisible", Lua_IsGpuProfilerVisible},
+      {"GetGpuTimings", Lua_GetGpuTimings},
+      {"Screenshot", Lua_Screenshot},
+      {"StartRecording", Lua_StartRecording},
+      {"StopRecording", Lua_StopRecording},
+      {"GetCaptureStats", Lua_GetCaptureStats},
+      {"LoadImage", Lua_LoadImage},
+      {"CreateImage", Lua_CreateImage},
+      {"RemoveImage", Lua_RemoveImage},
+      {"AddSprite", Lua_AddSprite},
+      {"SetSpriteImage", Lua_SetSpriteImage},
+      {"AddCircle", Lua_AddCircle},
+      {"AddRoundedRect", Lua_AddRoundedRect},
+      {"AddRing", Lua_AddRing},
+      {"AddLine", Lua_AddLine},
+      {"AddTriangle", Lua_AddTriangle},
+      {"AddPolyline", Lua_AddPolyline},
+      {"AppendPolyline", Lua_AppendPolyline},
+      {"ClearPolyline", Lua_ClearPolyline},
+      {"RemovePolyline", Lua_RemovePolyline},
+      {"SetPolylineRect", Lua_SetPolylineRect},
+      {"SetPolylineStyle", Lua_SetPolylineStyle},
+      {"SetPolylineView", Lua_SetPolylineView},
+      {"SetPolylineRange", Lua_SetPolylineRange},
+      {"SetPolylineLayer", Lua_SetPolylineLayer},
+      {"GetPolylineInfo", Lua_GetPolylineInfo},
+      {"CreateEmitter", Lua_CreateEmitter},
+      {"SetEmitter", Lua_SetEmitter},
+      {"MoveEmitter", Lua_MoveEmitter},
+      {"BurstEmitter", Lua_BurstEmitter},
+      {"RemoveEmitter", Lua_RemoveEmitter},
+      {"GetParticleStats", Lua_GetParticleStats},
+      {"CreateGpuEmitter", Lua_CreateGpuEmitter},
+      {"SetGpuEmitter", Lua_SetGpuEmitter},
+      {"MoveGpuEmitter", Lua_MoveGpuEmitter},
+      {"BurstGpuEmitter", Lua_BurstGpuEmitter},
+      {"RemoveGpuEmitter", Lua_RemoveGpuEmitter},
+      {"GetGpuParticleStats", Lua_GetGpuParticleStats},
+      {"LoadFont", Lua_LoadFont},
+      {"AddLabel", Lua_AddLabel},
+      {"SetLabelText", Lua_SetLabelText},
+      {"SetLabel", Lua_SetLabel},
+      {"RemoveLabel", Lua_RemoveLabel},
+      {"ClearLabels", Lua_ClearLabels},
+      {"MeasureText", Lua_MeasureText},
+      {"GetTextStats", Lua_GetTextStats},
       {nullptr, nullptr}};
-  luaL_setfuncs(L, app_functions, 0);
-  lua_setglobal(L, "App"); // Sets the table as a global named "App"
+  luaL_setfuncs(targetL, app_functions, 0);
+  lua_setglobal(targetL, "App"); // Sets the table as a global named "App"
+}
+
+void LuaEngine::RegisterBindings() {
+  ImGuiBindings::Register(L);
+
+  lua_pushlightuserdata(L, m_app);
+  lua_setfield(L, LUA_REGISTRYINDEX, "AppInstance");
+
+  RegisterAppFunctions(L);
 }
 
 bool LuaEngine::LoadScriptInternal(const char *filename, lua_State *targetL) {
@@ -329,18 +1951,7 @@ bool LuaEngine::ReloadScript() {
   lua_setfield(newL, LUA_REGISTRYINDEX, "AppInstance");
 
   ImGuiBindings::Register(newL);
-  lua_newtable(newL); // Creates the 'App' table in the NEW Lua state
-  static const luaL_Reg app_functions[] = {
-      {"SetShapePosition", Lua_SetShapePosition},
-      {"SetShapeSize", Lua_SetShapeSize},
-      {"SetShapeColor", Lua_SetShapeColor},
-      {"GetShapePosition", Lua_GetShapePosition},
-      {"GetShapeSize", Lua_GetShapeSize},
-      {"GetShapeColor", Lua_GetShapeColor},
-      {"SetBackgroundColor", Lua_SetBackgroundColor},
-      {nullptr, nullptr}};
-  luaL_setfuncs(newL, app_functions, 0);
-  lua_setglobal(newL, "App");
+  RegisterAppFunctions(newL); // 'App' table in the NEW Lua state
   // --- End of re-registering App bindings
 
   if (!LoadScriptInternal(m_scriptPath.c_str(), newL)) {
@@ -354,6 +1965,9 @@ bool LuaEngine::ReloadScript() {
   }
   L = newL;              // Replace with the new state
   m_scriptLoaded = true; // Mark as loaded
+  if (m_app != nullptr) {
+    m_app->RequestRedraw(); // Show the new GUI even while idle
+  }
 
   return true;
 }
@@ -441,10 +2055,9 @@ void LuaEngine::CreateDefaultGUI() {
     static float sq_col[3] = {1.0f, 0.0f, 0.0f};
 
     bool changed = false;
-    changed |= ImGui::SliderFloat("Default Sq X", &sq_x, 0,
-                                  Application::getWindowDimensions().x);
-    changed |= ImGui::SliderFloat("Default Sq Y", &sq_y, 0,
-                                  Application::getWindowDimensions().y);
+    const glm::vec2 windowSize = m_app->getWindowDimensions();
+    changed |= ImGui::SliderFloat("Default Sq X", &sq_x, 0, windowSize.x);
+    changed |= ImGui::SliderFloat("Default Sq Y", &sq_y, 0, windowSize.y);
     if (changed) {
       m_app->SetShapePosition(sq_x, sq_y);
     }
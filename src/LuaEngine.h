@@ -8,6 +8,7 @@ extern "C" {
 
 #include <chrono>
 #include <filesystem>
+#include <string>
 
 class Application;
 
@@ -16,7 +17,8 @@ public:
   LuaEngine();
   ~LuaEngine();
 
-  bool Initialize(Application *appInstance);
+  bool Initialize(Application *appInstance,
+                  const std::string &scriptPath = "gui.lua");
   void DrawGUI();
 
   // New live reload functionality
@@ -28,6 +30,7 @@ public:
 
 private:
   void RegisterBindings();
+  static void RegisterAppFunctions(lua_State *targetL);
   void CallLuaFunction(const char *functionName);
   void CreateDefaultGUI();
 
@@ -55,4 +58,93 @@ private:
   static int Lua_GetShapePosition(lua_State *L);
   static int Lua_GetShapeSize(lua_State *L);
   static int Lua_GetShapeColor(lua_State *L);
+  static int Lua_AddShape(lua_State *L);
+  static int Lua_RemoveShape(lua_State *L);
+  static int Lua_MoveShape(lua_State *L);
+  static int Lua_ResizeShape(lua_State *L);
+  static int Lua_RecolorShape(lua_State *L);
+  static int Lua_SetShapeVisible(lua_State *L);
+  static int Lua_GetShapeAt(lua_State *L);
+  static int Lua_SetShapeRotation(lua_State *L);
+  static int Lua_GetShapeRotation(lua_State *L);
+  static int Lua_CreateGroup(lua_State *L);
+  static int Lua_RemoveGroup(lua_State *L);
+  static int Lua_SetGroupTransform(lua_State *L);
+  static int Lua_GetGroupTransform(lua_State *L);
+  static int Lua_SetGroupParent(lua_State *L);
+  static int Lua_AttachShape(lua_State *L);
+  static int Lua_DetachShape(lua_State *L);
+  static int Lua_GetTransformStats(lua_State *L);
+  static int Lua_Tween(lua_State *L);
+  static int Lua_Animate(lua_State *L);
+  static int Lua_StopTween(lua_State *L);
+  static int Lua_StopTweens(lua_State *L);
+  static int Lua_IsTweenActive(lua_State *L);
+  static int Lua_GetTweenProgress(lua_State *L);
+  static int Lua_GetTweenCount(lua_State *L);
+  static int Lua_ClearShapes(lua_State *L);
+  static int Lua_GetShapeCount(lua_State *L);
+  static int Lua_GetRenderStats(lua_State *L);
+  static int Lua_GetDrawStats(lua_State *L);
+  static int Lua_ShowDrawStats(lua_State *L);
+  static int Lua_IsDrawStatsVisible(lua_State *L);
+  static int Lua_GetMemoryStats(lua_State *L);
+  static int Lua_ShowMemoryStats(lua_State *L);
+  static int Lua_IsMemoryStatsVisible(lua_State *L);
+  static int Lua_GetWindowSize(lua_State *L);
+  static int Lua_RequestRedraw(lua_State *L);
+  static int Lua_SetOnDemandRendering(lua_State *L);
+  static int Lua_IsOnDemandRendering(lua_State *L);
+  static int Lua_SetFrameLimit(lua_State *L);
+  static int Lua_GetFrameStats(lua_State *L);
+  static int Lua_GetDeltaTime(lua_State *L);
+  static int Lua_BeginGpuScope(lua_State *L);
+  static int Lua_EndGpuScope(lua_State *L);
+  static int Lua_ShowGpuProfiler(lua_State *L);
+  static int Lua_IsGpuProfilerVisible(lua_State *L);
+  static int Lua_GetGpuTimings(lua_State *L);
+  static int Lua_Screenshot(lua_State *L);
+  static int Lua_StartRecording(lua_State *L);
+  static int Lua_StopRecording(lua_State *L);
+  static int Lua_GetCaptureStats(lua_State *L);
+  static int Lua_LoadImage(lua_State *L);
+  static int Lua_CreateImage(lua_State *L);
+  static int Lua_RemoveImage(lua_State *L);
+  static int Lua_AddSprite(lua_State *L);
+  static int Lua_SetSpriteImage(lua_State *L);
+  static int Lua_AddCircle(lua_State *L);
+  static int Lua_AddRoundedRect(lua_State *L);
+  static int Lua_AddRing(lua_State *L);
+  static int Lua_AddLine(lua_State *L);
+  static int Lua_AddTriangle(lua_State *L);
+  static int Lua_AddPolyline(lua_State *L);
+  static int Lua_AppendPolyline(lua_State *L);
+  static int Lua_ClearPolyline(lua_State *L);
+  static int Lua_RemovePolyline(lua_State *L);
+  static int Lua_SetPolylineRect(lua_State *L);
+  static int Lua_SetPolylineStyle(lua_State *L);
+  static int Lua_SetPolylineView(lua_State *L);
+  static int Lua_SetPolylineRange(lua_State *L);
+  static int Lua_SetPolylineLayer(lua_State *L);
+  static int Lua_GetPolylineInfo(lua_State *L);
+  static int Lua_CreateEmitter(lua_State *L);
+  static int Lua_SetEmitter(lua_State *L);
+  static int Lua_MoveEmitter(lua_State *L);
+  static int Lua_BurstEmitter(lua_State *L);
+  static int Lua_RemoveEmitter(lua_State *L);
+  static int Lua_GetParticleStats(lua_State *L);
+  static int Lua_CreateGpuEmitter(lua_State *L);
+  static int Lua_SetGpuEmitter(lua_State *L);
+  static int Lua_MoveGpuEmitter(lua_State *L);
+  static int Lua_BurstGpuEmitter(lua_State *L);
+  static int Lua_RemoveGpuEmitter(lua_State *L);
+  static int Lua_GetGpuParticleStats(lua_State *L);
+  static int Lua_LoadFont(lua_State *L);
+  static int Lua_AddLabel(lua_State *L);
+  static int Lua_SetLabelText(lua_State *L);
+  static int Lua_SetLabel(lua_State *L);
+  static int Lua_RemoveLabel(lua_State *L);
+  static int Lua_ClearLabels(lua_State *L);
+  static int Lua_MeasureText(lua_State *L);
+  static int Lua_GetTextStats(lua_State *L);
 };
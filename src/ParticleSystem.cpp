@@ -0,0 +1,479 @@
+#include "ParticleSystem.h"
+#include "GLState.h"
+#include "Lanes.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace {
+// Columns are padded to this many floats, the widest lane group
+constexpr size_t COLUMN_PADDING = 8;
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Xorshift32, uniform in [0, 1)
+float NextRandom(uint32_t &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+}
+
+float RandomRange(uint32_t &state, float min, float max) {
+  return min + (max - min) * NextRandom(state);
+}
+} // namespace
+
+ParticleSystem::~ParticleSystem() { Cleanup(); }
+
+void ParticleSystem::Initialize(int threadCount) {
+  Cleanup();
+  if (threadCount <= 0) {
+    threadCount =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  m_stop = false;
+  m_generation = 0; // Workers start out having seen generation 0
+  // The calling thread takes jobs too
+  for (int i = 1; i < threadCount; ++i) {
+    m_workers.emplace_back(&ParticleSystem::WorkerMain, this);
+  }
+  m_stats.threads = threadCount;
+  m_stats.lanes = Lanes::WIDTH;
+}
+
+void ParticleSystem::Cleanup() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (std::thread &worker : m_workers) {
+    worker.join();
+  }
+  m_workers.clear();
+}
+
+uint32_t ParticleSystem::CreateEmitter(const EmitterSettings &settings) {
+  const uint32_t id = m_nextId++;
+  Pool &pool = m_pools[id];
+  pool.settings = settings;
+  // Distinct, never-zero seeds, so emitters created together differ
+  pool.random = m_nextSeed | 1u;
+  m_nextSeed = m_nextSeed * 747796405u + 2891336453u;
+  return id;
+}
+
+bool ParticleSystem::DestroyEmitter(uint32_t id) {
+  return m_pools.erase(id) > 0;
+}
+
+void ParticleSystem::Clear() { m_pools.clear(); }
+
+EmitterSettings *ParticleSystem::GetSettings(uint32_t id) {
+  auto it = m_pools.find(id);
+  return it != m_pools.end() ? &it->second.settings : nullptr;
+}
+
+void ParticleSystem::Burst(uint32_t id, uint32_t count) {
+  auto it = m_pools.find(id);
+  if (it != m_pools.end()) {
+    Spawn(it->second, count);
+  }
+}
+
+void ParticleSystem::Update(float deltaTime) {
+  const auto start = std::chrono::steady_clock::now();
+  m_deltaTime = deltaTime;
+  m_jobs.clear();
+  for (auto &[id, pool] : m_pools) {
+    // The rate's fractions carry over, so low rates still spawn steadily
+    pool.spawnCarry += std::max(pool.settings.rate, 0.0f) * deltaTime;
+    const auto due = static_cast<uint32_t>(pool.spawnCarry);
+    pool.spawnCarry -= static_cast<float>(due);
+    if (pool.count >= pool.settings.maxParticles) {
+      pool.spawnCarry = 0.0f; // Nothing owed while capped
+    }
+    Spawn(pool, due);
+    for (size_t begin = 0; begin < pool.count; begin += CHUNK_SIZE) {
+      m_jobs.push_back(
+          {&pool, begin, std::min(begin + CHUNK_SIZE, pool.count), 0});
+    }
+  }
+  RunJobs();
+
+  // A pool's jobs are consecutive
+  for (size_t first = 0; first < m_jobs.size();) {
+    size_t last = first + 1;
+    while (last < m_jobs.size() && m_jobs[last].pool == m_jobs[first].pool) {
+      ++last;
+    }
+    Compact(*m_jobs[first].pool, &m_jobs[first], last - first);
+    first = last;
+  }
+  m_stats.updateMs = MillisecondsSince(start);
+}
+
+void ParticleSystem::Emit(ParticleBatch &batch) const {
+  for (const auto &[id, pool] : m_pools) {
+    if (pool.count == 0) {
+      continue;
+    }
+    const EmitterSettings &settings = pool.settings;
+    ParticleDraw draw;
+    draw.first = static_cast<uint32_t>(batch.x.size());
+    draw.count = static_cast<uint32_t>(pool.count);
+    draw.startColor = settings.startColor;
+    draw.endColor = settings.endColor;
+    draw.startSize = settings.startSize;
+    draw.endSize = settings.endSize;
+    draw.blend = settings.blend;
+    draw.layer = settings.layer;
+    batch.draws.push_back(draw);
+
+    batch.x.insert(batch.x.end(), pool.x.begin(),
+                   pool.x.begin() + pool.count);
+    batch.y.insert(batch.y.end(), pool.y.begin(),
+                   pool.y.begin() + pool.count);
+    // Whole lane groups, then the padding is cut off again
+    const size_t base = batch.life.size();
+    const size_t padded =
+        (pool.count + Lanes::WIDTH - 1) / Lanes::WIDTH * Lanes::WIDTH;
+    batch.life.resize(base + padded);
+    for (size_t i = 0; i < padded; i += Lanes::WIDTH) {
+      (Lanes::LoadUnaligned(&pool.age[i]) *
+       Lanes::LoadUnaligned(&pool.inverseLifetime[i]))
+          .StoreUnaligned(&batch.life[base + i]);
+    }
+    batch.life.resize(base + pool.count);
+  }
+}
+
+size_t ParticleSystem::ParticleCount() const {
+  size_t count = 0;
+  for (const auto &[id, pool] : m_pools) {
+    count += pool.count;
+  }
+  return count;
+}
+
+bool ParticleSystem::IsActive() const {
+  for (const auto &[id, pool] : m_pools) {
+    if (pool.count > 0 ||
+        (pool.settings.rate > 0.0f && pool.settings.maxParticles > 0)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+ParticleSystem::Stats ParticleSystem::GetStats() const {
+  Stats stats = m_stats;
+  stats.particles = ParticleCount();
+  stats.emitters = m_pools.size();
+  return stats;
+}
+
+void ParticleSystem::Resize(Pool &pool, size_t count) {
+  const size_t padded =
+      (count + COLUMN_PADDING - 1) / COLUMN_PADDING * COLUMN_PADDING;
+  for (std::vector<float> *column :
+       {&pool.x, &pool.y, &pool.velocityX, &pool.velocityY, &pool.age,
+        &pool.inverseLifetime}) {
+    column->resize(padded, 0.0f);
+  }
+  pool.count = count;
+}
+
+void ParticleSystem::Spawn(Pool &pool, uint32_t count) {
+  const EmitterSettings &settings = pool.settings;
+  if (pool.count >= settings.maxParticles) {
+    return;
+  }
+  count = static_cast<uint32_t>(
+      std::min<size_t>(count, settings.maxParticles - pool.count));
+  const size_t first = pool.count;
+  Resize(pool, first + count);
+  const float lifetimeMin = std::max(settings.lifetimeMin, 1e-3f);
+  const float lifetimeMax = std::max(settings.lifetimeMax, lifetimeMin);
+  for (size_t i = first; i < pool.count; ++i) {
+    const float angle =
+        settings.direction + (NextRandom(pool.random) - 0.5f) * settings.spread;
+    const float speed =
+        RandomRange(pool.random, settings.speedMin, settings.speedMax);
+    pool.x[i] = settings.position.x;
+    pool.y[i] = settings.position.y;
+    pool.velocityX[i] = std::cos(angle) * speed;
+    pool.velocityY[i] = std::sin(angle) * speed;
+    pool.age[i] = 0.0f;
+    pool.inverseLifetime[i] =
+        1.0f / RandomRange(pool.random, lifetimeMin, lifetimeMax);
+  }
+}
+
+// Semi-implicit Euler, then the chunk's survivors are packed to its front.
+// Lane groups with no deaths before the first hole are left where they are.
+void ParticleSystem::Integrate(Job &job, float deltaTime) {
+  Pool &pool = *job.pool;
+  const EmitterSettings &settings = pool.settings;
+  const Lanes dt = Lanes::Set(deltaTime);
+  const Lanes gravityX = Lanes::Set(settings.gravity.x * deltaTime);
+  const Lanes gravityY = Lanes::Set(settings.gravity.y * deltaTime);
+  const Lanes damping =
+      Lanes::Set(std::exp(-std::max(settings.drag, 0.0f) * deltaTime));
+  const Lanes one = Lanes::Set(1.0f);
+
+  size_t write = job.begin;
+  for (size_t i = job.begin; i < job.end; i += Lanes::WIDTH) {
+    const Lanes velocityX =
+        (Lanes::LoadUnaligned(&pool.velocityX[i]) + gravityX) * damping;
+    const Lanes velocityY =
+        (Lanes::LoadUnaligned(&pool.velocityY[i]) + gravityY) * damping;
+    velocityX.StoreUnaligned(&pool.velocityX[i]);
+    velocityY.StoreUnaligned(&pool.velocityY[i]);
+    (Lanes::LoadUnaligned(&pool.x[i]) + velocityX * dt)
+        .StoreUnaligned(&pool.x[i]);
+    (Lanes::LoadUnaligned(&pool.y[i]) + velocityY * dt)
+        .StoreUnaligned(&pool.y[i]);
+    const Lanes age = Lanes::LoadUnaligned(&pool.age[i]) + dt;
+    age.StoreUnaligned(&pool.age[i]);
+
+    const Lanes dead = GreaterEqual(
+        age * Lanes::LoadUnaligned(&pool.inverseLifetime[i]), one);
+    if (write == i && i + Lanes::WIDTH <= job.end && !Any(dead)) {
+      write += Lanes::WIDTH;
+      continue;
+    }
+    // Same test as the lanes', so both agree on who died
+    const size_t groupEnd = std::min(i + Lanes::WIDTH, job.end);
+    for (size_t k = i; k < groupEnd; ++k) {
+      if (pool.age[k] * pool.inverseLifetime[k] >= 1.0f) {
+        continue;
+      }
+      if (write != k) {
+        pool.x[write] = pool.x[k];
+        pool.y[write] = pool.y[k];
+        pool.velocityX[write] = pool.velocityX[k];
+        pool.velocityY[write] = pool.velocityY[k];
+        pool.age[write] = pool.age[k];
+        pool.inverseLifetime[write] = pool.inverseLifetime[k];
+      }
+      ++write;
+    }
+  }
+  job.live = write - job.begin;
+}
+
+// Every job's survivors sit at its front. Holes in the front jobs are
+// filled with survivors from the back ones until the two meet, which leaves
+// every survivor in [0, count).
+void ParticleSystem::Compact(Pool &pool, Job *jobs, size_t jobCount) {
+  size_t front = 0;
+  size_t back = jobCount - 1;
+  while (front < back) {
+    Job &holes = jobs[front];
+    Job &tail = jobs[back];
+    const size_t gap = holes.end - holes.begin - holes.live;
+    if (gap == 0) {
+      ++front;
+      continue;
+    }
+    if (tail.live == 0) {
+      --back;
+      continue;
+    }
+    const size_t moved = std::min(gap, tail.live);
+    const size_t from = tail.begin + tail.live - moved;
+    const size_t to = holes.begin + holes.live;
+    for (std::vector<float> *column :
+         {&pool.x, &pool.y, &pool.velocityX, &pool.velocityY, &pool.age,
+          &pool.inverseLifetime}) {
+      std::copy(column->begin() + from, column->begin() + from + moved,
+                column->begin() + to);
+    }
+    holes.live += moved;
+    tail.live -= moved;
+  }
+  Resize(pool, jobs[front].begin + jobs[front].live);
+}
+
+void ParticleSystem::RunJobs() {
+  m_nextJob.store(0);
+  const bool parallel = !m_workers.empty() && m_jobs.size() > 1;
+  if (parallel) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      ++m_generation;
+      m_busyWorkers = static_cast<int>(m_workers.size());
+    }
+    m_wake.notify_all();
+  }
+  for (size_t index = m_nextJob.fetch_add(1); index < m_jobs.size();
+       index = m_nextJob.fetch_add(1)) {
+    Integrate(m_jobs[index], m_deltaTime);
+  }
+  if (parallel) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+  }
+}
+
+void ParticleSystem::WorkerMain() {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+      if (m_stop) {
+        return;
+      }
+      seen = m_generation;
+    }
+    for (size_t index = m_nextJob.fetch_add(1); index < m_jobs.size();
+         index = m_nextJob.fetch_add(1)) {
+      Integrate(m_jobs[index], m_deltaTime);
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_busyWorkers == 0) {
+        m_done.notify_one();
+      }
+    }
+  }
+}
+
+// Each instance is one particle; the quad is grown by a unit for the
+// anti-aliased edge, like the polyline capsules. Only GPU particles are
+// ever dead when drawn.
+const char *ParticleRenderer::VERTEX_SHADER = R"(
+    #version 410 core
+    layout (location = 0) in float iX;
+    layout (location = 1) in float iY;
+    layout (location = 2) in float iLife; // 0 at spawn, 1 at death
+
+    uniform vec4 u_startColor;
+    uniform vec4 u_endColor;
+    uniform vec2 u_size; // Diameter at spawn and at death
+
+    out vec2 vLocal;
+    flat out float vRadius;
+    out vec4 vColor;
+
+    void main() {
+        if (iLife >= 1.0) {
+            gl_Position = vec4(0.0); // Dead: the quad collapses
+            return;
+        }
+        vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+        vRadius = mix(u_size.x, u_size.y, iLife) * 0.5;
+        vLocal = (corner * 2.0 - 1.0) * (vRadius + 1.0);
+        vColor = mix(u_startColor, u_endColor, iLife);
+        gl_Position = u_projection * vec4(vec2(iX, iY) + vLocal, 0.0, 1.0);
+    }
+)";
+
+const char *ParticleRenderer::FRAGMENT_SHADER = R"(
+    #version 410 core
+    in vec2 vLocal;
+    flat in float vRadius;
+    in vec4 vColor;
+
+    out vec4 FragColor;
+
+    void main() {
+        float d = length(vLocal) - vRadius;
+        float coverage = clamp(0.5 - d / max(fwidth(d), 1e-4), 0.0, 1.0);
+        if (coverage <= 0.0) {
+            discard;
+        }
+        FragColor = vec4(vColor.rgb, vColor.a * coverage);
+    }
+)";
+
+ParticleRenderer::~ParticleRenderer() { Cleanup(); }
+
+bool ParticleRenderer::Initialize(ResourceManager *resources) {
+  m_shader = resources->AcquireProgram(VERTEX_SHADER, FRAGMENT_SHADER);
+  if (!m_shader) {
+    std::cerr << "ParticleRenderer::Initialize: failed to build the particle "
+                 "shader\n";
+    return false;
+  }
+  m_startColorUniform = m_shader->GetUniform<glm::vec4>("u_startColor");
+  m_endColorUniform = m_shader->GetUniform<glm::vec4>("u_endColor");
+  m_sizeUniform = m_shader->GetUniform<glm::vec2>("u_size");
+
+  // All three columns advance per instance; the pointers move with every
+  // draw to the emitter's range
+  glGenVertexArrays(1, &m_VAO);
+  glGenBuffers(1, &m_VBO);
+  GLState::BindVertexArray(m_VAO);
+  for (GLuint attrib = 0; attrib <= 2; ++attrib) {
+    glEnableVertexAttribArray(attrib);
+    glVertexAttribDivisor(attrib, 1);
+  }
+  return m_VAO != 0 && m_VBO != 0;
+}
+
+void ParticleRenderer::Submit(const ParticleBatch &batch, RenderQueue &queue) {
+  if (m_VAO == 0 || batch.draws.empty()) {
+    return;
+  }
+  m_columnBytes = batch.x.size() * sizeof(float);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  // Orphaned: the driver hands out fresh storage if draws still read the
+  // old one
+  glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(3 * m_columnBytes),
+               nullptr, GL_STREAM_DRAW);
+  size_t offset = 0;
+  for (const std::vector<float> *column : {&batch.x, &batch.y, &batch.life}) {
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(offset),
+                    static_cast<GLsizeiptr>(m_columnBytes), column->data());
+    offset += m_columnBytes;
+  }
+  m_batch = &batch;
+
+  DrawCommand command;
+  command.program = m_shader->ID;
+  command.vertexArray = m_VAO;
+  command.execute = &ParticleRenderer::DrawParticles;
+  command.context = this;
+  for (size_t i = 0; i < batch.draws.size(); ++i) {
+    command.blend = batch.draws[i].blend;
+    command.argument = static_cast<uint32_t>(i);
+    queue.Submit(command, batch.draws[i].layer);
+  }
+}
+
+// Runs with the program and VAO bound by the queue
+void ParticleRenderer::DrawParticles(void *context, uint32_t drawIndex) {
+  auto *renderer = static_cast<ParticleRenderer *>(context);
+  const ParticleDraw &draw = renderer->m_batch->draws[drawIndex];
+  const size_t first = draw.first * sizeof(float);
+  const size_t column = renderer->m_columnBytes;
+  GLState::BindBuffer(GL_ARRAY_BUFFER, renderer->m_VBO);
+  glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, 0, (void *)first);
+  glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 0, (void *)(column + first));
+  glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 0,
+                        (void *)(2 * column + first));
+  const Shader &shader = *renderer->m_shader;
+  shader.Set(renderer->m_startColorUniform, draw.startColor);
+  shader.Set(renderer->m_endColorUniform, draw.endColor);
+  shader.Set(renderer->m_sizeUniform,
+             glm::vec2(draw.startSize, draw.endSize));
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                        static_cast<GLsizei>(draw.count));
+}
+
+void ParticleRenderer::Cleanup() {
+  GLState::DeleteVertexArray(m_VAO);
+  GLState::DeleteBuffer(m_VBO);
+  m_VAO = m_VBO = 0;
+  m_batch = nullptr;
+  m_shader.Reset();
+}
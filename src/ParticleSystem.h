@@ -0,0 +1,209 @@
+#pragma once
+
+#include "RenderQueue.h"
+#include "ResourceManager.h"
+#include "Shader.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <glm.hpp>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// How an emitter spawns its particles and how they look. Distances are
+// window units, angles radians, clockwise from +x like shape rotation.
+struct EmitterSettings {
+  glm::vec2 position = glm::vec2(0.0f);
+  float rate = 1000.0f;          // Particles per second
+  uint32_t maxParticles = 100000; // Spawning pauses at the cap
+  float lifetimeMin = 1.0f;      // Seconds
+  float lifetimeMax = 2.0f;
+  float speedMin = 50.0f;
+  float speedMax = 150.0f;
+  float direction = -1.5707964f; // Up the screen
+  float spread = 6.2831855f;     // Full angle of the spawn cone
+  glm::vec2 gravity = glm::vec2(0.0f, 200.0f);
+  float drag = 0.0f; // Velocity decays by e^(-drag) per second
+  // Over each particle's life, start to end
+  glm::vec4 startColor = glm::vec4(1.0f, 0.8f, 0.3f, 1.0f);
+  glm::vec4 endColor = glm::vec4(1.0f, 0.2f, 0.1f, 0.0f);
+  float startSize = 6.0f; // Diameter
+  float endSize = 2.0f;
+  BlendMode blend = BlendMode::Additive;
+  uint8_t layer = DrawLayer::Particles;
+};
+
+// One emitter's particles in a ParticleBatch, and the looks its shader
+// interpolates between
+struct ParticleDraw {
+  uint32_t first = 0;
+  uint32_t count = 0;
+  glm::vec4 startColor = glm::vec4(1.0f);
+  glm::vec4 endColor = glm::vec4(1.0f);
+  float startSize = 1.0f;
+  float endSize = 1.0f;
+  BlendMode blend = BlendMode::Additive;
+  uint8_t layer = DrawLayer::Particles;
+};
+
+// Every live particle of a frame, SoA: position in window units and the
+// share of its life spent, 0 to 1. Color and size follow from the life on
+// the GPU, so this is all that crosses to the render thread.
+struct ParticleBatch {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> life;
+  std::vector<ParticleDraw> draws;
+
+  void Clear() {
+    x.clear();
+    y.clear();
+    life.clear();
+    draws.clear();
+  }
+};
+
+// CPU particles for high-volume transient effects. Each emitter keeps a
+// pool of SoA columns (position, velocity, age, inverse lifetime).
+// Update() spawns on the calling thread, then integrates every pool in
+// 16k-particle chunks spread over a worker pool, several particles per
+// SIMD step; each chunk packs its survivors to its front on the way. The
+// holes left behind are filled from the pool's tail, so compaction moves
+// one particle per death, not the whole pool.
+//
+// Emitter ids are never 0. Main thread only, apart from the workers
+// Update() runs while it waits.
+class ParticleSystem {
+public:
+  struct Stats {
+    size_t particles = 0;
+    size_t emitters = 0;
+    int threads = 0; // Including the calling thread
+    int lanes = 1;   // Particles per SIMD step
+    double updateMs = 0.0;
+  };
+
+  ParticleSystem() = default;
+  ~ParticleSystem();
+  ParticleSystem(const ParticleSystem &) = delete;
+  ParticleSystem &operator=(const ParticleSystem &) = delete;
+
+  // threadCount 0 uses every hardware thread
+  void Initialize(int threadCount = 0);
+  // Stops the workers; emitters are kept
+  void Cleanup();
+
+  uint32_t CreateEmitter(const EmitterSettings &settings);
+  bool DestroyEmitter(uint32_t id);
+  void Clear();
+  // Null for unknown ids. Changes apply to particles spawned afterwards,
+  // apart from the looks, which every live particle takes on.
+  EmitterSettings *GetSettings(uint32_t id);
+  // Spawns count particles at once, up to the emitter's cap
+  void Burst(uint32_t id, uint32_t count);
+
+  // Spawns, moves and ages every particle by deltaTime seconds, and drops
+  // the ones that died
+  void Update(float deltaTime);
+  // Appends every live particle and one draw per non-empty emitter
+  void Emit(ParticleBatch &batch) const;
+
+  [[nodiscard]] size_t ParticleCount() const;
+  // True while any emitter has particles or keeps spawning them
+  [[nodiscard]] bool IsActive() const;
+  [[nodiscard]] Stats GetStats() const;
+
+private:
+  static constexpr size_t CHUNK_SIZE = 16384;
+
+  struct Pool {
+    EmitterSettings settings;
+    size_t count = 0;
+    // Padded to whole lane groups past count; the padding is never read
+    // back as particles
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> velocityX;
+    std::vector<float> velocityY;
+    std::vector<float> age;
+    std::vector<float> inverseLifetime;
+    float spawnCarry = 0.0f; // Fraction of a particle owed by the rate
+    uint32_t random = 0;     // Xorshift state, never 0
+  };
+
+  // [begin, end) of one pool, integrated by whichever thread takes it
+  struct Job {
+    Pool *pool = nullptr;
+    size_t begin = 0;
+    size_t end = 0;
+    size_t live = 0; // Survivors, packed to begin
+  };
+
+  static void Resize(Pool &pool, size_t count);
+  static void Spawn(Pool &pool, uint32_t count);
+  static void Integrate(Job &job, float deltaTime);
+  // Fills the holes the jobs of one pool left, from its tail
+  static void Compact(Pool &pool, Job *jobs, size_t jobCount);
+
+  void WorkerMain();
+  void RunJobs();
+
+  std::map<uint32_t, Pool> m_pools; // Ordered: drawn by id
+  uint32_t m_nextId = 1;
+  uint32_t m_nextSeed = 0x9E3779B9u;
+
+  // This frame
+  std::vector<Job> m_jobs;
+  float m_deltaTime = 0.0f;
+
+  // Worker pool; a frame's jobs go to whoever takes them first
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  uint64_t m_generation = 0;
+  int m_busyWorkers = 0;
+  bool m_stop = false;
+  std::atomic<size_t> m_nextJob{0};
+
+  Stats m_stats;
+};
+
+// Draws a ParticleBatch: one instanced draw per emitter, each particle a
+// quad shaded as an anti-aliased disc, submitted to a RenderQueue at the
+// emitter's layer. The batch's columns are uploaded into a buffer orphaned
+// every frame, so uploads never wait on draws still reading the last one.
+class ParticleRenderer {
+public:
+  // The quad program; attributes 0 to 2 are x, y and life per instance.
+  // GpuParticleRenderer draws its particles with it too.
+  static const char *VERTEX_SHADER;
+  static const char *FRAGMENT_SHADER;
+
+  ParticleRenderer() = default;
+  ~ParticleRenderer();
+  ParticleRenderer(const ParticleRenderer &) = delete;
+  ParticleRenderer &operator=(const ParticleRenderer &) = delete;
+
+  bool Initialize(ResourceManager *resources);
+  // Uploads the particles and submits the draws. The batch has to outlive
+  // the queue's Execute().
+  void Submit(const ParticleBatch &batch, RenderQueue &queue);
+  void Cleanup();
+
+private:
+  static void DrawParticles(void *context, uint32_t drawIndex);
+
+  ProgramRef m_shader;
+  UniformHandle<glm::vec4> m_startColorUniform;
+  UniformHandle<glm::vec4> m_endColorUniform;
+  UniformHandle<glm::vec2> m_sizeUniform;
+  GLuint m_VAO = 0;
+  GLuint m_VBO = 0;
+
+  // The submitted frame, read back by DrawParticles
+  const ParticleBatch *m_batch = nullptr;
+  size_t m_columnBytes = 0; // Size of each column in m_VBO
+};
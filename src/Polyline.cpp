@@ -0,0 +1,311 @@
+#include "Polyline.h"
+#include "GLState.h"
+#include "StreamBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+// Each instance is one segment, iFrom -> iTo, read from consecutive points
+// of the stream buffer by offsetting the second attribute by one point. The
+// quad is grown by the half width plus a unit for the anti-aliased edge.
+const char *s_polylineVertexShaderSource = R"(
+    #version 410 core
+    layout (location = 0) in vec2 iFrom;
+    layout (location = 1) in vec2 iTo;
+
+    uniform float u_halfWidth;
+
+    out vec2 vPos;
+    flat out vec2 vFrom;
+    flat out vec2 vTo;
+
+    void main() {
+        vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+        vec2 dir = iTo - iFrom;
+        float len = length(dir);
+        dir = len > 1e-6 ? dir / len : vec2(1.0, 0.0);
+        vec2 normal = vec2(-dir.y, dir.x);
+        float extent = u_halfWidth + 1.0;
+        vPos = mix(iFrom - dir * extent, iTo + dir * extent, corner.x) +
+               normal * extent * (corner.y * 2.0 - 1.0);
+        vFrom = iFrom;
+        vTo = iTo;
+        gl_Position = u_projection * vec4(vPos, 0.0, 1.0);
+    }
+)";
+
+const char *s_polylineFragmentShaderSource = R"(
+    #version 410 core
+    in vec2 vPos;
+    flat in vec2 vFrom;
+    flat in vec2 vTo;
+
+    uniform vec4 u_color;
+    uniform vec4 u_clipRect;
+    uniform float u_halfWidth;
+
+    out vec4 FragColor;
+
+    void main() {
+        vec2 pa = vPos - vFrom;
+        vec2 ba = vTo - vFrom;
+        float h = clamp(dot(pa, ba) / max(dot(ba, ba), 1e-8), 0.0, 1.0);
+        float d = length(pa - ba * h) - u_halfWidth;
+        float coverage = clamp(0.5 - d / max(fwidth(d), 1e-4), 0.0, 1.0);
+        if (coverage <= 0.0 || any(lessThan(vPos, u_clipRect.xy)) ||
+            any(greaterThan(vPos, u_clipRect.zw))) {
+            discard;
+        }
+        FragColor = vec4(u_color.rgb, u_color.a * coverage);
+    }
+)";
+} // namespace
+
+void MinMaxPyramid::Append(const float *samples, size_t count) {
+  m_samples.reserve(m_samples.size() + count);
+  for (size_t s = 0; s < count; ++s) {
+    const float value = samples[s];
+    const size_t index = m_samples.size();
+    m_samples.push_back(value);
+
+    // The sample lands in exactly one bucket per level
+    for (size_t level = 1; level <= m_levels.size(); ++level) {
+      std::vector<glm::vec2> &buckets = m_levels[level - 1];
+      const size_t bucket = index >> level;
+      if (bucket == buckets.size()) {
+        buckets.emplace_back(value, value);
+      } else {
+        buckets[bucket].x = std::min(buckets[bucket].x, value);
+        buckets[bucket].y = std::max(buckets[bucket].y, value);
+      }
+    }
+
+    // Once the top level has two buckets, summarize it one level up
+    if (m_levels.empty()) {
+      if (m_samples.size() == 2) {
+        m_levels.push_back({{std::min(m_samples[0], m_samples[1]),
+                             std::max(m_samples[0], m_samples[1])}});
+      }
+    } else if (m_levels.back().size() == 2) {
+      const std::vector<glm::vec2> &top = m_levels.back();
+      m_levels.push_back({{std::min(top[0].x, top[1].x),
+                           std::max(top[0].y, top[1].y)}});
+    }
+  }
+}
+
+void MinMaxPyramid::Clear() {
+  m_samples.clear();
+  m_levels.clear();
+}
+
+void Polyline::Append(const float *samples, size_t count) {
+  m_pyramid.Append(samples, count);
+}
+
+void Polyline::Clear() { m_pyramid.Clear(); }
+
+void Polyline::SetRect(const glm::vec2 &position, const glm::vec2 &size) {
+  m_position = position;
+  m_size = glm::max(size, glm::vec2(1.0f));
+}
+
+void Polyline::SetStyle(const glm::vec4 &color, float thickness) {
+  m_color = color;
+  m_thickness = std::max(thickness, 0.0f);
+}
+
+void Polyline::SetView(double first, double count) {
+  m_viewFirst = first;
+  m_viewCount = count;
+}
+
+void Polyline::SetValueRange(float min, float max) {
+  m_valueMin = min;
+  m_valueMax = max;
+}
+
+void Polyline::Emit(float pixelsPerUnit, PolylineBatch &batch) {
+  const size_t size = m_pyramid.Size();
+  if (size == 0) {
+    return;
+  }
+
+  // Visible samples; `first` may lie before the series when following
+  double first = 0.0;
+  double count = static_cast<double>(size);
+  if (m_viewCount > 0.0) {
+    count = m_viewCount;
+    first = m_viewFirst < 0.0 ? static_cast<double>(size) - count
+                              : m_viewFirst;
+  }
+  const double firstVisible = std::max(first, 0.0);
+  const double endVisible = std::min(first + count, static_cast<double>(size));
+  if (endVisible <= firstVisible) {
+    return;
+  }
+
+  // Coarsest level that still has at least one bucket per pixel
+  const double pixels = std::max(m_size.x * pixelsPerUnit, 1.0f);
+  int level = 0;
+  if (count / pixels >= 2.0) {
+    level = static_cast<int>(std::floor(std::log2(count / pixels)));
+  }
+  level = std::min(level, m_pyramid.LevelCount() - 1);
+  m_lastLevel = level;
+
+  // Gather (sample position, value) pairs, one bucket past each edge so the
+  // line runs on into the clip rect. Positions are relative to first, taken
+  // in double: absolute indices past 2^24 don't fit a float exactly.
+  const size_t bucketSize = size_t(1) << level;
+  const auto firstBucket =
+      static_cast<size_t>(firstVisible) / bucketSize;
+  const size_t endBucket =
+      (static_cast<size_t>(std::ceil(endVisible)) + bucketSize - 1) /
+      bucketSize;
+  const size_t begin = firstBucket > 0 ? firstBucket - 1 : 0;
+  const size_t bucketCount = (size + bucketSize - 1) / bucketSize;
+  const size_t end = std::min(endBucket + 1, bucketCount);
+
+  const size_t firstPoint = batch.points.size();
+  if (level == 0) {
+    const std::vector<float> &samples = m_pyramid.Samples();
+    for (size_t i = begin; i < end; ++i) {
+      batch.points.emplace_back(
+          static_cast<float>(static_cast<double>(i) - first), samples[i]);
+    }
+  } else {
+    // Zig-zag through each bucket's extremes: the strokes cover every
+    // column's full range and join neighbouring columns
+    const std::vector<glm::vec2> &buckets = m_pyramid.Level(level);
+    for (size_t b = begin; b < end; ++b) {
+      const size_t start = b * bucketSize;
+      const size_t stop = std::min(start + bucketSize, size);
+      const auto center = static_cast<float>(
+          static_cast<double>(start + stop - 1) * 0.5 - first);
+      const bool rising = (b & 1) == 0;
+      batch.points.emplace_back(center,
+                                rising ? buckets[b].x : buckets[b].y);
+      batch.points.emplace_back(center,
+                                rising ? buckets[b].y : buckets[b].x);
+    }
+  }
+
+  float low = m_valueMin;
+  float high = m_valueMax;
+  if (low >= high) {
+    low = batch.points[firstPoint].y;
+    high = low;
+    for (size_t i = firstPoint; i < batch.points.size(); ++i) {
+      low = std::min(low, batch.points[i].y);
+      high = std::max(high, batch.points[i].y);
+    }
+    if (low == high) {
+      low -= 1.0f;
+      high += 1.0f;
+    }
+  }
+
+  // To window coordinates; values grow upwards
+  const double xScale = m_size.x / std::max(count - 1.0, 1.0);
+  const float yScale = m_size.y / (high - low);
+  for (size_t i = firstPoint; i < batch.points.size(); ++i) {
+    glm::vec2 &point = batch.points[i];
+    point.x = m_position.x + static_cast<float>(point.x * xScale);
+    point.y = m_position.y + m_size.y - (point.y - low) * yScale;
+  }
+
+  PolylineDraw &draw = batch.draws.emplace_back();
+  draw.firstPoint = static_cast<uint32_t>(firstPoint);
+  draw.pointCount = static_cast<uint32_t>(batch.points.size() - firstPoint);
+  draw.color = m_color;
+  draw.clipRect = {m_position, m_position + m_size};
+  draw.thickness = m_thickness;
+  draw.layer = m_layer;
+}
+
+PolylineRenderer::~PolylineRenderer() { Cleanup(); }
+
+bool PolylineRenderer::Initialize(ResourceManager *resources) {
+  m_shader = resources->AcquireProgram(s_polylineVertexShaderSource,
+                                       s_polylineFragmentShaderSource);
+  if (!m_shader) {
+    std::cerr
+        << "PolylineRenderer::Initialize: failed to build the line shader\n";
+    return false;
+  }
+  m_colorUniform = m_shader->GetUniform<glm::vec4>("u_color");
+  m_clipRectUniform = m_shader->GetUniform<glm::vec4>("u_clipRect");
+  m_halfWidthUniform = m_shader->GetUniform<float>("u_halfWidth");
+
+  // Both attributes advance per instance; the pointers move with every
+  // draw, since the points live wherever the stream buffer put them
+  glGenVertexArrays(1, &m_VAO);
+  GLState::BindVertexArray(m_VAO);
+  for (GLuint attrib = 0; attrib <= 1; ++attrib) {
+    glEnableVertexAttribArray(attrib);
+    glVertexAttribDivisor(attrib, 1);
+  }
+  return m_VAO != 0;
+}
+
+void PolylineRenderer::Submit(const PolylineBatch &batch,
+                              StreamBuffer &stream, RenderQueue &queue) {
+  if (m_VAO == 0 || batch.draws.empty()) {
+    return;
+  }
+  const auto bytes =
+      static_cast<GLsizeiptr>(batch.points.size() * sizeof(glm::vec2));
+  StreamBuffer::Allocation allocation = stream.Allocate(bytes);
+  if (!allocation.IsValid()) {
+    return; // Region full; the stream buffer reports it
+  }
+  std::memcpy(allocation.data, batch.points.data(),
+              static_cast<size_t>(bytes));
+  stream.Commit(allocation);
+  m_batch = &batch;
+  m_pointBuffer = stream.GetBuffer();
+  m_pointOffset = static_cast<size_t>(allocation.offset);
+
+  DrawCommand command;
+  command.program = m_shader->ID;
+  command.vertexArray = m_VAO;
+  command.blend = BlendMode::Alpha;
+  command.execute = &PolylineRenderer::DrawPolyline;
+  command.context = this;
+  for (size_t i = 0; i < batch.draws.size(); ++i) {
+    if (batch.draws[i].pointCount < 2) {
+      continue;
+    }
+    command.argument = static_cast<uint32_t>(i);
+    queue.Submit(command, batch.draws[i].layer);
+  }
+}
+
+// Runs with the program and VAO bound by the queue
+void PolylineRenderer::DrawPolyline(void *context, uint32_t drawIndex) {
+  auto *renderer = static_cast<PolylineRenderer *>(context);
+  const PolylineDraw &draw = renderer->m_batch->draws[drawIndex];
+  const size_t offset =
+      renderer->m_pointOffset + draw.firstPoint * sizeof(glm::vec2);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, renderer->m_pointBuffer);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2),
+                        (void *)offset);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2),
+                        (void *)(offset + sizeof(glm::vec2)));
+  const Shader &shader = *renderer->m_shader;
+  shader.Set(renderer->m_colorUniform, draw.color);
+  shader.Set(renderer->m_clipRectUniform, draw.clipRect);
+  shader.Set(renderer->m_halfWidthUniform, draw.thickness * 0.5f);
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                        static_cast<GLsizei>(draw.pointCount - 1));
+}
+
+void PolylineRenderer::Cleanup() {
+  GLState::DeleteVertexArray(m_VAO);
+  m_VAO = 0;
+  m_batch = nullptr;
+  m_shader.Reset();
+}
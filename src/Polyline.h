@@ -0,0 +1,135 @@
+#pragma once
+
+#include "RenderQueue.h"
+#include "ResourceManager.h"
+#include "Shader.h"
+#include <cstdint>
+#include <glm.hpp>
+#include <vector>
+
+class StreamBuffer;
+
+// Min/max summary of a growing series of evenly spaced samples. Level 0 is
+// the samples themselves; level k holds the min and max of each bucket of
+// 2^k samples. Appending updates one bucket per level, so a series can grow
+// by a sample at a time without rebuilding anything.
+class MinMaxPyramid {
+public:
+  void Append(const float *samples, size_t count);
+  void Clear();
+
+  [[nodiscard]] size_t Size() const { return m_samples.size(); }
+  // Levels with at least one bucket, counting level 0
+  [[nodiscard]] int LevelCount() const {
+    return static_cast<int>(m_levels.size()) + 1;
+  }
+  [[nodiscard]] const std::vector<float> &Samples() const {
+    return m_samples;
+  }
+  // Buckets of level >= 1 as (min, max); the last one may be partial
+  [[nodiscard]] const std::vector<glm::vec2> &Level(int level) const {
+    return m_levels[level - 1];
+  }
+
+private:
+  std::vector<float> m_samples;
+  std::vector<std::vector<glm::vec2>> m_levels; // Level k at [k - 1]
+};
+
+// One polyline in a PolylineBatch. Points are in window coordinates.
+struct PolylineDraw {
+  uint32_t firstPoint = 0;
+  uint32_t pointCount = 0;
+  glm::vec4 color = glm::vec4(1.0f);
+  glm::vec4 clipRect = glm::vec4(0.0f); // x0, y0, x1, y1
+  float thickness = 1.0f;
+  uint8_t layer = DrawLayer::Polylines;
+};
+
+// Every polyline of a frame, reduced to screen-resolution point lists on the
+// main thread; this, not the series, is what crosses to the render thread
+struct PolylineBatch {
+  std::vector<glm::vec2> points;
+  std::vector<PolylineDraw> draws;
+
+  void Clear() {
+    points.clear();
+    draws.clear();
+  }
+};
+
+// A sample series plotted into a rectangle of the window. The visible range
+// is drawn from the pyramid level closest to one bucket per pixel: level 0
+// as the samples themselves, coarser levels as the min/max envelope of each
+// bucket, so a million samples never cost more than about two points per
+// pixel column.
+class Polyline {
+public:
+  void Append(const float *samples, size_t count);
+  void Clear();
+
+  void SetRect(const glm::vec2 &position, const glm::vec2 &size);
+  void SetStyle(const glm::vec4 &color, float thickness);
+  // Samples [first, first + count). A count <= 0 shows the whole series; a
+  // negative first shows the last count samples, following appends.
+  void SetView(double first, double count);
+  // Fixed vertical range; min >= max fits the visible samples instead
+  void SetValueRange(float min, float max);
+  // RenderQueue layer; shapes draw at DrawLayer::Shapes
+  void SetLayer(uint8_t layer) { m_layer = layer; }
+
+  [[nodiscard]] const MinMaxPyramid &GetPyramid() const { return m_pyramid; }
+  // Level chosen by the last Emit()
+  [[nodiscard]] int GetLastLevel() const { return m_lastLevel; }
+
+  // Adds the points for the current view; pixelsPerUnit converts window
+  // units to framebuffer pixels
+  void Emit(float pixelsPerUnit, PolylineBatch &batch);
+
+private:
+  MinMaxPyramid m_pyramid;
+  glm::vec2 m_position = glm::vec2(0.0f);
+  glm::vec2 m_size = glm::vec2(100.0f);
+  glm::vec4 m_color = glm::vec4(1.0f);
+  float m_thickness = 1.5f;
+  double m_viewFirst = 0.0;
+  double m_viewCount = 0.0;
+  float m_valueMin = 0.0f;
+  float m_valueMax = 0.0f;
+  uint8_t m_layer = DrawLayer::Polylines;
+  int m_lastLevel = 0;
+};
+
+// Draws a PolylineBatch from the stream buffer: each segment is one
+// instance, a 4-vertex strip expanded in screen space around the segment and
+// shaded as a capsule SDF, so lines of any thickness come out anti-aliased
+// with round joins. One draw per polyline (uniforms differ), submitted to a
+// RenderQueue at the polyline's layer.
+class PolylineRenderer {
+public:
+  PolylineRenderer() = default;
+  ~PolylineRenderer();
+  PolylineRenderer(const PolylineRenderer &) = delete;
+  PolylineRenderer &operator=(const PolylineRenderer &) = delete;
+
+  bool Initialize(ResourceManager *resources);
+  // Copies the points into the stream buffer and submits the draws. The
+  // batch has to outlive the queue's Execute().
+  void Submit(const PolylineBatch &batch, StreamBuffer &stream,
+              RenderQueue &queue);
+  void Cleanup();
+
+private:
+  static void DrawPolyline(void *context, uint32_t drawIndex);
+
+  ProgramRef m_shader;
+  UniformHandle<glm::vec4> m_colorUniform;
+  UniformHandle<glm::vec4> m_clipRectUniform;
+  UniformHandle<float> m_halfWidthUniform;
+  GLuint m_VAO = 0;
+
+  // The submitted frame, read back by DrawPolyline
+  const PolylineBatch *m_batch = nullptr;
+  GLuint m_pointBuffer = 0;
+  size_t m_pointOffset = 0; // Bytes into m_pointBuffer
+};
@@ -0,0 +1,193 @@
+#include "ProgramCache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+constexpr char CACHE_MAGIC[4] = {'A', 'P', 'S', 'C'};
+constexpr uint32_t CACHE_VERSION = 1;
+
+struct CacheFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t binaryFormat;
+  uint32_t binaryLength;
+};
+
+// 64-bit FNV-1a, chained through the seed so several strings can be folded
+uint64_t HashBytes(const void *data, size_t length,
+                   uint64_t seed = 14695981039346656037ull) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  uint64_t hash = seed;
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+std::string GLString(GLenum name) {
+  const auto *value = reinterpret_cast<const char *>(glGetString(name));
+  return value != nullptr ? value : "";
+}
+} // namespace
+
+ProgramCache::ProgramCache(std::string directory)
+    : m_directory(std::move(directory)) {}
+
+bool ProgramCache::Initialize() {
+  GLint formatCount = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+  if (formatCount <= 0) {
+    std::cout << "ProgramCache: driver exposes no program binary formats, "
+                 "cache disabled\n";
+    m_enabled = false;
+    return false;
+  }
+
+  m_driverId = GLString(GL_VENDOR) + "|" + GLString(GL_RENDERER) + "|" +
+               GLString(GL_VERSION);
+
+  std::error_code ec;
+  std::filesystem::create_directories(m_directory, ec);
+  if (ec) {
+    std::cerr << "ProgramCache: could not create '" << m_directory
+              << "': " << ec.message() << "\n";
+    m_enabled = false;
+    return false;
+  }
+
+  m_enabled = true;
+  return true;
+}
+
+GLuint ProgramCache::Load(const std::string &vertexSource,
+                          const std::string &fragmentSource) {
+  if (!m_enabled) {
+    return 0;
+  }
+
+  uint64_t key = MakeKey(vertexSource, fragmentSource);
+  std::string path = PathForKey(key);
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    m_misses++;
+    return 0;
+  }
+
+  CacheFileHeader header{};
+  std::vector<char> binary;
+  bool valid = static_cast<bool>(
+      file.read(reinterpret_cast<char *>(&header), sizeof(header)));
+  valid = valid && std::memcmp(header.magic, CACHE_MAGIC, 4) == 0 &&
+          header.version == CACHE_VERSION && header.key == key &&
+          header.binaryLength > 0;
+  if (valid) {
+    binary.resize(header.binaryLength);
+    valid = static_cast<bool>(file.read(binary.data(), header.binaryLength));
+  }
+  file.close();
+
+  GLuint program = 0;
+  if (valid) {
+    program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, binary.data(),
+                    static_cast<GLsizei>(binary.size()));
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success == 0) {
+      // Driver rejected it (e.g. changed internals without a version bump)
+      glDeleteProgram(program);
+      program = 0;
+    }
+  }
+
+  if (program == 0) {
+    std::cerr << "ProgramCache: discarding stale entry " << path << "\n";
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    m_rejected++;
+    m_misses++;
+    return 0;
+  }
+
+  m_hits++;
+  return program;
+}
+
+void ProgramCache::PrepareForRetrieval(GLuint program) const {
+  if (m_enabled) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+}
+
+void ProgramCache::Store(GLuint program, const std::string &vertexSource,
+                         const std::string &fragmentSource) {
+  if (!m_enabled || program == 0) {
+    return;
+  }
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  std::vector<char> binary(static_cast<size_t>(length));
+  GLenum format = 0;
+  GLsizei written = 0;
+  glGetProgramBinary(program, length, &written, &format, binary.data());
+  if (written <= 0) {
+    return;
+  }
+
+  CacheFileHeader header{};
+  std::memcpy(header.magic, CACHE_MAGIC, 4);
+  header.version = CACHE_VERSION;
+  header.key = MakeKey(vertexSource, fragmentSource);
+  header.binaryFormat = format;
+  header.binaryLength = static_cast<uint32_t>(written);
+
+  // Write to a temporary file and rename, so a crash never leaves a
+  // truncated entry behind
+  std::string path = PathForKey(header.key);
+  std::string tempPath = path + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      return;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(binary.data(), written);
+    if (!file) {
+      return;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tempPath, path, ec);
+  if (ec) {
+    std::cerr << "ProgramCache: could not write " << path << ": "
+              << ec.message() << "\n";
+  }
+}
+
+uint64_t ProgramCache::MakeKey(const std::string &vertexSource,
+                               const std::string &fragmentSource) const {
+  // The separators keep ("ab","c") and ("a","bc") from colliding
+  uint64_t hash = HashBytes(m_driverId.data(), m_driverId.size());
+  hash = HashBytes("\0", 1, hash);
+  hash = HashBytes(vertexSource.data(), vertexSource.size(), hash);
+  hash = HashBytes("\0", 1, hash);
+  return HashBytes(fragmentSource.data(), fragmentSource.size(), hash);
+}
+
+std::string ProgramCache::PathForKey(uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin",
+                static_cast<unsigned long long>(key));
+  return (std::filesystem::path(m_directory) / name).string();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries (glGetProgramBinary). Entries are
+// keyed by a hash of the shader sources plus the driver's vendor, renderer
+// and version strings, so a driver update simply misses and recompiles.
+// Drivers that expose no binary formats (e.g. macOS) leave the cache
+// disabled and every lookup misses.
+class ProgramCache {
+public:
+  explicit ProgramCache(std::string directory = "shader_cache");
+
+  // Needs a current GL context
+  bool Initialize();
+  [[nodiscard]] bool IsEnabled() const { return m_enabled; }
+
+  // Returns a linked program loaded from disk, or 0 if there is no entry or
+  // the driver rejected the stored binary (the stale entry is removed)
+  GLuint Load(const std::string &vertexSource,
+              const std::string &fragmentSource);
+  // Must be called before glLinkProgram for the binary to be retrievable
+  void PrepareForRetrieval(GLuint program) const;
+  void Store(GLuint program, const std::string &vertexSource,
+             const std::string &fragmentSource);
+
+  [[nodiscard]] int GetHits() const { return m_hits; }
+  [[nodiscard]] int GetMisses() const { return m_misses; }
+  [[nodiscard]] int GetRejected() const { return m_rejected; }
+
+private:
+  [[nodiscard]] uint64_t MakeKey(const std::string &vertexSource,
+                                 const std::string &fragmentSource) const;
+  [[nodiscard]] std::string PathForKey(uint64_t key) const;
+
+  std::string m_directory;
+  std::string m_driverId; // Vendor/renderer/version, folded into every key
+  bool m_enabled = false;
+
+  int m_hits = 0;
+  int m_misses = 0;
+  int m_rejected = 0;
+};
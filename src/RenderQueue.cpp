@@ -0,0 +1,184 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <imgui.h>
+
+uint64_t SortKey::Make(uint8_t layer, bool translucent, uint32_t shader,
+                       uint32_t texture, uint32_t depth) {
+  const uint64_t shaderBits = shader & 0xFFFu;
+  const uint64_t textureBits = texture & 0xFFFFu;
+  const uint64_t depthBits = std::min(depth, MAX_DEPTH);
+  uint64_t key = static_cast<uint64_t>(layer) << LAYER_SHIFT;
+  if (translucent) {
+    key |= uint64_t(1) << TRANSLUCENT_SHIFT;
+    key |= depthBits << 31 | shaderBits << 19 | textureBits << 3;
+  } else {
+    // Front first: later submissions are nearer
+    key |= shaderBits << 43 | textureBits << 27 | (MAX_DEPTH - depthBits) << 3;
+  }
+  return key;
+}
+
+void RadixSort(std::vector<uint64_t> &keys, std::vector<uint32_t> &values,
+               std::vector<uint64_t> &scratchKeys,
+               std::vector<uint32_t> &scratchValues) {
+  const size_t count = keys.size();
+  if (count < 2) {
+    return;
+  }
+  scratchKeys.resize(count);
+  scratchValues.resize(count);
+
+  // Every pass's histogram in one read of the keys
+  std::array<std::array<uint32_t, 256>, 8> histograms{};
+  for (uint64_t key : keys) {
+    for (int pass = 0; pass < 8; ++pass) {
+      histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+    }
+  }
+
+  uint64_t *sourceKeys = keys.data();
+  uint32_t *sourceValues = values.data();
+  uint64_t *targetKeys = scratchKeys.data();
+  uint32_t *targetValues = scratchValues.data();
+  for (int pass = 0; pass < 8; ++pass) {
+    std::array<uint32_t, 256> &histogram = histograms[pass];
+    const int shift = pass * 8;
+    if (histogram[(sourceKeys[0] >> shift) & 0xFF] == count) {
+      continue; // One bucket holds everything; the order stays as it is
+    }
+    uint32_t offset = 0;
+    for (uint32_t &bucket : histogram) {
+      const uint32_t size = bucket;
+      bucket = offset;
+      offset += size;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      const uint32_t slot = histogram[(sourceKeys[i] >> shift) & 0xFF]++;
+      targetKeys[slot] = sourceKeys[i];
+      targetValues[slot] = sourceValues[i];
+    }
+    std::swap(sourceKeys, targetKeys);
+    std::swap(sourceValues, targetValues);
+  }
+  if (sourceKeys != keys.data()) {
+    keys.swap(scratchKeys);
+    values.swap(scratchValues);
+  }
+}
+
+void RenderQueue::Submit(const DrawCommand &command, uint8_t layer) {
+  if (command.execute == nullptr) {
+    return;
+  }
+  const auto depth = static_cast<uint32_t>(m_commands.size());
+  m_keys.push_back(SortKey::Make(layer, command.blend != BlendMode::Opaque,
+                                 command.program, command.texture, depth));
+  m_order.push_back(depth);
+  m_commands.push_back(command);
+}
+
+void RenderQueue::Execute() {
+  Stats stats;
+  stats.draws = static_cast<uint32_t>(m_commands.size());
+  for (size_t i = 0; i < m_commands.size(); ++i) {
+    stats.unsortedStateChanges += CountStateChanges(
+        i > 0 ? &m_commands[i - 1] : nullptr, m_commands[i]);
+  }
+
+  const auto sortStart = std::chrono::steady_clock::now();
+  RadixSort(m_keys, m_order, m_scratchKeys, m_scratchOrder);
+  stats.sortMs = std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - sortStart)
+                     .count();
+
+  const DrawCommand *previous = nullptr;
+  for (uint32_t index : m_order) {
+    const DrawCommand &command = m_commands[index];
+    stats.stateChanges += CountStateChanges(previous, command);
+    ApplyState(previous, command);
+    command.execute(command.context, command.argument);
+    previous = &command;
+  }
+
+  m_commands.clear();
+  m_keys.clear();
+  m_order.clear();
+  std::lock_guard<std::mutex> lock(m_statsMutex);
+  m_stats = stats;
+}
+
+RenderQueue::Stats RenderQueue::GetStats() const {
+  std::lock_guard<std::mutex> lock(m_statsMutex);
+  return m_stats;
+}
+
+void RenderQueue::DrawOverlay(bool *open) const {
+  const Stats stats = GetStats();
+  ImGui::SetNextWindowPos(ImVec2(10.0f, 200.0f), ImGuiCond_FirstUseEver);
+  if (ImGui::Begin("Draw Submission", open,
+                   ImGuiWindowFlags_AlwaysAutoResize |
+                       ImGuiWindowFlags_NoFocusOnAppearing)) {
+    ImGui::Text("Scene draws: %u", stats.draws);
+    ImGui::Text("State changes: %u (%u in submission order)",
+                stats.stateChanges, stats.unsortedStateChanges);
+    ImGui::Text("Sort: %.3f ms", stats.sortMs);
+  }
+  ImGui::End();
+}
+
+uint32_t RenderQueue::CountStateChanges(const DrawCommand *previous,
+                                        const DrawCommand &next) {
+  if (previous == nullptr) {
+    return 3 + (next.texture != 0 ? 1 : 0);
+  }
+  uint32_t changes = 0;
+  changes += previous->program != next.program ? 1 : 0;
+  changes += previous->vertexArray != next.vertexArray ? 1 : 0;
+  changes += previous->blend != next.blend ? 1 : 0;
+  if (next.texture != 0 &&
+      (previous->texture != next.texture ||
+       previous->textureUnit != next.textureUnit ||
+       previous->textureTarget != next.textureTarget)) {
+    ++changes;
+  }
+  return changes;
+}
+
+// Everything goes through GLState, so state that matches what an earlier
+// pass (or frame) left behind still doesn't reach the driver
+void RenderQueue::ApplyState(const DrawCommand *previous,
+                             const DrawCommand &next) {
+  if (previous == nullptr || previous->program != next.program) {
+    GLState::UseProgram(next.program);
+  }
+  if (previous == nullptr || previous->vertexArray != next.vertexArray) {
+    GLState::BindVertexArray(next.vertexArray);
+  }
+  if (next.texture != 0) {
+    GLState::ActiveTexture(GL_TEXTURE0 + next.textureUnit);
+    GLState::BindTexture(next.textureTarget, next.texture);
+  }
+  if (previous != nullptr && previous->blend == next.blend) {
+    return;
+  }
+  switch (next.blend) {
+  case BlendMode::Opaque:
+    GLState::SetEnabled(GL_BLEND, false);
+    break;
+  case BlendMode::Alpha:
+    GLState::SetEnabled(GL_BLEND, true);
+    GLState::BlendEquation(GL_FUNC_ADD);
+    GLState::BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
+                               GL_ONE_MINUS_SRC_ALPHA);
+    break;
+  case BlendMode::Additive:
+    GLState::SetEnabled(GL_BLEND, true);
+    GLState::BlendEquation(GL_FUNC_ADD);
+    GLState::BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ONE,
+                               GL_ONE_MINUS_SRC_ALPHA);
+    break;
+  }
+}
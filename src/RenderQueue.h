@@ -0,0 +1,112 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// 64-bit draw ordering keys, compared as plain integers. Most significant
+// first:
+//
+//   63..56  layer        Layers always draw in order
+//   55      translucent  Opaque draws first within a layer
+//   opaque:      54..43 shader, 42..27 texture, 26..3 depth (front first)
+//   translucent: 54..31 depth (back first), 30..19 shader, 18..3 texture
+//
+// Opaque draws group by state, translucent ones keep their back-to-front
+// order and only group by state among equal depths. The scene is 2D, so
+// depth is the submission index: the painter's order.
+namespace SortKey {
+constexpr int LAYER_SHIFT = 56;
+constexpr int TRANSLUCENT_SHIFT = 55;
+constexpr uint32_t MAX_DEPTH = (1u << 24) - 1;
+
+[[nodiscard]] uint64_t Make(uint8_t layer, bool translucent, uint32_t shader,
+                            uint32_t texture, uint32_t depth);
+[[nodiscard]] inline uint8_t Layer(uint64_t key) {
+  return static_cast<uint8_t>(key >> LAYER_SHIFT);
+}
+[[nodiscard]] inline bool IsTranslucent(uint64_t key) {
+  return ((key >> TRANSLUCENT_SHIFT) & 1u) != 0;
+}
+} // namespace SortKey
+
+// Layers of the built-in scene passes, spaced so scripts can put polylines
+// and particles below, between or above them
+namespace DrawLayer {
+constexpr uint8_t Shapes = 64;
+constexpr uint8_t Particles = 96;
+constexpr uint8_t Polylines = 128;
+constexpr uint8_t Text = 160;
+} // namespace DrawLayer
+
+// Sorts keys ascending with an LSD radix sort, a byte per pass, carrying
+// values along. Stable; passes where every key has the same byte are
+// skipped. scratch vectors are resized as needed and can be reused.
+void RadixSort(std::vector<uint64_t> &keys, std::vector<uint32_t> &values,
+               std::vector<uint64_t> &scratchKeys,
+               std::vector<uint32_t> &scratchValues);
+
+enum class BlendMode : uint8_t {
+  Opaque,   // Blending off
+  Alpha,    // Source over, as the UI blends
+  Additive, // Source alpha, one
+};
+
+// One draw: the GL state it needs, and a callback that sets its uniforms and
+// issues the call. The callback runs with program, vertex array, texture
+// and blend state already applied.
+struct DrawCommand {
+  GLuint program = 0;
+  GLuint vertexArray = 0;
+  GLenum textureTarget = GL_TEXTURE_2D;
+  GLuint texture = 0; // 0 leaves the unit as it is
+  GLuint textureUnit = 0;
+  BlendMode blend = BlendMode::Alpha;
+
+  void (*execute)(void *context, uint32_t argument) = nullptr;
+  void *context = nullptr;
+  uint32_t argument = 0;
+};
+
+// Scene draws for one frame. Renderers submit commands in painter's order;
+// Execute() sorts them by key and replays them, applying only the state
+// that differs from the previous command. Render thread only, apart from
+// GetStats() and DrawOverlay(), which read the stats published by the last
+// Execute().
+class RenderQueue {
+public:
+  struct Stats {
+    uint32_t draws = 0;
+    uint32_t stateChanges = 0; // Program, vertex array, texture or blend
+    // What the same draws would have cost in submission order
+    uint32_t unsortedStateChanges = 0;
+    double sortMs = 0.0;
+  };
+
+  void Submit(const DrawCommand &command, uint8_t layer);
+  // Sorts, draws everything and clears the queue
+  void Execute();
+
+  [[nodiscard]] Stats GetStats() const;
+  // ImGui window with the last frame's stats; call between NewFrame and
+  // Render
+  void DrawOverlay(bool *open) const;
+
+private:
+  // Categories of state next needs that previous didn't leave set; a null
+  // previous counts everything
+  static uint32_t CountStateChanges(const DrawCommand *previous,
+                                    const DrawCommand &next);
+  static void ApplyState(const DrawCommand *previous,
+                         const DrawCommand &next);
+
+  std::vector<DrawCommand> m_commands;
+  std::vector<uint64_t> m_keys;
+  std::vector<uint32_t> m_order; // Indices into m_commands
+  std::vector<uint64_t> m_scratchKeys;
+  std::vector<uint32_t> m_scratchOrder;
+
+  mutable std::mutex m_statsMutex;
+  Stats m_stats; // Guarded by m_statsMutex
+};
@@ -0,0 +1,89 @@
+#include "RenderThread.h"
+
+RenderThread::~RenderThread() { Stop(); }
+
+void RenderThread::Start(GLFWwindow *window, SubmitFunction submit,
+                         bool threaded) {
+  m_window = window;
+  m_submit = std::move(submit);
+  m_stopRequested = false;
+  m_recordIndex = 0;
+  m_pendingIndex = -1;
+  m_renderingIndex = -1;
+
+  if (threaded) {
+    // A context can only be current on one thread at a time
+    glfwMakeContextCurrent(nullptr);
+    m_thread = std::thread(&RenderThread::ThreadMain, this);
+  }
+}
+
+void RenderThread::Stop() {
+  if (!m_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopRequested = true;
+  }
+  m_condition.notify_all();
+  m_thread.join();
+  glfwMakeContextCurrent(m_window);
+}
+
+FramePacket &RenderThread::BeginPacket() {
+  if (m_thread.joinable()) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] {
+      return m_pendingIndex != m_recordIndex &&
+             m_renderingIndex != m_recordIndex;
+    });
+  }
+  return m_packets[m_recordIndex];
+}
+
+void RenderThread::SubmitPacket() {
+  if (!m_thread.joinable()) {
+    m_submit(m_packets[m_recordIndex]);
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Packets are never dropped: each carries only the shape changes since
+    // the previous one
+    m_condition.wait(lock, [this] { return m_pendingIndex < 0; });
+    m_pendingIndex = m_recordIndex;
+    m_recordIndex ^= 1;
+  }
+  m_condition.notify_all();
+}
+
+void RenderThread::ThreadMain() {
+  glfwMakeContextCurrent(m_window);
+
+  for (;;) {
+    int index = -1;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_condition.wait(
+          lock, [this] { return m_pendingIndex >= 0 || m_stopRequested; });
+      if (m_pendingIndex < 0) {
+        break; // Stop requested and nothing left to draw
+      }
+      index = m_pendingIndex;
+      m_pendingIndex = -1;
+      m_renderingIndex = index;
+    }
+    m_condition.notify_all();
+
+    m_submit(m_packets[index]);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_renderingIndex = -1;
+    }
+    m_condition.notify_all();
+  }
+
+  glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "FramePacket.h"
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs GL submission on its own thread. The thread owns the window's GL
+// context; the main thread records FramePackets (BeginPacket/SubmitPacket)
+// and can build frame N+1 while frame N is submitted and swapped. With two
+// packets the main thread only waits when it gets a whole frame ahead.
+//
+// Unthreaded, SubmitPacket() runs the submit function inline, so both modes
+// share a single code path for drawing.
+class RenderThread {
+public:
+  using SubmitFunction = std::function<void(FramePacket &)>;
+
+  RenderThread() = default;
+  ~RenderThread();
+  RenderThread(const RenderThread &) = delete;
+  RenderThread &operator=(const RenderThread &) = delete;
+
+  // Threaded, the window's context is released on the calling thread and
+  // made current on the render thread
+  void Start(GLFWwindow *window, SubmitFunction submit, bool threaded);
+  // Drains the pending packet, joins, and makes the context current on the
+  // calling thread again
+  void Stop();
+
+  // Returns the packet to record into, waiting until it is free
+  FramePacket &BeginPacket();
+  void SubmitPacket();
+
+  [[nodiscard]] bool IsThreaded() const { return m_thread.joinable(); }
+
+private:
+  void ThreadMain();
+
+  GLFWwindow *m_window = nullptr;
+  SubmitFunction m_submit;
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stopRequested = false;
+
+  FramePacket m_packets[2];
+  int m_recordIndex = 0;     // Packet the main thread records into
+  int m_pendingIndex = -1;   // Submitted, not yet picked up
+  int m_renderingIndex = -1; // Being drawn by the render thread
+};
@@ -0,0 +1,275 @@
+#include "ResourceManager.h"
+#include "GLState.h"
+#include <algorithm>
+#include <cstdio>
+#include <imgui.h>
+
+namespace {
+// 64-bit FNV-1a, as ProgramCache keys its entries, chained through the seed
+uint64_t HashBytes(const void *data, size_t length,
+                   uint64_t hash = 14695981039346656037ull) {
+  const auto *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+uint64_t HashString(const char *text, uint64_t hash) {
+  // The terminator separates consecutive strings
+  return HashBytes(text, std::char_traits<char>::length(text) + 1, hash);
+}
+
+struct BufferEntry : detail::TypedResourceEntry<SharedBuffer> {
+  void Destroy() override {
+    GLState::DeleteBuffer(value.buffer);
+    value.buffer = 0;
+  }
+};
+
+struct ProgramEntry : detail::TypedResourceEntry<Shader> {
+  void Destroy() override { value.Cleanup(); }
+};
+
+std::string FormatBytes(size_t bytes) {
+  char text[32];
+  if (bytes >= (1u << 20)) {
+    std::snprintf(text, sizeof(text), "%.1f MB",
+                  static_cast<double>(bytes) / (1u << 20));
+  } else {
+    std::snprintf(text, sizeof(text), "%.1f KB",
+                  static_cast<double>(bytes) / (1u << 10));
+  }
+  return text;
+}
+} // namespace
+
+ResourceManager::~ResourceManager() { Cleanup(); }
+
+void ResourceManager::Initialize(ProgramCache *cache) { m_cache = cache; }
+
+void ResourceManager::Cleanup() {
+  if (!m_retiring.empty() || !m_released.empty() || !m_entries.empty()) {
+    glFinish(); // Nothing the GPU still reads is left after this
+  }
+  for (RetiredFrame &frame : m_retiring) {
+    glDeleteSync(frame.fence);
+    for (auto &entry : frame.entries) {
+      entry->Destroy();
+    }
+  }
+  m_retiring.clear();
+  for (auto &entry : m_released) {
+    entry->Destroy();
+  }
+  m_released.clear();
+  for (auto &[key, entry] : m_entries) {
+    entry->Destroy();
+    entry->manager = nullptr;
+    entry.release(); // Deleted by its last reference
+  }
+  m_entries.clear();
+  m_external.clear();
+  for (size_t &bytes : m_bytes) {
+    bytes = 0;
+  }
+  m_cache = nullptr;
+}
+
+template <typename T> ResourceRef<T> ResourceManager::Find(uint64_t key) {
+  auto it = m_entries.find(key);
+  if (it == m_entries.end()) {
+    return {};
+  }
+  ++m_reuses;
+  return ResourceRef<T>(
+      static_cast<detail::TypedResourceEntry<T> *>(it->second.get()));
+}
+
+BufferRef ResourceManager::AcquireBuffer(const void *data, GLsizeiptr size) {
+  if (data == nullptr || size <= 0) {
+    return {};
+  }
+  const auto bytes = static_cast<size_t>(size);
+  uint64_t key = HashString("buffer", 14695981039346656037ull);
+  key = HashBytes(&bytes, sizeof(bytes), key);
+  key = HashBytes(data, bytes, key);
+  if (BufferRef found = Find<SharedBuffer>(key)) {
+    return found;
+  }
+
+  auto entry = std::make_unique<BufferEntry>();
+  glGenBuffers(1, &entry->value.buffer);
+  // The copy-write target leaves the bound VAO's element buffer alone
+  GLState::BindBuffer(GL_COPY_WRITE_BUFFER, entry->value.buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
+  entry->value.size = size;
+  entry->key = key;
+  entry->category = ResourceCategory::Geometry;
+  entry->bytes = bytes;
+  BufferRef ref(entry.get());
+  Adopt(std::move(entry));
+  return ref;
+}
+
+ProgramRef ResourceManager::AcquireProgram(
+    const char *vertexSource, const char *fragmentSource,
+    const std::vector<const char *> &feedbackVaryings) {
+  uint64_t key = HashString("program", 14695981039346656037ull);
+  key = HashString(vertexSource, key);
+  key = HashString(fragmentSource, key);
+  for (const char *varying : feedbackVaryings) {
+    key = HashString(varying, key);
+  }
+  if (ProgramRef found = Find<Shader>(key)) {
+    return found;
+  }
+
+  auto entry = std::make_unique<ProgramEntry>();
+  entry->value = Shader(vertexSource, fragmentSource, true, m_cache,
+                        feedbackVaryings);
+  if (entry->value.ID == 0) {
+    return {}; // Not cached, so a fixed source is tried again
+  }
+  GLint binaryLength = 0;
+  glGetProgramiv(entry->value.ID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+  entry->key = key;
+  entry->category = ResourceCategory::Program;
+  entry->bytes = static_cast<size_t>(std::max(binaryLength, 0));
+  ProgramRef ref(entry.get());
+  Adopt(std::move(entry));
+  return ref;
+}
+
+void ResourceManager::SetExternal(const std::string &name,
+                                  ResourceCategory category, size_t bytes) {
+  for (auto it = m_external.begin(); it != m_external.end(); ++it) {
+    if (it->name == name) {
+      if (bytes == 0) {
+        m_external.erase(it);
+      } else {
+        it->category = category;
+        it->bytes = bytes;
+      }
+      return;
+    }
+  }
+  if (bytes != 0) {
+    m_external.push_back({name, category, bytes});
+  }
+}
+
+void ResourceManager::EndFrame() {
+  // Frames complete in order, so the first one still running ends the scan
+  size_t done = 0;
+  for (; done < m_retiring.size(); ++done) {
+    RetiredFrame &frame = m_retiring[done];
+    if (glClientWaitSync(frame.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+      break;
+    }
+    glDeleteSync(frame.fence);
+    for (auto &entry : frame.entries) {
+      entry->Destroy();
+    }
+  }
+  m_retiring.erase(m_retiring.begin(),
+                   m_retiring.begin() + static_cast<std::ptrdiff_t>(done));
+  if (!m_released.empty()) {
+    RetiredFrame frame;
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame.entries = std::move(m_released);
+    m_released.clear();
+    m_retiring.push_back(std::move(frame));
+  }
+
+  Stats stats;
+  for (int i = 0; i < RESOURCE_CATEGORY_COUNT; ++i) {
+    stats.bytes[i] = m_bytes[i];
+  }
+  for (const External &external : m_external) {
+    stats.bytes[static_cast<int>(external.category)] += external.bytes;
+  }
+  for (const auto &[key, entry] : m_entries) {
+    if (entry->category == ResourceCategory::Program) {
+      ++stats.programs;
+    } else {
+      ++stats.buffers;
+    }
+  }
+  for (const RetiredFrame &frame : m_retiring) {
+    stats.retiring += static_cast<uint32_t>(frame.entries.size());
+  }
+  stats.reuses = m_reuses;
+  stats.external = m_external;
+  std::lock_guard<std::mutex> lock(m_statsMutex);
+  m_stats = std::move(stats);
+}
+
+ResourceManager::Stats ResourceManager::GetStats() const {
+  std::lock_guard<std::mutex> lock(m_statsMutex);
+  return m_stats;
+}
+
+void ResourceManager::DrawPanel(bool *open) const {
+  const Stats stats = GetStats();
+  ImGui::SetNextWindowPos(ImVec2(10.0f, 320.0f), ImGuiCond_FirstUseEver);
+  if (ImGui::Begin("GPU Memory", open,
+                   ImGuiWindowFlags_AlwaysAutoResize |
+                       ImGuiWindowFlags_NoFocusOnAppearing)) {
+    size_t total = 0;
+    for (int i = 0; i < RESOURCE_CATEGORY_COUNT; ++i) {
+      ImGui::Text("%-9s %s",
+                  CategoryName(static_cast<ResourceCategory>(i)),
+                  FormatBytes(stats.bytes[i]).c_str());
+      total += stats.bytes[i];
+    }
+    ImGui::Text("Total     %s", FormatBytes(total).c_str());
+    ImGui::Separator();
+    ImGui::Text("Shared: %u buffers, %u programs, %llu reuses",
+                stats.buffers, stats.programs,
+                static_cast<unsigned long long>(stats.reuses));
+    ImGui::Text("Waiting for the GPU: %u", stats.retiring);
+    if (!stats.external.empty()) {
+      ImGui::Separator();
+      for (const External &external : stats.external) {
+        ImGui::Text("%s: %s (%s)", external.name.c_str(),
+                    FormatBytes(external.bytes).c_str(),
+                    CategoryName(external.category));
+      }
+    }
+  }
+  ImGui::End();
+}
+
+const char *ResourceManager::CategoryName(ResourceCategory category) {
+  switch (category) {
+  case ResourceCategory::Geometry:
+    return "Geometry";
+  case ResourceCategory::Program:
+    return "Programs";
+  case ResourceCategory::Texture:
+    return "Textures";
+  case ResourceCategory::Buffer:
+    return "Buffers";
+  default:
+    return "?";
+  }
+}
+
+void ResourceManager::Adopt(std::unique_ptr<detail::ResourceEntry> entry) {
+  entry->manager = this;
+  m_bytes[static_cast<int>(entry->category)] += entry->bytes;
+  const uint64_t key = entry->key;
+  m_entries.emplace(key, std::move(entry));
+}
+
+void ResourceManager::Release(detail::ResourceEntry *entry) {
+  auto it = m_entries.find(entry->key);
+  if (it == m_entries.end() || it->second.get() != entry) {
+    return;
+  }
+  m_bytes[static_cast<int>(entry->category)] -= entry->bytes;
+  m_released.push_back(std::move(it->second));
+  m_entries.erase(it);
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "Shader.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ProgramCache;
+class ResourceManager;
+
+// What GPU memory is spent on, for the memory panel
+enum class ResourceCategory : uint8_t {
+  Geometry, // Immutable vertex and index buffers
+  Program,  // Linked program binaries, as the driver reports their size
+  Texture,
+  Buffer, // Dynamic and streamed buffers
+  Count
+};
+constexpr int RESOURCE_CATEGORY_COUNT =
+    static_cast<int>(ResourceCategory::Count);
+
+// Immutable buffer shared by everyone who uploaded the same bytes
+struct SharedBuffer {
+  GLuint buffer = 0;
+  GLsizeiptr size = 0;
+};
+
+namespace detail {
+// A ResourceManager-owned object and its use count. Outlives its manager if
+// references do, with the GL object already gone.
+struct ResourceEntry {
+  virtual ~ResourceEntry() = default;
+  virtual void Destroy() = 0; // Deletes the GL object
+
+  ResourceManager *manager = nullptr;
+  uint64_t key = 0;
+  ResourceCategory category = ResourceCategory::Geometry;
+  size_t bytes = 0;
+  uint32_t references = 0;
+};
+
+template <typename T> struct TypedResourceEntry : ResourceEntry {
+  T value;
+};
+} // namespace detail
+
+// Counted reference to a resource shared through a ResourceManager. Copies
+// add a reference; the last one to go hands the object back for deferred
+// deletion. Render thread only, like the manager.
+template <typename T> class ResourceRef {
+public:
+  ResourceRef() = default;
+  ResourceRef(const ResourceRef &other) : m_entry(other.m_entry) {
+    if (m_entry != nullptr) {
+      ++m_entry->references;
+    }
+  }
+  ResourceRef(ResourceRef &&other) noexcept : m_entry(other.m_entry) {
+    other.m_entry = nullptr;
+  }
+  ResourceRef &operator=(ResourceRef other) noexcept {
+    std::swap(m_entry, other.m_entry);
+    return *this;
+  }
+  ~ResourceRef() { Reset(); }
+
+  void Reset();
+
+  [[nodiscard]] bool IsValid() const { return m_entry != nullptr; }
+  explicit operator bool() const { return IsValid(); }
+  const T &operator*() const { return m_entry->value; }
+  const T *operator->() const { return &m_entry->value; }
+
+private:
+  friend class ResourceManager;
+  explicit ResourceRef(detail::TypedResourceEntry<T> *entry) : m_entry(entry) {
+    ++m_entry->references;
+  }
+
+  detail::TypedResourceEntry<T> *m_entry = nullptr;
+};
+
+using BufferRef = ResourceRef<SharedBuffer>;
+using ProgramRef = ResourceRef<Shader>;
+
+// Owner of the GL objects renderers can share: immutable buffers and linked
+// programs, deduplicated by a hash of their contents, so renderers asking
+// for the same program (the CPU and GPU particle draws) or the same vertex
+// data get the same object. Each is handed out as a counted reference.
+//
+// An object whose last reference goes is deleted only once the GPU is done
+// with it: commands already recorded into the RenderQueue, or still in
+// flight, may name it. Releases are fenced at EndFrame() and deleted at a
+// later EndFrame() once the fence has signaled.
+//
+// Bytes are tracked per ResourceCategory. Shared objects count themselves;
+// renderers with their own long-lived storage report it with SetExternal().
+// Render thread only, apart from GetStats() and DrawPanel(), which read what
+// the last EndFrame() published.
+class ResourceManager {
+public:
+  // Bytes a renderer allocated itself, under its own name
+  struct External {
+    std::string name;
+    ResourceCategory category = ResourceCategory::Buffer;
+    size_t bytes = 0;
+  };
+
+  struct Stats {
+    size_t bytes[RESOURCE_CATEGORY_COUNT] = {}; // Shared and external
+    uint32_t buffers = 0;  // Shared, referenced
+    uint32_t programs = 0;
+    uint32_t retiring = 0; // Released, waiting for the GPU
+    uint64_t reuses = 0;   // Acquires served by an existing object
+    std::vector<External> external;
+  };
+
+  ResourceManager() = default;
+  ~ResourceManager();
+  ResourceManager(const ResourceManager &) = delete;
+  ResourceManager &operator=(const ResourceManager &) = delete;
+
+  // Programs built here go through cache, if any
+  void Initialize(ProgramCache *cache);
+  // Waits for the GPU and deletes everything. References still held keep
+  // working as handles, but their objects are gone.
+  void Cleanup();
+
+  // A GL_STATIC_DRAW buffer holding a copy of data. Invalid if size is 0.
+  BufferRef AcquireBuffer(const void *data, GLsizeiptr size);
+  // Arguments as for Shader. Invalid if the program doesn't build.
+  ProgramRef AcquireProgram(
+      const char *vertexSource, const char *fragmentSource,
+      const std::vector<const char *> &feedbackVaryings = {});
+
+  // Replaces what was reported under name; 0 bytes removes it
+  void SetExternal(const std::string &name, ResourceCategory category,
+                   size_t bytes);
+
+  // Deletes released objects the GPU has finished with, fences this frame's
+  // releases and publishes the stats
+  void EndFrame();
+
+  [[nodiscard]] Stats GetStats() const;
+  // ImGui window with the last published stats; call between NewFrame and
+  // Render
+  void DrawPanel(bool *open) const;
+  [[nodiscard]] static const char *CategoryName(ResourceCategory category);
+
+private:
+  template <typename T> friend class ResourceRef;
+
+  // A frame's releases, deleted together once its fence signals
+  struct RetiredFrame {
+    GLsync fence = nullptr;
+    std::vector<std::unique_ptr<detail::ResourceEntry>> entries;
+  };
+
+  template <typename T>
+  ResourceRef<T> Find(uint64_t key);
+  void Adopt(std::unique_ptr<detail::ResourceEntry> entry);
+  // The last reference went: out of the lookup, into the retiring list
+  void Release(detail::ResourceEntry *entry);
+
+  ProgramCache *m_cache = nullptr;
+  std::unordered_map<uint64_t, std::unique_ptr<detail::ResourceEntry>>
+      m_entries; // By content key
+  std::vector<std::unique_ptr<detail::ResourceEntry>> m_released; // Unfenced
+  std::vector<RetiredFrame> m_retiring; // Oldest first
+  std::vector<External> m_external;
+  size_t m_bytes[RESOURCE_CATEGORY_COUNT] = {}; // Shared objects only
+  uint64_t m_reuses = 0;
+
+  mutable std::mutex m_statsMutex;
+  Stats m_stats; // Guarded by m_statsMutex
+};
+
+template <typename T> void ResourceRef<T>::Reset() {
+  if (m_entry == nullptr) {
+    return;
+  }
+  if (--m_entry->references == 0) {
+    if (m_entry->manager != nullptr) {
+      m_entry->manager->Release(m_entry);
+    } else {
+      delete m_entry; // Orphaned by Cleanup(); the GL object is gone
+    }
+  }
+  m_entry = nullptr;
+}
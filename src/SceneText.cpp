@@ -0,0 +1,520 @@
+#include "SceneText.h"
+#include "GLState.h"
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+
+// imgui_draw.cpp compiles its own static copy of stb_truetype; this is a
+// second one for baking distance fields
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <imstb_truetype.h>
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+// Field alpha at the glyph's outline, and alpha lost per atlas pixel
+// outward from it
+constexpr unsigned char ON_EDGE = 128;
+constexpr float PIXEL_DIST_SCALE =
+    static_cast<float>(ON_EDGE) / SceneText::SDF_PADDING;
+
+// Next code point of UTF-8 text, U+FFFD for malformed bytes
+uint32_t DecodeUtf8(const std::string &text, size_t &i) {
+  const auto byte = [&](size_t at) {
+    return static_cast<unsigned char>(text[at]);
+  };
+  const unsigned char lead = byte(i++);
+  int extra = 0;
+  uint32_t codepoint = 0;
+  if (lead < 0x80) {
+    return lead;
+  } else if ((lead & 0xE0) == 0xC0) {
+    extra = 1;
+    codepoint = lead & 0x1F;
+  } else if ((lead & 0xF0) == 0xE0) {
+    extra = 2;
+    codepoint = lead & 0x0F;
+  } else if ((lead & 0xF8) == 0xF0) {
+    extra = 3;
+    codepoint = lead & 0x07;
+  } else {
+    return 0xFFFD;
+  }
+  for (; extra > 0; --extra) {
+    if (i >= text.size() || (byte(i) & 0xC0) != 0x80) {
+      return 0xFFFD;
+    }
+    codepoint = (codepoint << 6) | (byte(i++) & 0x3F);
+  }
+  return codepoint <= 0x10FFFF ? codepoint : 0xFFFD;
+}
+
+// Corner from gl_VertexID, expanded to the instance's rectangle. The field
+// gives the distance to the outline in atlas pixels; distanceScale and the
+// projection turn it into framebuffer pixels, so the edge ramp is one pixel
+// wide however far the view is zoomed.
+const char *s_vertexShaderSource = R"(
+    #version 410 core
+    layout (location = 0) in vec4 iRect;   // x0, y0, x1, y1
+    layout (location = 1) in vec4 iUVRect; // u0, v0, u1, v1
+    layout (location = 2) in vec4 iColor;
+    layout (location = 3) in vec2 iField;  // Atlas layer, distance scale
+
+    out vec2 vUV;
+    flat out float vLayer;
+    flat out float vSharpness;
+    out vec4 vColor;
+
+    void main() {
+        vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+        vUV = mix(iUVRect.xy, iUVRect.zw, corner);
+        vLayer = iField.x;
+        float pixelsPerUnit = 0.5 * u_viewportSize.x * abs(u_projection[0][0]);
+        vSharpness = iField.y * pixelsPerUnit;
+        vColor = iColor;
+        gl_Position =
+            u_projection * vec4(mix(iRect.xy, iRect.zw, corner), 0.0, 1.0);
+    }
+)";
+
+const char *s_fragmentShaderSource = R"(
+    #version 410 core
+    in vec2 vUV;
+    flat in float vLayer;
+    flat in float vSharpness;
+    in vec4 vColor;
+
+    uniform sampler2DArray u_atlas;
+
+    out vec4 FragColor;
+
+    void main() {
+        float field = texture(u_atlas, vec3(vUV, vLayer)).a;
+        float coverage =
+            clamp((field - 128.0 / 255.0) * vSharpness + 0.5, 0.0, 1.0);
+        if (coverage <= 0.0) {
+            discard;
+        }
+        FragColor = vec4(vColor.rgb, vColor.a * coverage);
+    }
+)";
+} // namespace
+
+struct SceneText::Glyph {
+  int index = 0;             // In the font
+  float advance = 0.0f;      // Ems
+  glm::vec2 offset{0.0f};    // Field's top-left from the pen, ems, y down
+  glm::vec2 size{0.0f};      // Field's extent, ems; zero for blank glyphs
+  bool baked = false;        // Bake was tried
+  bool inAtlas = false;      // and succeeded
+  glm::vec4 uvRect{0.0f};
+  float layer = 0.0f;
+};
+
+struct SceneText::Layout {
+  struct Quad {
+    glm::vec2 min; // Ems from the text box's top-left
+    glm::vec2 max;
+    Glyph *glyph;
+  };
+
+  Font *font = nullptr;
+  std::vector<Quad> quads;
+  glm::vec2 size{0.0f}; // Text box, ems
+  size_t users = 0;     // Labels showing it
+};
+
+struct SceneText::Font {
+  std::string path;
+  std::vector<unsigned char> data; // stbtt reads it in place
+  stbtt_fontinfo info{};
+  float scale = 0.0f;      // Font units to atlas pixels
+  float ascent = 0.0f;     // Ems from a line's top to its baseline
+  float lineHeight = 0.0f; // Ems
+  // Node-based, so layouts keep pointers into both
+  std::unordered_map<uint32_t, Glyph> glyphs; // By code point
+  std::unordered_map<std::string, Layout> layouts;
+
+  Glyph &GetGlyph(uint32_t codepoint) {
+    auto [it, inserted] = glyphs.try_emplace(codepoint);
+    Glyph &glyph = it->second;
+    if (!inserted) {
+      return glyph;
+    }
+    glyph.index = stbtt_FindGlyphIndex(&info, static_cast<int>(codepoint));
+    int advance = 0;
+    int bearing = 0;
+    stbtt_GetGlyphHMetrics(&info, glyph.index, &advance, &bearing);
+    const float emsPerPixel = 1.0f / BAKE_SIZE;
+    glyph.advance = static_cast<float>(advance) * scale * emsPerPixel;
+    // The same box stbtt_GetGlyphSDF bakes, grown by the field's padding
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    stbtt_GetGlyphBitmapBox(&info, glyph.index, scale, scale, &x0, &y0, &x1,
+                            &y1);
+    if (x1 > x0 && y1 > y0) {
+      glyph.offset = glm::vec2(x0 - SDF_PADDING, y0 - SDF_PADDING) *
+                     emsPerPixel;
+      glyph.size = glm::vec2(x1 - x0 + 2 * SDF_PADDING,
+                             y1 - y0 + 2 * SDF_PADDING) *
+                   emsPerPixel;
+    }
+    return glyph;
+  }
+};
+
+SceneText::SceneText() = default;
+SceneText::~SceneText() = default;
+
+uint32_t SceneText::LoadFont(const std::string &path) {
+  for (const auto &[id, font] : m_fonts) {
+    if (font->path == path) {
+      return id; // Already loaded, glyphs and all
+    }
+  }
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "SceneText::LoadFont: failed to open " << path << '\n';
+    return 0;
+  }
+  auto font = std::make_unique<Font>();
+  font->path = path;
+  font->data.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+  const int offset = stbtt_GetFontOffsetForIndex(font->data.data(), 0);
+  if (font->data.empty() || offset < 0 ||
+      !stbtt_InitFont(&font->info, font->data.data(), offset)) {
+    std::cerr << "SceneText::LoadFont: failed to parse " << path << '\n';
+    return 0;
+  }
+  font->scale = stbtt_ScaleForMappingEmToPixels(&font->info, BAKE_SIZE);
+  int ascent = 0, descent = 0, lineGap = 0;
+  stbtt_GetFontVMetrics(&font->info, &ascent, &descent, &lineGap);
+  const float emsPerUnit = font->scale / BAKE_SIZE;
+  font->ascent = static_cast<float>(ascent) * emsPerUnit;
+  font->lineHeight = static_cast<float>(ascent - descent + lineGap) *
+                     emsPerUnit;
+
+  const uint32_t id = m_nextFontId++;
+  m_fonts.emplace(id, std::move(font));
+  return id;
+}
+
+uint32_t SceneText::AddLabel(const std::string &text, uint32_t font,
+                             const LabelStyle &style) {
+  Layout *layout = AcquireLayout(text, font);
+  if (layout == nullptr) {
+    return 0;
+  }
+  const uint32_t id = m_nextLabelId++;
+  Label &label = m_labels[id];
+  label.style = style;
+  label.font = font;
+  label.text = text;
+  label.layout = layout;
+  return id;
+}
+
+bool SceneText::RemoveLabel(uint32_t id) {
+  auto it = m_labels.find(id);
+  if (it == m_labels.end()) {
+    return false;
+  }
+  ReleaseLayout(it->second.layout);
+  m_labels.erase(it);
+  return true;
+}
+
+void SceneText::ClearLabels() {
+  for (auto &[id, label] : m_labels) {
+    ReleaseLayout(label.layout);
+  }
+  m_labels.clear();
+}
+
+bool SceneText::SetLabelText(uint32_t id, const std::string &text,
+                             uint32_t font) {
+  auto it = m_labels.find(id);
+  if (it == m_labels.end()) {
+    return false;
+  }
+  Label &label = it->second;
+  if (font == 0) {
+    font = label.font;
+  }
+  if (label.font == font && label.text == text) {
+    return true;
+  }
+  // Acquired first, so a layout shared with the old text isn't counted
+  // unused in between
+  Layout *layout = AcquireLayout(text, font);
+  if (layout == nullptr) {
+    return false;
+  }
+  ReleaseLayout(label.layout);
+  label.font = font;
+  label.text = text;
+  label.layout = layout;
+  return true;
+}
+
+LabelStyle *SceneText::GetLabelStyle(uint32_t id) {
+  auto it = m_labels.find(id);
+  return it != m_labels.end() ? &it->second.style : nullptr;
+}
+
+glm::vec2 SceneText::Measure(const std::string &text, uint32_t font,
+                             float size) {
+  // Cached like a label's, so measuring then adding lays out once
+  Layout *layout = AcquireLayout(text, font);
+  if (layout == nullptr) {
+    return glm::vec2(0.0f);
+  }
+  const glm::vec2 box = layout->size * size;
+  ReleaseLayout(layout);
+  return box;
+}
+
+void SceneText::Emit(const ShapeStore &shapes, TextureAtlas &atlas,
+                     TextBatch &batch) {
+  const size_t first = batch.glyphs.size();
+  for (auto &[id, label] : m_labels) {
+    const LabelStyle &style = label.style;
+    const Layout &layout = *label.layout;
+    if (!style.visible || layout.quads.empty()) {
+      continue;
+    }
+    glm::vec2 origin = style.position;
+    if (style.anchor.IsValid()) {
+      if (!shapes.IsAlive(style.anchor) ||
+          (shapes.GetFlags(style.anchor) & ShapeFlags::Visible) == 0) {
+        continue;
+      }
+      // The shape's center, turned with it about its position
+      const glm::vec2 half = shapes.GetSize(style.anchor) * 0.5f;
+      const float rotation = shapes.GetRotation(style.anchor);
+      const float c = std::cos(rotation);
+      const float s = std::sin(rotation);
+      origin += shapes.GetPosition(style.anchor) +
+                glm::vec2(c * half.x - s * half.y, s * half.x + c * half.y);
+    }
+    origin -= style.align * layout.size * style.size;
+    const float distanceScale =
+        255.0f / PIXEL_DIST_SCALE * style.size / BAKE_SIZE;
+
+    for (const Layout::Quad &quad : layout.quads) {
+      Glyph &glyph = *quad.glyph;
+      if (!glyph.baked) {
+        Bake(*layout.font, glyph, atlas);
+      }
+      if (!glyph.inAtlas) {
+        continue;
+      }
+      GlyphInstance &instance = batch.glyphs.emplace_back();
+      instance.rect = glm::vec4(origin + quad.min * style.size,
+                                origin + quad.max * style.size);
+      instance.uvRect = glyph.uvRect;
+      instance.color = style.color;
+      instance.layer = glyph.layer;
+      instance.distanceScale = distanceScale;
+    }
+  }
+  m_lastGlyphCount = batch.glyphs.size() - first;
+
+  if (m_unusedLayouts > MAX_UNUSED_LAYOUTS) {
+    DropUnusedLayouts();
+  }
+}
+
+SceneText::Stats SceneText::GetStats() const {
+  Stats stats;
+  stats.fonts = m_fonts.size();
+  stats.labels = m_labels.size();
+  for (const auto &[id, font] : m_fonts) {
+    stats.layouts += font->layouts.size();
+    for (const auto &[codepoint, glyph] : font->glyphs) {
+      stats.bakedGlyphs += glyph.inAtlas ? 1 : 0;
+    }
+  }
+  stats.glyphs = m_lastGlyphCount;
+  return stats;
+}
+
+SceneText::Layout *SceneText::AcquireLayout(const std::string &text,
+                                            uint32_t fontId) {
+  auto fontIt = m_fonts.find(fontId);
+  if (fontIt == m_fonts.end()) {
+    return nullptr;
+  }
+  Font &font = *fontIt->second;
+  auto [it, inserted] = font.layouts.try_emplace(text);
+  Layout &layout = it->second;
+  if (inserted) {
+    // Pen on the first line's baseline; kerning between neighbours
+    layout.font = &font;
+    glm::vec2 pen(0.0f, font.ascent);
+    float width = 0.0f;
+    int lines = 1;
+    int previous = -1;
+    for (size_t i = 0; i < text.size();) {
+      const uint32_t codepoint = DecodeUtf8(text, i);
+      if (codepoint == '\n') {
+        width = std::max(width, pen.x);
+        pen = glm::vec2(0.0f, pen.y + font.lineHeight);
+        ++lines;
+        previous = -1;
+        continue;
+      }
+      Glyph &glyph = font.GetGlyph(codepoint);
+      if (previous >= 0) {
+        pen.x += static_cast<float>(stbtt_GetGlyphKernAdvance(
+                     &font.info, previous, glyph.index)) *
+                 font.scale / BAKE_SIZE;
+      }
+      if (glyph.size.x > 0.0f) {
+        const glm::vec2 min = pen + glyph.offset;
+        layout.quads.push_back({min, min + glyph.size, &glyph});
+      }
+      pen.x += glyph.advance;
+      previous = glyph.index;
+    }
+    layout.size = glm::vec2(std::max(width, pen.x),
+                            static_cast<float>(lines) * font.lineHeight);
+  } else if (layout.users == 0) {
+    --m_unusedLayouts;
+  }
+  ++layout.users;
+  return &layout;
+}
+
+void SceneText::ReleaseLayout(Layout *layout) {
+  if (--layout->users == 0) {
+    ++m_unusedLayouts;
+  }
+}
+
+void SceneText::DropUnusedLayouts() {
+  for (auto &[id, font] : m_fonts) {
+    for (auto it = font->layouts.begin(); it != font->layouts.end();) {
+      if (it->second.users == 0) {
+        it = font->layouts.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  m_unusedLayouts = 0;
+}
+
+bool SceneText::Bake(Font &font, Glyph &glyph, TextureAtlas &atlas) {
+  glyph.baked = true;
+  int width = 0, height = 0, xOffset = 0, yOffset = 0;
+  unsigned char *field = stbtt_GetGlyphSDF(
+      &font.info, font.scale, glyph.index, SDF_PADDING, ON_EDGE,
+      PIXEL_DIST_SCALE, &width, &height, &xOffset, &yOffset);
+  if (field == nullptr) {
+    return false;
+  }
+  // White, with the field in alpha
+  std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4, 255);
+  for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i) {
+    rgba[i * 4 + 3] = field[i];
+  }
+  stbtt_FreeSDF(field, nullptr);
+
+  AtlasRegion region;
+  const uint32_t image = atlas.Add(rgba.data(), width, height);
+  if (image == 0 || !atlas.GetRegion(image, region)) {
+    std::cerr << "SceneText::Bake: failed to add a glyph to the atlas\n";
+    return false;
+  }
+  glyph.uvRect = region.uvRect;
+  glyph.layer = static_cast<float>(region.layer);
+  glyph.inAtlas = true;
+  return true;
+}
+
+TextRenderer::~TextRenderer() { Cleanup(); }
+
+bool TextRenderer::Initialize(ResourceManager *resources, GLuint atlasUnit) {
+  m_shader =
+      resources->AcquireProgram(s_vertexShaderSource, s_fragmentShaderSource);
+  if (!m_shader) {
+    std::cerr << "TextRenderer::Initialize: failed to build the text shader\n";
+    return false;
+  }
+  m_atlasUnit = atlasUnit;
+  m_shader->Use();
+  m_shader->Set(m_shader->GetUniform<int>("u_atlas"),
+                static_cast<int>(atlasUnit));
+
+  // One instance per glyph; the buffer is reallocated every frame but the
+  // pointers never move
+  glGenVertexArrays(1, &m_VAO);
+  glGenBuffers(1, &m_VBO);
+  GLState::BindVertexArray(m_VAO);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  const auto stride = static_cast<GLsizei>(sizeof(GlyphInstance));
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride,
+                        (void *)offsetof(GlyphInstance, rect));
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride,
+                        (void *)offsetof(GlyphInstance, uvRect));
+  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride,
+                        (void *)offsetof(GlyphInstance, color));
+  glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride,
+                        (void *)offsetof(GlyphInstance, layer));
+  for (GLuint attrib = 0; attrib <= 3; ++attrib) {
+    glEnableVertexAttribArray(attrib);
+    glVertexAttribDivisor(attrib, 1);
+  }
+  return m_VAO != 0 && m_VBO != 0;
+}
+
+void TextRenderer::Submit(const TextBatch &batch, GLuint atlasTexture,
+                          RenderQueue &queue) {
+  if (m_VAO == 0 || batch.glyphs.empty()) {
+    return;
+  }
+  GLState::BindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  // Orphaned: the driver hands out fresh storage if draws still read the
+  // old one
+  const auto bytes =
+      static_cast<GLsizeiptr>(batch.glyphs.size() * sizeof(GlyphInstance));
+  glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, batch.glyphs.data());
+
+  DrawCommand command;
+  command.program = m_shader->ID;
+  command.vertexArray = m_VAO;
+  command.textureTarget = GL_TEXTURE_2D_ARRAY;
+  command.texture = atlasTexture;
+  command.textureUnit = m_atlasUnit;
+  command.blend = BlendMode::Alpha;
+  command.execute = &TextRenderer::DrawGlyphs;
+  command.context = this;
+  command.argument = static_cast<uint32_t>(batch.glyphs.size());
+  queue.Submit(command, DrawLayer::Text);
+}
+
+// Runs with the program, VAO and atlas bound by the queue
+void TextRenderer::DrawGlyphs(void * /*context*/, uint32_t glyphCount) {
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                        static_cast<GLsizei>(glyphCount));
+}
+
+void TextRenderer::Cleanup() {
+  GLState::DeleteVertexArray(m_VAO);
+  GLState::DeleteBuffer(m_VBO);
+  m_VAO = m_VBO = 0;
+  m_shader.Reset();
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "RenderQueue.h"
+#include "ResourceManager.h"
+#include "Shader.h"
+#include "ShapeStore.h"
+#include <cstdint>
+#include <glm.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class TextureAtlas;
+
+// One glyph quad of a TextBatch, in window units. The glyph's distance
+// field sits in the alpha of an atlas region; color is unpremultiplied.
+struct GlyphInstance {
+  glm::vec4 rect = glm::vec4(0.0f);   // x0, y0, x1, y1
+  glm::vec4 uvRect = glm::vec4(0.0f); // u0, v0, u1, v1
+  glm::vec4 color = glm::vec4(1.0f);
+  float layer = 0.0f; // Atlas layer
+  // Window units of distance per unit of field alpha, so the edge stays
+  // one pixel wide at any size
+  float distanceScale = 1.0f;
+};
+
+// Every visible label's glyphs, drawn in one instanced call
+struct TextBatch {
+  std::vector<GlyphInstance> glyphs;
+
+  void Clear() { glyphs.clear(); }
+};
+
+// Where and how a label is drawn; free to change between frames
+struct LabelStyle {
+  float size = 16.0f; // Em height, window units
+  // With an anchor, an offset from the anchor shape's center
+  glm::vec2 position = glm::vec2(0.0f);
+  // Point of the text box placed at position: (0, 0) top-left, (0.5, 0.5)
+  // centered
+  glm::vec2 align = glm::vec2(0.0f);
+  glm::vec4 color = glm::vec4(1.0f);
+  // Followed while alive and visible; the label hides otherwise
+  ShapeHandle anchor;
+  bool visible = true;
+};
+
+// Text placed in the scene, for labels on many shapes at once. Glyphs are
+// baked on first use as signed distance fields into the texture atlas, at
+// one size, and drawn at any size from there. Each distinct (font, string)
+// is laid out once and shared by every label showing it; layouts no label
+// uses are dropped when too many pile up.
+//
+// Layouts are in ems, so a label's size only scales them: labels that
+// differ in size alone share one layout. Main thread only.
+class SceneText {
+public:
+  static constexpr int BAKE_SIZE = 48;   // Atlas pixels per em
+  static constexpr int SDF_PADDING = 6;  // Reach of the field, atlas pixels
+  static constexpr size_t MAX_UNUSED_LAYOUTS = 1024;
+
+  struct Stats {
+    size_t fonts = 0;
+    size_t labels = 0;
+    size_t layouts = 0;     // Cached, used or not
+    size_t bakedGlyphs = 0; // In the atlas
+    size_t glyphs = 0;      // Emitted last frame
+  };
+
+  SceneText();
+  ~SceneText();
+  SceneText(const SceneText &) = delete;
+  SceneText &operator=(const SceneText &) = delete;
+
+  // TrueType or OpenType (glyf) file. Returns a font id, never 0, or 0 if
+  // the file can't be read or parsed.
+  uint32_t LoadFont(const std::string &path);
+
+  // text is UTF-8; '\n' starts a new line. Returns a label id, never 0, or
+  // 0 for an unknown font.
+  uint32_t AddLabel(const std::string &text, uint32_t font,
+                    const LabelStyle &style);
+  bool RemoveLabel(uint32_t id);
+  // Removes every label; fonts and their baked glyphs stay
+  void ClearLabels();
+  // font 0 keeps the label's. False for unknown labels or fonts.
+  bool SetLabelText(uint32_t id, const std::string &text, uint32_t font = 0);
+  // Null for unknown ids
+  LabelStyle *GetLabelStyle(uint32_t id);
+
+  [[nodiscard]] bool HasFont(uint32_t font) const {
+    return m_fonts.count(font) != 0;
+  }
+  // Text box of text at size, in window units; zero for unknown fonts
+  glm::vec2 Measure(const std::string &text, uint32_t font, float size);
+
+  // Appends the glyphs of every visible label, by id, baking the ones the
+  // atlas doesn't have yet
+  void Emit(const ShapeStore &shapes, TextureAtlas &atlas, TextBatch &batch);
+
+  [[nodiscard]] Stats GetStats() const;
+
+private:
+  struct Font;
+  struct Glyph;
+  struct Layout;
+
+  struct Label {
+    LabelStyle style;
+    uint32_t font = 0;
+    std::string text;
+    Layout *layout = nullptr; // Holds a use of it
+  };
+
+  Layout *AcquireLayout(const std::string &text, uint32_t font);
+  void ReleaseLayout(Layout *layout);
+  // Drops every layout no label uses
+  void DropUnusedLayouts();
+  static bool Bake(Font &font, Glyph &glyph, TextureAtlas &atlas);
+
+  std::map<uint32_t, std::unique_ptr<Font>> m_fonts;
+  uint32_t m_nextFontId = 1;
+  std::map<uint32_t, Label> m_labels; // Ordered: drawn by id
+  uint32_t m_nextLabelId = 1;
+  size_t m_unusedLayouts = 0;
+  size_t m_lastGlyphCount = 0;
+};
+
+// Draws a TextBatch: every glyph is one instance of a quad sampling the
+// atlas array texture, all in a single draw at DrawLayer::Text. The edge
+// is placed from the distance field at one pixel wide for the current
+// framebuffer scale, so labels stay sharp when scaled up and smooth when
+// scaled down. Instances go into a buffer orphaned every frame.
+class TextRenderer {
+public:
+  TextRenderer() = default;
+  ~TextRenderer();
+  TextRenderer(const TextRenderer &) = delete;
+  TextRenderer &operator=(const TextRenderer &) = delete;
+
+  // atlasUnit is the texture unit the atlas is bound to for the draw
+  bool Initialize(ResourceManager *resources, GLuint atlasUnit);
+  // Uploads the glyphs and submits their draw. The batch has to outlive the
+  // queue's Execute().
+  void Submit(const TextBatch &batch, GLuint atlasTexture,
+              RenderQueue &queue);
+  void Cleanup();
+
+private:
+  static void DrawGlyphs(void *context, uint32_t glyphCount);
+
+  ProgramRef m_shader;
+  GLuint m_atlasUnit = 0;
+  GLuint m_VAO = 0;
+  GLuint m_VBO = 0;
+};
@@ -1,11 +1,16 @@
 #include "Shader.h"
+#include "FrameGlobals.h"
+#include "GLState.h"
+#include "ProgramCache.h"
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 
 // Constructor that reads from files (default) or directly from source strings
 Shader::Shader(const char *vertexPathOrSource, const char *fragmentPathOrSource,
-               bool isSourceCode) {
+               bool isSourceCode, ProgramCache *cache,
+               const std::vector<const char *> &feedbackVaryings) {
   std::string vertexCode;
   std::string fragmentCode;
 
@@ -41,6 +46,25 @@ Shader::Shader(const char *vertexPathOrSource, const char *fragmentPathOrSource,
     }
   }
 
+  // Every stage sees the shared per-frame globals
+  vertexCode = InjectFrameGlobals(vertexCode);
+  fragmentCode = InjectFrameGlobals(fragmentCode);
+  // Captured outputs are link state the sources don't show; naming them in
+  // the source keys cached binaries by them too
+  for (const char *varying : feedbackVaryings) {
+    vertexCode += std::string("\n// Transform feedback: ") + varying;
+  }
+
+  // 1. Try a cached program binary before compiling anything
+  if (cache != nullptr) {
+    ID = cache->Load(vertexCode, fragmentCode);
+    if (ID != 0) {
+      BindFrameGlobals();
+      ReadActiveUniforms();
+      return;
+    }
+  }
+
   const char *vShaderCode = vertexCode.c_str();
   const char *fShaderCode = fragmentCode.c_str();
 
@@ -61,7 +85,14 @@ Shader::Shader(const char *vertexPathOrSource, const char *fragmentPathOrSource,
   }
 
   // Shader Program
-  ID = LinkProgram(vertex, fragment);
+  ID = LinkProgram(vertex, fragment, cache, feedbackVaryings);
+  if (ID != 0) {
+    BindFrameGlobals();
+    ReadActiveUniforms();
+    if (cache != nullptr) {
+      cache->Store(ID, vertexCode, fragmentCode);
+    }
+  }
 
   // Delete the shaders as they're linked into our program now and no longer
   // necessary
@@ -80,8 +111,18 @@ GLuint Shader::CompileShader(GLenum shaderType, const char *source,
   return (success != 0) ? shader : 0;
 }
 
-GLuint Shader::LinkProgram(GLuint vertexShader, GLuint fragmentShader) {
+GLuint Shader::LinkProgram(GLuint vertexShader, GLuint fragmentShader,
+                           const ProgramCache *cache,
+                           const std::vector<const char *> &feedbackVaryings) {
   GLuint program = glCreateProgram();
+  if (cache != nullptr) {
+    cache->PrepareForRetrieval(program);
+  }
+  if (!feedbackVaryings.empty()) {
+    glTransformFeedbackVaryings(
+        program, static_cast<GLsizei>(feedbackVaryings.size()),
+        feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
+  }
   glAttachShader(program, vertexShader);
   glAttachShader(program, fragmentShader);
   glLinkProgram(program);
@@ -93,7 +134,7 @@ GLuint Shader::LinkProgram(GLuint vertexShader, GLuint fragmentShader) {
 
 void Shader::Use() const {
   if (ID != 0) {
-    glUseProgram(ID);
+    GLState::UseProgram(ID);
   } else {
     // std::cerr << "Trying to use an invalid shader program (ID=0)" <<
     // std::endl;
@@ -102,9 +143,112 @@ void Shader::Use() const {
 
 void Shader::Cleanup() {
   if (ID != 0) {
-    glDeleteProgram(ID);
+    GLState::DeleteProgram(ID);
     ID = 0;
   }
+  m_uniforms.clear();
+}
+
+std::string Shader::InjectFrameGlobals(const std::string &source) {
+  // The block has to follow #version, which must come first in the source
+  size_t versionPos = source.find("#version");
+  if (versionPos == std::string::npos) {
+    return FrameGlobals::GLSL_BLOCK + source;
+  }
+  size_t lineEnd = source.find('\n', versionPos);
+  if (lineEnd == std::string::npos) {
+    return source + "\n" + FrameGlobals::GLSL_BLOCK;
+  }
+  std::string result = source;
+  result.insert(lineEnd + 1, FrameGlobals::GLSL_BLOCK);
+  return result;
+}
+
+void Shader::BindFrameGlobals() const {
+  // Inactive if the program never reads a frame global; nothing to bind then
+  GLuint blockIndex = glGetUniformBlockIndex(ID, FrameGlobals::BLOCK_NAME);
+  if (blockIndex != GL_INVALID_INDEX) {
+    glUniformBlockBinding(ID, blockIndex, FrameGlobals::BINDING_POINT);
+  }
+}
+
+void Shader::ReadActiveUniforms() {
+  m_uniforms.clear();
+
+  GLint count = 0;
+  GLint maxNameLength = 0;
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+  std::vector<GLchar> nameBuffer(static_cast<size_t>(maxNameLength) + 1);
+
+  m_uniforms.reserve(static_cast<size_t>(count));
+  for (GLint i = 0; i < count; ++i) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(ID, static_cast<GLuint>(i),
+                       static_cast<GLsizei>(nameBuffer.size()), &length, &size,
+                       &type, nameBuffer.data());
+
+    UniformInfo info;
+    info.name.assign(nameBuffer.data(), static_cast<size_t>(length));
+    // Arrays are reported as "name[0]"; look them up by their base name
+    if (info.name.size() > 3 &&
+        info.name.compare(info.name.size() - 3, 3, "[0]") == 0) {
+      info.name.resize(info.name.size() - 3);
+    }
+    info.location = glGetUniformLocation(ID, nameBuffer.data());
+    info.type = type;
+    // Members of uniform blocks have no location and can't be set here
+    if (info.location >= 0) {
+      m_uniforms.push_back(std::move(info));
+    }
+  }
+}
+
+int Shader::FindUniform(const char *name, GLenum expectedType) const {
+  for (size_t i = 0; i < m_uniforms.size(); ++i) {
+    const UniformInfo &info = m_uniforms[i];
+    if (info.name != name) {
+      continue;
+    }
+    bool compatible = info.type == expectedType;
+    if (!compatible && expectedType == GL_INT) {
+      // Samplers and bools are set through glUniform1i as well
+      switch (info.type) {
+      case GL_BOOL:
+      case GL_SAMPLER_2D:
+      case GL_SAMPLER_2D_ARRAY:
+      case GL_SAMPLER_3D:
+      case GL_SAMPLER_CUBE:
+      case GL_SAMPLER_BUFFER:
+      case GL_INT_SAMPLER_BUFFER:
+      case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+        compatible = true;
+        break;
+      default:
+        break;
+      }
+    }
+    if (!compatible) {
+      std::cerr << "Shader::GetUniform: type mismatch for uniform '" << name
+                << "' in program " << ID << std::endl;
+      return -1;
+    }
+    return static_cast<int>(i);
+  }
+  return -1; // Not active (missing or optimized out)
+}
+
+bool Shader::UpdateCachedValue(int slot, const void *value,
+                               size_t bytes) const {
+  UniformInfo &info = m_uniforms[static_cast<size_t>(slot)];
+  if (info.hasCachedValue && std::memcmp(info.cachedValue, value, bytes) == 0) {
+    return false;
+  }
+  std::memcpy(info.cachedValue, value, bytes);
+  info.hasCachedValue = true;
+  return true;
 }
 
 void Shader::CheckCompileErrors(GLuint shader, std::string type) {
@@ -133,36 +277,78 @@ void Shader::CheckCompileErrors(GLuint shader, std::string type) {
   }
 }
 
+// Typed setters
+void Shader::Set(UniformHandle<bool> handle, bool value) const {
+  int intValue = static_cast<int>(value);
+  if (handle.IsValid() &&
+      UpdateCachedValue(handle.slot, &intValue, sizeof(intValue))) {
+    glUniform1i(handle.location, intValue);
+  }
+}
+void Shader::Set(UniformHandle<int> handle, int value) const {
+  if (handle.IsValid() && UpdateCachedValue(handle.slot, &value, sizeof(value))) {
+    glUniform1i(handle.location, value);
+  }
+}
+void Shader::Set(UniformHandle<float> handle, float value) const {
+  if (handle.IsValid() && UpdateCachedValue(handle.slot, &value, sizeof(value))) {
+    glUniform1f(handle.location, value);
+  }
+}
+void Shader::Set(UniformHandle<glm::vec2> handle,
+                 const glm::vec2 &value) const {
+  if (handle.IsValid() && UpdateCachedValue(handle.slot, &value, sizeof(value))) {
+    glUniform2fv(handle.location, 1, &value[0]);
+  }
+}
+void Shader::Set(UniformHandle<glm::vec3> handle,
+                 const glm::vec3 &value) const {
+  if (handle.IsValid() && UpdateCachedValue(handle.slot, &value, sizeof(value))) {
+    glUniform3fv(handle.location, 1, &value[0]);
+  }
+}
+void Shader::Set(UniformHandle<glm::vec4> handle,
+                 const glm::vec4 &value) const {
+  if (handle.IsValid() && UpdateCachedValue(handle.slot, &value, sizeof(value))) {
+    glUniform4fv(handle.location, 1, &value[0]);
+  }
+}
+void Shader::Set(UniformHandle<glm::mat4> handle,
+                 const glm::mat4 &value) const {
+  if (handle.IsValid() && UpdateCachedValue(handle.slot, &value, sizeof(value))) {
+    glUniformMatrix4fv(handle.location, 1, GL_FALSE, &value[0][0]);
+  }
+}
+
 // Utility uniform functions implementations
-void Shader::SetBool(const std::string &name, bool value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+void Shader::SetBool(const char *name, bool value) const {
+  Set(GetUniform<bool>(name), value);
 }
-void Shader::SetInt(const std::string &name, int value) const {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::SetInt(const char *name, int value) const {
+  Set(GetUniform<int>(name), value);
 }
-void Shader::SetFloat(const std::string &name, float value) const {
-  glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::SetFloat(const char *name, float value) const {
+  Set(GetUniform<float>(name), value);
 }
-void Shader::SetVec2(const std::string &name, float x, float y) const {
-  glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+void Shader::SetVec2(const char *name, float x, float y) const {
+  Set(GetUniform<glm::vec2>(name), glm::vec2(x, y));
 }
-void Shader::SetVec2(const std::string &name, const glm::vec2 &value) const {
-  glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+void Shader::SetVec2(const char *name, const glm::vec2 &value) const {
+  Set(GetUniform<glm::vec2>(name), value);
 }
-void Shader::SetVec3(const std::string &name, float x, float y, float z) const {
-  glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+void Shader::SetVec3(const char *name, float x, float y, float z) const {
+  Set(GetUniform<glm::vec3>(name), glm::vec3(x, y, z));
 }
-void Shader::SetVec3(const std::string &name, const glm::vec3 &value) const {
-  glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+void Shader::SetVec3(const char *name, const glm::vec3 &value) const {
+  Set(GetUniform<glm::vec3>(name), value);
 }
-void Shader::SetVec4(const std::string &name, float x, float y, float z,
+void Shader::SetVec4(const char *name, float x, float y, float z,
                      float w) const {
-  glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+  Set(GetUniform<glm::vec4>(name), glm::vec4(x, y, z, w));
+}
+void Shader::SetVec4(const char *name, const glm::vec4 &value) const {
+  Set(GetUniform<glm::vec4>(name), value);
 }
-void Shader::SetVec4(const std::string &name, const glm::vec4 &value) const {
-  glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+void Shader::SetMat4(const char *name, const glm::mat4 &mat) const {
+  Set(GetUniform<glm::mat4>(name), mat);
 }
-void Shader::SetMat4(const std::string &name, const glm::mat4 &mat) const {
-  glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                     &mat[0][0]);
-}
\ No newline at end of file
@@ -3,37 +3,125 @@
 #include <glad/glad.h>
 #include <glm.hpp>
 #include <string>
+#include <vector>
+
+class ProgramCache;
+
+// Maps a C++ uniform value type to the GL type reported by glGetActiveUniform
+template <typename T> struct UniformTraits;
+template <> struct UniformTraits<bool> {
+  static constexpr GLenum GL_TYPE = GL_BOOL;
+};
+template <> struct UniformTraits<int> {
+  static constexpr GLenum GL_TYPE = GL_INT;
+};
+template <> struct UniformTraits<float> {
+  static constexpr GLenum GL_TYPE = GL_FLOAT;
+};
+template <> struct UniformTraits<glm::vec2> {
+  static constexpr GLenum GL_TYPE = GL_FLOAT_VEC2;
+};
+template <> struct UniformTraits<glm::vec3> {
+  static constexpr GLenum GL_TYPE = GL_FLOAT_VEC3;
+};
+template <> struct UniformTraits<glm::vec4> {
+  static constexpr GLenum GL_TYPE = GL_FLOAT_VEC4;
+};
+template <> struct UniformTraits<glm::mat4> {
+  static constexpr GLenum GL_TYPE = GL_FLOAT_MAT4;
+};
+
+// Lightweight typed reference to an entry in a Shader's uniform table.
+// Resolve once with Shader::GetUniform<T>() and keep it; setting through a
+// handle never touches strings.
+template <typename T> struct UniformHandle {
+  GLint location = -1;
+  int slot = -1; // Index into the owning shader's uniform table
+
+  [[nodiscard]] bool IsValid() const { return slot >= 0; }
+};
 
 class Shader {
 public:
   GLuint ID = 0;
 
   Shader() = default;
+  // The FrameGlobals uniform block is injected into both stages and bound
+  // automatically (see FrameGlobals.h).
+  // With a cache, a stored program binary is used when the driver accepts
+  // it, and freshly linked programs are written back to it.
+  // feedbackVaryings are vertex outputs captured interleaved, in order, by
+  // transform feedback.
   Shader(const char *vertexPath, const char *fragmentPath,
-         bool isSourceCode = false);
+         bool isSourceCode = false, ProgramCache *cache = nullptr,
+         const std::vector<const char *> &feedbackVaryings = {});
 
   // Activates the shader program
   void Use() const;
 
-  // Utility uniform functions
-  void SetBool(const std::string &name, bool value) const;
-  void SetInt(const std::string &name, int value) const;
-  void SetFloat(const std::string &name, float value) const;
-  void SetVec2(const std::string &name, float x, float y) const;
-  void SetVec2(const std::string &name, const glm::vec2 &value) const;
-  void SetVec3(const std::string &name, float x, float y, float z) const;
-  void SetVec3(const std::string &name, const glm::vec3 &value) const;
-  void SetVec4(const std::string &name, float x, float y, float z,
-               float w) const;
-  void SetVec4(const std::string &name, const glm::vec4 &value) const;
-  void SetMat4(const std::string &name, const glm::mat4 &mat) const;
+  // Looks up an active uniform read at link time. Returns an invalid handle
+  // (and logs) if the uniform is missing or its GL type doesn't match T.
+  template <typename T>
+  [[nodiscard]] UniformHandle<T> GetUniform(const char *name) const {
+    UniformHandle<T> handle;
+    handle.slot = FindUniform(name, UniformTraits<T>::GL_TYPE);
+    if (handle.slot >= 0) {
+      handle.location = m_uniforms[handle.slot].location;
+    }
+    return handle;
+  }
+
+  // Typed setters. The program must be in use; values equal to the last one
+  // set through this Shader are skipped.
+  void Set(UniformHandle<bool> handle, bool value) const;
+  void Set(UniformHandle<int> handle, int value) const;
+  void Set(UniformHandle<float> handle, float value) const;
+  void Set(UniformHandle<glm::vec2> handle, const glm::vec2 &value) const;
+  void Set(UniformHandle<glm::vec3> handle, const glm::vec3 &value) const;
+  void Set(UniformHandle<glm::vec4> handle, const glm::vec4 &value) const;
+  void Set(UniformHandle<glm::mat4> handle, const glm::mat4 &value) const;
+
+  // Utility uniform functions (name lookup per call; prefer handles in
+  // per-draw code)
+  void SetBool(const char *name, bool value) const;
+  void SetInt(const char *name, int value) const;
+  void SetFloat(const char *name, float value) const;
+  void SetVec2(const char *name, float x, float y) const;
+  void SetVec2(const char *name, const glm::vec2 &value) const;
+  void SetVec3(const char *name, float x, float y, float z) const;
+  void SetVec3(const char *name, const glm::vec3 &value) const;
+  void SetVec4(const char *name, float x, float y, float z, float w) const;
+  void SetVec4(const char *name, const glm::vec4 &value) const;
+  void SetMat4(const char *name, const glm::mat4 &mat) const;
 
   void Cleanup(); // To delete the shader program
 
 private:
+  // One entry per active uniform, filled once after linking. The cached
+  // value lets setters skip redundant glUniform* calls; it stays valid as
+  // long as uniforms of this program are only set through this Shader.
+  struct UniformInfo {
+    std::string name;
+    GLint location = -1;
+    GLenum type = 0;
+    bool hasCachedValue = false;
+    alignas(16) unsigned char cachedValue[sizeof(glm::mat4)] = {};
+  };
+
+  static std::string InjectFrameGlobals(const std::string &source);
+  void BindFrameGlobals() const;
+  void ReadActiveUniforms();
+  [[nodiscard]] int FindUniform(const char *name, GLenum expectedType) const;
+  // Stores the value and returns true if it differs from the cached one
+  bool UpdateCachedValue(int slot, const void *value, size_t bytes) const;
+
+  mutable std::vector<UniformInfo> m_uniforms;
+
   // Utility function for checking shader compilation/linking errors.
   static void CheckCompileErrors(GLuint shader, std::string type);
   static GLuint CompileShader(GLenum shaderType, const char *source,
                               const std::string &typeName);
-  static GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader);
-};
\ No newline at end of file
+  static GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader,
+                            const ProgramCache *cache,
+                            const std::vector<const char *> &feedbackVaryings);
+};
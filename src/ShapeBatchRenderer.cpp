@@ -0,0 +1,221 @@
+#include "ShapeBatchRenderer.h"
+#include "GLState.h"
+#include "ShapeStore.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+// Per-instance column sizes, in the order they are laid out in the VBO
+constexpr size_t POSITION_BYTES = sizeof(glm::vec2);
+constexpr size_t SIZE_BYTES = sizeof(glm::vec2);
+constexpr size_t ROTATION_BYTES = sizeof(float);
+constexpr size_t COLOR_BYTES = sizeof(glm::vec4);
+constexpr size_t FLAGS_BYTES = sizeof(uint32_t);
+constexpr size_t UV_RECT_BYTES = sizeof(glm::vec4);
+constexpr size_t LAYER_BYTES = sizeof(uint32_t);
+constexpr size_t PARAMS_BYTES = sizeof(ShapeParams); // Two vec4 attributes
+constexpr size_t INSTANCE_BYTES = POSITION_BYTES + SIZE_BYTES +
+                                  ROTATION_BYTES + COLOR_BYTES + FLAGS_BYTES +
+                                  UV_RECT_BYTES + LAYER_BYTES + PARAMS_BYTES;
+
+// Writes the first `count` elements of a copied column slice to dense
+// index `first` of the column starting at columnOffset
+template <typename T>
+void UploadColumn(const std::vector<T> &slice, size_t columnOffset,
+                  size_t first, size_t count) {
+  glBufferSubData(GL_ARRAY_BUFFER,
+                  static_cast<GLintptr>(columnOffset + first * sizeof(T)),
+                  static_cast<GLsizeiptr>(count * sizeof(T)), slice.data());
+}
+} // namespace
+
+ShapeBatchRenderer::ShapeBatchRenderer() = default;
+
+ShapeBatchRenderer::~ShapeBatchRenderer() { Cleanup(); }
+
+bool ShapeBatchRenderer::Initialize(const ProgramRef &program,
+                                    ResourceManager *resources,
+                                    size_t initialCapacity) {
+  if (!program || program->ID == 0 || resources == nullptr) {
+    std::cerr << "ShapeBatchRenderer::Initialize: Invalid shader provided."
+              << std::endl;
+    return false;
+  }
+  m_program = program;
+
+  // Unit quad, scaled and offset per instance
+  float vertices[] = {
+      0.0f, 0.0f, // Top-left
+      1.0f, 0.0f, // Top-right
+      1.0f, 1.0f, // Bottom-right
+      0.0f, 1.0f  // Bottom-left
+  };
+
+  m_quad = resources->AcquireBuffer(vertices, sizeof(vertices));
+  if (!m_quad) {
+    return false;
+  }
+  glGenVertexArrays(1, &m_VAO);
+
+  GLState::BindVertexArray(m_VAO);
+
+  GLState::BindBuffer(GL_ARRAY_BUFFER, m_quad->buffer);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *)0);
+  glEnableVertexAttribArray(0);
+
+  // Per-instance attributes, advanced once per instance; Reallocate creates
+  // the instance buffer
+  for (GLuint attrib = 1; attrib <= 9; ++attrib) {
+    glEnableVertexAttribArray(attrib);
+    glVertexAttribDivisor(attrib, 1);
+  }
+  Reallocate(std::max<size_t>(initialCapacity, 1));
+
+  return m_VAO != 0 && m_instanceVBO != 0;
+}
+
+DrawCommand ShapeBatchRenderer::Prepare(const ShapeBatchUpdate &update) {
+  DrawCommand draw;
+  if (!m_program || m_program->ID == 0 || m_VAO == 0) {
+    return draw;
+  }
+
+  // Bindings are left in place; GLState skips them next frame if nothing
+  // else changed them in between
+  GLState::BindVertexArray(m_VAO);
+  Upload(update);
+
+  if (update.count > 0) {
+    draw.program = m_program->ID;
+    draw.vertexArray = m_VAO;
+    draw.blend = BlendMode::Alpha;
+    draw.argument = static_cast<uint32_t>(update.count);
+    draw.execute = [](void *, uint32_t instances) {
+      glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4,
+                            static_cast<GLsizei>(instances));
+    };
+  }
+  return draw;
+}
+
+void ShapeBatchRenderer::Cleanup() {
+  GLState::DeleteVertexArray(m_VAO);
+  GLState::DeleteBuffer(m_instanceVBO);
+  m_VAO = m_instanceVBO = 0;
+  m_gpuCapacity = 0;
+  m_quad.Reset();
+  m_program.Reset();
+}
+
+size_t ShapeBatchRenderer::GetBufferBytes() const {
+  return m_gpuCapacity * INSTANCE_BYTES;
+}
+
+// Expects the VAO to be bound. Column offsets depend on the capacity, so the
+// storage moves to a new buffer: existing instances are copied over on the
+// GPU (updates only carry dirty ranges) and the attribute pointers are
+// re-specified.
+void ShapeBatchRenderer::Reallocate(size_t capacity) {
+  GLuint buffer = 0;
+  glGenBuffers(1, &buffer);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(capacity * INSTANCE_BYTES), nullptr,
+               GL_DYNAMIC_DRAW);
+
+  if (m_instanceVBO != 0) {
+    GLState::BindBuffer(GL_COPY_READ_BUFFER, m_instanceVBO);
+    size_t readOffset = 0;
+    size_t writeOffset = 0;
+    for (size_t columnBytes :
+         {POSITION_BYTES, SIZE_BYTES, ROTATION_BYTES, COLOR_BYTES, FLAGS_BYTES,
+          UV_RECT_BYTES, LAYER_BYTES, PARAMS_BYTES}) {
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER,
+                          static_cast<GLintptr>(readOffset),
+                          static_cast<GLintptr>(writeOffset),
+                          static_cast<GLsizeiptr>(m_gpuCapacity * columnBytes));
+      readOffset += m_gpuCapacity * columnBytes;
+      writeOffset += capacity * columnBytes;
+    }
+    GLState::DeleteBuffer(m_instanceVBO);
+  }
+  m_instanceVBO = buffer;
+  m_gpuCapacity = capacity;
+
+  size_t offset = 0;
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void *)offset);
+  offset += m_gpuCapacity * POSITION_BYTES;
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void *)offset);
+  offset += m_gpuCapacity * SIZE_BYTES;
+  glVertexAttribPointer(9, 1, GL_FLOAT, GL_FALSE, 0, (void *)offset);
+  offset += m_gpuCapacity * ROTATION_BYTES;
+  glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 0, (void *)offset);
+  offset += m_gpuCapacity * COLOR_BYTES;
+  glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, 0, (void *)offset);
+  offset += m_gpuCapacity * FLAGS_BYTES;
+  glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 0, (void *)offset);
+  offset += m_gpuCapacity * UV_RECT_BYTES;
+  glVertexAttribIPointer(6, 1, GL_UNSIGNED_INT, 0, (void *)offset);
+  offset += m_gpuCapacity * LAYER_BYTES;
+  glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, PARAMS_BYTES, (void *)offset);
+  glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, PARAMS_BYTES,
+                        (void *)(offset + sizeof(glm::vec4)));
+}
+
+// Expects the VAO to be bound
+void ShapeBatchRenderer::Upload(const ShapeBatchUpdate &update) {
+  if (update.count > m_gpuCapacity) {
+    // Grow geometrically
+    size_t capacity = m_gpuCapacity;
+    while (capacity < update.count) {
+      capacity *= 2;
+    }
+    Reallocate(capacity);
+  } else {
+    GLState::BindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+  }
+
+  // Slots past the live count were swap-removed; they are never drawn
+  size_t end = std::min(update.End(), update.count);
+  size_t count = end > update.begin ? end - update.begin : 0;
+  if (count > 0) {
+    size_t offset = 0;
+    UploadColumn(update.positions, offset, update.begin, count);
+    offset += m_gpuCapacity * POSITION_BYTES;
+    UploadColumn(update.sizes, offset, update.begin, count);
+    offset += m_gpuCapacity * SIZE_BYTES;
+    UploadColumn(update.rotations, offset, update.begin, count);
+    offset += m_gpuCapacity * ROTATION_BYTES;
+    UploadColumn(update.colors, offset, update.begin, count);
+    offset += m_gpuCapacity * COLOR_BYTES;
+    UploadColumn(update.flags, offset, update.begin, count);
+    offset += m_gpuCapacity * FLAGS_BYTES;
+    UploadColumn(update.uvRects, offset, update.begin, count);
+    offset += m_gpuCapacity * UV_RECT_BYTES;
+    UploadColumn(update.layers, offset, update.begin, count);
+    offset += m_gpuCapacity * LAYER_BYTES;
+    UploadColumn(update.params, offset, update.begin, count);
+  }
+}
+
+void ShapeBatchUpdate::Capture(ShapeStore &store) {
+  count = store.Size();
+  begin = store.DirtyBegin();
+  size_t end = std::min(store.DirtyEnd(), count);
+  if (begin >= end) {
+    begin = 0;
+    end = 0;
+  }
+  positions.assign(store.Positions().begin() + begin,
+                   store.Positions().begin() + end);
+  sizes.assign(store.Sizes().begin() + begin, store.Sizes().begin() + end);
+  rotations.assign(store.Rotations().begin() + begin,
+                   store.Rotations().begin() + end);
+  colors.assign(store.Colors().begin() + begin, store.Colors().begin() + end);
+  flags.assign(store.Flags().begin() + begin, store.Flags().begin() + end);
+  uvRects.assign(store.UVRects().begin() + begin,
+                 store.UVRects().begin() + end);
+  layers.assign(store.Layers().begin() + begin, store.Layers().begin() + end);
+  params.assign(store.Params().begin() + begin, store.Params().begin() + end);
+  store.ClearDirtyRange();
+}
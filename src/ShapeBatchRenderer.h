@@ -0,0 +1,64 @@
+#pragma once
+
+#include "RenderQueue.h"
+#include "ResourceManager.h"
+#include "Shader.h"
+#include "ShapeStore.h"
+#include <cstdint>
+#include <glm.hpp>
+#include <vector>
+
+// The dirty range of a ShapeStore's columns, copied out on the main thread
+// so the render thread never reads the live store. Every captured update
+// must reach the renderer, since capturing clears the store's dirty range.
+struct ShapeBatchUpdate {
+  size_t count = 0; // Live shapes at capture time
+  size_t begin = 0; // Dense index of the first copied element
+  std::vector<glm::vec2> positions;
+  std::vector<glm::vec2> sizes;
+  std::vector<float> rotations;
+  std::vector<glm::vec4> colors;
+  std::vector<uint32_t> flags;
+  std::vector<glm::vec4> uvRects;
+  std::vector<uint32_t> layers;
+  std::vector<ShapeParams> params;
+
+  void Capture(ShapeStore &store);
+  [[nodiscard]] size_t End() const { return begin + positions.size(); }
+};
+
+// Draws every shape with a single glDrawArraysInstanced call, submitted to the
+// RenderQueue. Each instance is a quad; the shader picks the primitive inside
+// it from the ShapeKind in the flags (an SDF for everything but plain rects)
+// and samples the texture atlas for sprites, so mixed shape lists still share
+// the one draw. The instance VBO mirrors the ShapeStore's columns as
+// consecutive sub-ranges, so syncing is a straight copy of each column of a
+// ShapeBatchUpdate. The projection comes from the FrameGlobals uniform block,
+// so a frame costs no per-batch uniforms at all. The unit quad is the
+// ResourceManager's shared copy.
+class ShapeBatchRenderer {
+public:
+  ShapeBatchRenderer();
+  ~ShapeBatchRenderer();
+
+  bool Initialize(const ProgramRef &program, ResourceManager *resources,
+                  size_t initialCapacity = 1024);
+  // Uploads the update and returns the draw for every live shape (none when
+  // there are no shapes). Texture and layer are left to the caller.
+  DrawCommand Prepare(const ShapeBatchUpdate &update);
+  void Cleanup();
+
+  // Size of the instance storage, which grows with the shape count
+  [[nodiscard]] size_t GetBufferBytes() const;
+
+private:
+  void Reallocate(size_t capacity);
+  void Upload(const ShapeBatchUpdate &update);
+
+  size_t m_gpuCapacity = 0; // Instances each column sub-range can hold
+
+  ProgramRef m_program;
+  BufferRef m_quad;
+  GLuint m_VAO = 0;
+  GLuint m_instanceVBO = 0;
+};
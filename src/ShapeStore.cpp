@@ -0,0 +1,294 @@
+#include "ShapeStore.h"
+#include <algorithm>
+#include <cmath>
+
+ShapeStore::ShapeStore(uint32_t initialCapacity) {
+  // Reserve up front so steady-state create/destroy never allocates
+  m_positions.reserve(initialCapacity);
+  m_sizes.reserve(initialCapacity);
+  m_rotations.reserve(initialCapacity);
+  m_colors.reserve(initialCapacity);
+  m_flags.reserve(initialCapacity);
+  m_uvRects.reserve(initialCapacity);
+  m_layers.reserve(initialCapacity);
+  m_params.reserve(initialCapacity);
+  m_denseToSlot.reserve(initialCapacity);
+  m_slotToDense.reserve(initialCapacity);
+  m_slotGeneration.reserve(initialCapacity);
+  m_freeSlots.reserve(initialCapacity);
+}
+
+ShapeHandle ShapeStore::Create(const glm::vec2 &position, const glm::vec2 &size,
+                               const glm::vec4 &color, uint32_t flags) {
+  uint32_t slot;
+  if (!m_freeSlots.empty()) {
+    slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+  } else {
+    if (m_slotToDense.size() >= MAX_SHAPES) {
+      return {}; // Slot table exhausted
+    }
+    slot = static_cast<uint32_t>(m_slotToDense.size());
+    m_slotToDense.push_back(INVALID_INDEX);
+    m_slotGeneration.push_back(1); // Generation 0 is reserved for "invalid"
+  }
+
+  auto denseIndex = static_cast<uint32_t>(m_positions.size());
+  m_positions.push_back(position);
+  m_sizes.push_back(size);
+  m_rotations.push_back(0.0f);
+  m_colors.push_back(color);
+  m_flags.push_back(flags);
+  m_uvRects.emplace_back(0.0f, 0.0f, 1.0f, 1.0f);
+  m_layers.push_back(0);
+  m_params.emplace_back();
+  m_denseToSlot.push_back(slot);
+  m_slotToDense[slot] = denseIndex;
+
+  MarkDirty(denseIndex);
+  return ShapeHandle::Make(slot, m_slotGeneration[slot]);
+}
+
+bool ShapeStore::Destroy(ShapeHandle handle) {
+  uint32_t denseIndex = DenseIndex(handle);
+  if (denseIndex == INVALID_INDEX) {
+    return false;
+  }
+
+  // Swap-remove: move the last shape into the hole to keep arrays packed
+  auto last = static_cast<uint32_t>(m_positions.size() - 1);
+  if (denseIndex != last) {
+    m_positions[denseIndex] = m_positions[last];
+    m_sizes[denseIndex] = m_sizes[last];
+    m_rotations[denseIndex] = m_rotations[last];
+    m_colors[denseIndex] = m_colors[last];
+    m_flags[denseIndex] = m_flags[last];
+    m_uvRects[denseIndex] = m_uvRects[last];
+    m_layers[denseIndex] = m_layers[last];
+    m_params[denseIndex] = m_params[last];
+    m_denseToSlot[denseIndex] = m_denseToSlot[last];
+    m_slotToDense[m_denseToSlot[denseIndex]] = denseIndex;
+    MarkDirty(denseIndex);
+  }
+  m_positions.pop_back();
+  m_sizes.pop_back();
+  m_rotations.pop_back();
+  m_colors.pop_back();
+  m_flags.pop_back();
+  m_uvRects.pop_back();
+  m_layers.pop_back();
+  m_params.pop_back();
+  m_denseToSlot.pop_back();
+
+  uint32_t slot = handle.Index();
+  m_slotToDense[slot] = INVALID_INDEX;
+  uint32_t nextGeneration =
+      (m_slotGeneration[slot] + 1) & ShapeHandle::GENERATION_MASK;
+  m_slotGeneration[slot] = nextGeneration == 0 ? 1 : nextGeneration;
+  m_freeSlots.push_back(slot);
+  m_revision++; // Removing the last shape marks nothing dirty
+  return true;
+}
+
+void ShapeStore::Clear() {
+  // Invalidate every outstanding handle; slots are kept for reuse
+  for (uint32_t slot : m_denseToSlot) {
+    m_slotToDense[slot] = INVALID_INDEX;
+    uint32_t nextGeneration =
+        (m_slotGeneration[slot] + 1) & ShapeHandle::GENERATION_MASK;
+    m_slotGeneration[slot] = nextGeneration == 0 ? 1 : nextGeneration;
+    m_freeSlots.push_back(slot);
+  }
+  m_positions.clear();
+  m_sizes.clear();
+  m_rotations.clear();
+  m_colors.clear();
+  m_flags.clear();
+  m_uvRects.clear();
+  m_layers.clear();
+  m_params.clear();
+  m_denseToSlot.clear();
+  ClearDirtyRange();
+  m_revision++;
+}
+
+bool ShapeStore::IsAlive(ShapeHandle handle) const {
+  return DenseIndex(handle) != INVALID_INDEX;
+}
+
+void ShapeStore::SetPosition(ShapeHandle handle, const glm::vec2 &position) {
+  uint32_t i = DenseIndex(handle);
+  if (i != INVALID_INDEX && m_positions[i] != position) {
+    m_positions[i] = position;
+    MarkDirty(i);
+  }
+}
+
+void ShapeStore::SetSize(ShapeHandle handle, const glm::vec2 &size) {
+  uint32_t i = DenseIndex(handle);
+  if (i != INVALID_INDEX && m_sizes[i] != size) {
+    m_sizes[i] = size;
+    MarkDirty(i);
+  }
+}
+
+void ShapeStore::SetRotation(ShapeHandle handle, float rotation) {
+  uint32_t i = DenseIndex(handle);
+  if (i != INVALID_INDEX && m_rotations[i] != rotation) {
+    m_rotations[i] = rotation;
+    MarkDirty(i);
+  }
+}
+
+void ShapeStore::SetPlacement(ShapeHandle handle, const glm::vec2 &position,
+                              const glm::vec2 &size, float rotation) {
+  uint32_t i = DenseIndex(handle);
+  if (i != INVALID_INDEX &&
+      (m_positions[i] != position || m_sizes[i] != size ||
+       m_rotations[i] != rotation)) {
+    m_positions[i] = position;
+    m_sizes[i] = size;
+    m_rotations[i] = rotation;
+    MarkDirty(i);
+  }
+}
+
+void ShapeStore::SetColor(ShapeHandle handle, const glm::vec4 &color) {
+  uint32_t i = DenseIndex(handle);
+  if (i != INVALID_INDEX && m_colors[i] != color) {
+    m_colors[i] = color;
+    MarkDirty(i);
+  }
+}
+
+void ShapeStore::SetFlags(ShapeHandle handle, uint32_t flags) {
+  uint32_t i = DenseIndex(handle);
+  if (i != INVALID_INDEX && m_flags[i] != flags) {
+    m_flags[i] = flags;
+    MarkDirty(i);
+  }
+}
+
+void ShapeStore::SetSprite(ShapeHandle handle, const glm::vec4 &uvRect,
+                           uint32_t layer) {
+  uint32_t i = DenseIndex(handle);
+  if (i != INVALID_INDEX &&
+      (m_uvRects[i] != uvRect || m_layers[i] != layer ||
+       (m_flags[i] & ShapeFlags::Textured) == 0)) {
+    m_uvRects[i] = uvRect;
+    m_layers[i] = layer;
+    m_flags[i] |= ShapeFlags::Textured;
+    MarkDirty(i);
+  }
+}
+
+void ShapeStore::SetKind(ShapeHandle handle, ShapeKind kind,
+                         const ShapeParams &params) {
+  uint32_t i = DenseIndex(handle);
+  if (i == INVALID_INDEX) {
+    return;
+  }
+  uint32_t flags = (m_flags[i] & ~ShapeFlags::KindMask) |
+                   (static_cast<uint32_t>(kind) << ShapeFlags::KindShift);
+  if (m_flags[i] != flags || m_params[i] != params) {
+    m_flags[i] = flags;
+    m_params[i] = params;
+    MarkDirty(i);
+  }
+}
+
+glm::vec2 ShapeStore::GetPosition(ShapeHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_positions[i] : glm::vec2(0.0f);
+}
+
+glm::vec2 ShapeStore::GetSize(ShapeHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_sizes[i] : glm::vec2(0.0f);
+}
+
+float ShapeStore::GetRotation(ShapeHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_rotations[i] : 0.0f;
+}
+
+glm::vec4 ShapeStore::GetColor(ShapeHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_colors[i] : glm::vec4(0.0f);
+}
+
+uint32_t ShapeStore::GetFlags(ShapeHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_flags[i] : 0u;
+}
+
+glm::vec4 ShapeStore::GetUVRect(ShapeHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_uvRects[i] : glm::vec4(0.0f);
+}
+
+uint32_t ShapeStore::GetLayer(ShapeHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_layers[i] : 0u;
+}
+
+ShapeKind ShapeStore::GetKind(ShapeHandle handle) const {
+  return static_cast<ShapeKind>((GetFlags(handle) & ShapeFlags::KindMask) >>
+                                ShapeFlags::KindShift);
+}
+
+ShapeParams ShapeStore::GetParams(ShapeHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_params[i] : ShapeParams();
+}
+
+ShapeHandle ShapeStore::HitTest(const glm::vec2 &point,
+                                uint32_t requiredFlags) const {
+  requiredFlags |= ShapeFlags::Visible;
+  // Walk back to front so the topmost shape wins
+  for (size_t i = m_positions.size(); i-- > 0;) {
+    if ((m_flags[i] & requiredFlags) != requiredFlags) {
+      continue;
+    }
+    glm::vec2 p = point - m_positions[i];
+    if (m_rotations[i] != 0.0f) {
+      // Into the shape's unrotated frame
+      const float c = std::cos(m_rotations[i]);
+      const float s = std::sin(m_rotations[i]);
+      p = {c * p.x + s * p.y, c * p.y - s * p.x};
+    }
+    const glm::vec2 &s = m_sizes[i];
+    if (p.x >= 0.0f && p.x <= s.x && p.y >= 0.0f && p.y <= s.y) {
+      return HandleAt(static_cast<uint32_t>(i));
+    }
+  }
+  return {};
+}
+
+ShapeHandle ShapeStore::HandleAt(uint32_t denseIndex) const {
+  if (denseIndex >= m_denseToSlot.size()) {
+    return {};
+  }
+  uint32_t slot = m_denseToSlot[denseIndex];
+  return ShapeHandle::Make(slot, m_slotGeneration[slot]);
+}
+
+uint32_t ShapeStore::DenseIndex(ShapeHandle handle) const {
+  uint32_t slot = handle.Index();
+  if (!handle.IsValid() || slot >= m_slotToDense.size() ||
+      m_slotGeneration[slot] != handle.Generation()) {
+    return INVALID_INDEX;
+  }
+  return m_slotToDense[slot];
+}
+
+void ShapeStore::MarkDirty(size_t denseIndex) {
+  m_revision++;
+  if (m_dirtyBegin == m_dirtyEnd) {
+    m_dirtyBegin = denseIndex;
+    m_dirtyEnd = denseIndex + 1;
+  } else {
+    m_dirtyBegin = std::min(m_dirtyBegin, denseIndex);
+    m_dirtyEnd = std::max(m_dirtyEnd, denseIndex + 1);
+  }
+}
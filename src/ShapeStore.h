@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdint>
+#include <glm.hpp>
+#include <vector>
+
+// 32-bit generational handle: the low bits index a slot, the high bits hold
+// the slot's generation so handles to destroyed shapes are detected instead
+// of silently aliasing a newer shape. A value of 0 is never valid.
+struct ShapeHandle {
+  static constexpr uint32_t INDEX_BITS = 20;
+  static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+  static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+  uint32_t value = 0;
+
+  [[nodiscard]] bool IsValid() const { return value != 0; }
+  [[nodiscard]] uint32_t Index() const { return value & INDEX_MASK; }
+  [[nodiscard]] uint32_t Generation() const { return value >> INDEX_BITS; }
+
+  static ShapeHandle Make(uint32_t index, uint32_t generation) {
+    return ShapeHandle{(generation << INDEX_BITS) | (index & INDEX_MASK)};
+  }
+
+  bool operator==(const ShapeHandle &other) const {
+    return value == other.value;
+  }
+  bool operator!=(const ShapeHandle &other) const {
+    return value != other.value;
+  }
+};
+
+namespace ShapeFlags {
+constexpr uint32_t Visible = 1u << 0;
+constexpr uint32_t Draggable = 1u << 1;
+constexpr uint32_t Textured = 1u << 2; // Color is modulated by the atlas
+constexpr uint32_t Default = Visible | Draggable;
+// Bits 8-15 hold the ShapeKind, so the shader gets it with the flags
+constexpr uint32_t KindShift = 8;
+constexpr uint32_t KindMask = 0xFFu << KindShift;
+} // namespace ShapeFlags
+
+// Primitive drawn inside a shape's box. Everything but Rect is evaluated as
+// a signed distance field in the batch shader and anti-aliased
+// analytically, so every kind still shares the one instanced draw.
+enum class ShapeKind : uint32_t {
+  Rect,        // The plain box
+  Circle,      // Largest circle centered in the box
+  RoundedRect, // params.a.x: corner radius
+  Ring,        // Circle outline; params.a.x: thickness
+  Line,        // Capsule; params.a: start.xy, end.xy; params.b.x: radius
+  Triangle     // params.a: p0.xy, p1.xy; params.b: p2.xy
+};
+
+// Per-kind parameters. Points are in box units, (0, 0) at the shape's
+// position and (1, 1) at the far corner, and a Line's radius is a share of
+// the box's shorter side, so both follow the shape when it is resized.
+struct ShapeParams {
+  glm::vec4 a = glm::vec4(0.0f);
+  glm::vec4 b = glm::vec4(0.0f);
+
+  bool operator==(const ShapeParams &other) const {
+    return a == other.a && b == other.b;
+  }
+  bool operator!=(const ShapeParams &other) const { return !(*this == other); }
+};
+
+// Structure-of-arrays storage for every shape in the scene. Live shapes are
+// kept densely packed (destroy swaps the last shape into the hole), so the
+// renderer and hit-testing walk plain contiguous arrays. Handles go through
+// a slot table that maps to the current dense index.
+class ShapeStore {
+public:
+  static constexpr uint32_t MAX_SHAPES = ShapeHandle::INDEX_MASK;
+
+  explicit ShapeStore(uint32_t initialCapacity = 16384);
+
+  ShapeHandle Create(const glm::vec2 &position, const glm::vec2 &size,
+                     const glm::vec4 &color,
+                     uint32_t flags = ShapeFlags::Default);
+  bool Destroy(ShapeHandle handle);
+  void Clear();
+
+  [[nodiscard]] bool IsAlive(ShapeHandle handle) const;
+  [[nodiscard]] size_t Size() const { return m_positions.size(); }
+  [[nodiscard]] size_t Capacity() const { return m_positions.capacity(); }
+
+  // Per-shape accessors; setters on a dead handle are ignored
+  void SetPosition(ShapeHandle handle, const glm::vec2 &position);
+  void SetSize(ShapeHandle handle, const glm::vec2 &size);
+  // Radians, clockwise on screen (Y points down), about the shape's position
+  void SetRotation(ShapeHandle handle, float rotation);
+  // Position, size and rotation at once, as a TransformHierarchy writes them
+  void SetPlacement(ShapeHandle handle, const glm::vec2 &position,
+                    const glm::vec2 &size, float rotation);
+  void SetColor(ShapeHandle handle, const glm::vec4 &color);
+  void SetFlags(ShapeHandle handle, uint32_t flags);
+  // Shows a region of the texture atlas (uvRect: u0, v0, u1, v1) and sets
+  // ShapeFlags::Textured
+  void SetSprite(ShapeHandle handle, const glm::vec4 &uvRect, uint32_t layer);
+  void SetKind(ShapeHandle handle, ShapeKind kind,
+               const ShapeParams &params = {});
+  [[nodiscard]] glm::vec2 GetPosition(ShapeHandle handle) const;
+  [[nodiscard]] glm::vec2 GetSize(ShapeHandle handle) const;
+  [[nodiscard]] float GetRotation(ShapeHandle handle) const;
+  [[nodiscard]] glm::vec4 GetColor(ShapeHandle handle) const;
+  [[nodiscard]] uint32_t GetFlags(ShapeHandle handle) const;
+  [[nodiscard]] glm::vec4 GetUVRect(ShapeHandle handle) const;
+  [[nodiscard]] uint32_t GetLayer(ShapeHandle handle) const;
+  [[nodiscard]] ShapeKind GetKind(ShapeHandle handle) const;
+  [[nodiscard]] ShapeParams GetParams(ShapeHandle handle) const;
+
+  // Topmost (last drawn) visible shape whose box contains the point, or an
+  // invalid handle. Only shapes with all of requiredFlags set are considered.
+  [[nodiscard]] ShapeHandle HitTest(const glm::vec2 &point,
+                                    uint32_t requiredFlags = 0) const;
+
+  // Dense arrays, index-aligned, in draw order
+  [[nodiscard]] const std::vector<glm::vec2> &Positions() const {
+    return m_positions;
+  }
+  [[nodiscard]] const std::vector<glm::vec2> &Sizes() const { return m_sizes; }
+  [[nodiscard]] const std::vector<float> &Rotations() const {
+    return m_rotations;
+  }
+  [[nodiscard]] const std::vector<glm::vec4> &Colors() const {
+    return m_colors;
+  }
+  [[nodiscard]] const std::vector<uint32_t> &Flags() const { return m_flags; }
+  [[nodiscard]] const std::vector<glm::vec4> &UVRects() const {
+    return m_uvRects;
+  }
+  [[nodiscard]] const std::vector<uint32_t> &Layers() const {
+    return m_layers;
+  }
+  [[nodiscard]] const std::vector<ShapeParams> &Params() const {
+    return m_params;
+  }
+  [[nodiscard]] ShapeHandle HandleAt(uint32_t denseIndex) const;
+
+  // Half-open dense range modified since the last ClearDirtyRange()
+  [[nodiscard]] bool HasDirtyRange() const { return m_dirtyBegin < m_dirtyEnd; }
+  [[nodiscard]] size_t DirtyBegin() const { return m_dirtyBegin; }
+  [[nodiscard]] size_t DirtyEnd() const { return m_dirtyEnd; }
+  void ClearDirtyRange() { m_dirtyBegin = m_dirtyEnd = 0; }
+  // Bumped by every change to the store's contents; setters that don't
+  // change a value don't count
+  [[nodiscard]] uint64_t Revision() const { return m_revision; }
+
+private:
+  static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFFu;
+
+  // Dense index for a live handle, INVALID_INDEX otherwise
+  [[nodiscard]] uint32_t DenseIndex(ShapeHandle handle) const;
+  void MarkDirty(size_t denseIndex);
+
+  // Dense SoA columns
+  std::vector<glm::vec2> m_positions;
+  std::vector<glm::vec2> m_sizes;
+  std::vector<float> m_rotations;
+  std::vector<glm::vec4> m_colors;
+  std::vector<uint32_t> m_flags;
+  std::vector<glm::vec4> m_uvRects;
+  std::vector<uint32_t> m_layers; // Atlas layer
+  std::vector<ShapeParams> m_params;
+  std::vector<uint32_t> m_denseToSlot;
+
+  // Slot table, indexed by ShapeHandle::Index()
+  std::vector<uint32_t> m_slotToDense;
+  std::vector<uint32_t> m_slotGeneration;
+  std::vector<uint32_t> m_freeSlots;
+
+  size_t m_dirtyBegin = 0;
+  size_t m_dirtyEnd = 0;
+  uint64_t m_revision = 0;
+};
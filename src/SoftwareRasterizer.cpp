@@ -0,0 +1,988 @@
+#include "SoftwareRasterizer.h"
+#include "FramePacket.h"
+#include "GLState.h"
+#include "Lanes.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+// Lanes of a point relative to a scalar one
+struct LanePoint {
+  Lanes x, y;
+};
+
+inline LanePoint Offset(const LanePoint &p, glm::vec2 origin) {
+  return {p.x - Lanes::Set(origin.x), p.y - Lanes::Set(origin.y)};
+}
+
+// The batch shader's distance functions, several pixels at a time. Same
+// formulas, so both backends put the edges in the same place.
+Lanes SdRoundedBox(const LanePoint &p, glm::vec2 halfSize, float radius) {
+  radius = std::min(radius, std::min(halfSize.x, halfSize.y));
+  const Lanes qx = Abs(p.x) - Lanes::Set(halfSize.x - radius);
+  const Lanes qy = Abs(p.y) - Lanes::Set(halfSize.y - radius);
+  const Lanes zero = Lanes::Set(0.0f);
+  return Length(Max(qx, zero), Max(qy, zero)) + Min(Max(qx, qy), zero) -
+         Lanes::Set(radius);
+}
+
+Lanes SdSegment(const LanePoint &p, glm::vec2 a, glm::vec2 b) {
+  const LanePoint pa = Offset(p, a);
+  const glm::vec2 ba = b - a;
+  const float invLength2 = 1.0f / std::max(glm::dot(ba, ba), 1e-8f);
+  const Lanes h = Clamp01((pa.x * Lanes::Set(ba.x) + pa.y * Lanes::Set(ba.y)) *
+                          Lanes::Set(invLength2));
+  return Length(pa.x - Lanes::Set(ba.x) * h, pa.y - Lanes::Set(ba.y) * h);
+}
+
+Lanes SdTriangle(const LanePoint &p, glm::vec2 p0, glm::vec2 p1,
+                 glm::vec2 p2) {
+  const glm::vec2 edges[3] = {p1 - p0, p2 - p1, p0 - p2};
+  const glm::vec2 corners[3] = {p0, p1, p2};
+  const float s = (edges[0].x * edges[2].y - edges[0].y * edges[2].x) < 0.0f
+                      ? -1.0f
+                      : 1.0f;
+  Lanes distance2 = Lanes::Set(INFINITY);
+  Lanes side = Lanes::Set(INFINITY);
+  for (int i = 0; i < 3; ++i) {
+    const glm::vec2 e = edges[i];
+    const LanePoint v = Offset(p, corners[i]);
+    const Lanes h =
+        Clamp01((v.x * Lanes::Set(e.x) + v.y * Lanes::Set(e.y)) *
+                Lanes::Set(1.0f / std::max(glm::dot(e, e), 1e-8f)));
+    const Lanes qx = v.x - Lanes::Set(e.x) * h;
+    const Lanes qy = v.y - Lanes::Set(e.y) * h;
+    distance2 = Min(distance2, qx * qx + qy * qy);
+    side = Min(side, Lanes::Set(s) * (v.x * Lanes::Set(e.y) -
+                                      v.y * Lanes::Set(e.x)));
+  }
+  return Lanes::Set(0.0f) - Sqrt(distance2) * Sign(side);
+}
+
+// Source-over into the tile, the blend state the GL passes use:
+// SRC_ALPHA, ONE_MINUS_SRC_ALPHA for color and ONE, ONE_MINUS_SRC_ALPHA for
+// alpha. Lanes with zero alpha are left as they were.
+template <typename Tile>
+void Blend(Tile &tile, int offset, Lanes r, Lanes g, Lanes b, Lanes alpha) {
+  const Lanes keep = Lanes::Set(1.0f) - alpha;
+  (r * alpha + Lanes::Load(tile.r + offset) * keep).Store(tile.r + offset);
+  (g * alpha + Lanes::Load(tile.g + offset) * keep).Store(tile.g + offset);
+  (b * alpha + Lanes::Load(tile.b + offset) * keep).Store(tile.b + offset);
+  (alpha + Lanes::Load(tile.a + offset) * keep).Store(tile.a + offset);
+}
+
+// BlendMode::Additive: SRC_ALPHA, ONE for color, alpha as source-over
+template <typename Tile>
+void BlendAdditive(Tile &tile, int offset, Lanes r, Lanes g, Lanes b,
+                   Lanes alpha) {
+  (r * alpha + Lanes::Load(tile.r + offset)).Store(tile.r + offset);
+  (g * alpha + Lanes::Load(tile.g + offset)).Store(tile.g + offset);
+  (b * alpha + Lanes::Load(tile.b + offset)).Store(tile.b + offset);
+  (alpha + Lanes::Load(tile.a + offset) * (Lanes::Set(1.0f) - alpha))
+      .Store(tile.a + offset);
+}
+
+// Calls fn(offset, pixel centers, inside) for every lane group covering the
+// part of the half-open rect [x0, x1) x [y0, y1) in a tile. Groups start at
+// multiples of the lane count, so loads stay aligned; `inside` masks the
+// lanes that fall outside [x0, x1).
+template <typename Fn>
+void ForEachLaneGroup(int tileX, int tileY, int x0, int y0, int x1, int y1,
+                      Fn &&fn) {
+  constexpr int tileSize = SoftwareRasterizer::TILE_SIZE;
+  const int start = (x0 - tileX) & ~(Lanes::WIDTH - 1);
+  const Lanes left = Lanes::Set(static_cast<float>(x0));
+  const Lanes right = Lanes::Set(static_cast<float>(x1));
+  for (int y = y0; y < y1; ++y) {
+    const int row = (y - tileY) * tileSize;
+    const Lanes centerY = Lanes::Set(static_cast<float>(y) + 0.5f);
+    for (int x = start; tileX + x < x1; x += Lanes::WIDTH) {
+      const Lanes centerX = Lanes::Ramp(static_cast<float>(tileX + x) + 0.5f);
+      const Lanes inside =
+          And(GreaterEqual(centerX, left), Less(centerX, right));
+      fn(row + x, LanePoint{centerX, centerY}, inside);
+    }
+  }
+}
+
+// Bilinear, clamped to the edge, like the GL samplers; RGBA8 rows top first
+glm::vec4 SampleBilinear(const uint8_t *rgba, int width, int height,
+                         glm::vec2 uv) {
+  const float x = uv.x * static_cast<float>(width) - 0.5f;
+  const float y = uv.y * static_cast<float>(height) - 0.5f;
+  const float fx = std::floor(x);
+  const float fy = std::floor(y);
+  const float tx = x - fx;
+  const float ty = y - fy;
+  const int x0 = std::clamp(static_cast<int>(fx), 0, width - 1);
+  const int y0 = std::clamp(static_cast<int>(fy), 0, height - 1);
+  const int x1 = std::min(x0 + 1, width - 1);
+  const int y1 = std::min(y0 + 1, height - 1);
+  const auto texel = [&](int tx_, int ty_) {
+    const uint8_t *p = rgba + (static_cast<size_t>(ty_) * width + tx_) * 4;
+    return glm::vec4(p[0], p[1], p[2], p[3]);
+  };
+  const glm::vec4 top = glm::mix(texel(x0, y0), texel(x1, y0), tx);
+  const glm::vec4 bottom = glm::mix(texel(x0, y1), texel(x1, y1), tx);
+  return glm::mix(top, bottom, ty) * (1.0f / 255.0f);
+}
+
+glm::vec4 UnpackColor(ImU32 color) {
+  return glm::vec4(static_cast<float>((color >> IM_COL32_R_SHIFT) & 0xFF),
+                   static_cast<float>((color >> IM_COL32_G_SHIFT) & 0xFF),
+                   static_cast<float>((color >> IM_COL32_B_SHIFT) & 0xFF),
+                   static_cast<float>((color >> IM_COL32_A_SHIFT) & 0xFF)) *
+         (1.0f / 255.0f);
+}
+
+uint8_t ToByte(float value) {
+  return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+glm::ivec4 Intersect(const glm::ivec4 &a, const glm::ivec4 &b) {
+  return {std::max(a.x, b.x), std::max(a.y, b.y), std::min(a.z, b.z),
+          std::min(a.w, b.w)};
+}
+
+// Every pixel the box touches
+glm::ivec4 OuterBounds(glm::vec2 min, glm::vec2 max) {
+  return {static_cast<int>(std::floor(min.x)),
+          static_cast<int>(std::floor(min.y)),
+          static_cast<int>(std::ceil(max.x)),
+          static_cast<int>(std::ceil(max.y))};
+}
+
+// Pixels whose centers lie in [min, max), GL's rule for filled rects
+glm::ivec4 CenterBounds(glm::vec2 min, glm::vec2 max) {
+  return {static_cast<int>(std::ceil(min.x - 0.5f)),
+          static_cast<int>(std::ceil(min.y - 0.5f)),
+          static_cast<int>(std::ceil(max.x - 0.5f)),
+          static_cast<int>(std::ceil(max.y - 0.5f))};
+}
+
+// Edge function of a -> b, as A * x + B * y + C; positive on the inside of
+// a triangle with positive area. Top-left edges own the pixels they pass
+// through, so shared edges are drawn exactly once.
+struct Edge {
+  float a, b, c;
+  bool topLeft;
+};
+
+Edge MakeEdge(glm::vec2 from, glm::vec2 to) {
+  Edge edge;
+  edge.a = -(to.y - from.y);
+  edge.b = to.x - from.x;
+  edge.c = (to.y - from.y) * from.x - (to.x - from.x) * from.y;
+  edge.topLeft = (to.y == from.y && to.x > from.x) || to.y < from.y;
+  return edge;
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+} // namespace
+
+SoftwareRasterizer::~SoftwareRasterizer() { Cleanup(); }
+
+void SoftwareRasterizer::Initialize(int threadCount) {
+  Cleanup();
+  if (threadCount <= 0) {
+    threadCount =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  m_stop = false;
+  m_generation = 0; // Workers start out having seen generation 0
+  for (int i = 0; i < threadCount; ++i) {
+    m_tileBuffers.push_back(std::make_unique<TileBuffer>());
+  }
+  // The calling thread is the first shader
+  for (int i = 1; i < threadCount; ++i) {
+    m_workers.emplace_back(&SoftwareRasterizer::WorkerMain, this, i);
+  }
+  m_stats.threads = threadCount;
+  m_stats.lanes = Lanes::WIDTH;
+}
+
+void SoftwareRasterizer::Cleanup() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (std::thread &worker : m_workers) {
+    worker.join();
+  }
+  m_workers.clear();
+  m_tileBuffers.clear();
+}
+
+void SoftwareRasterizer::SetUiTexture(const uint8_t *rgba, int width,
+                                      int height) {
+  m_uiTexture.assign(rgba, rgba + static_cast<size_t>(width) * height * 4);
+  m_uiTextureWidth = width;
+  m_uiTextureHeight = height;
+}
+
+void SoftwareRasterizer::Render(FramePacket &packet) {
+  SyncShapes(packet);
+  SyncAtlas(packet);
+  Resize(static_cast<int>(packet.globals.viewportSize.x),
+         static_cast<int>(packet.globals.viewportSize.y));
+  if (m_width <= 0 || m_height <= 0 || m_tileBuffers.empty()) {
+    return;
+  }
+
+  // Window units to pixels (top-down), read back from the ortho projection
+  // so the mapping can't drift from the GL path's
+  const glm::mat4 &projection = packet.globals.projection;
+  const glm::vec2 viewport(static_cast<float>(m_width),
+                           static_cast<float>(m_height));
+  m_windowScale = {projection[0][0] * 0.5f * viewport.x,
+                   -projection[1][1] * 0.5f * viewport.y};
+  m_windowOffset = {(projection[3][0] + 1.0f) * 0.5f * viewport.x,
+                    (1.0f - projection[3][1]) * 0.5f * viewport.y};
+  m_background = {packet.backgroundColor[0], packet.backgroundColor[1],
+                  packet.backgroundColor[2], packet.backgroundColor[3]};
+
+  const auto binStart = std::chrono::steady_clock::now();
+  BuildPrimitives(packet);
+  BinPrimitives();
+  m_stats.binMs = MillisecondsSince(binStart);
+
+  const auto shadeStart = std::chrono::steady_clock::now();
+  m_nextTile.store(0);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    m_busyWorkers = static_cast<int>(m_workers.size());
+  }
+  m_wake.notify_all();
+  ShadeTiles(*m_tileBuffers[0]);
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+  }
+  m_stats.shadeMs = MillisecondsSince(shadeStart);
+}
+
+void SoftwareRasterizer::SyncShapes(const FramePacket &packet) {
+  const ShapeBatchUpdate &update = packet.shapes;
+  m_positions.resize(update.count);
+  m_sizes.resize(update.count);
+  m_rotations.resize(update.count);
+  m_colors.resize(update.count);
+  m_flags.resize(update.count);
+  m_uvRects.resize(update.count);
+  m_layers.resize(update.count);
+  m_params.resize(update.count);
+
+  const size_t end = std::min(update.End(), update.count);
+  for (size_t i = update.begin; i < end; ++i) {
+    const size_t j = i - update.begin;
+    m_positions[i] = update.positions[j];
+    m_sizes[i] = update.sizes[j];
+    m_rotations[i] = update.rotations[j];
+    m_colors[i] = update.colors[j];
+    m_flags[i] = update.flags[j];
+    m_uvRects[i] = update.uvRects[j];
+    m_layers[i] = update.layers[j];
+    m_params[i] = update.params[j];
+  }
+}
+
+void SoftwareRasterizer::SyncAtlas(const FramePacket &packet) {
+  const AtlasUpdate &update = packet.atlas;
+  constexpr size_t layerBytes =
+      static_cast<size_t>(TextureAtlas::PAGE_SIZE) * TextureAtlas::PAGE_SIZE *
+      4;
+  while (static_cast<int>(m_atlasLayers.size()) < update.layerCount) {
+    m_atlasLayers.emplace_back(layerBytes, 0);
+  }
+  for (const AtlasUpload &upload : update.uploads) {
+    std::vector<uint8_t> &layer = m_atlasLayers[upload.layer];
+    for (int row = 0; row < upload.height; ++row) {
+      std::memcpy(layer.data() +
+                      (static_cast<size_t>(upload.y + row) *
+                           TextureAtlas::PAGE_SIZE +
+                       upload.x) * 4,
+                  upload.pixels.data() +
+                      static_cast<size_t>(row) * upload.width * 4,
+                  static_cast<size_t>(upload.width) * 4);
+    }
+  }
+}
+
+void SoftwareRasterizer::Resize(int width, int height) {
+  if (width == m_width && height == m_height) {
+    return;
+  }
+  m_width = std::max(width, 0);
+  m_height = std::max(height, 0);
+  m_tilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+  m_tilesY = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+  m_bins.resize(static_cast<size_t>(m_tilesX) * m_tilesY);
+  m_pixels.assign(static_cast<size_t>(m_width) * m_height * 4, 0);
+}
+
+void SoftwareRasterizer::AddPrimitive(PrimitiveType type, uint32_t index,
+                                      glm::ivec4 bounds) {
+  bounds = Intersect(bounds, {0, 0, m_width, m_height});
+  if (bounds.z <= bounds.x || bounds.w <= bounds.y) {
+    return;
+  }
+  m_primitives.push_back({type, index, bounds.x, bounds.y, bounds.z,
+                          bounds.w});
+}
+
+// Same order as the GL passes: the scene by layer, then the UI on top
+void SoftwareRasterizer::BuildPrimitives(FramePacket &packet) {
+  m_primitives.clear();
+  m_segments.clear();
+  m_triangles.clear();
+  m_glyphs.clear();
+  const auto toPixels = [this](glm::vec2 p) {
+    return p * m_windowScale + m_windowOffset;
+  };
+
+  const float pixelsPerUnit =
+      0.5f * (std::fabs(m_windowScale.x) + std::fabs(m_windowScale.y));
+  const PolylineBatch &polylines = packet.polylines;
+  const ParticleBatch &particles = packet.particles;
+  const TextBatch &text = packet.text;
+  // In layer order, as the RenderQueue sorts them: the ones below the
+  // shapes' layer first, the rest after the shapes. Within a layer,
+  // particles come first, then polylines, then text, in submission order.
+  m_layeredDraws.clear();
+  for (size_t i = 0; i < particles.draws.size(); ++i) {
+    m_layeredDraws.push_back({particles.draws[i].layer,
+                              LayeredDraw::Kind::Particles,
+                              static_cast<uint32_t>(i)});
+  }
+  for (size_t i = 0; i < polylines.draws.size(); ++i) {
+    m_layeredDraws.push_back({polylines.draws[i].layer,
+                              LayeredDraw::Kind::Polyline,
+                              static_cast<uint32_t>(i)});
+  }
+  if (!text.glyphs.empty()) {
+    m_layeredDraws.push_back({DrawLayer::Text, LayeredDraw::Kind::Text, 0});
+  }
+  std::stable_sort(m_layeredDraws.begin(), m_layeredDraws.end(),
+                   [](const LayeredDraw &a, const LayeredDraw &b) {
+                     return a.layer < b.layer;
+                   });
+  // Particles are zero-length segments: the capsule becomes the disc the
+  // GL shader draws
+  const auto addParticles = [&](const ParticleDraw &draw) {
+    for (uint32_t p = draw.first; p < draw.first + draw.count; ++p) {
+      const float life = particles.life[p];
+      Segment segment;
+      segment.from = toPixels({particles.x[p], particles.y[p]});
+      segment.to = segment.from;
+      segment.halfWidth =
+          (draw.startSize + (draw.endSize - draw.startSize) * life) * 0.5f *
+          pixelsPerUnit;
+      segment.color =
+          draw.startColor + (draw.endColor - draw.startColor) * life;
+      segment.additive = draw.blend == BlendMode::Additive;
+      const glm::vec2 extent(segment.halfWidth + 1.0f);
+      m_segments.push_back(segment);
+      AddPrimitive(PrimitiveType::Segment,
+                   static_cast<uint32_t>(m_segments.size() - 1),
+                   OuterBounds(segment.from - extent, segment.from + extent));
+    }
+  };
+  // Every glyph of the batch, as the one instanced draw
+  const auto addText = [&]() {
+    for (const GlyphInstance &instance : text.glyphs) {
+      if (instance.layer >= static_cast<float>(m_atlasLayers.size())) {
+        continue;
+      }
+      Glyph glyph;
+      glyph.from = toPixels({instance.rect.x, instance.rect.y});
+      glyph.to = toPixels({instance.rect.z, instance.rect.w});
+      glyph.uvRect = instance.uvRect;
+      glyph.layer = static_cast<uint32_t>(instance.layer);
+      glyph.color = instance.color;
+      glyph.sharpness = instance.distanceScale * pixelsPerUnit;
+      m_glyphs.push_back(glyph);
+      AddPrimitive(PrimitiveType::Glyph,
+                   static_cast<uint32_t>(m_glyphs.size() - 1),
+                   CenterBounds(glm::min(glyph.from, glyph.to),
+                                glm::max(glyph.from, glyph.to)));
+    }
+  };
+  const auto addLayered = [&](bool belowShapes) {
+    for (const LayeredDraw &layered : m_layeredDraws) {
+      if ((layered.layer < DrawLayer::Shapes) != belowShapes) {
+        continue;
+      }
+      if (layered.kind == LayeredDraw::Kind::Particles) {
+        addParticles(particles.draws[layered.index]);
+        continue;
+      }
+      if (layered.kind == LayeredDraw::Kind::Text) {
+        addText();
+        continue;
+      }
+      const PolylineDraw &draw = polylines.draws[layered.index];
+      const glm::vec2 clipA = toPixels({draw.clipRect.x, draw.clipRect.y});
+      const glm::vec2 clipB = toPixels({draw.clipRect.z, draw.clipRect.w});
+      // The GL shader keeps pixel centers in the clip rect, edges included
+      const glm::vec2 clipMin = glm::min(clipA, clipB);
+      const glm::vec2 clipMax = glm::max(clipA, clipB);
+      const glm::ivec4 clip = {
+          static_cast<int>(std::ceil(clipMin.x - 0.5f)),
+          static_cast<int>(std::ceil(clipMin.y - 0.5f)),
+          static_cast<int>(std::floor(clipMax.x - 0.5f)) + 1,
+          static_cast<int>(std::floor(clipMax.y - 0.5f)) + 1};
+      const float halfWidth = draw.thickness * 0.5f * pixelsPerUnit;
+      for (uint32_t p = 1; p < draw.pointCount; ++p) {
+        Segment segment;
+        segment.from = toPixels(polylines.points[draw.firstPoint + p - 1]);
+        segment.to = toPixels(polylines.points[draw.firstPoint + p]);
+        segment.halfWidth = halfWidth;
+        segment.color = draw.color;
+        const glm::vec2 extent(halfWidth + 1.0f);
+        const glm::ivec4 bounds =
+            OuterBounds(glm::min(segment.from, segment.to) - extent,
+                        glm::max(segment.from, segment.to) + extent);
+        m_segments.push_back(segment);
+        AddPrimitive(PrimitiveType::Segment,
+                     static_cast<uint32_t>(m_segments.size() - 1),
+                     Intersect(bounds, clip));
+      }
+    }
+  };
+  addLayered(true);
+
+  for (size_t i = 0; i < m_positions.size(); ++i) {
+    const uint32_t flags = m_flags[i];
+    if ((flags & ShapeFlags::Visible) == 0) {
+      continue;
+    }
+    const bool plain = (flags & ShapeFlags::KindMask) == 0;
+    const glm::vec2 pad(plain ? 0.0f : 1.0f);
+    if (m_rotations[i] != 0.0f) {
+      // Bounds of the turned quad; DrawShape tests plain rects per pixel
+      const float c = std::cos(m_rotations[i]);
+      const float s = std::sin(m_rotations[i]);
+      const glm::vec2 lo = -pad;
+      const glm::vec2 hi = m_sizes[i] + pad;
+      glm::vec2 min(std::numeric_limits<float>::max());
+      glm::vec2 max(std::numeric_limits<float>::lowest());
+      for (const glm::vec2 corner :
+           {lo, glm::vec2(hi.x, lo.y), hi, glm::vec2(lo.x, hi.y)}) {
+        const glm::vec2 turned(c * corner.x - s * corner.y,
+                               s * corner.x + c * corner.y);
+        const glm::vec2 p = toPixels(m_positions[i] + turned);
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+      }
+      AddPrimitive(PrimitiveType::Shape, static_cast<uint32_t>(i),
+                   OuterBounds(min, max));
+      continue;
+    }
+    const glm::vec2 a = toPixels(m_positions[i] - pad);
+    const glm::vec2 b = toPixels(m_positions[i] + m_sizes[i] + pad);
+    const glm::vec2 min = glm::min(a, b);
+    const glm::vec2 max = glm::max(a, b);
+    AddPrimitive(PrimitiveType::Shape, static_cast<uint32_t>(i),
+                 plain ? CenterBounds(min, max) : OuterBounds(min, max));
+  }
+  addLayered(false);
+
+  const ImDrawData *drawData = packet.ui.Get();
+  if (drawData == nullptr) {
+    return;
+  }
+  const ImVec2 clipOffset = drawData->DisplayPos;
+  const ImVec2 scale = drawData->FramebufferScale;
+  for (const ImDrawList *drawList : drawData->CmdLists) {
+    for (const ImDrawCmd &cmd : drawList->CmdBuffer) {
+      if (cmd.UserCallback != nullptr) {
+        continue; // GL callbacks have nothing to draw into here
+      }
+      // Truncated like the GL scissor box
+      const glm::ivec4 clip = {
+          static_cast<int>((cmd.ClipRect.x - clipOffset.x) * scale.x),
+          static_cast<int>((cmd.ClipRect.y - clipOffset.y) * scale.y),
+          static_cast<int>((cmd.ClipRect.z - clipOffset.x) * scale.x),
+          static_cast<int>((cmd.ClipRect.w - clipOffset.y) * scale.y)};
+      if (clip.z <= clip.x || clip.w <= clip.y) {
+        continue;
+      }
+      for (unsigned int e = 0; e + 3 <= cmd.ElemCount; e += 3) {
+        Triangle triangle;
+        for (int v = 0; v < 3; ++v) {
+          const ImDrawIdx index = drawList->IdxBuffer[cmd.IdxOffset + e + v];
+          const ImDrawVert &vertex = drawList->VtxBuffer[cmd.VtxOffset + index];
+          triangle.position[v] = {(vertex.pos.x - clipOffset.x) * scale.x,
+                                  (vertex.pos.y - clipOffset.y) * scale.y};
+          triangle.uv[v] = {vertex.uv.x, vertex.uv.y};
+          triangle.color[v] = UnpackColor(vertex.col);
+        }
+        const glm::vec2 *p = triangle.position;
+        const float area =
+            (p[1].x - p[0].x) * (p[2].y - p[0].y) -
+            (p[1].y - p[0].y) * (p[2].x - p[0].x);
+        if (area == 0.0f) {
+          continue;
+        }
+        if (area < 0.0f) { // Either winding; the edge functions want one
+          std::swap(triangle.position[1], triangle.position[2]);
+          std::swap(triangle.uv[1], triangle.uv[2]);
+          std::swap(triangle.color[1], triangle.color[2]);
+        }
+        const glm::ivec4 bounds =
+            OuterBounds(glm::min(glm::min(p[0], p[1]), p[2]),
+                        glm::max(glm::max(p[0], p[1]), p[2]));
+        m_triangles.push_back(triangle);
+        AddPrimitive(PrimitiveType::Triangle,
+                     static_cast<uint32_t>(m_triangles.size() - 1),
+                     Intersect(bounds, clip));
+      }
+    }
+  }
+}
+
+// Single-threaded and in draw order, so every bin lists its primitives in
+// the order they blend
+void SoftwareRasterizer::BinPrimitives() {
+  for (std::vector<uint32_t> &bin : m_bins) {
+    bin.clear();
+  }
+  size_t refs = 0;
+  for (size_t i = 0; i < m_primitives.size(); ++i) {
+    const Primitive &primitive = m_primitives[i];
+    const int tx0 = primitive.x0 / TILE_SIZE;
+    const int ty0 = primitive.y0 / TILE_SIZE;
+    const int tx1 = (primitive.x1 - 1) / TILE_SIZE;
+    const int ty1 = (primitive.y1 - 1) / TILE_SIZE;
+    for (int ty = ty0; ty <= ty1; ++ty) {
+      for (int tx = tx0; tx <= tx1; ++tx) {
+        m_bins[static_cast<size_t>(ty) * m_tilesX + tx].push_back(
+            static_cast<uint32_t>(i));
+      }
+    }
+    refs += static_cast<size_t>(tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+  }
+  m_stats.primitives = m_primitives.size();
+  m_stats.binnedRefs = refs;
+}
+
+void SoftwareRasterizer::WorkerMain(int worker) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+      if (m_stop) {
+        return;
+      }
+      seen = m_generation;
+    }
+    ShadeTiles(*m_tileBuffers[worker]);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_busyWorkers == 0) {
+        m_done.notify_one();
+      }
+    }
+  }
+}
+
+void SoftwareRasterizer::ShadeTiles(TileBuffer &tile) {
+  const int tileCount = m_tilesX * m_tilesY;
+  for (int index = m_nextTile.fetch_add(1); index < tileCount;
+       index = m_nextTile.fetch_add(1)) {
+    ShadeTile(index, tile);
+  }
+}
+
+void SoftwareRasterizer::ShadeTile(int tileIndex, TileBuffer &tile) {
+  const int tileX = (tileIndex % m_tilesX) * TILE_SIZE;
+  const int tileY = (tileIndex / m_tilesX) * TILE_SIZE;
+  const int width = std::min(TILE_SIZE, m_width - tileX);
+  const int height = std::min(TILE_SIZE, m_height - tileY);
+
+  constexpr int tilePixels = TILE_SIZE * TILE_SIZE;
+  std::fill(tile.r, tile.r + tilePixels, m_background.r);
+  std::fill(tile.g, tile.g + tilePixels, m_background.g);
+  std::fill(tile.b, tile.b + tilePixels, m_background.b);
+  std::fill(tile.a, tile.a + tilePixels, m_background.a);
+
+  for (uint32_t index : m_bins[tileIndex]) {
+    const Primitive &primitive = m_primitives[index];
+    switch (primitive.type) {
+    case PrimitiveType::Shape:
+      DrawShape(primitive, tileX, tileY, tile);
+      break;
+    case PrimitiveType::Segment:
+      DrawSegment(primitive, tileX, tileY, tile);
+      break;
+    case PrimitiveType::Triangle:
+      DrawTriangle(primitive, tileX, tileY, tile);
+      break;
+    case PrimitiveType::Glyph:
+      DrawGlyph(primitive, tileX, tileY, tile);
+      break;
+    }
+  }
+
+  for (int y = 0; y < height; ++y) {
+    uint8_t *out =
+        m_pixels.data() +
+        (static_cast<size_t>(tileY + y) * m_width + tileX) * 4;
+    const int row = y * TILE_SIZE;
+    for (int x = 0; x < width; ++x) {
+      out[x * 4 + 0] = ToByte(tile.r[row + x]);
+      out[x * 4 + 1] = ToByte(tile.g[row + x]);
+      out[x * 4 + 2] = ToByte(tile.b[row + x]);
+      out[x * 4 + 3] = ToByte(tile.a[row + x]);
+    }
+  }
+}
+
+void SoftwareRasterizer::DrawShape(const Primitive &primitive, int tileX,
+                                   int tileY, TileBuffer &tile) const {
+  const uint32_t s = primitive.index;
+  const uint32_t flags = m_flags[s];
+  const auto kind = static_cast<ShapeKind>(
+      (flags & ShapeFlags::KindMask) >> ShapeFlags::KindShift);
+  const bool textured = (flags & ShapeFlags::Textured) != 0 &&
+                        m_layers[s] < m_atlasLayers.size();
+  const glm::vec2 size = m_sizes[s];
+  const glm::vec4 color = m_colors[s];
+  const ShapeParams &params = m_params[s];
+  const glm::vec2 center = size * 0.5f;
+  const float radius = std::min(size.x, size.y) * 0.5f;
+  const float pixelsPerUnit =
+      0.5f * (std::fabs(m_windowScale.x) + std::fabs(m_windowScale.y));
+
+  // Pixel centers to the shape's local window units, as vLocal
+  const glm::vec2 invScale = 1.0f / m_windowScale;
+  const glm::vec2 localOffset = -m_windowOffset * invScale - m_positions[s];
+  const glm::vec4 uvRect = m_uvRects[s];
+  const glm::vec2 invSize = 1.0f / glm::max(size, glm::vec2(1e-5f));
+  const bool rotated = m_rotations[s] != 0.0f;
+  const float cosRotation = std::cos(m_rotations[s]);
+  const float sinRotation = std::sin(m_rotations[s]);
+
+  const int x0 = std::max(primitive.x0, tileX);
+  const int y0 = std::max(primitive.y0, tileY);
+  const int x1 = std::min(primitive.x1, tileX + TILE_SIZE);
+  const int y1 = std::min(primitive.y1, tileY + TILE_SIZE);
+  ForEachLaneGroup(tileX, tileY, x0, y0, x1, y1, [&](int offset,
+                                                     const LanePoint &pixel,
+                                                     Lanes inside) {
+    LanePoint local = {
+        pixel.x * Lanes::Set(invScale.x) + Lanes::Set(localOffset.x),
+        pixel.y * Lanes::Set(invScale.y) + Lanes::Set(localOffset.y)};
+    Lanes coverage = Lanes::Set(1.0f);
+    if (rotated) {
+      const Lanes cosine = Lanes::Set(cosRotation);
+      const Lanes sine = Lanes::Set(sinRotation);
+      local = {cosine * local.x + sine * local.y,
+               cosine * local.y - sine * local.x};
+      if (kind == ShapeKind::Rect) {
+        // Pixel centers inside the turned box, as GL rasterizes the quad
+        const Lanes zero = Lanes::Set(0.0f);
+        const Lanes in = And(
+            And(GreaterEqual(local.x, zero), Less(local.x, Lanes::Set(size.x))),
+            And(GreaterEqual(local.y, zero),
+                Less(local.y, Lanes::Set(size.y))));
+        coverage = And(in, coverage);
+      }
+    }
+    if (kind != ShapeKind::Rect) {
+      Lanes d = Lanes::Set(-1.0f);
+      switch (kind) {
+      case ShapeKind::Circle: {
+        const LanePoint p = Offset(local, center);
+        d = Length(p.x, p.y) - Lanes::Set(radius);
+        break;
+      }
+      case ShapeKind::RoundedRect:
+        d = SdRoundedBox(Offset(local, center), center, params.a.x);
+        break;
+      case ShapeKind::Ring: {
+        const float halfThickness = std::min(params.a.x, radius) * 0.5f;
+        const LanePoint p = Offset(local, center);
+        d = Abs(Length(p.x, p.y) - Lanes::Set(radius - halfThickness)) -
+            Lanes::Set(halfThickness);
+        break;
+      }
+      // Points and the radius are in box units
+      case ShapeKind::Line:
+        d = SdSegment(local, glm::vec2(params.a.x, params.a.y) * size,
+                      glm::vec2(params.a.z, params.a.w) * size) -
+            Lanes::Set(params.b.x * std::min(size.x, size.y));
+        break;
+      case ShapeKind::Triangle:
+        d = SdTriangle(local, glm::vec2(params.a.x, params.a.y) * size,
+                       glm::vec2(params.a.z, params.a.w) * size,
+                       glm::vec2(params.b.x, params.b.y) * size);
+        break;
+      default:
+        break;
+      }
+      coverage = Clamp01(Lanes::Set(0.5f) - d * Lanes::Set(pixelsPerUnit));
+    }
+    coverage = And(inside, coverage);
+    if (!Any(Greater(coverage, Lanes::Set(0.0f)))) {
+      return;
+    }
+
+    Lanes r = Lanes::Set(color.r);
+    Lanes g = Lanes::Set(color.g);
+    Lanes b = Lanes::Set(color.b);
+    Lanes a = Lanes::Set(color.a) * coverage;
+    if (textured) {
+      alignas(32) float u[Lanes::WIDTH];
+      alignas(32) float v[Lanes::WIDTH];
+      alignas(32) float texel[4][Lanes::WIDTH];
+      (Lanes::Set(uvRect.x) +
+       Lanes::Set(uvRect.z - uvRect.x) *
+           Clamp01(local.x * Lanes::Set(invSize.x)))
+          .Store(u);
+      (Lanes::Set(uvRect.y) +
+       Lanes::Set(uvRect.w - uvRect.y) *
+           Clamp01(local.y * Lanes::Set(invSize.y)))
+          .Store(v);
+      for (int lane = 0; lane < Lanes::WIDTH; ++lane) {
+        const glm::vec4 sample = SampleAtlas(m_layers[s], {u[lane], v[lane]});
+        for (int c = 0; c < 4; ++c) {
+          texel[c][lane] = sample[c];
+        }
+      }
+      r = r * Lanes::Load(texel[0]);
+      g = g * Lanes::Load(texel[1]);
+      b = b * Lanes::Load(texel[2]);
+      a = a * Lanes::Load(texel[3]);
+    }
+    Blend(tile, offset, r, g, b, a);
+  });
+}
+
+void SoftwareRasterizer::DrawSegment(const Primitive &primitive, int tileX,
+                                     int tileY, TileBuffer &tile) const {
+  const Segment &segment = m_segments[primitive.index];
+  const int x0 = std::max(primitive.x0, tileX);
+  const int y0 = std::max(primitive.y0, tileY);
+  const int x1 = std::min(primitive.x1, tileX + TILE_SIZE);
+  const int y1 = std::min(primitive.y1, tileY + TILE_SIZE);
+  const Lanes r = Lanes::Set(segment.color.r);
+  const Lanes g = Lanes::Set(segment.color.g);
+  const Lanes b = Lanes::Set(segment.color.b);
+  const Lanes alpha = Lanes::Set(segment.color.a);
+  ForEachLaneGroup(tileX, tileY, x0, y0, x1, y1, [&](int offset,
+                                                     const LanePoint &pixel,
+                                                     Lanes inside) {
+    const Lanes d = SdSegment(pixel, segment.from, segment.to) -
+                    Lanes::Set(segment.halfWidth);
+    const Lanes coverage = And(inside, Clamp01(Lanes::Set(0.5f) - d));
+    if (!Any(Greater(coverage, Lanes::Set(0.0f)))) {
+      return;
+    }
+    if (segment.additive) {
+      BlendAdditive(tile, offset, r, g, b, alpha * coverage);
+    } else {
+      Blend(tile, offset, r, g, b, alpha * coverage);
+    }
+  });
+}
+
+void SoftwareRasterizer::DrawTriangle(const Primitive &primitive, int tileX,
+                                      int tileY, TileBuffer &tile) const {
+  const Triangle &triangle = m_triangles[primitive.index];
+  const glm::vec2 *p = triangle.position;
+  // edges[i] is opposite vertex i, so it weighs that vertex
+  const Edge edges[3] = {MakeEdge(p[1], p[2]), MakeEdge(p[2], p[0]),
+                         MakeEdge(p[0], p[1])};
+  const float invArea =
+      1.0f / ((p[1].x - p[0].x) * (p[2].y - p[0].y) -
+              (p[1].y - p[0].y) * (p[2].x - p[0].x));
+
+  // Most UI triangles are flat: solid fills all sample the atlas's white
+  // pixel, and text is one color
+  const bool flatUV = triangle.uv[0] == triangle.uv[1] &&
+                      triangle.uv[0] == triangle.uv[2];
+  const bool flatColor = triangle.color[0] == triangle.color[1] &&
+                         triangle.color[0] == triangle.color[2];
+  const glm::vec4 flatTexel =
+      flatUV ? SampleUiTexture(triangle.uv[0]) : glm::vec4(1.0f);
+
+  const int x0 = std::max(primitive.x0, tileX);
+  const int y0 = std::max(primitive.y0, tileY);
+  const int x1 = std::min(primitive.x1, tileX + TILE_SIZE);
+  const int y1 = std::min(primitive.y1, tileY + TILE_SIZE);
+  const Lanes zero = Lanes::Set(0.0f);
+  ForEachLaneGroup(tileX, tileY, x0, y0, x1, y1, [&](int offset,
+                                                     const LanePoint &pixel,
+                                                     Lanes inside) {
+    Lanes weight[3];
+    Lanes mask = inside;
+    for (int i = 0; i < 3; ++i) {
+      const Edge &edge = edges[i];
+      weight[i] = pixel.x * Lanes::Set(edge.a) + pixel.y * Lanes::Set(edge.b) +
+                  Lanes::Set(edge.c);
+      mask = And(mask, edge.topLeft ? GreaterEqual(weight[i], zero)
+                                    : Greater(weight[i], zero));
+    }
+    if (!Any(mask)) {
+      return;
+    }
+    for (Lanes &w : weight) {
+      w = w * Lanes::Set(invArea);
+    }
+
+    Lanes color[4];
+    for (int c = 0; c < 4; ++c) {
+      color[c] = flatColor ? Lanes::Set(triangle.color[0][c])
+                           : weight[0] * Lanes::Set(triangle.color[0][c]) +
+                                 weight[1] * Lanes::Set(triangle.color[1][c]) +
+                                 weight[2] * Lanes::Set(triangle.color[2][c]);
+    }
+    if (flatUV) {
+      for (int c = 0; c < 4; ++c) {
+        color[c] = color[c] * Lanes::Set(flatTexel[c]);
+      }
+    } else {
+      alignas(32) float u[Lanes::WIDTH];
+      alignas(32) float v[Lanes::WIDTH];
+      alignas(32) float texel[4][Lanes::WIDTH];
+      (weight[0] * Lanes::Set(triangle.uv[0].x) +
+       weight[1] * Lanes::Set(triangle.uv[1].x) +
+       weight[2] * Lanes::Set(triangle.uv[2].x))
+          .Store(u);
+      (weight[0] * Lanes::Set(triangle.uv[0].y) +
+       weight[1] * Lanes::Set(triangle.uv[1].y) +
+       weight[2] * Lanes::Set(triangle.uv[2].y))
+          .Store(v);
+      for (int lane = 0; lane < Lanes::WIDTH; ++lane) {
+        const glm::vec4 sample = SampleUiTexture({u[lane], v[lane]});
+        for (int c = 0; c < 4; ++c) {
+          texel[c][lane] = sample[c];
+        }
+      }
+      for (int c = 0; c < 4; ++c) {
+        color[c] = color[c] * Lanes::Load(texel[c]);
+      }
+    }
+    Blend(tile, offset, color[0], color[1], color[2], And(mask, color[3]));
+  });
+}
+
+void SoftwareRasterizer::DrawGlyph(const Primitive &primitive, int tileX,
+                                   int tileY, TileBuffer &tile) const {
+  const Glyph &glyph = m_glyphs[primitive.index];
+  // Pixel centers to the share of the way across the rect, as the quad's
+  // interpolated UVs
+  const glm::vec2 invExtent = 1.0f / (glyph.to - glyph.from);
+  const glm::vec4 uvRect = glyph.uvRect;
+  const Lanes edge = Lanes::Set(128.0f / 255.0f);
+  const Lanes sharpness = Lanes::Set(glyph.sharpness);
+  const Lanes r = Lanes::Set(glyph.color.r);
+  const Lanes g = Lanes::Set(glyph.color.g);
+  const Lanes b = Lanes::Set(glyph.color.b);
+  const Lanes alpha = Lanes::Set(glyph.color.a);
+
+  const int x0 = std::max(primitive.x0, tileX);
+  const int y0 = std::max(primitive.y0, tileY);
+  const int x1 = std::min(primitive.x1, tileX + TILE_SIZE);
+  const int y1 = std::min(primitive.y1, tileY + TILE_SIZE);
+  ForEachLaneGroup(tileX, tileY, x0, y0, x1, y1, [&](int offset,
+                                                     const LanePoint &pixel,
+                                                     Lanes inside) {
+    alignas(32) float u[Lanes::WIDTH];
+    alignas(32) float v[Lanes::WIDTH];
+    alignas(32) float field[Lanes::WIDTH];
+    (Lanes::Set(uvRect.x) +
+     Lanes::Set(uvRect.z - uvRect.x) *
+         ((pixel.x - Lanes::Set(glyph.from.x)) * Lanes::Set(invExtent.x)))
+        .Store(u);
+    (Lanes::Set(uvRect.y) +
+     Lanes::Set(uvRect.w - uvRect.y) *
+         ((pixel.y - Lanes::Set(glyph.from.y)) * Lanes::Set(invExtent.y)))
+        .Store(v);
+    for (int lane = 0; lane < Lanes::WIDTH; ++lane) {
+      field[lane] = SampleAtlas(glyph.layer, {u[lane], v[lane]}).a;
+    }
+    const Lanes coverage = And(
+        inside, Clamp01((Lanes::Load(field) - edge) * sharpness +
+                        Lanes::Set(0.5f)));
+    if (!Any(Greater(coverage, Lanes::Set(0.0f)))) {
+      return;
+    }
+    Blend(tile, offset, r, g, b, alpha * coverage);
+  });
+}
+
+glm::vec4 SoftwareRasterizer::SampleAtlas(uint32_t layer, glm::vec2 uv) const {
+  return SampleBilinear(m_atlasLayers[layer].data(), TextureAtlas::PAGE_SIZE,
+                        TextureAtlas::PAGE_SIZE, uv);
+}
+
+glm::vec4 SoftwareRasterizer::SampleUiTexture(glm::vec2 uv) const {
+  if (m_uiTexture.empty()) {
+    return glm::vec4(1.0f);
+  }
+  return SampleBilinear(m_uiTexture.data(), m_uiTextureWidth,
+                        m_uiTextureHeight, uv);
+}
+
+SoftwarePresenter::~SoftwarePresenter() { Cleanup(); }
+
+void SoftwarePresenter::Present(const SoftwareRasterizer &rasterizer) {
+  const int width = rasterizer.GetWidth();
+  const int height = rasterizer.GetHeight();
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+  if (m_texture == 0 || width != m_width || height != m_height) {
+    if (m_texture == 0) {
+      glGenTextures(1, &m_texture);
+      glGenFramebuffers(1, &m_framebuffer);
+    }
+    GLState::BindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, nullptr);
+    m_width = width;
+    m_height = height;
+  }
+
+  GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  GLState::BindTexture(GL_TEXTURE_2D, m_texture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA,
+                  GL_UNSIGNED_BYTE, rasterizer.GetPixels());
+
+  // Rows are top first, GL's bottom first: the blit flips them. The read
+  // binding is restored for frame capture, which reads the target after.
+  GLint previousReadFramebuffer = 0;
+  glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                         GL_TEXTURE_2D, m_texture, 0);
+  glBlitFramebuffer(0, 0, width, height, 0, height, width, 0,
+                    GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER,
+                    static_cast<GLuint>(previousReadFramebuffer));
+}
+
+void SoftwarePresenter::Cleanup() {
+  if (m_framebuffer != 0) {
+    glDeleteFramebuffers(1, &m_framebuffer);
+    m_framebuffer = 0;
+  }
+  GLState::DeleteTexture(m_texture);
+  m_texture = 0;
+  m_width = 0;
+  m_height = 0;
+}
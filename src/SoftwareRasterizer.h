@@ -0,0 +1,206 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "ShapeStore.h"
+#include "TextureAtlas.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <glm.hpp>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct FramePacket;
+
+// CPU backend for machines without a usable GPU, where llvmpipe spends most
+// of its time on generality flat 2D shapes don't need. Draws a FramePacket
+// the way the GL passes would (shapes with their SDF kinds and atlas
+// sprites, polylines, particles and scene text, then the ImGui draw data)
+// into an RGBA8 buffer.
+//
+// Primitives are binned into 64x64 screen tiles in draw order, then tiles
+// are shaded in parallel: the render thread and a pool of workers take
+// tiles off a shared counter. Each tile blends in planar float buffers that
+// stay in cache, evaluating edge functions and distance fields several
+// pixels at a time (8 lanes with AVX2, 4 with SSE2, else scalar), and is
+// converted to RGBA8 once at the end.
+//
+// Not supported: ImDrawList callbacks (skipped), UI textures other than
+// the font atlas (every UI draw samples it), and GPU particles, whose state
+// never leaves the GPU.
+class SoftwareRasterizer {
+public:
+  static constexpr int TILE_SIZE = 64;
+
+  struct Stats {
+    int threads = 0;      // Including the calling thread
+    int lanes = 1;        // Pixels per SIMD step
+    size_t primitives = 0;
+    size_t binnedRefs = 0; // Primitive-in-tile entries
+    double binMs = 0.0;
+    double shadeMs = 0.0;
+  };
+
+  SoftwareRasterizer() = default;
+  ~SoftwareRasterizer();
+  SoftwareRasterizer(const SoftwareRasterizer &) = delete;
+  SoftwareRasterizer &operator=(const SoftwareRasterizer &) = delete;
+
+  // threadCount 0 uses every hardware thread
+  void Initialize(int threadCount = 0);
+  void Cleanup();
+
+  // RGBA, rows top to bottom; sampled by every UI triangle
+  void SetUiTexture(const uint8_t *rgba, int width, int height);
+
+  // Consumes the packet's shape and atlas updates (mirrored here, since
+  // packets only carry what changed) and draws the frame
+  void Render(FramePacket &packet);
+
+  // The last frame: RGBA8, rows top to bottom
+  [[nodiscard]] const uint8_t *GetPixels() const { return m_pixels.data(); }
+  [[nodiscard]] int GetWidth() const { return m_width; }
+  [[nodiscard]] int GetHeight() const { return m_height; }
+  [[nodiscard]] Stats GetStats() const { return m_stats; }
+
+private:
+  enum class PrimitiveType : uint8_t { Shape, Segment, Triangle, Glyph };
+
+  // Pixel-space bounds, half-open and already clipped
+  struct Primitive {
+    PrimitiveType type;
+    // Dense shape index, or into m_segments / m_triangles / m_glyphs
+    uint32_t index;
+    int x0, y0, x1, y1;
+  };
+
+  // Polyline segments, and particles as zero-length ones
+  struct Segment {
+    glm::vec2 from, to; // Pixels
+    float halfWidth;
+    glm::vec4 color;
+    bool additive = false; // BlendMode::Additive rather than source-over
+  };
+
+  // A polyline, a particle emitter's or the scene text's draw, ordered by
+  // layer
+  struct LayeredDraw {
+    enum class Kind : uint8_t { Particles, Polyline, Text };
+
+    uint8_t layer;
+    Kind kind;
+    uint32_t index; // Into the batch's draws
+  };
+
+  // A scene text glyph quad, sampling a distance field from the atlas
+  struct Glyph {
+    glm::vec2 from, to; // Pixels of the rect's first and second corner
+    glm::vec4 uvRect;
+    uint32_t layer;
+    glm::vec4 color;
+    float sharpness; // Coverage per unit of field alpha
+  };
+
+  struct Triangle {
+    glm::vec2 position[3]; // Pixels
+    glm::vec2 uv[3];
+    glm::vec4 color[3];
+  };
+
+  // Per-thread tile storage, planar so every channel loads as one vector
+  struct alignas(32) TileBuffer {
+    float r[TILE_SIZE * TILE_SIZE];
+    float g[TILE_SIZE * TILE_SIZE];
+    float b[TILE_SIZE * TILE_SIZE];
+    float a[TILE_SIZE * TILE_SIZE];
+  };
+
+  void SyncShapes(const FramePacket &packet);
+  void SyncAtlas(const FramePacket &packet);
+  void Resize(int width, int height);
+  // Bounds are x0, y0, x1, y1 in pixels; empty ones are dropped
+  void AddPrimitive(PrimitiveType type, uint32_t index, glm::ivec4 bounds);
+  void BuildPrimitives(FramePacket &packet);
+  void BinPrimitives();
+
+  void WorkerMain(int worker);
+  void ShadeTiles(TileBuffer &tile);
+  void ShadeTile(int tileIndex, TileBuffer &tile);
+  void DrawShape(const Primitive &primitive, int tileX, int tileY,
+                 TileBuffer &tile) const;
+  void DrawSegment(const Primitive &primitive, int tileX, int tileY,
+                   TileBuffer &tile) const;
+  void DrawTriangle(const Primitive &primitive, int tileX, int tileY,
+                    TileBuffer &tile) const;
+  void DrawGlyph(const Primitive &primitive, int tileX, int tileY,
+                 TileBuffer &tile) const;
+  [[nodiscard]] glm::vec4 SampleAtlas(uint32_t layer, glm::vec2 uv) const;
+  [[nodiscard]] glm::vec4 SampleUiTexture(glm::vec2 uv) const;
+
+  // Mirror of the ShapeStore columns, kept current from each packet
+  std::vector<glm::vec2> m_positions;
+  std::vector<glm::vec2> m_sizes;
+  std::vector<float> m_rotations;
+  std::vector<glm::vec4> m_colors;
+  std::vector<uint32_t> m_flags;
+  std::vector<glm::vec4> m_uvRects;
+  std::vector<uint32_t> m_layers;
+  std::vector<ShapeParams> m_params;
+
+  // Mirror of the texture atlas layers, RGBA8
+  std::vector<std::vector<uint8_t>> m_atlasLayers;
+  std::vector<uint8_t> m_uiTexture;
+  int m_uiTextureWidth = 0;
+  int m_uiTextureHeight = 0;
+
+  // This frame
+  glm::vec2 m_windowScale = glm::vec2(1.0f); // Window units to pixels
+  glm::vec2 m_windowOffset = glm::vec2(0.0f);
+  glm::vec4 m_background = glm::vec4(0.0f);
+  std::vector<Primitive> m_primitives;
+  std::vector<Segment> m_segments;
+  std::vector<Triangle> m_triangles;
+  std::vector<Glyph> m_glyphs;
+  std::vector<LayeredDraw> m_layeredDraws;
+  std::vector<std::vector<uint32_t>> m_bins; // Primitive indices per tile
+
+  int m_width = 0;
+  int m_height = 0;
+  int m_tilesX = 0;
+  int m_tilesY = 0;
+  std::vector<uint8_t> m_pixels;
+
+  // Worker pool; a frame's tiles go to whoever takes them first
+  std::vector<std::thread> m_workers;
+  std::vector<std::unique_ptr<TileBuffer>> m_tileBuffers; // One per thread
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  uint64_t m_generation = 0;
+  int m_busyWorkers = 0;
+  bool m_stop = false;
+  std::atomic<int> m_nextTile{0};
+
+  Stats m_stats;
+};
+
+// Shows a SoftwareRasterizer frame through GL: one texture upload and a
+// flipped blit into the bound draw framebuffer. Needs a current context.
+class SoftwarePresenter {
+public:
+  SoftwarePresenter() = default;
+  ~SoftwarePresenter();
+  SoftwarePresenter(const SoftwarePresenter &) = delete;
+  SoftwarePresenter &operator=(const SoftwarePresenter &) = delete;
+
+  void Present(const SoftwareRasterizer &rasterizer);
+  void Cleanup();
+
+private:
+  GLuint m_texture = 0;
+  GLuint m_framebuffer = 0;
+  int m_width = 0;
+  int m_height = 0;
+};
@@ -0,0 +1,169 @@
+#include "StreamBuffer.h"
+#include "GLState.h"
+#include <cstring>
+#include <iostream>
+
+// ARB_buffer_storage / GL 4.4, not part of the GL 4.1 GLAD loader
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace {
+using BufferStorageProc = void(APIENTRYP)(GLenum target, GLsizeiptr size,
+                                          const void *data, GLbitfield flags);
+} // namespace
+
+StreamBuffer::~StreamBuffer() { Cleanup(); }
+
+bool StreamBuffer::HasBufferStorage() {
+  GLint major = 0;
+  GLint minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  if (major > 4 || (major == 4 && minor >= 4)) {
+    return true;
+  }
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    const auto *name = reinterpret_cast<const char *>(
+        glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+    if (name != nullptr && std::strcmp(name, "GL_ARB_buffer_storage") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool StreamBuffer::Initialize(GLsizeiptr regionSize, GLADloadproc loader) {
+  m_regionSize = regionSize;
+  const GLsizeiptr totalSize = regionSize * REGION_COUNT;
+
+  glGenBuffers(1, &m_buffer);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, m_buffer);
+
+  BufferStorageProc bufferStorage = nullptr;
+  if (loader != nullptr && HasBufferStorage()) {
+    bufferStorage = reinterpret_cast<BufferStorageProc>(
+        loader("glBufferStorage"));
+  }
+
+  if (bufferStorage != nullptr) {
+    const GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    bufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+    m_persistentPtr = static_cast<unsigned char *>(
+        glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags));
+    if (m_persistentPtr == nullptr) {
+      // Immutable storage can't be respecified; start over with a new name
+      std::cerr << "StreamBuffer: persistent mapping failed, falling back\n";
+      GLState::DeleteBuffer(m_buffer);
+      glGenBuffers(1, &m_buffer);
+      GLState::BindBuffer(GL_ARRAY_BUFFER, m_buffer);
+      glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+    }
+  } else {
+    glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+  }
+
+  m_region = 0;
+  m_regionUsed = 0;
+  return m_buffer != 0;
+}
+
+void StreamBuffer::Cleanup() {
+  for (GLsync &fence : m_fences) {
+    if (fence != nullptr) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  if (m_buffer != 0) {
+    if (m_persistentPtr != nullptr || m_hasOpenMapping) {
+      GLState::BindBuffer(GL_ARRAY_BUFFER, m_buffer);
+      glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    GLState::DeleteBuffer(m_buffer);
+    m_buffer = 0;
+  }
+  m_persistentPtr = nullptr;
+  m_hasOpenMapping = false;
+}
+
+void StreamBuffer::BeginFrame() {
+  m_region = (m_region + 1) % REGION_COUNT;
+  m_regionUsed = 0;
+
+  GLsync &fence = m_fences[m_region];
+  if (fence == nullptr) {
+    return;
+  }
+  // With three regions the fence is normally long signaled; polling with a
+  // zero timeout costs nothing. Only block if the GPU is 3 frames behind.
+  GLenum status = glClientWaitSync(fence, 0, 0);
+  if (status == GL_TIMEOUT_EXPIRED) {
+    m_stalls++;
+    const GLuint64 oneSecond = 1000000000;
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, oneSecond);
+  }
+  glDeleteSync(fence);
+  fence = nullptr;
+}
+
+StreamBuffer::Allocation StreamBuffer::Allocate(GLsizeiptr bytes,
+                                                GLsizeiptr alignment) {
+  Allocation allocation;
+  if (m_buffer == 0 || bytes <= 0 || m_hasOpenMapping) {
+    return allocation;
+  }
+
+  GLsizeiptr start = (m_regionUsed + alignment - 1) / alignment * alignment;
+  if (start + bytes > m_regionSize) {
+    if (!m_reportedOverflow) {
+      std::cerr << "StreamBuffer: frame region of " << m_regionSize
+                << " bytes exhausted, dropping allocations\n";
+      m_reportedOverflow = true;
+    }
+    return allocation;
+  }
+  m_regionUsed = start + bytes;
+
+  allocation.offset = m_region * m_regionSize + start;
+  allocation.size = bytes;
+  if (m_persistentPtr != nullptr) {
+    allocation.data = m_persistentPtr + allocation.offset;
+  } else {
+    // The fence already guarantees the GPU is done with this range
+    GLState::BindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    allocation.data = glMapBufferRange(
+        GL_ARRAY_BUFFER, allocation.offset, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+            GL_MAP_INVALIDATE_RANGE_BIT);
+    m_hasOpenMapping = allocation.data != nullptr;
+  }
+  return allocation;
+}
+
+void StreamBuffer::Commit(const Allocation &allocation) {
+  // Coherent persistent mappings need no flush
+  if (!allocation.IsValid() || m_persistentPtr != nullptr) {
+    return;
+  }
+  GLState::BindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+  m_hasOpenMapping = false;
+}
+
+void StreamBuffer::EndFrame() {
+  if (m_buffer == 0) {
+    return;
+  }
+  GLsync &fence = m_fences[m_region];
+  if (fence != nullptr) {
+    glDeleteSync(fence);
+  }
+  fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
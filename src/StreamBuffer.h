@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+
+// Triple-buffered ring for per-frame dynamic data (vertices, instances).
+// Each frame writes into its own region; a fence placed at EndFrame() guards
+// the region until the GPU is done with it, so writes never synchronize with
+// in-flight draws. With ARB_buffer_storage the whole buffer is mapped once,
+// persistently; otherwise each allocation is mapped unsynchronized and
+// unmapped by Commit(), which keeps the path GL 4.1 compatible.
+//
+// Per frame:
+//   stream.BeginFrame();
+//   auto alloc = stream.Allocate(bytes);
+//   memcpy(alloc.data, ...); stream.Commit(alloc);
+//   ... draw from stream.GetBuffer() at alloc.offset ...
+//   stream.EndFrame();
+class StreamBuffer {
+public:
+  static constexpr int REGION_COUNT = 3;
+
+  struct Allocation {
+    void *data = nullptr; // CPU write pointer, valid until Commit()
+    GLintptr offset = 0;  // Byte offset into GetBuffer()
+    GLsizeiptr size = 0;
+
+    [[nodiscard]] bool IsValid() const { return data != nullptr; }
+  };
+
+  StreamBuffer() = default;
+  ~StreamBuffer();
+
+  // The loader resolves glBufferStorage, which the GL 4.1 GLAD loader
+  // doesn't cover (pass glfwGetProcAddress)
+  bool Initialize(GLsizeiptr regionSize, GLADloadproc loader);
+  void Cleanup();
+
+  void BeginFrame();
+  // Returns an invalid allocation if the frame's region is full. On the
+  // non-persistent path only one allocation may be open (uncommitted) at a
+  // time.
+  Allocation Allocate(GLsizeiptr bytes, GLsizeiptr alignment = 16);
+  void Commit(const Allocation &allocation);
+  void EndFrame();
+
+  [[nodiscard]] GLuint GetBuffer() const { return m_buffer; }
+  [[nodiscard]] GLsizeiptr GetRegionSize() const { return m_regionSize; }
+  [[nodiscard]] bool IsPersistent() const { return m_persistentPtr != nullptr; }
+  // Frames where the GPU still held the region being recycled
+  [[nodiscard]] uint64_t GetStallCount() const { return m_stalls; }
+
+private:
+  static bool HasBufferStorage();
+
+  GLuint m_buffer = 0;
+  GLsizeiptr m_regionSize = 0;
+  unsigned char *m_persistentPtr = nullptr; // Null on the fallback path
+
+  int m_region = 0;
+  GLsizeiptr m_regionUsed = 0;
+  GLsync m_fences[REGION_COUNT] = {};
+  bool m_hasOpenMapping = false;
+
+  uint64_t m_stalls = 0;
+  bool m_reportedOverflow = false;
+};
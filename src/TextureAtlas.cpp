@@ -0,0 +1,294 @@
+#include "TextureAtlas.h"
+#include "GLState.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+uint32_t TextureAtlas::Add(const uint8_t *rgba, int width, int height) {
+  if (rgba == nullptr || width <= 0 || height <= 0) {
+    return 0;
+  }
+  const int paddedWidth = width + 2 * PADDING;
+  const int paddedHeight = height + 2 * PADDING;
+  if (paddedWidth > PAGE_SIZE || paddedHeight > PAGE_SIZE) {
+    std::cerr << "TextureAtlas: " << width << "x" << height
+              << " image is larger than a page\n";
+    return 0;
+  }
+
+  // Freed space first, then the skylines, then a new layer
+  Rect rect{};
+  int layerIndex = -1;
+  for (size_t i = 0; i < m_layers.size() && layerIndex < 0; ++i) {
+    if (TakeFreeRect(m_layers[i], paddedWidth, paddedHeight, rect)) {
+      layerIndex = static_cast<int>(i);
+    }
+  }
+  for (size_t i = 0; i < m_layers.size() && layerIndex < 0; ++i) {
+    if (SkylineInsert(m_layers[i], paddedWidth, paddedHeight, rect)) {
+      layerIndex = static_cast<int>(i);
+    }
+  }
+  if (layerIndex < 0) {
+    if (static_cast<int>(m_layers.size()) >= MAX_LAYERS) {
+      std::cerr << "TextureAtlas: all " << MAX_LAYERS << " layers are full\n";
+      return 0;
+    }
+    m_layers.push_back(NewLayer());
+    layerIndex = static_cast<int>(m_layers.size()) - 1;
+    SkylineInsert(m_layers.back(), paddedWidth, paddedHeight, rect);
+  }
+  m_layers[layerIndex].liveImages++;
+
+  Entry entry;
+  entry.rect = rect;
+  entry.layer = layerIndex;
+  const int x = rect.x + PADDING;
+  const int y = rect.y + PADDING;
+  const float page = static_cast<float>(PAGE_SIZE);
+  entry.region.uvRect = {x / page, y / page, (x + width) / page,
+                         (y + height) / page};
+  entry.region.layer = static_cast<uint32_t>(layerIndex);
+  entry.region.width = width;
+  entry.region.height = height;
+
+  // The whole padded rect is written, so a reused region's old gutter
+  // doesn't bleed into the new image
+  AtlasUpload upload;
+  upload.x = rect.x;
+  upload.y = rect.y;
+  upload.layer = layerIndex;
+  upload.width = paddedWidth;
+  upload.height = paddedHeight;
+  upload.pixels.assign(static_cast<size_t>(paddedWidth) * paddedHeight * 4, 0);
+  for (int row = 0; row < height; ++row) {
+    std::memcpy(upload.pixels.data() +
+                    (static_cast<size_t>(row + PADDING) * paddedWidth +
+                     PADDING) * 4,
+                rgba + static_cast<size_t>(row) * width * 4,
+                static_cast<size_t>(width) * 4);
+  }
+  m_pending.uploads.push_back(std::move(upload));
+  m_pending.layerCount = static_cast<int>(m_layers.size());
+
+  uint32_t id = m_nextId++;
+  m_images.emplace(id, entry);
+  return id;
+}
+
+bool TextureAtlas::Remove(uint32_t id) {
+  auto it = m_images.find(id);
+  if (it == m_images.end()) {
+    return false;
+  }
+  Layer &layer = m_layers[it->second.layer];
+  if (--layer.liveImages == 0) {
+    layer = NewLayer(); // Nothing left: start the page over
+  } else {
+    layer.freeRects.push_back(it->second.rect);
+  }
+  m_images.erase(it);
+  return true;
+}
+
+bool TextureAtlas::GetRegion(uint32_t id, AtlasRegion &region) const {
+  auto it = m_images.find(id);
+  if (it == m_images.end()) {
+    return false;
+  }
+  region = it->second.region;
+  return true;
+}
+
+void TextureAtlas::TakeUpdate(AtlasUpdate &update) {
+  update.layerCount = static_cast<int>(m_layers.size());
+  update.uploads.clear();
+  update.uploads.swap(m_pending.uploads);
+}
+
+TextureAtlas::Layer TextureAtlas::NewLayer() {
+  Layer layer;
+  layer.skyline.push_back({0, 0, PAGE_SIZE});
+  return layer;
+}
+
+// Best fit by area; what's left of the free rect is split in two along its
+// longer leftover side
+bool TextureAtlas::TakeFreeRect(Layer &layer, int width, int height,
+                                Rect &out) {
+  size_t best = layer.freeRects.size();
+  int bestArea = INT_MAX;
+  for (size_t i = 0; i < layer.freeRects.size(); ++i) {
+    const Rect &r = layer.freeRects[i];
+    if (r.width >= width && r.height >= height &&
+        r.width * r.height < bestArea) {
+      best = i;
+      bestArea = r.width * r.height;
+    }
+  }
+  if (best == layer.freeRects.size()) {
+    return false;
+  }
+
+  Rect free = layer.freeRects[best];
+  layer.freeRects.erase(layer.freeRects.begin() +
+                        static_cast<std::ptrdiff_t>(best));
+  out = {free.x, free.y, width, height};
+  const int rightWidth = free.width - width;
+  const int bottomHeight = free.height - height;
+  Rect right;
+  Rect bottom;
+  if (rightWidth > bottomHeight) {
+    right = {free.x + width, free.y, rightWidth, free.height};
+    bottom = {free.x, free.y + height, width, bottomHeight};
+  } else {
+    right = {free.x + width, free.y, rightWidth, height};
+    bottom = {free.x, free.y + height, free.width, bottomHeight};
+  }
+  for (const Rect &r : {right, bottom}) {
+    if (r.width > 2 * PADDING && r.height > 2 * PADDING) {
+      layer.freeRects.push_back(r);
+    }
+  }
+  return true;
+}
+
+int TextureAtlas::SkylineFit(const Layer &layer, size_t index, int width,
+                             int height) {
+  const int x = layer.skyline[index].x;
+  if (x + width > PAGE_SIZE) {
+    return -1;
+  }
+  int y = 0;
+  int remaining = width;
+  for (size_t i = index; remaining > 0; ++i) {
+    if (i == layer.skyline.size()) {
+      return -1;
+    }
+    y = std::max(y, layer.skyline[i].y);
+    if (y + height > PAGE_SIZE) {
+      return -1;
+    }
+    remaining -= layer.skyline[i].width;
+  }
+  return y;
+}
+
+bool TextureAtlas::SkylineInsert(Layer &layer, int width, int height,
+                                 Rect &out) {
+  // Bottom-left: the position with the lowest top edge, ties broken by the
+  // narrower skyline segment
+  size_t bestIndex = layer.skyline.size();
+  int bestTop = INT_MAX;
+  int bestWidth = INT_MAX;
+  for (size_t i = 0; i < layer.skyline.size(); ++i) {
+    int y = SkylineFit(layer, i, width, height);
+    if (y < 0) {
+      continue;
+    }
+    int top = y + height;
+    if (top < bestTop ||
+        (top == bestTop && layer.skyline[i].width < bestWidth)) {
+      bestIndex = i;
+      bestTop = top;
+      bestWidth = layer.skyline[i].width;
+    }
+  }
+  if (bestIndex == layer.skyline.size()) {
+    return false;
+  }
+
+  const int x = layer.skyline[bestIndex].x;
+  out = {x, bestTop - height, width, height};
+
+  // The new segment covers [x, x + width); trim or drop what it shadows
+  std::vector<SkylineNode> &nodes = layer.skyline;
+  nodes.insert(nodes.begin() + static_cast<std::ptrdiff_t>(bestIndex),
+               {x, bestTop, width});
+  for (size_t i = bestIndex + 1; i < nodes.size();) {
+    const int shadowEnd = nodes[i - 1].x + nodes[i - 1].width;
+    if (nodes[i].x >= shadowEnd) {
+      break;
+    }
+    const int shrink = shadowEnd - nodes[i].x;
+    nodes[i].x += shrink;
+    nodes[i].width -= shrink;
+    if (nodes[i].width > 0) {
+      break;
+    }
+    nodes.erase(nodes.begin() + static_cast<std::ptrdiff_t>(i));
+  }
+  // Merge neighbours at the same height
+  for (size_t i = 0; i + 1 < nodes.size();) {
+    if (nodes[i].y == nodes[i + 1].y) {
+      nodes[i].width += nodes[i + 1].width;
+      nodes.erase(nodes.begin() + static_cast<std::ptrdiff_t>(i + 1));
+    } else {
+      ++i;
+    }
+  }
+  return true;
+}
+
+AtlasTexture::~AtlasTexture() { Cleanup(); }
+
+void AtlasTexture::Apply(const AtlasUpdate &update) {
+  if (update.layerCount > m_layerCapacity) {
+    Grow(std::max(update.layerCount, m_layerCapacity * 2));
+  }
+  if (update.uploads.empty()) {
+    return;
+  }
+
+  GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  GLState::BindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+  for (const AtlasUpload &upload : update.uploads) {
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, upload.x, upload.y, upload.layer,
+                    upload.width, upload.height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                    upload.pixels.data());
+  }
+}
+
+void AtlasTexture::Cleanup() {
+  GLState::DeleteTexture(m_texture);
+  m_texture = 0;
+  m_layerCapacity = 0;
+}
+
+// Array textures can't change their layer count, so a bigger one replaces
+// the old. The old layers are copied through a read framebuffer, which
+// stays on the GPU.
+void AtlasTexture::Grow(int layerCapacity) {
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  GLState::BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, TextureAtlas::PAGE_SIZE,
+               TextureAtlas::PAGE_SIZE, layerCapacity, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, nullptr);
+
+  if (m_texture != 0) {
+    GLint previousReadFramebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer);
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    for (int layer = 0; layer < m_layerCapacity; ++layer) {
+      glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                m_texture, 0, layer);
+      glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0, 0,
+                          TextureAtlas::PAGE_SIZE, TextureAtlas::PAGE_SIZE);
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER,
+                      static_cast<GLuint>(previousReadFramebuffer));
+    glDeleteFramebuffers(1, &framebuffer);
+    GLState::DeleteTexture(m_texture);
+    GLState::BindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  }
+  m_texture = texture;
+  m_layerCapacity = layerCapacity;
+}
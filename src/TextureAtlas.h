@@ -0,0 +1,119 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+// Pixels bound for one atlas region, recorded on the main thread
+struct AtlasUpload {
+  int x = 0;
+  int y = 0;
+  int layer = 0;
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> pixels; // RGBA, rows top to bottom
+};
+
+// What the GPU copy of the atlas needs to catch up with the packer; moved
+// into the frame packet so uploads happen on the render thread
+struct AtlasUpdate {
+  int layerCount = 0;
+  std::vector<AtlasUpload> uploads;
+};
+
+// Where an image landed: UVs into one layer of the array texture
+struct AtlasRegion {
+  glm::vec4 uvRect = {0.0f, 0.0f, 0.0f, 0.0f}; // u0, v0, u1, v1
+  uint32_t layer = 0;
+  int width = 0;
+  int height = 0;
+};
+
+// Packs images into the layers of a 2D array texture, so anything drawn from
+// the atlas shares a single texture bind. Each layer is filled with a
+// skyline packer (bottom-left heuristic). Removed images leave free
+// rectangles that later images are fitted into first, and a layer whose
+// images are all gone is reset. Layers are added when nothing fits.
+//
+// This is the CPU side and lives on the main thread; AtlasTexture applies
+// the resulting AtlasUpdates on the render thread.
+class TextureAtlas {
+public:
+  static constexpr int PAGE_SIZE = 2048;
+  static constexpr int MAX_LAYERS = 16;
+  static constexpr int PADDING = 1; // Transparent gutter against bleeding
+
+  // Returns an image id, or 0 if the image is invalid or doesn't fit
+  uint32_t Add(const uint8_t *rgba, int width, int height);
+  // The region may be handed to a later image; sprites still showing it
+  // will show that image instead
+  bool Remove(uint32_t id);
+  [[nodiscard]] bool GetRegion(uint32_t id, AtlasRegion &region) const;
+  [[nodiscard]] size_t GetImageCount() const { return m_images.size(); }
+  [[nodiscard]] int GetLayerCount() const {
+    return static_cast<int>(m_layers.size());
+  }
+
+  // Moves the uploads recorded since the last call into update
+  void TakeUpdate(AtlasUpdate &update);
+
+private:
+  struct Rect {
+    int x, y, width, height;
+  };
+  struct SkylineNode {
+    int x, y, width;
+  };
+  struct Layer {
+    std::vector<SkylineNode> skyline;
+    std::vector<Rect> freeRects; // Released by Remove(), padded
+    int liveImages = 0;
+  };
+  struct Entry {
+    Rect rect; // Padded
+    int layer;
+    AtlasRegion region;
+  };
+
+  static Layer NewLayer();
+  static bool TakeFreeRect(Layer &layer, int width, int height, Rect &out);
+  static bool SkylineInsert(Layer &layer, int width, int height, Rect &out);
+  // Lowest y at which a width-wide rect can sit starting at node index, or
+  // -1 if it doesn't fit
+  static int SkylineFit(const Layer &layer, size_t index, int width,
+                        int height);
+
+  std::vector<Layer> m_layers;
+  std::unordered_map<uint32_t, Entry> m_images;
+  uint32_t m_nextId = 1;
+  AtlasUpdate m_pending;
+};
+
+// GPU side of a TextureAtlas: a GL_TEXTURE_2D_ARRAY grown to the layer
+// count in each update. Growing copies the existing layers on the GPU.
+// Render thread only.
+class AtlasTexture {
+public:
+  AtlasTexture() = default;
+  ~AtlasTexture();
+  AtlasTexture(const AtlasTexture &) = delete;
+  AtlasTexture &operator=(const AtlasTexture &) = delete;
+
+  void Apply(const AtlasUpdate &update);
+  // The GL_TEXTURE_2D_ARRAY, or 0 before the first image
+  [[nodiscard]] GLuint GetTexture() const { return m_texture; }
+  // Storage of every allocated layer, RGBA8
+  [[nodiscard]] size_t GetBytes() const {
+    return static_cast<size_t>(m_layerCapacity) * TextureAtlas::PAGE_SIZE *
+           TextureAtlas::PAGE_SIZE * 4;
+  }
+  void Cleanup();
+
+private:
+  void Grow(int layerCapacity);
+
+  GLuint m_texture = 0;
+  int m_layerCapacity = 0;
+};
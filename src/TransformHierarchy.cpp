@@ -0,0 +1,424 @@
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <cmath>
+
+glm::mat3 Transform2D::ToMatrix() const {
+  const float c = std::cos(rotation);
+  const float s = std::sin(rotation);
+  // Columns: the scaled, turned axes, then the translation
+  return glm::mat3(c * scale.x, s * scale.x, 0.0f, -s * scale.y, c * scale.y,
+                   0.0f, translation.x, translation.y, 1.0f);
+}
+
+Transform2D Transform2D::FromMatrix(const glm::mat3 &matrix) {
+  const glm::vec2 axisX(matrix[0]);
+  const glm::vec2 axisY(matrix[1]);
+  Transform2D transform;
+  transform.translation = glm::vec2(matrix[2]);
+  transform.rotation = std::atan2(axisX.y, axisX.x);
+  transform.scale = {glm::length(axisX), glm::length(axisY)};
+  return transform;
+}
+
+namespace {
+bool SameTransform(const Transform2D &a, const Transform2D &b) {
+  return a.translation == b.translation && a.rotation == b.rotation &&
+         a.scale == b.scale;
+}
+
+// [first, middle) and [middle, last) swap places, in every column
+template <typename T>
+void RotateColumn(std::vector<T> &column, size_t first, size_t middle,
+                  size_t last) {
+  std::rotate(column.begin() + first, column.begin() + middle,
+              column.begin() + last);
+}
+} // namespace
+
+template <typename Function>
+void TransformHierarchy::ForEachColumn(Function &&function) {
+  function(m_parents);
+  function(m_subtreeSizes);
+  function(m_locals);
+  function(m_worlds);
+  function(m_dirty);
+  function(m_shapes);
+  function(m_shapeSizes);
+  function(m_denseToSlot);
+}
+
+TransformHandle TransformHierarchy::Create(TransformHandle parent,
+                                           const Transform2D &local) {
+  return CreateNode(parent, local, {}, glm::vec2(0.0f));
+}
+
+TransformHandle TransformHierarchy::CreateForShape(ShapeHandle shape,
+                                                   const glm::vec2 &shapeSize,
+                                                   TransformHandle parent,
+                                                   const Transform2D &local) {
+  if (!shape.IsValid() || m_shapeToSlot.count(shape.value) != 0) {
+    return {};
+  }
+  return CreateNode(parent, local, shape, shapeSize);
+}
+
+TransformHandle TransformHierarchy::CreateNode(TransformHandle parent,
+                                               const Transform2D &local,
+                                               ShapeHandle shape,
+                                               const glm::vec2 &shapeSize) {
+  uint32_t parentIndex = INVALID_INDEX;
+  auto position = static_cast<uint32_t>(Size());
+  if (parent.IsValid()) {
+    parentIndex = DenseIndex(parent);
+    if (parentIndex == INVALID_INDEX) {
+      return {};
+    }
+    position = parentIndex + m_subtreeSizes[parentIndex];
+  }
+
+  uint32_t slot;
+  if (!m_freeSlots.empty()) {
+    slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+  } else {
+    if (m_slotToDense.size() >= MAX_NODES) {
+      return {}; // Slot table exhausted
+    }
+    slot = static_cast<uint32_t>(m_slotToDense.size());
+    m_slotToDense.push_back(INVALID_INDEX);
+    m_slotGeneration.push_back(1); // Generation 0 is reserved for "invalid"
+  }
+
+  m_parents.insert(m_parents.begin() + position, parentIndex);
+  m_subtreeSizes.insert(m_subtreeSizes.begin() + position, 1);
+  m_locals.insert(m_locals.begin() + position, local);
+  m_worlds.insert(m_worlds.begin() + position, glm::mat3(1.0f));
+  m_dirty.insert(m_dirty.begin() + position, 0);
+  m_shapes.insert(m_shapes.begin() + position, shape);
+  m_shapeSizes.insert(m_shapeSizes.begin() + position, shapeSize);
+  m_denseToSlot.insert(m_denseToSlot.begin() + position, slot);
+  // Everything behind the new node moved up by one, parents included
+  for (size_t i = position + 1; i < Size(); ++i) {
+    if (m_parents[i] != INVALID_INDEX && m_parents[i] >= position) {
+      m_parents[i]++;
+    }
+  }
+  Reindex(position, Size());
+  if (parentIndex != INVALID_INDEX) {
+    AddToSubtrees(parentIndex, 1);
+  }
+  if (shape.IsValid()) {
+    m_shapeToSlot[shape.value] = slot;
+  }
+
+  if (m_dirtyBegin < m_dirtyEnd) {
+    m_dirtyBegin += m_dirtyBegin > position ? 1 : 0;
+    m_dirtyEnd += m_dirtyEnd > position ? 1 : 0;
+  }
+  MarkDirty(position);
+  return TransformHandle::Make(slot, m_slotGeneration[slot]);
+}
+
+bool TransformHierarchy::Destroy(TransformHandle handle) {
+  const uint32_t begin = DenseIndex(handle);
+  if (begin == INVALID_INDEX) {
+    return false;
+  }
+  const uint32_t count = m_subtreeSizes[begin];
+  const uint32_t end = begin + count;
+  if (m_parents[begin] != INVALID_INDEX) {
+    AddToSubtrees(m_parents[begin], -static_cast<int64_t>(count));
+  }
+
+  for (uint32_t i = begin; i < end; ++i) {
+    ReleaseSlot(m_denseToSlot[i]);
+    if (m_shapes[i].IsValid()) {
+      m_shapeToSlot.erase(m_shapes[i].value);
+    }
+  }
+  ForEachColumn([&](auto &column) {
+    column.erase(column.begin() + begin, column.begin() + end);
+  });
+  // Nodes outside a subtree never point into it, so any parent at or past
+  // begin was behind the removed range
+  for (size_t i = begin; i < Size(); ++i) {
+    if (m_parents[i] != INVALID_INDEX && m_parents[i] >= begin) {
+      m_parents[i] -= count;
+    }
+  }
+  Reindex(begin, Size());
+
+  const auto shift = [&](size_t index) -> size_t {
+    return index <= begin ? index : (index >= end ? index - count : begin);
+  };
+  m_dirtyBegin = shift(m_dirtyBegin);
+  m_dirtyEnd = shift(m_dirtyEnd);
+  return true;
+}
+
+void TransformHierarchy::Clear() {
+  // Invalidate every outstanding handle; slots are kept for reuse
+  for (uint32_t slot : m_denseToSlot) {
+    ReleaseSlot(slot);
+  }
+  ForEachColumn([](auto &column) { column.clear(); });
+  m_shapeToSlot.clear();
+  m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+size_t TransformHierarchy::RemoveDeadShapes(const ShapeStore &shapes) {
+  // Parents come first, so a removed parent is known before its children.
+  // Kept nodes are compacted in place; m_parents then holds new indices.
+  std::vector<uint32_t> newIndex(Size(), INVALID_INDEX);
+  uint32_t kept = 0;
+  for (size_t i = 0; i < Size(); ++i) {
+    const uint32_t parent = m_parents[i];
+    const bool removed =
+        (m_shapes[i].IsValid() && !shapes.IsAlive(m_shapes[i])) ||
+        (parent != INVALID_INDEX && newIndex[parent] == INVALID_INDEX);
+    if (removed) {
+      ReleaseSlot(m_denseToSlot[i]);
+      if (m_shapes[i].IsValid()) {
+        m_shapeToSlot.erase(m_shapes[i].value);
+      }
+      continue;
+    }
+    newIndex[i] = kept++;
+    m_parents[i] = parent == INVALID_INDEX ? parent : newIndex[parent];
+  }
+  const size_t removedCount = Size() - kept;
+  if (removedCount == 0) {
+    return 0;
+  }
+  ForEachColumn([&](auto &column) {
+    for (size_t i = 0; i < newIndex.size(); ++i) {
+      if (newIndex[i] != INVALID_INDEX) {
+        column[newIndex[i]] = column[i];
+      }
+    }
+    column.resize(kept);
+  });
+  // Subtree sizes from scratch, children before parents
+  std::fill(m_subtreeSizes.begin(), m_subtreeSizes.end(), 1u);
+  for (size_t i = kept; i-- > 0;) {
+    if (m_parents[i] != INVALID_INDEX) {
+      m_subtreeSizes[m_parents[i]] += m_subtreeSizes[i];
+    }
+  }
+  Reindex(0, kept);
+  if (m_dirtyBegin < m_dirtyEnd) {
+    m_dirtyBegin = 0;
+    m_dirtyEnd = kept;
+  }
+  return removedCount;
+}
+
+bool TransformHierarchy::SetParent(TransformHandle handle,
+                                   TransformHandle parent) {
+  const uint32_t begin = DenseIndex(handle);
+  if (begin == INVALID_INDEX) {
+    return false;
+  }
+  const uint32_t count = m_subtreeSizes[begin];
+  const uint32_t end = begin + count;
+  uint32_t parentIndex = INVALID_INDEX;
+  if (parent.IsValid()) {
+    parentIndex = DenseIndex(parent);
+    if (parentIndex == INVALID_INDEX ||
+        (parentIndex >= begin && parentIndex < end)) {
+      return false; // Unknown, or would make a cycle
+    }
+  }
+  if (m_parents[begin] == parentIndex) {
+    return true;
+  }
+
+  // The subtree becomes the new parent's last child: it moves to just
+  // before `target`, an index in the current layout
+  const uint32_t target = parentIndex == INVALID_INDEX
+                              ? static_cast<uint32_t>(Size())
+                              : parentIndex + m_subtreeSizes[parentIndex];
+  if (m_parents[begin] != INVALID_INDEX) {
+    AddToSubtrees(m_parents[begin], -static_cast<int64_t>(count));
+  }
+
+  // Only [low, high) moves: the subtree and the nodes it jumps over
+  uint32_t low = begin;
+  uint32_t high = begin;
+  uint32_t newBegin = begin;
+  if (target > end) {
+    low = begin;
+    high = target;
+    newBegin = target - count;
+    ForEachColumn(
+        [&](auto &column) { RotateColumn(column, begin, end, target); });
+  } else if (target < begin) {
+    low = target;
+    high = end;
+    newBegin = target;
+    ForEachColumn(
+        [&](auto &column) { RotateColumn(column, target, begin, end); });
+  }
+  const auto remap = [&](uint32_t index) -> uint32_t {
+    if (index == INVALID_INDEX || index < low || index >= high) {
+      return index;
+    }
+    if (index >= begin && index < end) {
+      return index - begin + newBegin;
+    }
+    return target > end ? index - count : index + count;
+  };
+  for (size_t i = low; i < Size(); ++i) {
+    m_parents[i] = remap(m_parents[i]);
+  }
+  parentIndex = remap(parentIndex);
+  m_parents[newBegin] = parentIndex;
+  if (parentIndex != INVALID_INDEX) {
+    AddToSubtrees(parentIndex, count);
+  }
+  Reindex(low, high);
+
+  if (m_dirtyBegin < m_dirtyEnd && low < high) {
+    m_dirtyBegin = std::min<size_t>(m_dirtyBegin, low);
+    m_dirtyEnd = std::max<size_t>(m_dirtyEnd, high);
+  }
+  MarkDirty(newBegin);
+  return true;
+}
+
+bool TransformHierarchy::IsAlive(TransformHandle handle) const {
+  return DenseIndex(handle) != INVALID_INDEX;
+}
+
+void TransformHierarchy::SetLocal(TransformHandle handle,
+                                  const Transform2D &local) {
+  uint32_t i = DenseIndex(handle);
+  if (i != INVALID_INDEX && !SameTransform(m_locals[i], local)) {
+    m_locals[i] = local;
+    MarkDirty(i);
+  }
+}
+
+void TransformHierarchy::SetShapeSize(TransformHandle handle,
+                                      const glm::vec2 &size) {
+  uint32_t i = DenseIndex(handle);
+  if (i != INVALID_INDEX && m_shapeSizes[i] != size) {
+    m_shapeSizes[i] = size;
+    MarkDirty(i);
+  }
+}
+
+Transform2D TransformHierarchy::GetLocal(TransformHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_locals[i] : Transform2D();
+}
+
+glm::vec2 TransformHierarchy::GetShapeSize(TransformHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_shapeSizes[i] : glm::vec2(0.0f);
+}
+
+TransformHandle TransformHierarchy::GetParent(TransformHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  if (i == INVALID_INDEX || m_parents[i] == INVALID_INDEX) {
+    return {};
+  }
+  uint32_t slot = m_denseToSlot[m_parents[i]];
+  return TransformHandle::Make(slot, m_slotGeneration[slot]);
+}
+
+glm::mat3 TransformHierarchy::GetWorld(TransformHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_worlds[i] : glm::mat3(1.0f);
+}
+
+glm::mat3 TransformHierarchy::GetParentWorld(TransformHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  if (i == INVALID_INDEX || m_parents[i] == INVALID_INDEX) {
+    return glm::mat3(1.0f);
+  }
+  return m_worlds[m_parents[i]];
+}
+
+ShapeHandle TransformHierarchy::GetShape(TransformHandle handle) const {
+  uint32_t i = DenseIndex(handle);
+  return i != INVALID_INDEX ? m_shapes[i] : ShapeHandle();
+}
+
+TransformHandle TransformHierarchy::FindShape(ShapeHandle shape) const {
+  auto it = m_shapeToSlot.find(shape.value);
+  if (it == m_shapeToSlot.end()) {
+    return {};
+  }
+  return TransformHandle::Make(it->second, m_slotGeneration[it->second]);
+}
+
+size_t TransformHierarchy::Update(ShapeStore &shapes) {
+  m_lastUpdateCount = 0;
+  const size_t end = std::min(m_dirtyEnd, Size());
+  for (size_t i = m_dirtyBegin; i < end;) {
+    if (m_dirty[i] == 0) {
+      ++i;
+      continue;
+    }
+    // Parents come first, so each world below reads an updated parent
+    const size_t subtreeEnd = i + m_subtreeSizes[i];
+    for (size_t j = i; j < subtreeEnd; ++j) {
+      const uint32_t parent = m_parents[j];
+      const glm::mat3 local = m_locals[j].ToMatrix();
+      m_worlds[j] = parent == INVALID_INDEX ? local : m_worlds[parent] * local;
+      m_dirty[j] = 0;
+      if (!m_shapes[j].IsValid()) {
+        continue;
+      }
+      const Transform2D world = Transform2D::FromMatrix(m_worlds[j]);
+      shapes.SetPlacement(m_shapes[j], world.translation,
+                          m_shapeSizes[j] * world.scale, world.rotation);
+    }
+    m_lastUpdateCount += subtreeEnd - i;
+    i = subtreeEnd;
+  }
+  m_dirtyBegin = m_dirtyEnd = 0;
+  return m_lastUpdateCount;
+}
+
+uint32_t TransformHierarchy::DenseIndex(TransformHandle handle) const {
+  uint32_t slot = handle.Index();
+  if (!handle.IsValid() || slot >= m_slotToDense.size() ||
+      m_slotGeneration[slot] != handle.Generation()) {
+    return INVALID_INDEX;
+  }
+  return m_slotToDense[slot];
+}
+
+void TransformHierarchy::MarkDirty(uint32_t denseIndex) {
+  m_dirty[denseIndex] = 1;
+  const size_t end = denseIndex + m_subtreeSizes[denseIndex];
+  if (m_dirtyBegin == m_dirtyEnd) {
+    m_dirtyBegin = denseIndex;
+    m_dirtyEnd = end;
+  } else {
+    m_dirtyBegin = std::min<size_t>(m_dirtyBegin, denseIndex);
+    m_dirtyEnd = std::max(m_dirtyEnd, end);
+  }
+}
+
+void TransformHierarchy::AddToSubtrees(uint32_t denseIndex, int64_t delta) {
+  for (uint32_t i = denseIndex; i != INVALID_INDEX; i = m_parents[i]) {
+    m_subtreeSizes[i] = static_cast<uint32_t>(m_subtreeSizes[i] + delta);
+  }
+}
+
+void TransformHierarchy::ReleaseSlot(uint32_t slot) {
+  m_slotToDense[slot] = INVALID_INDEX;
+  uint32_t nextGeneration =
+      (m_slotGeneration[slot] + 1) & TransformHandle::GENERATION_MASK;
+  m_slotGeneration[slot] = nextGeneration == 0 ? 1 : nextGeneration;
+  m_freeSlots.push_back(slot);
+}
+
+void TransformHierarchy::Reindex(size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    m_slotToDense[m_denseToSlot[i]] = static_cast<uint32_t>(i);
+  }
+}
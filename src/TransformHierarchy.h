@@ -0,0 +1,142 @@
+#pragma once
+
+#include "ShapeStore.h"
+#include <cstdint>
+#include <glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+// Generational handle to a transform node, laid out like ShapeHandle. A
+// value of 0 is never valid.
+struct TransformHandle {
+  static constexpr uint32_t INDEX_BITS = 20;
+  static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+  static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+  uint32_t value = 0;
+
+  [[nodiscard]] bool IsValid() const { return value != 0; }
+  [[nodiscard]] uint32_t Index() const { return value & INDEX_MASK; }
+  [[nodiscard]] uint32_t Generation() const { return value >> INDEX_BITS; }
+
+  static TransformHandle Make(uint32_t index, uint32_t generation) {
+    return TransformHandle{(generation << INDEX_BITS) | (index & INDEX_MASK)};
+  }
+
+  bool operator==(const TransformHandle &other) const {
+    return value == other.value;
+  }
+  bool operator!=(const TransformHandle &other) const {
+    return value != other.value;
+  }
+};
+
+// Local transform relative to the parent: scale, then rotate, then
+// translate. Rotation is in radians, clockwise on screen like shapes'.
+struct Transform2D {
+  glm::vec2 translation = glm::vec2(0.0f);
+  float rotation = 0.0f;
+  glm::vec2 scale = glm::vec2(1.0f);
+
+  [[nodiscard]] glm::mat3 ToMatrix() const;
+  // The inverse for matrices ToMatrix() can make. Anything else loses its
+  // skew; mirroring is dropped too, scale comes back positive.
+  [[nodiscard]] static Transform2D FromMatrix(const glm::mat3 &matrix);
+};
+
+// Parent/child transforms for grouping shapes. Nodes live in dense arrays in
+// pre-order: a parent always comes before its children and every subtree is
+// one contiguous range, so world transforms are computed in a single
+// forward pass and a changed node only recomputes its own range. Moving a
+// group of any size is one SetLocal() and one partial Update().
+//
+// A node may drive a shape: Update() writes the node's world origin,
+// rotation and scale (times the node's shape size) into the ShapeStore.
+// Shapes can't shear, so skew from non-uniform scale under rotation is
+// dropped (see Transform2D::FromMatrix). Restructuring (create, destroy,
+// reparent) moves the arrays behind the changed position and costs
+// O(nodes) at worst.
+class TransformHierarchy {
+public:
+  static constexpr uint32_t MAX_NODES = TransformHandle::INDEX_MASK;
+
+  // Appended as the parent's last child, or as the last root without one
+  TransformHandle Create(TransformHandle parent = {},
+                         const Transform2D &local = {});
+  // A node placing shape, whose size at a world scale of 1 is shapeSize.
+  // A shape is driven by at most one node; an attached shape fails.
+  TransformHandle CreateForShape(ShapeHandle shape, const glm::vec2 &shapeSize,
+                                 TransformHandle parent = {},
+                                 const Transform2D &local = {});
+  // Removes the node and its subtree. Shapes they drove keep their last
+  // placement.
+  bool Destroy(TransformHandle handle);
+  void Clear();
+  // Destroys, in one pass, every node whose shape is no longer alive in
+  // shapes, with its subtree. Returns the number of nodes removed.
+  size_t RemoveDeadShapes(const ShapeStore &shapes);
+  // Moves the node's subtree under parent (a root when invalid), keeping
+  // local transforms. Fails if parent is inside the subtree.
+  bool SetParent(TransformHandle handle, TransformHandle parent);
+
+  [[nodiscard]] bool IsAlive(TransformHandle handle) const;
+  [[nodiscard]] size_t Size() const { return m_parents.size(); }
+
+  void SetLocal(TransformHandle handle, const Transform2D &local);
+  void SetShapeSize(TransformHandle handle, const glm::vec2 &size);
+  [[nodiscard]] Transform2D GetLocal(TransformHandle handle) const;
+  [[nodiscard]] glm::vec2 GetShapeSize(TransformHandle handle) const;
+  [[nodiscard]] TransformHandle GetParent(TransformHandle handle) const;
+  // As of the last Update(); identity for dead handles
+  [[nodiscard]] glm::mat3 GetWorld(TransformHandle handle) const;
+  // World transform of the node's parent (identity for roots), the frame
+  // its local transform is in
+  [[nodiscard]] glm::mat3 GetParentWorld(TransformHandle handle) const;
+  // The shape the node drives, invalid for plain group nodes
+  [[nodiscard]] ShapeHandle GetShape(TransformHandle handle) const;
+  // The node driving shape, or an invalid handle
+  [[nodiscard]] TransformHandle FindShape(ShapeHandle shape) const;
+
+  // Recomputes the subtrees of nodes changed since the last call, in one
+  // pass over the dirty range, and places their shapes. Returns the number
+  // of nodes recomputed.
+  size_t Update(ShapeStore &shapes);
+  [[nodiscard]] size_t LastUpdateCount() const { return m_lastUpdateCount; }
+
+private:
+  static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFFu;
+
+  [[nodiscard]] uint32_t DenseIndex(TransformHandle handle) const;
+  void MarkDirty(uint32_t denseIndex);
+  // Adds delta to the subtree size of the node at denseIndex and every
+  // ancestor
+  void AddToSubtrees(uint32_t denseIndex, int64_t delta);
+  TransformHandle CreateNode(TransformHandle parent, const Transform2D &local,
+                             ShapeHandle shape, const glm::vec2 &shapeSize);
+  // Invalidates the slot's handles and makes it reusable
+  void ReleaseSlot(uint32_t slot);
+  // Points the slots of the nodes in [begin, end) at their new places
+  void Reindex(size_t begin, size_t end);
+  template <typename Function> void ForEachColumn(Function &&function);
+
+  // Dense columns, in pre-order
+  std::vector<uint32_t> m_parents; // Dense index, INVALID_INDEX for roots
+  std::vector<uint32_t> m_subtreeSizes; // Including the node itself
+  std::vector<Transform2D> m_locals;
+  std::vector<glm::mat3> m_worlds;
+  std::vector<uint8_t> m_dirty; // Local changed since the last Update()
+  std::vector<ShapeHandle> m_shapes; // Invalid for plain group nodes
+  std::vector<glm::vec2> m_shapeSizes;
+  std::vector<uint32_t> m_denseToSlot;
+
+  // Slot table, indexed by TransformHandle::Index()
+  std::vector<uint32_t> m_slotToDense;
+  std::vector<uint32_t> m_slotGeneration;
+  std::vector<uint32_t> m_freeSlots;
+  std::unordered_map<uint32_t, uint32_t> m_shapeToSlot; // ShapeHandle value
+
+  // Dense range holding every dirty node and their subtrees
+  size_t m_dirtyBegin = 0;
+  size_t m_dirtyEnd = 0;
+  size_t m_lastUpdateCount = 0;
+};
@@ -0,0 +1,396 @@
+#include "TweenSystem.h"
+#include "Lanes.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+int TweenComponentCount(TweenProperty property) {
+  switch (property) {
+  case TweenProperty::Position:
+  case TweenProperty::Size:
+    return 2;
+  case TweenProperty::Rotation:
+    return 1;
+  case TweenProperty::Color:
+    return 4;
+  }
+  return 0;
+}
+
+glm::vec4 GetTweenValue(const ShapeStore &shapes, ShapeHandle shape,
+                        TweenProperty property) {
+  switch (property) {
+  case TweenProperty::Position:
+    return glm::vec4(shapes.GetPosition(shape), 0.0f, 0.0f);
+  case TweenProperty::Size:
+    return glm::vec4(shapes.GetSize(shape), 0.0f, 0.0f);
+  case TweenProperty::Rotation:
+    return glm::vec4(shapes.GetRotation(shape), 0.0f, 0.0f, 0.0f);
+  case TweenProperty::Color:
+    return shapes.GetColor(shape);
+  }
+  return glm::vec4(0.0f);
+}
+
+bool Easing::FromName(const char *name, Easing &easing) {
+  struct Preset {
+    const char *name;
+    Easing easing;
+  };
+  static const Preset PRESETS[] = {
+      {"linear", {0.0f, 0.0f, 1.0f, 1.0f}},
+      {"easeIn", {0.42f, 0.0f, 1.0f, 1.0f}},
+      {"easeOut", {0.0f, 0.0f, 0.58f, 1.0f}},
+      {"easeInOut", {0.42f, 0.0f, 0.58f, 1.0f}},
+      {"backIn", {0.6f, -0.28f, 0.735f, 0.045f}},
+      {"backOut", {0.175f, 0.885f, 0.32f, 1.275f}},
+      {"backInOut", {0.68f, -0.55f, 0.265f, 1.55f}},
+  };
+  for (const Preset &preset : PRESETS) {
+    if (std::strcmp(preset.name, name) == 0) {
+      easing = preset.easing;
+      return true;
+    }
+  }
+  return false;
+}
+
+namespace {
+void WriteValue(ShapeStore &shapes, ShapeHandle shape, TweenProperty property,
+                const glm::vec4 &value) {
+  switch (property) {
+  case TweenProperty::Position:
+    shapes.SetPosition(shape, glm::vec2(value));
+    break;
+  case TweenProperty::Size:
+    shapes.SetSize(shape, glm::vec2(value));
+    break;
+  case TweenProperty::Rotation:
+    shapes.SetRotation(shape, value.x);
+    break;
+  case TweenProperty::Color:
+    shapes.SetColor(shape, value);
+    break;
+  }
+}
+
+// Solves x(s) = progress for the curve parameter s and returns y(s), for
+// Lanes::WIDTH tracks at once. Newton steps that leave the bracket around
+// the root, or stall on a flat tangent, fall back to bisection, so every
+// lane converges whatever its curve.
+Lanes EaseLanes(Lanes progress, Lanes x1, Lanes y1, Lanes x2, Lanes y2) {
+  constexpr int ITERATIONS = 8;
+  const Lanes one = Lanes::Set(1.0f);
+  const Lanes three = Lanes::Set(3.0f);
+
+  // Power-basis coefficients: x(s) = ((ax s + bx) s + cx) s
+  const Lanes cx = three * x1;
+  const Lanes bx = three * (x2 - x1) - cx;
+  const Lanes ax = one - cx - bx;
+  const Lanes cy = three * y1;
+  const Lanes by = three * (y2 - y1) - cy;
+  const Lanes ay = one - cy - by;
+
+  Lanes low = Lanes::Set(0.0f);
+  Lanes high = one;
+  Lanes s = progress;
+  for (int i = 0; i < ITERATIONS; ++i) {
+    const Lanes error = ((ax * s + bx) * s + cx) * s - progress;
+    const Lanes slope = (three * ax * s + Lanes::Set(2.0f) * bx) * s + cx;
+    const Lanes below = Less(error, Lanes::Set(0.0f));
+    low = Select(below, s, low);
+    high = Select(below, high, s);
+    // A zero slope makes the step infinite or NaN; both fail the bracket
+    const Lanes newton = s - error / slope;
+    const Lanes inside =
+        And(GreaterEqual(newton, low), GreaterEqual(high, newton));
+    s = Select(inside, newton, (low + high) * Lanes::Set(0.5f));
+  }
+  return ((ay * s + by) * s + cy) * s;
+}
+} // namespace
+
+uint32_t TweenSystem::Start(ShapeHandle shape, TweenProperty property,
+                            const std::vector<TweenKeyframe> &keyframes,
+                            const Easing &easing, TweenLoop loop,
+                            float delay) {
+  if (!shape.IsValid() || keyframes.size() < 2 || !std::isfinite(delay)) {
+    return 0;
+  }
+  for (size_t i = 1; i < keyframes.size(); ++i) {
+    if (!(keyframes[i].time > keyframes[i - 1].time) ||
+        !std::isfinite(keyframes[i].time)) {
+      return 0;
+    }
+  }
+  if (!std::isfinite(keyframes[0].time)) {
+    return 0;
+  }
+
+  const uint64_t target = TargetKey(shape, property);
+  auto replaced = m_targetToId.find(target);
+  if (replaced != m_targetToId.end()) {
+    Stop(replaced->second);
+  }
+
+  const uint32_t id = m_nextId++;
+  if (m_nextId == 0) {
+    m_nextId = 1;
+  }
+
+  Easing clamped = easing;
+  clamped.x1 = std::clamp(clamped.x1, 0.0f, 1.0f);
+  clamped.x2 = std::clamp(clamped.x2, 0.0f, 1.0f);
+
+  // Times are stored relative to the first keyframe
+  const float startTime = keyframes[0].time;
+  const uint32_t first = static_cast<uint32_t>(m_keyframes.size());
+  for (const TweenKeyframe &keyframe : keyframes) {
+    m_keyframes.push_back({keyframe.time - startTime, keyframe.value});
+  }
+  m_liveKeyframes += keyframes.size();
+
+  m_idToIndex[id] = static_cast<uint32_t>(m_ids.size());
+  m_targetToId[target] = id;
+  m_ids.push_back(id);
+  m_shapes.push_back(shape);
+  m_properties.push_back(property);
+  m_loops.push_back(loop);
+  m_easings.push_back(clamped);
+  m_elapsed.push_back(-std::max(delay, 0.0f));
+  m_firstKeyframes.push_back(first);
+  m_keyframeCounts.push_back(static_cast<uint32_t>(keyframes.size()));
+  return id;
+}
+
+bool TweenSystem::Stop(uint32_t id) {
+  auto found = m_idToIndex.find(id);
+  if (found == m_idToIndex.end()) {
+    return false;
+  }
+  RemoveAt(found->second);
+  CompactKeyframes();
+  return true;
+}
+
+size_t TweenSystem::StopShape(ShapeHandle shape) {
+  size_t removed = 0;
+  for (size_t i = m_ids.size(); i-- > 0;) {
+    if (m_shapes[i] == shape) {
+      RemoveAt(i);
+      ++removed;
+    }
+  }
+  CompactKeyframes();
+  return removed;
+}
+
+size_t TweenSystem::RemoveDeadShapes(const ShapeStore &shapes) {
+  size_t removed = 0;
+  for (size_t i = m_ids.size(); i-- > 0;) {
+    if (!shapes.IsAlive(m_shapes[i])) {
+      RemoveAt(i);
+      ++removed;
+    }
+  }
+  CompactKeyframes();
+  return removed;
+}
+
+void TweenSystem::Clear() {
+  m_ids.clear();
+  m_shapes.clear();
+  m_properties.clear();
+  m_loops.clear();
+  m_easings.clear();
+  m_elapsed.clear();
+  m_firstKeyframes.clear();
+  m_keyframeCounts.clear();
+  m_keyframes.clear();
+  m_liveKeyframes = 0;
+  m_idToIndex.clear();
+  m_targetToId.clear();
+}
+
+bool TweenSystem::IsActive(uint32_t id) const {
+  return m_idToIndex.count(id) != 0;
+}
+
+float TweenSystem::GetProgress(uint32_t id) const {
+  auto found = m_idToIndex.find(id);
+  if (found == m_idToIndex.end()) {
+    return -1.0f;
+  }
+  const size_t index = found->second;
+  const float elapsed = m_elapsed[index];
+  const float duration =
+      m_keyframes[m_firstKeyframes[index] + m_keyframeCounts[index] - 1].time;
+  if (elapsed <= 0.0f) {
+    return 0.0f;
+  }
+  if (m_loops[index] == TweenLoop::Once) {
+    return std::min(elapsed / duration, 1.0f);
+  }
+  return std::fmod(elapsed, duration) / duration;
+}
+
+void TweenSystem::Update(float deltaTime, ShapeStore &shapes) {
+  m_evalTracks.clear();
+  m_evalProgress.clear();
+  for (int c = 0; c < 4; ++c) {
+    m_evalCurve[c].clear();
+    m_evalFrom[c].clear();
+    m_evalTo[c].clear();
+  }
+  m_finished.clear();
+
+  // Locate each track's segment. Tracks that are delayed or done hold a
+  // keyframe and are written here; the rest go to the SIMD pass.
+  for (size_t i = 0; i < m_ids.size(); ++i) {
+    if (!shapes.IsAlive(m_shapes[i])) {
+      m_finished.push_back(m_ids[i]);
+      continue;
+    }
+    const TweenKeyframe *keys = m_keyframes.data() + m_firstKeyframes[i];
+    const uint32_t count = m_keyframeCounts[i];
+    const float duration = keys[count - 1].time;
+    const float elapsed = m_elapsed[i] + deltaTime;
+    m_elapsed[i] = elapsed;
+
+    if (elapsed < 0.0f) {
+      WriteValue(shapes, m_shapes[i], m_properties[i], keys[0].value);
+      continue;
+    }
+    float time = elapsed;
+    switch (m_loops[i]) {
+    case TweenLoop::Once:
+      if (elapsed >= duration) {
+        WriteValue(shapes, m_shapes[i], m_properties[i],
+                   keys[count - 1].value);
+        m_finished.push_back(m_ids[i]);
+        continue;
+      }
+      break;
+    case TweenLoop::Repeat:
+      time = std::fmod(elapsed, duration);
+      // Keeps elapsed small so float precision holds on long loops
+      m_elapsed[i] = time;
+      break;
+    case TweenLoop::PingPong:
+      time = std::fmod(elapsed, 2.0f * duration);
+      m_elapsed[i] = time;
+      if (time > duration) {
+        time = 2.0f * duration - time;
+      }
+      break;
+    }
+
+    // The last keyframe at or before time; count - 2 at most
+    const TweenKeyframe *next = std::upper_bound(
+        keys + 1, keys + count - 1, time,
+        [](float t, const TweenKeyframe &key) { return t < key.time; });
+    const TweenKeyframe &from = next[-1];
+    const TweenKeyframe &to = *next;
+
+    const Easing &easing = m_easings[i];
+    m_evalTracks.push_back(static_cast<uint32_t>(i));
+    m_evalProgress.push_back(
+        std::clamp((time - from.time) / (to.time - from.time), 0.0f, 1.0f));
+    m_evalCurve[0].push_back(easing.x1);
+    m_evalCurve[1].push_back(easing.y1);
+    m_evalCurve[2].push_back(easing.x2);
+    m_evalCurve[3].push_back(easing.y2);
+    for (int c = 0; c < 4; ++c) {
+      m_evalFrom[c].push_back(from.value[c]);
+      m_evalTo[c].push_back(to.value[c]);
+    }
+  }
+
+  // Pad to whole lanes with linear, zero-length tracks
+  const size_t count = m_evalTracks.size();
+  const size_t padded =
+      (count + Lanes::WIDTH - 1) / Lanes::WIDTH * Lanes::WIDTH;
+  m_evalProgress.resize(padded, 0.0f);
+  m_evalCurve[0].resize(padded, 0.0f);
+  m_evalCurve[1].resize(padded, 0.0f);
+  m_evalCurve[2].resize(padded, 1.0f);
+  m_evalCurve[3].resize(padded, 1.0f);
+  for (int c = 0; c < 4; ++c) {
+    m_evalFrom[c].resize(padded, 0.0f);
+    m_evalTo[c].resize(padded, 0.0f);
+  }
+
+  // Ease and interpolate every track at once; results replace m_evalTo
+  for (size_t i = 0; i < padded; i += Lanes::WIDTH) {
+    const Lanes eased =
+        EaseLanes(Lanes::LoadUnaligned(&m_evalProgress[i]),
+                  Lanes::LoadUnaligned(&m_evalCurve[0][i]),
+                  Lanes::LoadUnaligned(&m_evalCurve[1][i]),
+                  Lanes::LoadUnaligned(&m_evalCurve[2][i]),
+                  Lanes::LoadUnaligned(&m_evalCurve[3][i]));
+    for (int c = 0; c < 4; ++c) {
+      const Lanes from = Lanes::LoadUnaligned(&m_evalFrom[c][i]);
+      const Lanes to = Lanes::LoadUnaligned(&m_evalTo[c][i]);
+      (from + (to - from) * eased).StoreUnaligned(&m_evalTo[c][i]);
+    }
+  }
+
+  for (size_t e = 0; e < count; ++e) {
+    const uint32_t track = m_evalTracks[e];
+    const glm::vec4 value(m_evalTo[0][e], m_evalTo[1][e], m_evalTo[2][e],
+                          m_evalTo[3][e]);
+    WriteValue(shapes, m_shapes[track], m_properties[track], value);
+  }
+
+  // Removing by id: swap-removal reorders the columns
+  for (uint32_t id : m_finished) {
+    RemoveAt(m_idToIndex[id]);
+  }
+  if (!m_finished.empty()) {
+    CompactKeyframes();
+  }
+}
+
+void TweenSystem::RemoveAt(size_t index) {
+  m_idToIndex.erase(m_ids[index]);
+  m_targetToId.erase(TargetKey(m_shapes[index], m_properties[index]));
+  m_liveKeyframes -= m_keyframeCounts[index];
+
+  const size_t last = m_ids.size() - 1;
+  if (index != last) {
+    m_ids[index] = m_ids[last];
+    m_shapes[index] = m_shapes[last];
+    m_properties[index] = m_properties[last];
+    m_loops[index] = m_loops[last];
+    m_easings[index] = m_easings[last];
+    m_elapsed[index] = m_elapsed[last];
+    m_firstKeyframes[index] = m_firstKeyframes[last];
+    m_keyframeCounts[index] = m_keyframeCounts[last];
+    m_idToIndex[m_ids[index]] = static_cast<uint32_t>(index);
+  }
+  m_ids.pop_back();
+  m_shapes.pop_back();
+  m_properties.pop_back();
+  m_loops.pop_back();
+  m_easings.pop_back();
+  m_elapsed.pop_back();
+  m_firstKeyframes.pop_back();
+  m_keyframeCounts.pop_back();
+}
+
+void TweenSystem::CompactKeyframes() {
+  constexpr size_t MIN_GARBAGE = 256;
+  const size_t garbage = m_keyframes.size() - m_liveKeyframes;
+  if (garbage < MIN_GARBAGE || garbage < m_liveKeyframes) {
+    return;
+  }
+  std::vector<TweenKeyframe> compacted;
+  compacted.reserve(m_liveKeyframes);
+  for (size_t i = 0; i < m_ids.size(); ++i) {
+    const uint32_t first = m_firstKeyframes[i];
+    m_firstKeyframes[i] = static_cast<uint32_t>(compacted.size());
+    compacted.insert(compacted.end(), m_keyframes.begin() + first,
+                     m_keyframes.begin() + first + m_keyframeCounts[i]);
+  }
+  m_keyframes.swap(compacted);
+}
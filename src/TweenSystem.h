@@ -0,0 +1,115 @@
+#pragma once
+
+#include "ShapeStore.h"
+#include <cstdint>
+#include <glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+// Shape columns a tween can drive, with 2, 2, 1 and 4 components
+enum class TweenProperty : uint8_t { Position, Size, Rotation, Color };
+
+[[nodiscard]] int TweenComponentCount(TweenProperty property);
+// The property's current value, in the leading components
+[[nodiscard]] glm::vec4 GetTweenValue(const ShapeStore &shapes,
+                                      ShapeHandle shape,
+                                      TweenProperty property);
+
+// Cubic Bezier from (0, 0) to (1, 1), like a CSS timing function: x1 and x2
+// must lie in [0, 1], y1 and y2 may overshoot
+struct Easing {
+  float x1 = 0.0f;
+  float y1 = 0.0f;
+  float x2 = 1.0f;
+  float y2 = 1.0f;
+
+  // linear, easeIn, easeOut, easeInOut, backIn, backOut, backInOut; false
+  // for anything else
+  static bool FromName(const char *name, Easing &easing);
+};
+
+enum class TweenLoop : uint8_t {
+  Once,    // Holds the last keyframe, then the tween ends
+  Repeat,  // Jumps back to the first keyframe
+  PingPong // Runs back and forth
+};
+
+// Time in seconds, counted from the first keyframe, and the property's
+// value there (unused components are ignored)
+struct TweenKeyframe {
+  float time = 0.0f;
+  glm::vec4 value = glm::vec4(0.0f);
+};
+
+// Shape animation without a script round trip per property per frame.
+// Tweens are tracks of keyframes on one shape property; every segment is
+// eased by the track's curve. Tracks live in flat arrays and their
+// keyframes in one shared pool. Update() locates each track's segment, then
+// eases and interpolates every active track in one SIMD pass, and writes
+// the results straight into the ShapeStore.
+//
+// One tween per shape property: starting another replaces it. Shapes
+// attached to a group are placed by the TransformHierarchy, which
+// overwrites an animated position, size or rotation whenever the group
+// moves.
+class TweenSystem {
+public:
+  // Ids are never 0. Needs at least two keyframes with increasing times.
+  // The property holds the first keyframe during the delay. Returns 0 on
+  // bad input; tweens on dead shapes end at the next Update().
+  uint32_t Start(ShapeHandle shape, TweenProperty property,
+                 const std::vector<TweenKeyframe> &keyframes,
+                 const Easing &easing, TweenLoop loop = TweenLoop::Once,
+                 float delay = 0.0f);
+  // The property keeps its current value
+  bool Stop(uint32_t id);
+  size_t StopShape(ShapeHandle shape);
+  // Drops the tweens of shapes no longer alive in shapes
+  size_t RemoveDeadShapes(const ShapeStore &shapes);
+  void Clear();
+
+  [[nodiscard]] bool IsActive(uint32_t id) const;
+  // Share of a single run completed, 0 to 1; -1 for unknown ids
+  [[nodiscard]] float GetProgress(uint32_t id) const;
+  [[nodiscard]] size_t ActiveCount() const { return m_ids.size(); }
+
+  // Advances every tween by deltaTime seconds and writes the values.
+  // Tweens that ran out write their last keyframe, then end.
+  void Update(float deltaTime, ShapeStore &shapes);
+
+private:
+  [[nodiscard]] static uint64_t TargetKey(ShapeHandle shape,
+                                          TweenProperty property) {
+    return (static_cast<uint64_t>(shape.value) << 8) |
+           static_cast<uint64_t>(property);
+  }
+  void RemoveAt(size_t index);
+  // Drops keyframes no track points at once they outnumber the live ones
+  void CompactKeyframes();
+
+  // Per-track columns, index-aligned
+  std::vector<uint32_t> m_ids;
+  std::vector<ShapeHandle> m_shapes;
+  std::vector<TweenProperty> m_properties;
+  std::vector<TweenLoop> m_loops;
+  std::vector<Easing> m_easings;
+  std::vector<float> m_elapsed; // Negative while delayed
+  std::vector<uint32_t> m_firstKeyframes;
+  std::vector<uint32_t> m_keyframeCounts;
+
+  // Keyframe pool, shared by every track
+  std::vector<TweenKeyframe> m_keyframes;
+  size_t m_liveKeyframes = 0;
+
+  std::unordered_map<uint32_t, uint32_t> m_idToIndex;
+  std::unordered_map<uint64_t, uint32_t> m_targetToId;
+  uint32_t m_nextId = 1;
+
+  // Update() scratch, one entry per evaluated track, SoA for the SIMD pass
+  std::vector<uint32_t> m_evalTracks;
+  std::vector<float> m_evalProgress;
+  std::vector<float> m_evalCurve[4]; // Easing x1, y1, x2, y2
+  std::vector<float> m_evalFrom[4];  // Segment start, per component
+  std::vector<float> m_evalTo[4];    // Segment end, then the result
+  std::vector<uint32_t> m_finished;
+};
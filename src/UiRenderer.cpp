@@ -0,0 +1,309 @@
+#include "UiRenderer.h"
+#include "GLState.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <gtc/matrix_transform.hpp>
+#include <iostream>
+
+namespace {
+const char *s_uiVertexShaderSource = R"(
+    #version 410 core
+    layout (location = 0) in vec2 aPos;
+    layout (location = 1) in vec2 aUV;
+    layout (location = 2) in vec4 aColor;
+
+    uniform mat4 u_uiProjection;
+
+    out vec2 vUV;
+    out vec4 vColor;
+
+    void main() {
+        vUV = aUV;
+        vColor = aColor;
+        gl_Position = u_uiProjection * vec4(aPos, 0.0, 1.0);
+    }
+)";
+
+const char *s_uiFragmentShaderSource = R"(
+    #version 410 core
+    in vec2 vUV;
+    in vec4 vColor;
+
+    uniform sampler2D u_texture;
+
+    out vec4 FragColor;
+
+    void main() {
+        FragColor = vColor * texture(u_texture, vUV);
+    }
+)";
+
+// Copies without giving up dst's allocation (ImVector::operator= frees it)
+template <typename T> void CopyInto(ImVector<T> &dst, const ImVector<T> &src) {
+  dst.resize(src.Size);
+  if (src.Size > 0) {
+    std::memcpy(dst.Data, src.Data, static_cast<size_t>(src.Size) * sizeof(T));
+  }
+}
+
+// Grows to at least `required` bytes; otherwise orphans the old storage so
+// the driver never waits on last frame's draws
+void Respecify(GLenum target, GLsizeiptr &capacity, GLsizeiptr required) {
+  if (required > capacity) {
+    GLsizeiptr grown = capacity > 0 ? capacity : 4096;
+    while (grown < required) {
+      grown *= 2;
+    }
+    capacity = grown;
+  }
+  glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+}
+} // namespace
+
+DrawDataSnapshot::~DrawDataSnapshot() {
+  for (ImDrawList *drawList : m_lists) {
+    IM_DELETE(drawList);
+  }
+}
+
+void DrawDataSnapshot::Capture(const ImDrawData *source) {
+  m_drawData.Clear();
+  if (source == nullptr || !source->Valid) {
+    return;
+  }
+
+  while (m_lists.Size < source->CmdListsCount) {
+    m_lists.push_back(IM_NEW(ImDrawList)(nullptr)); // Never drawn into
+  }
+  for (int i = 0; i < source->CmdListsCount; ++i) {
+    const ImDrawList *src = source->CmdLists[i];
+    ImDrawList *dst = m_lists[i];
+    CopyInto(dst->CmdBuffer, src->CmdBuffer);
+    CopyInto(dst->IdxBuffer, src->IdxBuffer);
+    CopyInto(dst->VtxBuffer, src->VtxBuffer);
+    dst->Flags = src->Flags;
+
+    // Callback data stored by value lives in the list; repoint it at the copy
+    CopyInto(dst->_CallbacksDataBuf, src->_CallbacksDataBuf);
+    for (ImDrawCmd &cmd : dst->CmdBuffer) {
+      if (cmd.UserCallback != nullptr && cmd.UserCallbackDataSize > 0 &&
+          cmd.UserCallbackDataOffset >= 0) {
+        cmd.UserCallbackData =
+            dst->_CallbacksDataBuf.Data + cmd.UserCallbackDataOffset;
+      }
+    }
+    m_drawData.CmdLists.push_back(dst);
+  }
+
+  m_drawData.Valid = true;
+  m_drawData.CmdListsCount = source->CmdListsCount;
+  m_drawData.TotalIdxCount = source->TotalIdxCount;
+  m_drawData.TotalVtxCount = source->TotalVtxCount;
+  m_drawData.DisplayPos = source->DisplayPos;
+  m_drawData.DisplaySize = source->DisplaySize;
+  m_drawData.FramebufferScale = source->FramebufferScale;
+}
+
+UiRenderer::~UiRenderer() { Cleanup(); }
+
+bool UiRenderer::Initialize(ResourceManager *resources) {
+  m_shader = resources->AcquireProgram(s_uiVertexShaderSource,
+                                       s_uiFragmentShaderSource);
+  if (!m_shader) {
+    std::cerr << "UiRenderer::Initialize: failed to build the UI shader\n";
+    return false;
+  }
+  m_projectionUniform = m_shader->GetUniform<glm::mat4>("u_uiProjection");
+  m_textureUniform = m_shader->GetUniform<int>("u_texture");
+
+  glGenVertexArrays(1, &m_VAO);
+  glGenBuffers(1, &m_VBO);
+  glGenBuffers(1, &m_EBO);
+
+  // Every draw list lands in the same buffers (draws use a base vertex), so
+  // the attribute layout never changes and is set up once
+  GLState::BindVertexArray(m_VAO);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert),
+                        (void *)offsetof(ImDrawVert, pos));
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert),
+                        (void *)offsetof(ImDrawVert, uv));
+  glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert),
+                        (void *)offsetof(ImDrawVert, col));
+  GLState::BindVertexArray(0);
+
+  if (!CreateFontTexture()) {
+    return false;
+  }
+
+  ImGuiIO &io = ImGui::GetIO();
+  io.BackendRendererName = "UiRenderer";
+  // Base-vertex draws allow 64K+ vertex meshes with 16-bit indices
+  io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+  return m_VAO != 0 && m_VBO != 0 && m_EBO != 0;
+}
+
+bool UiRenderer::CreateFontTexture() {
+  ImGuiIO &io = ImGui::GetIO();
+  unsigned char *pixels = nullptr;
+  int width = 0;
+  int height = 0;
+  io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+  if (pixels == nullptr) {
+    std::cerr << "UiRenderer: font atlas has no pixel data\n";
+    return false;
+  }
+
+  glGenTextures(1, &m_fontTexture);
+  GLState::ActiveTexture(GL_TEXTURE0);
+  GLState::BindTexture(GL_TEXTURE_2D, m_fontTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, pixels);
+
+  io.Fonts->SetTexID(static_cast<ImTextureID>(m_fontTexture));
+  return m_fontTexture != 0;
+}
+
+void UiRenderer::Cleanup() {
+  if (m_fontTexture != 0) {
+    GLState::DeleteTexture(m_fontTexture);
+    m_fontTexture = 0;
+    if (ImGui::GetCurrentContext() != nullptr) {
+      ImGuiIO &io = ImGui::GetIO();
+      io.Fonts->SetTexID(0);
+      io.BackendRendererName = nullptr;
+      io.BackendFlags &= ~ImGuiBackendFlags_RendererHasVtxOffset;
+    }
+  }
+  GLState::DeleteVertexArray(m_VAO);
+  GLState::DeleteBuffer(m_VBO);
+  GLState::DeleteBuffer(m_EBO);
+  m_VAO = m_VBO = m_EBO = 0;
+  m_vertexCapacity = m_indexCapacity = 0;
+  m_shader.Reset();
+}
+
+// Alpha blending, no culling/depth/stencil, scissor on. Whatever of this the
+// previous pass already set is filtered out by GLState.
+void UiRenderer::SetupRenderState(ImDrawData *drawData, int fbWidth,
+                                  int fbHeight) {
+  GLState::SetEnabled(GL_BLEND, true);
+  GLState::BlendEquation(GL_FUNC_ADD);
+  GLState::BlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
+                             GL_ONE_MINUS_SRC_ALPHA);
+  GLState::SetEnabled(GL_CULL_FACE, false);
+  GLState::SetEnabled(GL_DEPTH_TEST, false);
+  GLState::SetEnabled(GL_STENCIL_TEST, false);
+  GLState::SetEnabled(GL_PRIMITIVE_RESTART, false);
+  GLState::SetEnabled(GL_SCISSOR_TEST, true);
+  GLState::Viewport(0, 0, fbWidth, fbHeight);
+
+  float L = drawData->DisplayPos.x;
+  float R = drawData->DisplayPos.x + drawData->DisplaySize.x;
+  float T = drawData->DisplayPos.y;
+  float B = drawData->DisplayPos.y + drawData->DisplaySize.y;
+
+  m_shader->Use();
+  m_shader->Set(m_projectionUniform, glm::ortho(L, R, B, T, -1.0f, 1.0f));
+  m_shader->Set(m_textureUniform, 0);
+  GLState::ActiveTexture(GL_TEXTURE0);
+  GLState::BindVertexArray(m_VAO);
+  GLState::BindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+}
+
+// Expects the VAO and both buffers to be bound
+void UiRenderer::Upload(ImDrawData *drawData) {
+  const auto vertexBytes =
+      static_cast<GLsizeiptr>(drawData->TotalVtxCount * sizeof(ImDrawVert));
+  const auto indexBytes =
+      static_cast<GLsizeiptr>(drawData->TotalIdxCount * sizeof(ImDrawIdx));
+  Respecify(GL_ARRAY_BUFFER, m_vertexCapacity, vertexBytes);
+  Respecify(GL_ELEMENT_ARRAY_BUFFER, m_indexCapacity, indexBytes);
+
+  GLintptr vertexOffset = 0;
+  GLintptr indexOffset = 0;
+  for (const ImDrawList *drawList : drawData->CmdLists) {
+    const auto listVertexBytes = static_cast<GLsizeiptr>(
+        drawList->VtxBuffer.Size * sizeof(ImDrawVert));
+    const auto listIndexBytes = static_cast<GLsizeiptr>(
+        drawList->IdxBuffer.Size * sizeof(ImDrawIdx));
+    glBufferSubData(GL_ARRAY_BUFFER, vertexOffset, listVertexBytes,
+                    drawList->VtxBuffer.Data);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset, listIndexBytes,
+                    drawList->IdxBuffer.Data);
+    vertexOffset += listVertexBytes;
+    indexOffset += listIndexBytes;
+  }
+}
+
+void UiRenderer::Render(ImDrawData *drawData) {
+  if (drawData == nullptr || !m_shader) {
+    return;
+  }
+  // Framebuffer size in pixels; differs from DisplaySize on retina displays
+  int fbWidth =
+      static_cast<int>(drawData->DisplaySize.x * drawData->FramebufferScale.x);
+  int fbHeight =
+      static_cast<int>(drawData->DisplaySize.y * drawData->FramebufferScale.y);
+  if (fbWidth <= 0 || fbHeight <= 0 || drawData->TotalVtxCount == 0) {
+    return;
+  }
+
+  SetupRenderState(drawData, fbWidth, fbHeight);
+  Upload(drawData);
+
+  const ImVec2 clipOffset = drawData->DisplayPos;
+  const ImVec2 clipScale = drawData->FramebufferScale;
+  const GLenum indexType =
+      sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+  GLint listBaseVertex = 0;
+  size_t listFirstIndex = 0;
+  for (const ImDrawList *drawList : drawData->CmdLists) {
+    for (const ImDrawCmd &cmd : drawList->CmdBuffer) {
+      if (cmd.UserCallback != nullptr) {
+        // Callbacks must use GLState (or call GLState::Invalidate)
+        if (cmd.UserCallback == ImDrawCallback_ResetRenderState) {
+          SetupRenderState(drawData, fbWidth, fbHeight);
+        } else {
+          cmd.UserCallback(drawList, &cmd);
+        }
+        continue;
+      }
+
+      // Project the clip rectangle into framebuffer space
+      ImVec2 clipMin((cmd.ClipRect.x - clipOffset.x) * clipScale.x,
+                     (cmd.ClipRect.y - clipOffset.y) * clipScale.y);
+      ImVec2 clipMax((cmd.ClipRect.z - clipOffset.x) * clipScale.x,
+                     (cmd.ClipRect.w - clipOffset.y) * clipScale.y);
+      if (clipMax.x <= clipMin.x || clipMax.y <= clipMin.y) {
+        continue;
+      }
+
+      // GL's scissor origin is bottom-left
+      GLState::Scissor(static_cast<GLint>(clipMin.x),
+                       static_cast<GLint>(fbHeight - clipMax.y),
+                       static_cast<GLsizei>(clipMax.x - clipMin.x),
+                       static_cast<GLsizei>(clipMax.y - clipMin.y));
+      GLState::BindTexture(GL_TEXTURE_2D,
+                           static_cast<GLuint>(cmd.GetTexID()));
+      glDrawElementsBaseVertex(
+          GL_TRIANGLES, static_cast<GLsizei>(cmd.ElemCount), indexType,
+          (void *)((listFirstIndex + cmd.IdxOffset) * sizeof(ImDrawIdx)),
+          listBaseVertex + static_cast<GLint>(cmd.VtxOffset));
+    }
+    listBaseVertex += drawList->VtxBuffer.Size;
+    listFirstIndex += static_cast<size_t>(drawList->IdxBuffer.Size);
+  }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ResourceManager.h"
+#include "Shader.h"
+#include <glad/glad.h>
+#include <imgui.h>
+
+// Deep copy of ImDrawData. ImGui rewrites its draw lists on the next
+// NewFrame(), so a frame drawn on another thread is drawn from a snapshot.
+// The copied lists are kept between captures, so in steady state capturing
+// is a handful of memcpys and no allocations.
+class DrawDataSnapshot {
+public:
+  DrawDataSnapshot() = default;
+  ~DrawDataSnapshot();
+  DrawDataSnapshot(const DrawDataSnapshot &) = delete;
+  DrawDataSnapshot &operator=(const DrawDataSnapshot &) = delete;
+
+  void Capture(const ImDrawData *source);
+  // Null if the captured data wasn't valid
+  [[nodiscard]] ImDrawData *Get() {
+    return m_drawData.Valid ? &m_drawData : nullptr;
+  }
+
+private:
+  ImDrawData m_drawData;
+  ImVector<ImDrawList *> m_lists; // Owned; reused across captures
+};
+
+// Renders ImGui draw data; replaces imgui_impl_opengl3 as the renderer
+// backend. All state changes go through GLState, so instead of backing up
+// and restoring the whole context around the UI (as the stock backend does
+// every frame) it only issues the binds that differ from what the scene
+// pass left behind. The shader comes from the ResourceManager like every
+// other program, and the vertex/index buffers and VAO live across frames.
+class UiRenderer {
+public:
+  UiRenderer() = default;
+  ~UiRenderer();
+
+  // Needs a current GL context and an ImGui context
+  bool Initialize(ResourceManager *resources);
+  void Render(ImDrawData *drawData);
+  void Cleanup();
+
+private:
+  bool CreateFontTexture();
+  void SetupRenderState(ImDrawData *drawData, int fbWidth, int fbHeight);
+  // Copies every draw list into the shared vertex/index buffers
+  void Upload(ImDrawData *drawData);
+
+  ProgramRef m_shader;
+  UniformHandle<glm::mat4> m_projectionUniform;
+  UniformHandle<int> m_textureUniform;
+
+  GLuint m_VAO = 0;
+  GLuint m_VBO = 0;
+  GLuint m_EBO = 0;
+  GLuint m_fontTexture = 0;
+  GLsizeiptr m_vertexCapacity = 0; // Bytes
+  GLsizeiptr m_indexCapacity = 0;  // Bytes
+};
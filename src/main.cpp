@@ -1,8 +1,46 @@
 #include "Application.h"
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
-int main() {
-  Application app;
+namespace {
+void PrintUsage(const char *program) {
+  std::cerr << "Usage: " << program
+            << " [--headless] [--frames N] [--script PATH] [--serial]"
+               " [--software]\n"
+            << "  --headless     Render offscreen without a display "
+               "(EGL or OSMesa)\n"
+            << "  --frames N     Exit after N frames and print timings\n"
+            << "  --script PATH  Lua GUI script (default: gui.lua)\n"
+            << "  --serial       Submit frames on the main thread\n"
+            << "  --software     Rasterize on the CPU; GL only presents\n";
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  ApplicationOptions options;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--headless") == 0) {
+      options.headless = true;
+    } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      options.frameLimit = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+      options.scriptPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--serial") == 0) {
+      options.threadedRendering = false;
+    } else if (std::strcmp(argv[i], "--software") == 0) {
+      options.softwareRendering = true;
+    } else {
+      PrintUsage(argv[0]);
+      return -1;
+    }
+  }
+  if (options.headless && options.frameLimit <= 0) {
+    std::cerr << "--headless needs --frames, nothing could close it\n";
+    return -1;
+  }
+
+  Application app(options);
 
   if (!app.Initialize()) {
     std::cerr << "Failed to initialize application\n";
@@ -11,4 +49,4 @@ int main() {
 
   app.Run();
   return 0;
-}
\ No newline at end of file
+}